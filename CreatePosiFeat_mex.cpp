@@ -12,6 +12,8 @@
  *		Date			Description of change
  *	   ======			=====================
  *	   10/08/14			Original code
+ *	   10/18/26			Loop moved to CreatePosiFeat() for the native
+ *						pipeline (Drowsiness_C), built with -DNO_MEXFUNCTION
  *
  * Define variables:
  *      coord       -- <n x 2> matrix, stores desired pixel's coordinates
@@ -26,14 +28,18 @@
  * Author: Quang Nguyen
  ******************************************************************************/
 
+#ifndef NO_MEXFUNCTION
 #include <mex.h>
 #include <matrix.h>
+#endif
 #include <stdio.h>
 #include <math.h>
 
 double GetMax(double *array, int size);
 double GetMin(double *array, int size);
+void CreatePosiFeat(double *img, double *coord, int coord_dimy, double *featPa, int featPa_dimy, double *featMat);
 
+#ifndef NO_MEXFUNCTION
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
 // Declare variables
@@ -44,7 +50,6 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	int img_dimy,	 img_dimx;		// dims of img
 	int coord_dimy,  coord_dimx;	// dims of coord
 	int featPa_dimy, featPa_dimx;	// dims of given feature
-	int i, j;						// for iteration
 
 // Dimension of the given img
 	dims = mxGetDimensions(prhs[0]);	img_dimy = (int)dims[0];	img_dimx = (int)dims[1];
@@ -69,6 +74,16 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	coord = mxGetPr(coord_m);
     featPa = mxGetPr(featPa_m);
 
+	CreatePosiFeat(img, coord, coord_dimy, featPa, featPa_dimy, featMat);
+}
+#endif
+
+/*
+ * featMat (coord_dimy x featPa_dimy) of the 128x128 img, see above
+ */
+void CreatePosiFeat(double *img, double *coord, int coord_dimy, double *featPa, int featPa_dimy, double *featMat)
+{
+	int i, j;						// for iteration
 	double a, b;
 	double x, y;
     double down = GetMin(coord, coord_dimy); // collect max and min values in ONE COLUMN
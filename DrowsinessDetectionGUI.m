@@ -146,7 +146,7 @@ t = timer('TimerFcn', {@DetectDrowsiness, checkbox, popup}, ...
 
     % Declare variables
     persistent framelim Wd warn_win indx lastval lastthresh laststate lastdrowsy
-    persistent aa aa2 aa3 pos
+    persistent aa aa2 aa3 intImg pos
     persistent posiFeat haarFeat 
     persistent classlabel
     persistent RE RE_cen REreg LE LE_cen LEreg
@@ -212,9 +212,16 @@ t = timer('TimerFcn', {@DetectDrowsiness, checkbox, popup}, ...
             coord2 = floor(coord/128*width);
             coord2(:,1) = coord2(:,1) + y; coord2(:,2) = coord2(:,2) + x;
             
-            aa3 = histeq(imresize(imcrop(aa2,[x,y,width,width]),[128 128]));
+            % crop, resize, equalise and integrate the face in one pass
+            % (NormFace_mex), or as before if it has not been compiled
+            if exist('NormFace_mex') == 3
+                [aa3, intImg] = NormFace_mex(aa2, [x,y,width,width]);
+            else
+                aa3 = histeq(imresize(imcrop(aa2,[x,y,width,width]),[128 128]));
+                intImg = IntImg(double(aa3));
+            end
             posiFeat = CreatePosiFeat_mex(double(aa3), coord, AB);
-            haarFeat = CreateHaarFeat_mex(IntImg(double(aa3)), coord, haarPara);
+            haarFeat = CreateHaarFeat_mex(intImg, coord, haarPara);
             
             classlabel = classRF_predict([posiFeat haarFeat],modelRF) + 1;
             
@@ -0,0 +1,73 @@
+%**************************************************************
+%* Writes the models of DrowsinessDetectionGUI for the native runtime
+%
+% Run from the repository root or from Drowsiness_C. The face detector
+% (fdtool model_hmblbp_R4 with the settings of the GUI), coord2, AB,
+% haarPara and modelRF are written as double arrays to one binary file:
+%   'DROWSYM1', then per array: int32 name length, name, int32 rows,
+%   int32 cols, rows*cols doubles (column-major)
+% modelRF is trimmed to its largest tree: the padding to nrnodes is dropped.
+%**************************************************************
+%function export_models(filename)
+% filename: output file, models.bin by default
+
+function export_models(filename)
+
+    if nargin<1
+        filename = 'models.bin';
+    end
+    root = fileparts(fileparts(mfilename('fullpath')));
+
+    load(fullfile(root,'fdtool_release','fdtool_release','model_hmblbp_R4.mat'));
+    model.postprocessing = 2;   % as in DrowsinessDetectionGUI
+    load(fullfile(root,'coord2.mat'));
+    load(fullfile(root,'AB.mat'));
+    load(fullfile(root,'haarPara.mat'));
+    load(fullfile(root,'modelRF.mat'));
+
+    fid = fopen(filename,'w');
+    if fid<0
+        error('cannot write %s',filename);
+    end
+    fwrite(fid,'DROWSYM1','char');
+
+    fields = fieldnames(model);
+    for i=1:length(fields)
+        writeArray(fid,['face.' fields{i}],model.(fields{i}));
+    end
+    writeArray(fid,'min_detect',2);
+    writeArray(fid,'coord',coord2);
+    writeArray(fid,'AB',AB);
+    writeArray(fid,'haarPara',haarPara);
+
+    % size of every tree from nodestatus (ndbigtree is not reliable)
+    ntree = double(modelRF.ntree);
+    treeSize = zeros(1,ntree);
+    for t=1:ntree
+        treeSize(t) = find(modelRF.nodestatus(:,t)~=0,1,'last');
+    end
+    n = max(treeSize);
+    nrnodes = double(modelRF.nrnodes);
+    treemap = reshape(modelRF.treemap,2*nrnodes,ntree);
+
+    writeArray(fid,'rf.nrnodes',n);
+    writeArray(fid,'rf.ntree',ntree);
+    writeArray(fid,'rf.nclass',modelRF.nclass);
+    writeArray(fid,'rf.mdim',size(modelRF.importance,1));
+    writeArray(fid,'rf.ndbigtree',treeSize);
+    writeArray(fid,'rf.treemap',treemap(1:2*n,:));
+    writeArray(fid,'rf.nodestatus',modelRF.nodestatus(1:n,:));
+    writeArray(fid,'rf.bestvar',modelRF.bestvar(1:n,:));
+    writeArray(fid,'rf.nodeclass',modelRF.nodeclass(1:n,:));
+    writeArray(fid,'rf.xbestsplit',modelRF.xbestsplit(1:n,:));
+    writeArray(fid,'rf.cutoff',modelRF.cutoff);
+    writeArray(fid,'rf.orig_labels',modelRF.orig_labels);
+    fclose(fid);
+end
+
+function writeArray(fid,name,A)
+    fwrite(fid,length(name),'int32');
+    fwrite(fid,name,'char');
+    fwrite(fid,size(A),'int32');
+    fwrite(fid,double(A),'double');
+end
@@ -0,0 +1,224 @@
+/**************************************************************
+ * Offline batch analysis of a recorded video
+ *
+ * See batch.h. One mutex and one condition variable guard the states
+ * of all the slots: they change once per frame and stage, which is
+ * rare next to the detection of a frame.
+ *************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "trace.h"
+
+enum { SLOT_FREE, SLOT_READ, SLOT_DONE };
+
+drowsyBatch::drowsyBatch(const drowsyModels *models_, frameSource *src_, int nworkers, int depth)
+        : models(models_), src(src_), nread(0), eof(false), nframes(0), warnings(0),
+          readerBlocked(0), reduceBusy(0), tStart(0), tEnd(0) {
+    size_t size = (size_t) src->Ny * src->Nx;
+    int i;
+
+    if (nworkers <= 0) nworkers = (int) std::thread::hardware_concurrency();
+    if (nworkers <= 0) nworkers = 1;
+    if (depth <= 0) depth = 4 * nworkers;
+    if (depth < nworkers) depth = nworkers;
+    workers.resize(nworkers);
+    for (i = 0; i < nworkers; i++) {
+        workers[i].frames = 0;
+        workers[i].busy = 0;
+    }
+    slots.resize(depth);
+    pixels = (unsigned char *) malloc(size * depth);
+    for (i = 0; i < depth; i++) {
+        slots[i].frame = -1;
+        slots[i].state = SLOT_FREE;
+        slots[i].gray = pixels + size * i;
+        slots[i].nfaces = 0;
+    }
+    next.store(0);
+    drowsyInitState(&state);
+}
+
+drowsyBatch::~drowsyBatch() {
+    free(pixels);
+}
+
+void drowsyBatch::readerLoop() {
+    long long f;
+    batchSlot *s;
+    double t0;
+
+    traceThreadName("reader");
+    for (f = 0;; f++) {
+        s = &slots[f % slots.size()];
+        {
+            std::unique_lock<std::mutex> g(lock);
+            t0 = pipelineNow();
+            changed.wait(g, [s] { return s->state == SLOT_FREE; });
+            readerBlocked += pipelineNow() - t0;
+        }
+        traceSetFrame(0, f);
+        if (!src->read(s->gray)) break;
+        std::lock_guard<std::mutex> g(lock);
+        s->frame = f;
+        s->state = SLOT_READ;
+        nread = f + 1;
+        changed.notify_all();
+    }
+    std::lock_guard<std::mutex> g(lock);
+    eof = true;
+    changed.notify_all();
+}
+
+void drowsyBatch::workerLoop(int w) {
+    batchWorker *me = &workers[w];
+    drowsyWork work;
+    batchSlot *s;
+    long long f;
+    double t0;
+    int i;
+    char name[32];
+
+    snprintf(name, sizeof(name), "worker %d", w);
+    traceThreadName(name);
+    drowsyNewWork(models, &work);
+    for (;;) {
+        f = next.fetch_add(1);
+        s = &slots[f % slots.size()];
+        {
+            std::unique_lock<std::mutex> g(lock);
+            changed.wait(g, [&] {
+                return (s->state == SLOT_READ && s->frame == f) || (eof && f >= nread);
+            });
+            if (s->state != SLOT_READ || s->frame != f) break;
+        }
+
+        t0 = pipelineNow();
+        traceSetFrame(0, f);
+        s->nfaces = drowsyDetect(models, s->gray, src->Ny, src->Nx, s->faces);
+        for (i = 0; i < s->nfaces; i++)
+            drowsyAnalyseFace(models, s->gray, src->Ny, src->Nx, &work, s->faces + i);
+        me->frames++;
+        me->busy += pipelineNow() - t0;
+
+        std::lock_guard<std::mutex> g(lock);
+        s->state = SLOT_DONE;
+        changed.notify_all();
+    }
+    drowsyFreeWork(&work);
+}
+
+/* drowsyUpdate of the frame of s, in frame order */
+void drowsyBatch::reduce(batchSlot *s, FILE *csv, FILE *bin) {
+    const drowsyFace *face = NULL;
+    drowsyResult r;
+    batchRecord rec;
+    int i;
+
+    traceSetFrame(0, s->frame);
+    drowsyUpdate(&state, s->faces, s->nfaces, &r);
+    for (i = 0; i < s->nfaces; i++)
+        if (!isnan(s->faces[i].value)) face = s->faces + i;
+
+    nframes++;
+    warnings += r.warning;
+    if (r.warning) {
+        if (ev.empty() || ev.back().last != s->frame - 1) {
+            batchEvent e = {s->frame, s->frame, r.level};
+            ev.push_back(e);
+        } else {
+            ev.back().last = s->frame;
+            if (r.level > ev.back().peak) ev.back().peak = r.level;
+        }
+    }
+
+    if (csv) {
+        fprintf(csv, "%lld,%d,%d,%g,%g,%d,%g,%d", s->frame, r.nfaces, r.analysed, r.value,
+                r.thresh, r.closed, r.level, r.warning);
+        if (face)
+            fprintf(csv, ",%g,%g,%g\n", face->det[0], face->det[1], face->det[2]);
+        else
+            fprintf(csv, ",,,\n");
+    }
+    if (bin) {
+        rec.frame    = (int) s->frame;
+        rec.faces    = (unsigned char) r.nfaces;
+        rec.analysed = (unsigned char) r.analysed;
+        rec.closed   = (unsigned char) r.closed;
+        rec.warning  = (unsigned char) r.warning;
+        rec.value    = (float) r.value;
+        rec.thresh   = (float) r.thresh;
+        rec.level    = (float) r.level;
+        rec.x        = face ? (float) face->det[0] : NAN;
+        rec.y        = face ? (float) face->det[1] : NAN;
+        rec.size     = face ? (float) face->det[2] : NAN;
+        fwrite(&rec, sizeof(rec), 1, bin);
+    }
+}
+
+void drowsyBatch::run(FILE *csv, FILE *bin) {
+    std::vector<std::thread> threads;
+    batchSlot *s;
+    long long f;
+    double t0;
+    int w, width = src->Nx, height = src->Ny;
+    size_t k;
+
+    if (csv) fprintf(csv, "frame,faces,analysed,value,thresh,closed,level,warning,x,y,size\n");
+    if (bin) {
+        fwrite("DROWSYB1", 1, 8, bin);
+        fwrite(&width, sizeof(int), 1, bin);
+        fwrite(&height, sizeof(int), 1, bin);
+        fwrite(&src->fps, sizeof(double), 1, bin);
+    }
+
+    traceThreadName("reduce");
+    tStart = pipelineNow();
+    threads.push_back(std::thread(&drowsyBatch::readerLoop, this));
+    for (w = 0; w < (int) workers.size(); w++)
+        threads.push_back(std::thread(&drowsyBatch::workerLoop, this, w));
+
+    for (f = 0;; f++) {
+        s = &slots[f % slots.size()];
+        {
+            std::unique_lock<std::mutex> g(lock);
+            changed.wait(g, [&] {
+                return (s->state == SLOT_DONE && s->frame == f) || (eof && f >= nread);
+            });
+            if (s->state != SLOT_DONE || s->frame != f) break;
+        }
+        t0 = pipelineNow();
+        reduce(s, csv, bin);
+        reduceBusy += pipelineNow() - t0;
+
+        std::lock_guard<std::mutex> g(lock);
+        s->state = SLOT_FREE;
+        changed.notify_all();
+    }
+
+    for (k = 0; k < threads.size(); k++) threads[k].join();
+    tEnd = pipelineNow();
+}
+
+void drowsyBatch::printStats(FILE *fp) const {
+    double T = elapsed(), fps = src->fps;
+    size_t i;
+
+    fprintf(fp, "%-6s %8s %8s\n", "worker", "frames", "busy(%)");
+    for (i = 0; i < workers.size(); i++)
+        fprintf(fp, "%-6d %8lld %8.1f\n", (int) i, workers[i].frames,
+                T > 0 ? 100 * workers[i].busy / T : 0.0);
+    fprintf(fp, "reader blocked %.3f s, reduction %.3f s, %d slots\n", readerBlocked,
+            reduceBusy, (int) slots.size());
+    fprintf(fp, "%lld frames in %.3f s (%.2f fps", nframes, T, T > 0 ? nframes / T : 0.0);
+    if (fps > 0 && T > 0)
+        fprintf(fp, ", %.1fx real time at %g fps", nframes / fps / T, fps);
+    fprintf(fp, "), %lld warning frames\n", warnings);
+    for (i = 0; i < ev.size(); i++) {
+        fprintf(fp, "drowsy: frames %lld-%lld", ev[i].first, ev[i].last);
+        if (fps > 0)
+            fprintf(fp, " (%.2f-%.2f s)", ev[i].first / fps, (ev[i].last + 1) / fps);
+        fprintf(fp, ", peak level %g\n", ev[i].peak);
+    }
+}
@@ -0,0 +1,98 @@
+/**************************************************************
+ * Offline batch analysis of a recorded video
+ *
+ * The detection and the analysis of the faces of a frame (facial
+ * regions, eye openness) only read the models, so the frames are
+ * spread over a pool of workers; the adaptive threshold and the
+ * drowsiness level (drowsyUpdate) depend on the previous frames and
+ * are folded over the results in frame order by the thread calling
+ * run().
+ *
+ * The frames go through a ring of slots: a reader thread fills the
+ * free slots in frame order, the workers claim the frames in order
+ * (one atomic counter) and mark their slot done, and the reduction
+ * frees the slots in order. At most depth frames are in flight and
+ * nothing is allocated once the run has started.
+ *************************************************************/
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "drowsy.h"
+#include "frame_source.h"
+
+/* record of the binary log, after the header
+   "DROWSYB1", int32 width, int32 height, float64 fps (0 if unknown);
+   host byte order. x, y, size: face of value, NaN if none */
+struct batchRecord {
+    int frame;
+    unsigned char faces, analysed, closed, warning;
+    float value, thresh, level;
+    float x, y, size;
+};
+
+/* frames over DROWSY_WARN_LEVEL, first..last */
+struct batchEvent {
+    long long first, last;
+    double peak;                /* highest drowsiness level */
+};
+
+struct batchSlot {
+    long long frame;
+    int state;                  /* SLOT_FREE, SLOT_READ, SLOT_DONE */
+    unsigned char *gray;
+    int nfaces;
+    drowsyFace faces[DROWSY_MAX_FACES];
+};
+
+struct batchWorker {
+    long long frames;
+    double busy;                /* s */
+};
+
+class drowsyBatch {
+public:
+    /* nworkers <= 0: one per core; depth <= 0: 4 slots per worker */
+    drowsyBatch(const drowsyModels *models, frameSource *src, int nworkers, int depth);
+    ~drowsyBatch();
+
+    /* processes the whole source; csv and bin (the logs) may be NULL */
+    void run(FILE *csv, FILE *bin);
+
+    long long frames() const { return nframes; }
+    double elapsed() const { return tEnd - tStart; }
+    const std::vector<batchEvent> &events() const { return ev; }
+    void printStats(FILE *fp) const;
+
+private:
+    drowsyBatch(const drowsyBatch &);
+    drowsyBatch &operator=(const drowsyBatch &);
+
+    void readerLoop();
+    void workerLoop(int w);
+    void reduce(batchSlot *s, FILE *csv, FILE *bin);
+
+    const drowsyModels *models;
+    frameSource *src;
+    std::vector<batchWorker> workers;
+    std::vector<batchSlot> slots;
+    unsigned char *pixels;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::atomic<long long> next;    /* next frame to claim */
+    long long nread;                /* frames read, final once eof */
+    bool eof;
+
+    drowsyState state;
+    std::vector<batchEvent> ev;
+    long long nframes, warnings;
+    double readerBlocked, reduceBusy, tStart, tEnd;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/**************************************************************
+ * detect_haar and detect_mblbp of fdtool for drowsy_bench
+ *
+ * detector_haar.c and detector_mblbp.c (NO_MEXFUNCTION) both define
+ * struct model, Round, MakeIntegralImagePad, ... as detector_mlhmslbp_spyr.c
+ * does, so each is compiled here in a namespace of its own. The models
+ * are filled as their mexFunction does when it is called without one.
+ *************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_MEXFUNCTION
+
+namespace fdHaar {
+#include "../../fdtool_release/fdtool_release/detector_haar.c"
+}
+
+namespace fdMblbp {
+#include "../../fdtool_release/fdtool_release/detector_mblbp.c"
+}
+
+#include "bench_detectors.h"
+
+static fdHaar::model haarModel;
+static fdMblbp::model mblbpModel;
+
+void benchDetectorsInit() {
+    fdHaar::model *h = &haarModel;
+    fdMblbp::model *m = &mblbpModel;
+    int i;
+
+    memset(h, 0, sizeof(*h));
+    h->weaklearner    = 2;
+    h->epsi           = 0.1;
+    h->param          = fdHaar::param_default;
+    h->T              = 10;
+    h->ny             = 24;
+    h->nx             = 24;
+    h->rect_param     = fdHaar::rect_param_default;
+    h->nR             = 4;
+    h->nF             = fdHaar::number_haar_features(h->ny, h->nx, h->rect_param, h->nR);
+    h->F              = (unsigned int *) malloc(6 * h->nF * sizeof(int));
+    fdHaar::haar_featlist(h->ny, h->nx, h->rect_param, h->nR, h->F);
+    h->postprocessing = 1;
+    h->scalingbox     = fdHaar::scalingbox_default;
+    h->cascade_type   = 0;
+    h->cascade        = fdHaar::cascade_default;
+    h->Ncascade       = 8;
+    h->max_detections = 500;
+    h->mergingbox     = fdHaar::mergingbox_default;
+
+    memset(m, 0, sizeof(*m));
+    m->weaklearner    = 0;
+    m->epsi           = 0.1;
+    m->param          = fdMblbp::param_default;
+    m->T              = 10;
+    m->ny             = 24;
+    m->nx             = 24;
+    m->nF             = fdMblbp::number_mblbp_features(m->ny, m->nx);
+    m->F              = (unsigned int *) malloc(5 * m->nF * sizeof(int));
+    fdMblbp::mblbp_featlist(m->ny, m->nx, m->F);
+    m->map            = (unsigned char *) malloc(256);
+    for (i = 0; i < 256; i++) m->map[i] = (unsigned char) i;
+    m->cascade_type   = 0;
+    m->postprocessing = 1;
+    m->scalingbox     = fdMblbp::scalingbox_default;
+    m->cascade        = fdMblbp::cascade_default;
+    m->Ncascade       = 8;
+    m->max_detections = 500;
+    m->mergingbox     = fdMblbp::mergingbox_default;
+}
+
+void benchDetectorsFree() {
+    free(haarModel.F);
+    free(mblbpModel.F);
+    free(mblbpModel.map);
+    memset(&haarModel, 0, sizeof(haarModel));
+    memset(&mblbpModel, 0, sizeof(mblbpModel));
+}
+
+double *benchDetectHaar(unsigned char *I, int Ny, int Nx, int *nD) {
+    double stat[2];
+
+    *nD = 0;
+    return fdHaar::detect_haar(I, Ny, Nx, haarModel, nD, stat);
+}
+
+double *benchDetectMblbp(unsigned char *I, int Ny, int Nx, int *nD) {
+    double stat[2];
+
+    *nD = 0;
+    return fdMblbp::detect_mblbp(I, Ny, Nx, mblbpModel, nD, stat);
+}
@@ -0,0 +1,21 @@
+/**************************************************************
+ * detect_haar and detect_mblbp of fdtool for drowsy_bench
+ * (detector_haar.c and detector_mblbp.c without MATLAB)
+ *************************************************************/
+#ifndef BENCH_DETECTORS_H
+#define BENCH_DETECTORS_H
+
+/* builds the default models of the two mex files (no model argument) */
+void benchDetectorsInit();
+void benchDetectorsFree();
+
+/*
+ * detections of the (Ny x Nx) UINT8 image I (column-major): malloc'ed
+ * (5 x nD) matrix as D of detector_haar/detector_mblbp, to be freed
+ * by the caller. Both may be called from any thread after
+ * benchDetectorsInit.
+ */
+double *benchDetectHaar(unsigned char *I, int Ny, int Nx, int *nD);
+double *benchDetectMblbp(unsigned char *I, int Ny, int Nx, int *nD);
+
+#endif
@@ -0,0 +1,515 @@
+/**************************************************************
+ * Native version of the per-frame processing of DrowsinessDetectionGUI
+ *
+ * Follows DetectDrowsiness line by line; the MATLAB indices (1-based)
+ * are kept in the eye and threshold code to ease the comparison,
+ * including the off-by-one of the threshold update once indx > Wd
+ * (meanSideNext).
+ * Differences:
+ *  - a face whose eye regions are not found (no sample point labelled
+ *    as an eye) is skipped, where MATLAB stops with an error; an eye
+ *    region partly outside the frame is clipped to it, and the face is
+ *    skipped only when nothing of the region is left,
+ *  - indx wraps to 1 after framelim even on frames without a face
+ *    (DetectDrowsiness only wraps on frames with a face and otherwise
+ *    lets data grow),
+ *  - forest ties go to the lowest class instead of a random one.
+ *************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drowsy.h"
+#include "trace.h"
+
+/* NormFace_mex.cpp, CreatePosiFeat_mex.cpp, CreateHaarFeat_mex.cpp (NO_MEXFUNCTION) */
+int NormFace(const unsigned char *frame, int Ny, int Nx, const double *rect,
+        unsigned char *face, double *ii);
+void CreatePosiFeat(double *img, double *coord, int coord_dimy, double *featPa,
+        int featPa_dimy, double *featMat);
+void CreateHaarFeat(double *img, int img_dimy, int img_dimx, double *coord,
+        int coord_dimy, double *featPa, int featPa_dimy, double *featMat);
+
+#define MODEL_MAGIC "DROWSYM1"
+#define DROWSY_MAX_CLASS 16
+
+/* MATLAB round */
+static double roundm(double v) {
+    return (v >= 0) ? floor(v + 0.5) : -floor(-v + 0.5);
+}
+
+/*------------------------------ models ------------------------------*/
+
+static int readArrays(FILE *fp, drowsyArray **arrays, int *narrays) {
+    int len, cap = 0, dims[2];
+    size_t n;
+    drowsyArray *a;
+
+    *arrays = NULL;
+    *narrays = 0;
+    while (fread(&len, sizeof(int), 1, fp) == 1) {
+        if (*narrays == cap) {
+            cap = cap ? 2 * cap : 64;
+            *arrays = (drowsyArray *) realloc(*arrays, cap * sizeof(drowsyArray));
+        }
+        if (len <= 0 || len > 255) return 1;
+        char *name = (char *) calloc(len + 1, 1);
+        if (fread(name, 1, len, fp) != (size_t) len || fread(dims, sizeof(int), 2, fp) != 2 ||
+                dims[0] < 0 || dims[1] < 0) {
+            free(name);
+            return 1;
+        }
+        a = *arrays + (*narrays)++;
+        a->name = name;
+        a->rows = dims[0];
+        a->cols = dims[1];
+        n = (size_t) dims[0] * dims[1];
+        a->data = (double *) malloc((n ? n : 1) * sizeof(double));
+        if (fread(a->data, sizeof(double), n, fp) != n) return 1;
+    }
+    return 0;
+}
+
+static void freeArrays(drowsyArray *arrays, int narrays) {
+    int i;
+
+    for (i = 0; i < narrays; i++) {
+        free((char *) arrays[i].name);
+        free(arrays[i].data);
+    }
+    free(arrays);
+}
+
+static const drowsyArray *getArray(const drowsyArray *arrays, int narrays, const char *name) {
+    int i;
+
+    for (i = 0; i < narrays; i++)
+        if (!strcmp(arrays[i].name, name)) return arrays + i;
+    return NULL;
+}
+
+static int *toInt(const drowsyArray *a) {
+    size_t i, n = (size_t) a->rows * a->cols;
+    int *v = (int *) malloc((n ? n : 1) * sizeof(int));
+
+    for (i = 0; i < n; i++) v[i] = (int) a->data[i];
+    return v;
+}
+
+static double *takeData(drowsyArray *a) {
+    double *d = a->data;
+    a->data = NULL;
+    return d;
+}
+
+/* modelRF, trimmed by export_models.m to nrnodes = max(ndbigtree) */
+static int loadForest(drowsyArray *arrays, int narrays, drowsyModels *m, char *err, int errlen) {
+    const char *names[] = {"rf.nrnodes", "rf.ntree", "rf.nclass", "rf.mdim", "rf.ndbigtree",
+        "rf.treemap", "rf.nodestatus", "rf.bestvar", "rf.nodeclass", "rf.xbestsplit",
+        "rf.cutoff", "rf.orig_labels"};
+    const drowsyArray *a[12];
+    int i, nrnodes, nnode, total = 0, ret;
+    int *treeSize, *treemap, *nodestatus, *bestvar, *nodeclass;
+
+    for (i = 0; i < 12; i++) {
+        a[i] = getArray(arrays, narrays, names[i]);
+        if (a[i] == NULL) {
+            snprintf(err, errlen, "%s is missing, rerun export_models.m", names[i]);
+            return 1;
+        }
+    }
+    nrnodes   = (int) a[0]->data[0];
+    m->ntree  = (int) a[1]->data[0];
+    m->nclass = (int) a[2]->data[0];
+    m->mdim   = (int) a[3]->data[0];
+    if (a[4]->rows * a[4]->cols != m->ntree ||
+            (size_t) a[5]->rows * a[5]->cols != (size_t) 2 * nrnodes * m->ntree ||
+            (size_t) a[9]->rows * a[9]->cols != (size_t) nrnodes * m->ntree ||
+            a[10]->rows * a[10]->cols != m->nclass || a[11]->rows * a[11]->cols != m->nclass) {
+        snprintf(err, errlen, "the forest arrays do not match nrnodes/ntree/nclass");
+        return 1;
+    }
+    if (m->nclass < 1 || m->nclass > DROWSY_MAX_CLASS) {
+        snprintf(err, errlen, "the forest must have 1 to %d classes", DROWSY_MAX_CLASS);
+        return 1;
+    }
+    if (m->mdim != m->nAB + m->nhaar) {
+        snprintf(err, errlen, "the forest has %d variables, AB and haarPara give %d",
+                m->mdim, m->nAB + m->nhaar);
+        return 1;
+    }
+
+    treeSize   = toInt(a[4]);
+    treemap    = toInt(a[5]);
+    nodestatus = toInt(a[6]);
+    bestvar    = toInt(a[7]);
+    nodeclass  = toInt(a[8]);
+    for (i = 0; i < m->ntree; i++) total += treeSize[i];
+    m->nodes = (qnode *) malloc((total ? total : 1) * sizeof(qnode));
+    m->root  = (int *) malloc(m->ntree * sizeof(int));
+    ret = classForestQuantize(m->mdim, m->ntree, nrnodes, treeSize, treemap, nodestatus,
+            bestvar, nodeclass, a[9]->data, m->nodes, m->root, &nnode);
+    free(treeSize); free(treemap); free(nodestatus); free(bestvar); free(nodeclass);
+    if (ret) {
+        snprintf(err, errlen, "the forest cannot be quantised (error %d)", ret);
+        return 1;
+    }
+    m->nodes  = (qnode *) realloc(m->nodes, (nnode ? nnode : 1) * sizeof(qnode));
+    m->cutoff = takeData((drowsyArray *) a[10]);
+    m->labels = toInt(a[11]);
+    return 0;
+}
+
+int drowsyLoadModels(const char *file, drowsyModels *m, char *err, int errlen) {
+    FILE *fp = fopen(file, "rb");
+    char magic[8];
+    drowsyArray *arrays, *a;
+    int narrays, ret = 1;
+
+    memset(m, 0, sizeof(drowsyModels));
+    if (fp == NULL) {
+        snprintf(err, errlen, "cannot open %s", file);
+        return 1;
+    }
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, MODEL_MAGIC, 8)) {
+        snprintf(err, errlen, "%s was not written by export_models.m", file);
+        fclose(fp);
+        return 1;
+    }
+    if (readArrays(fp, &arrays, &narrays)) {
+        snprintf(err, errlen, "%s is truncated", file);
+        fclose(fp);
+        freeArrays(arrays, narrays);
+        return 1;
+    }
+    fclose(fp);
+
+    m->face = faceDetectorNew(arrays, narrays, "face.", err, errlen);
+    if (m->face == NULL) goto done;
+    a = (drowsyArray *) getArray(arrays, narrays, "min_detect");
+    m->minDetect = a ? (int) a->data[0] : 2;
+
+    a = (drowsyArray *) getArray(arrays, narrays, "coord");
+    if (a == NULL || a->cols != 2) { snprintf(err, errlen, "coord must be (n x 2)"); goto done; }
+    m->ncoord = a->rows;
+    m->coord  = takeData(a);
+    a = (drowsyArray *) getArray(arrays, narrays, "AB");
+    if (a == NULL || a->cols != 2) { snprintf(err, errlen, "AB must be (n x 2)"); goto done; }
+    m->nAB = a->rows;
+    m->AB  = takeData(a);
+    a = (drowsyArray *) getArray(arrays, narrays, "haarPara");
+    if (a == NULL || a->cols != 2) { snprintf(err, errlen, "haarPara must be (n x 2)"); goto done; }
+    m->nhaar    = a->rows;
+    m->haarPara = takeData(a);
+
+    ret = loadForest(arrays, narrays, m, err, errlen);
+done:
+    freeArrays(arrays, narrays);
+    if (ret) drowsyFreeModels(m);
+    return ret;
+}
+
+void drowsyFreeModels(drowsyModels *m) {
+    faceDetectorFree(m->face);
+    free(m->coord); free(m->AB); free(m->haarPara);
+    free(m->nodes); free(m->root); free(m->cutoff); free(m->labels);
+    memset(m, 0, sizeof(drowsyModels));
+}
+
+void drowsyNewWork(const drowsyModels *m, drowsyWork *w) {
+    int n = DROWSY_FACE * DROWSY_FACE;
+
+    w->face  = (unsigned char *) malloc(n);
+    w->faced = (double *) malloc(n * sizeof(double));
+    w->ii    = (double *) malloc(n * sizeof(double));
+    w->feat  = (double *) malloc((size_t) m->ncoord * m->mdim * sizeof(double));
+    w->label = (int *) malloc(m->ncoord * sizeof(int));
+    w->eye = w->mask = w->dil = NULL;
+    w->eyeSize = 0;
+}
+
+void drowsyFreeWork(drowsyWork *w) {
+    free(w->face); free(w->faced); free(w->ii); free(w->feat); free(w->label);
+    free(w->eye); free(w->mask); free(w->dil);
+    memset(w, 0, sizeof(drowsyWork));
+}
+
+/*------------------------------ frame-independent part ------------------------------*/
+
+int drowsyDetect(const drowsyModels *m, unsigned char *gray, int Ny, int Nx,
+        drowsyFace *faces) {
+    int i, nD, n = 0;
+    double *D = faceDetect(m->face, gray, Ny, Nx, &nD);
+
+    for (i = 0; i < nD && n < DROWSY_MAX_FACES; i++) {
+        if (D[3 + 5*i] < m->minDetect) continue;
+        memcpy(faces[n].det, D + 5*i, 5 * sizeof(double));
+        faces[n].value = NAN;
+        n++;
+    }
+    free(D);
+    return n;
+}
+
+/* classRF_predict([posiFeat haarFeat],modelRF) + 1 */
+void drowsyLabelRegions(const drowsyModels *m, drowsyWork *w) {
+    int i, j, k, c, best;
+    double votes[DROWSY_MAX_CLASS], crit, cmax;
+    const qnode *nodes = m->nodes;
+
+    for (i = 0; i < m->ncoord; i++) {
+        const double *xi = w->feat + i;
+        for (c = 0; c < m->nclass; c++) votes[c] = 0.0;
+        for (j = 0; j < m->ntree; j++) {
+            k = m->root[j];
+            while (nodes[k].var != QNODE_LEAF)
+                k = (xi[(size_t) nodes[k].var * m->ncoord] <= nodes[k].split) ?
+                    k + 1 : k + nodes[k].right;
+            votes[nodes[k].split - 1] += 1.0;
+        }
+        best = 0;
+        cmax = 0.0;
+        for (c = 0; c < m->nclass; c++) {
+            crit = (votes[c] / m->ntree) / m->cutoff[c];
+            if (crit > cmax) {
+                cmax = crit;
+                best = c;
+            }
+        }
+        w->label[i] = m->labels[best] + 1;
+    }
+}
+
+/* graythresh (Otsu) of n UINT8 pixels */
+static double graythresh(const unsigned char *I, int n) {
+    double counts[256], omega = 0.0, mu = 0.0, mu_t = 0.0, sigma[256], maxval = -1.0;
+    int i, nmax = 0;
+    double idx = 0.0;
+
+    for (i = 0; i < 256; i++) counts[i] = 0.0;
+    for (i = 0; i < n; i++) counts[I[i]] += 1.0;
+    for (i = 0; i < 256; i++) mu_t += counts[i] / n * (i + 1);
+    for (i = 0; i < 256; i++) {
+        omega += counts[i] / n;
+        mu    += counts[i] / n * (i + 1);
+        sigma[i] = (mu_t * omega - mu) * (mu_t * omega - mu) / (omega * (1.0 - omega));
+        if (sigma[i] == sigma[i] && sigma[i] > maxval) maxval = sigma[i];
+    }
+    if (maxval < 0.0 || isinf(maxval)) return 0.0;
+    for (i = 0; i < 256; i++)
+        if (sigma[i] == maxval) {
+            idx += i + 1;
+            nmax++;
+        }
+    return (idx / nmax - 1.0) / 255.0;
+}
+
+/*
+ * eye openness of the region of the eye at (row, col):
+ * im = region < graythresh(region)*0.3*width; mean(imdilate(im, strel('disk',2)))*3
+ */
+static int eyeValue(const unsigned char *gray, int Ny, int Nx, double row, double col,
+        double width, drowsyWork *w, double *value) {
+    int r0 = (int) (row - roundm(width*0.1)), r1 = (int) (row + roundm(width*0.1));
+    int c0 = (int) (col - roundm(width*0.13)), c1 = (int) (col + roundm(width*0.1));
+    int h, wd, i, j, di, dj, n, sum = 0;
+    double t;
+
+    r0 = (r0 < 1) ? 1 : r0;  r1 = (r1 > Ny) ? Ny : r1;
+    c0 = (c0 < 1) ? 1 : c0;  c1 = (c1 > Nx) ? Nx : c1;
+    if (r0 > r1 || c0 > c1) return 0;
+    h = r1 - r0 + 1;
+    wd = c1 - c0 + 1;
+    n = h * wd;
+    if (n > w->eyeSize) {
+        w->eye  = (unsigned char *) realloc(w->eye, n);
+        w->mask = (unsigned char *) realloc(w->mask, n);
+        w->dil  = (unsigned char *) realloc(w->dil, n);
+        w->eyeSize = n;
+    }
+    for (j = 0; j < wd; j++)
+        memcpy(w->eye + j*h, gray + (size_t) (c0 - 1 + j) * Ny + (r0 - 1), h);
+
+    t = graythresh(w->eye, n) * 0.3 * width;
+    for (i = 0; i < n; i++) w->mask[i] = w->eye[i] < t;
+
+    /* strel('disk',2): the 13 offsets with di^2 + dj^2 <= 4 */
+    for (j = 0; j < wd; j++)
+        for (i = 0; i < h; i++) {
+            unsigned char v = 0;
+            for (dj = -2; dj <= 2 && !v; dj++)
+                for (di = -2; di <= 2; di++) {
+                    if (di*di + dj*dj > 4 || i + di < 0 || i + di >= h ||
+                            j + dj < 0 || j + dj >= wd) continue;
+                    if (w->mask[(i + di) + (j + dj)*h]) { v = 1; break; }
+                }
+            w->dil[i + j*h] = v;
+            sum += v;
+        }
+    *value = 3.0 * sum / n;
+    return 1;
+}
+
+int drowsyAnalyseFace(const drowsyModels *m, const unsigned char *gray, int Ny, int Nx,
+        drowsyWork *w, drowsyFace *face) {
+    double x = face->det[0] - 5, y = face->det[1] - 5, width = 1.1*face->det[2];
+    double rect[4] = {x, y, width, width};
+    double sum[2][2] = {{0, 0}, {0, 0}}, value1, value2;
+    int cnt[2] = {0, 0}, i, e;
+
+    face->value = NAN;
+    TRACE_BEGIN(tNorm);
+    if (NormFace(gray, Ny, Nx, rect, w->face, w->ii)) {
+        TRACE_END(TRACE_NORMFACE, tNorm);
+        return 0;
+    }
+    for (i = 0; i < DROWSY_FACE * DROWSY_FACE; i++) w->faced[i] = w->face[i];
+    TRACE_END(TRACE_NORMFACE, tNorm);
+
+    TRACE_BEGIN(tFeat);
+    CreatePosiFeat(w->faced, m->coord, m->ncoord, m->AB, m->nAB, w->feat);
+    CreateHaarFeat(w->ii, DROWSY_FACE, DROWSY_FACE, m->coord, m->ncoord, m->haarPara,
+            m->nhaar, w->feat + (size_t) m->ncoord * m->nAB);
+    TRACE_END(TRACE_FEATURES, tFeat);
+    TRACE_BEGIN(tForest);
+    drowsyLabelRegions(m, w);
+    TRACE_END(TRACE_FOREST, tForest);
+
+    /* RE = coord2(classlabel==2,:), LE = coord2(classlabel==3,:) */
+    for (i = 0; i < m->ncoord; i++) {
+        if (w->label[i] != 2 && w->label[i] != 3) continue;
+        e = w->label[i] - 2;
+        sum[e][0] += floor(m->coord[i] / DROWSY_FACE * width) + y;
+        sum[e][1] += floor(m->coord[i + m->ncoord] / DROWSY_FACE * width) + x;
+        cnt[e]++;
+    }
+    if (cnt[0] == 0 || cnt[1] == 0) return 0;
+
+    TRACE_BEGIN(tEye);
+    if (!eyeValue(gray, Ny, Nx, roundm(sum[1][0] / cnt[1]), roundm(sum[1][1] / cnt[1]),
+                width, w, &value1) ||
+            !eyeValue(gray, Ny, Nx, roundm(sum[0][0] / cnt[0]), roundm(sum[0][1] / cnt[0]),
+                width, w, &value2)) {
+        TRACE_END(TRACE_EYE, tEye);
+        return 0;
+    }
+    face->value = (value1 + value2) / 2;
+    TRACE_END(TRACE_EYE, tEye);
+    return 1;
+}
+
+/*------------------------------ order-dependent part ------------------------------*/
+
+#define DATA(i)  s->data[(i) - 1]
+#define STATE(i) s->state[(i) - 1]
+
+void drowsyInitState(drowsyState *s) {
+    memset(s, 0, sizeof(drowsyState));
+    s->indx = 1;
+    s->thresh = 0.2;
+    s->drowsyLev = NAN;
+}
+
+/* mean of data(idx) over idx in [a1,b1] U [a2,b2] above (sgn > 0) or below thresh */
+static double meanSide(const drowsyState *s, int a1, int b1, int a2, int b2, int sgn) {
+    double sum = 0.0;
+    int i, n = 0;
+
+    for (i = a1; i <= b1; i++)
+        if (sgn > 0 ? DATA(i) > s->thresh : DATA(i) < s->thresh) { sum += DATA(i); n++; }
+    for (i = a2; i <= b2; i++)
+        if (sgn > 0 ? DATA(i) > s->thresh : DATA(i) < s->thresh) { sum += DATA(i); n++; }
+    return n ? sum / n : NAN;
+}
+
+/* mean(data(find(data(a:b) > thresh) + a)) (or < thresh): the positions
+   found are 1-based, so the values averaged are those one after the
+   values compared, up to data(b + 1) */
+static double meanSideNext(const drowsyState *s, int a, int b, int sgn) {
+    double sum = 0.0;
+    int i, n = 0;
+
+    for (i = a; i <= b; i++)
+        if (sgn > 0 ? DATA(i) > s->thresh : DATA(i) < s->thresh) { sum += DATA(i + 1); n++; }
+    return n ? sum / n : NAN;
+}
+
+static void extremes(const drowsyState *s, int a1, int b1, int a2, int b2, double *mx, double *mn) {
+    int i;
+
+    *mx = -INFINITY;
+    *mn = INFINITY;
+    for (i = a1; i <= b1; i++) { *mx = fmax(*mx, DATA(i)); *mn = fmin(*mn, DATA(i)); }
+    for (i = a2; i <= b2; i++) { *mx = fmax(*mx, DATA(i)); *mn = fmin(*mn, DATA(i)); }
+}
+
+/* one face of the frame at indx */
+static int updateFace(drowsyState *s, double value) {
+    const int framelim = DROWSY_FRAMELIM, Wd = DROWSY_WD, warn_win = DROWSY_WARN_WIN;
+    int indx = s->indx, i, sum, closed;
+    double T1, T2;
+
+    DATA(indx) = value;
+
+    /* ADAPTIVE THRESHOLDING */
+    if (indx == 1) {
+        extremes(s, framelim - Wd + 1, framelim, 1, indx, &T1, &T2);
+        s->thresh = (T1 + T2) / 2;
+    } else if (indx <= Wd) {
+        T1 = meanSide(s, 1, indx - 1, framelim - (Wd - indx), framelim, 1);
+        T2 = meanSide(s, 1, indx - 1, framelim - (Wd - indx), framelim, -1);
+        if (isnan(T1) || isnan(T2) || T1 > 1 || T2 > 1)
+            extremes(s, 1, indx - 1, framelim - (Wd - indx), framelim, &T1, &T2);
+        s->thresh = (T1 + T2) / 2 * (1 - 0.15);
+    } else {
+        T1 = meanSideNext(s, indx - Wd, indx - 1, 1);
+        T2 = meanSideNext(s, indx - Wd, indx - 1, -1);
+        if (isnan(T1) || isnan(T2) || T1 > 1 || T2 > 1)
+            extremes(s, indx - Wd, indx - 1, 1, 0, &T1, &T2);
+        s->thresh = (T1 + T2) / 2 * (1 - 0.2);
+    }
+
+    closed = value < s->thresh;
+    if (closed) STATE(indx) = 1;
+
+    if (indx == framelim) indx = s->indx = 1;
+
+    /* DROWSINESS DETECTION RULES */
+    sum = 0;
+    if (indx == 1) {
+        for (i = 2; i <= framelim - warn_win + 2; i++) STATE(i) = 0;
+        for (i = framelim - warn_win + 1; i <= framelim; i++) sum += STATE(i);
+    } else if (indx < warn_win) {
+        for (i = 1; i <= indx - 1; i++) sum += STATE(i);
+        for (i = framelim - (warn_win - indx - 1); i <= framelim; i++) sum += STATE(i);
+    } else if (indx == warn_win) {
+        for (i = 1; i <= indx; i++) sum += STATE(i);
+        for (i = framelim - warn_win + 3; i <= framelim; i++) STATE(i) = 0;
+    } else {
+        for (i = indx - warn_win + 1; i <= indx; i++) sum += STATE(i);
+    }
+    s->drowsyLev = (double) sum / warn_win;
+    return closed;
+}
+
+void drowsyUpdate(drowsyState *s, const drowsyFace *faces, int nfaces, drowsyResult *r) {
+    int i;
+    TRACE_BEGIN(t0);
+
+    r->nfaces = nfaces;
+    r->analysed = 0;
+    r->value = NAN;
+    r->closed = 0;
+    for (i = 0; i < nfaces; i++) {
+        if (isnan(faces[i].value)) continue;
+        r->closed = updateFace(s, faces[i].value);
+        r->value = faces[i].value;
+        r->analysed++;
+    }
+    r->thresh = s->thresh;
+    r->level = s->drowsyLev;
+    r->warning = s->drowsyLev > DROWSY_WARN_LEVEL;
+
+    if (++s->indx > DROWSY_FRAMELIM) s->indx = 1;
+    TRACE_END(TRACE_STATE, t0);
+}
@@ -0,0 +1,111 @@
+/**************************************************************
+ * Native version of the per-frame processing of DrowsinessDetectionGUI
+ *
+ *  drowsyDetect       face detection (detector_mlhmslbp_spyr)
+ *  drowsyAnalyseFace  facial regions (NormFace, CreatePosiFeat,
+ *                     CreateHaarFeat, modelRF) and eye openness value
+ *  drowsyUpdate       adaptive threshold, eye state and drowsiness
+ *                     level, in frame order (the persistent variables
+ *                     of DetectDrowsiness)
+ *
+ * The first two only read the models and work buffers and may run on
+ * any thread; drowsyUpdate must see the frames of a stream in order.
+ *************************************************************/
+#ifndef DROWSY_H
+#define DROWSY_H
+
+#include "face_detector.h"
+#include "../../RF_Class_C/src/rf.h"
+
+#define DROWSY_FACE       128   /* size of the normalised face */
+#define DROWSY_MAX_FACES  8     /* faces analysed per frame */
+#define DROWSY_FRAMELIM   100   /* framelim of DetectDrowsiness */
+#define DROWSY_WD         20    /* window of the adaptive threshold (Wd) */
+#define DROWSY_WARN_WIN   15    /* window of the drowsiness level (warn_win) */
+#define DROWSY_WARN_LEVEL 0.55  /* level raising the warning */
+
+/* models shared by all streams, read-only once loaded */
+struct drowsyModels {
+    faceDetector *face;
+    int minDetect;              /* merged detections for a face to count (min_detect) */
+    int ncoord;                 /* sample points of the face (coord2), ncoord x 2 */
+    double *coord;
+    int nAB;                    /* pixel-difference features (AB), nAB x 2 */
+    double *AB;
+    int nhaar;                  /* Haar features (haarPara), nhaar x 2 */
+    double *haarPara;
+    /* facial regions forest (modelRF) quantised to 8 byte nodes, see
+       classRF_quant.cpp: the features are integers */
+    int mdim, nclass, ntree;
+    qnode *nodes;
+    int *root;
+    double *cutoff;
+    int *labels;                /* orig_labels of the classes 1..nclass */
+};
+
+/* per-thread buffers of drowsyAnalyseFace */
+struct drowsyWork {
+    unsigned char *face;        /* DROWSY_FACE x DROWSY_FACE */
+    double *faced, *ii;         /* double(face) and its integral image */
+    double *feat;               /* ncoord x mdim, [posiFeat haarFeat] */
+    int *label;                 /* ncoord facial region labels 1..5 */
+    unsigned char *eye;         /* eye region and its thresholded, dilated masks */
+    unsigned char *mask, *dil;
+    int eyeSize;
+};
+
+/* one detected face: [x ; y ; size ; merged ; value] of the detector */
+struct drowsyFace {
+    double det[5];
+    double value;               /* eye openness, NaN if the eyes were not found */
+};
+
+/* state of one stream, the persistent variables of DetectDrowsiness;
+   data and state are rings of framelim frames */
+struct drowsyState {
+    double data[DROWSY_FRAMELIM];
+    unsigned char state[DROWSY_FRAMELIM];
+    int indx;                   /* 1-based, as in MATLAB */
+    double thresh;
+    double drowsyLev;
+};
+
+/* outcome of one frame */
+struct drowsyResult {
+    int nfaces;                 /* faces with at least minDetect merged detections */
+    int analysed;               /* faces whose eyes were found */
+    double value;               /* eye openness of the last of them, NaN if none */
+    double thresh;              /* adaptive threshold */
+    int closed;                 /* eye state of the frame */
+    double level;               /* drowsiness level, NaN until the first face */
+    int warning;                /* level above DROWSY_WARN_LEVEL */
+};
+
+/*
+ * reads the file written by export_models.m; returns 0, or 1 and a message
+ * in err if the file cannot be read or a model is incomplete
+ */
+int drowsyLoadModels(const char *file, drowsyModels *m, char *err, int errlen);
+void drowsyFreeModels(drowsyModels *m);
+
+void drowsyNewWork(const drowsyModels *m, drowsyWork *w);
+void drowsyFreeWork(drowsyWork *w);
+
+/* faces of the (Ny x Nx) gray frame with at least minDetect merged
+   detections, at most DROWSY_MAX_FACES; returns their number */
+int drowsyDetect(const drowsyModels *m, unsigned char *gray, int Ny, int Nx,
+        drowsyFace *faces);
+
+/* facial region (1..5) of every sample point from w->feat into w->label,
+   the forest step of drowsyAnalyseFace */
+void drowsyLabelRegions(const drowsyModels *m, drowsyWork *w);
+
+/* fills face->value; returns 0 if the eyes of the face were not found */
+int drowsyAnalyseFace(const drowsyModels *m, const unsigned char *gray, int Ny, int Nx,
+        drowsyWork *w, drowsyFace *face);
+
+void drowsyInitState(drowsyState *s);
+/* advances s by one frame with its analysed faces, as DetectDrowsiness */
+void drowsyUpdate(drowsyState *s, const drowsyFace *faces, int nfaces, drowsyResult *r);
+
+#endif
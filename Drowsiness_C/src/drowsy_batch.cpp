@@ -0,0 +1,114 @@
+/**************************************************************
+ * drowsy_batch: offline analysis of a recorded video
+ *
+ *   drowsy_batch models.bin video.y4m [-threads N] [-depth N] [-o log.csv]
+ *                [-b log.bin] [-trace trace.json] [-hist latency.hgrm]
+ *   drowsy_batch models.bin video.yuv|video.gray WIDTH HEIGHT [-fps F] ...
+ *
+ * The format follows the extension: .y4m YUV4MPEG2, .yuv raw planar
+ * YUV 4:2:0, anything else raw 8-bit gray (see drowsy_pipeline);
+ * -format y4m|yuv420|gray overrides it. The frames are detected and
+ * analysed in parallel by -threads workers (default: one per core),
+ * the threshold and drowsiness level are computed in frame order
+ * (batch.h). -fps gives the frame rate of raw videos, for the real
+ * time factor and the times of the drowsy episodes printed at the end.
+ * -o writes one CSV line per frame, -b the same as 32 byte records.
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "trace.h"
+
+static void usage() {
+    fprintf(stderr, "usage: drowsy_batch models.bin video.y4m [-threads N] [-depth N] "
+            "[-o log.csv] [-b log.bin]\n"
+            "       [-trace trace.json] [-hist latency.hgrm]\n"
+            "       drowsy_batch models.bin video.yuv|video.gray WIDTH HEIGHT [-fps F] ...\n"
+            "       (-format y4m|yuv420|gray overrides the extension)\n");
+    exit(1);
+}
+
+static int endsWith(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && !strcmp(s + n - m, suffix);
+}
+
+int main(int argc, char **argv) {
+    drowsyModels models;
+    frameSource *src;
+    const char *format = NULL, *csvFile = NULL, *binFile = NULL;
+    const char *traceFile = NULL, *histFile = NULL;
+    FILE *csv = NULL, *bin = NULL;
+    int width = 0, height = 0, nthreads = 0, depth = 0, npos = 0, i;
+    double fps = 0;
+    char err[256];
+
+    if (argc < 3) usage();
+    for (i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            nthreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-fps") && i + 1 < argc)
+            fps = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-format") && i + 1 < argc)
+            format = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            csvFile = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            binFile = argv[++i];
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (!strcmp(argv[i], "-hist") && i + 1 < argc)
+            histFile = argv[++i];
+        else if (argv[i][0] != '-' && npos < 2) {
+            if (npos++ == 0) width = atoi(argv[i]);
+            else height = atoi(argv[i]);
+        } else
+            usage();
+    }
+    if (format == NULL)
+        format = endsWith(argv[2], ".y4m") ? "y4m" : endsWith(argv[2], ".yuv") ? "yuv420" : "gray";
+    if (strcmp(format, "y4m") && strcmp(format, "yuv420") && strcmp(format, "gray")) usage();
+    if (strcmp(format, "y4m") && npos != 2) usage();
+
+    if (drowsyLoadModels(argv[1], &models, err, sizeof(err))) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+    if (!strcmp(format, "y4m"))
+        src = openY4M(argv[2]);
+    else if (!strcmp(format, "yuv420"))
+        src = openRawYuv420(argv[2], width, height);
+    else
+        src = openRawGray(argv[2], width, height);
+    if (src == NULL) {
+        fprintf(stderr, "cannot open %s as %s\n", argv[2], format);
+        drowsyFreeModels(&models);
+        return 1;
+    }
+    if (fps > 0) src->fps = fps;
+    if ((csvFile && (csv = fopen(csvFile, "w")) == NULL) ||
+            (binFile && (bin = fopen(binFile, "wb")) == NULL)) {
+        fprintf(stderr, "cannot write %s\n", csv == NULL && csvFile ? csvFile : binFile);
+        if (csv) fclose(csv);
+        delete src;
+        drowsyFreeModels(&models);
+        return 1;
+    }
+
+    if (traceFile || histFile) traceStart(traceFile ? TRACE_EVENTS : 0);
+    {
+        drowsyBatch batch(&models, src, nthreads, depth);
+        batch.run(csv, bin);
+        batch.printStats(stdout);
+    }
+    traceReport(stdout, traceFile, histFile);
+
+    if (csv) fclose(csv);
+    if (bin) fclose(bin);
+    delete src;
+    drowsyFreeModels(&models);
+    return 0;
+}
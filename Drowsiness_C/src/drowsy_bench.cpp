@@ -0,0 +1,684 @@
+/**************************************************************
+ * drowsy_bench: benchmark of the kernels of the native runtime
+ *
+ *   drowsy_bench models.bin image.pgm [image.pgm ...] [-threads 1,2,4]
+ *                [-reps N] [-kernels k1,k2,...] [-twonorm DIR] [-o results.jsonl]
+ *
+ * Kernels (one operation each):
+ *   mlhmslbp  faceDetect (detector_mlhmslbp_spyr, face model of models.bin)
+ *             of an image
+ *   haar      detect_haar of an image, default model of detector_haar.c
+ *   mblbp     detect_mblbp of an image, default model of detector_mblbp.c
+ *   posifeat  CreatePosiFeat of a 128x128 face (coord, AB)
+ *   haarfeat  CreateHaarFeat of the integral image of the face (coord, haarPara)
+ *   regions   facial regions forest (modelRF, quantised) on the features
+ *             of the face
+ *   twonorm   the trees and the vote of classForest, for a forest trained
+ *             on the twonorm data of RF_Class_C, over its 300 samples
+ *
+ * The images are 8-bit binary PGM (convert image.jpg image.pgm); the
+ * faces are the first face found by drowsyDetect in every image, or
+ * its centre when there is none, normalised by NormFace.
+ *
+ * Every kernel runs once on every input to warm up and compute its
+ * check value (same inputs, same value: compare it between runs and
+ * builds), then for every thread count: each thread goes reps times
+ * over the inputs, from a different first input. Reported per kernel
+ * and thread count: throughput, latency of one operation (mean, p50,
+ * p90, p99, max), heap allocations and bytes asked per operation
+ * (malloc/calloc/realloc of the linked objects, wrapped at link time,
+ * and operator new) and peak RSS (VmHWM, reset before every run where
+ * /proc/self/clear_refs allows it, else the peak of the process so far).
+ * -o writes the same as JSON lines, one object per kernel and thread count.
+ *************************************************************/
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+#include "drowsy.h"
+#include "bench_detectors.h"
+#include "frame_source.h"
+
+/* NormFace_mex.cpp, CreatePosiFeat_mex.cpp, CreateHaarFeat_mex.cpp (NO_MEXFUNCTION) */
+int NormFace(const unsigned char *frame, int Ny, int Nx, const double *rect,
+        unsigned char *face, double *ii);
+void CreatePosiFeat(double *img, double *coord, int coord_dimy, double *featPa,
+        int featPa_dimy, double *featMat);
+void CreateHaarFeat(double *img, int img_dimy, int img_dimx, double *coord,
+        int coord_dimy, double *featPa, int featPa_dimy, double *featMat);
+
+/* classRF.cpp, declared as in RF_Class_C/src/twonorm_C_wrapper.cpp */
+void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
+        int *sampsize, int *strata, int *Options, int *ntree, int *nvar,
+        int *ipi, double *classwt, double *cut, int *nodesize,
+        int *outcl, int *counttr, double *prox,
+        double *imprt, double *impsd, double *impmat, int *nrnodes,
+        int *ndbigtree, int *nodestatus, int *bestvar, int *treemap,
+        int *nodeclass, double *xbestsplit, double *errtr,
+        int *testdat, double *xts, int *clts, int *nts, double *countts,
+        int *outclts, int labelts, double *proxts, double *errts,
+        int *inbag);
+
+/*------------------------------ allocations ------------------------------*/
+
+/* the Makefile links drowsy_bench with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free */
+static std::atomic<long long> allocCount(0), allocBytes(0);
+
+static void countAlloc(size_t n) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add((long long) n, std::memory_order_relaxed);
+}
+
+extern "C" {
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+    countAlloc(n);
+    return __real_malloc(n);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    countAlloc(n * size);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t n) {
+    countAlloc(n);
+    return __real_realloc(p, n);
+}
+
+void __wrap_free(void *p) {
+    __real_free(p);
+}
+}
+
+void *operator new(size_t n) {
+    void *p;
+
+    countAlloc(n);
+    p = __real_malloc(n ? n : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t n) {
+    return operator new(n);
+}
+
+void operator delete(void *p) noexcept {
+    __real_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    __real_free(p);
+}
+
+/*------------------------------ peak RSS ------------------------------*/
+
+/* resets VmHWM to the current RSS (Linux >= 4.0); returns 0 if it cannot */
+static int resetPeakRss() {
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    int ok;
+
+    if (fp == NULL) return 0;
+    ok = fputs("5", fp) >= 0;
+    return (fclose(fp) == 0) && ok;
+}
+
+/* peak resident set size (kB) */
+static long peakRss() {
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    long kb = -1;
+    struct rusage ru;
+
+    if (fp) {
+        while (fgets(line, sizeof(line), fp))
+            if (!strncmp(line, "VmHWM:", 6)) {
+                kb = atol(line + 6);
+                break;
+            }
+        fclose(fp);
+    }
+    if (kb < 0 && getrusage(RUSAGE_SELF, &ru) == 0) kb = ru.ru_maxrss;
+    return kb;
+}
+
+/*------------------------------ inputs ------------------------------*/
+
+struct benchImage {
+    const char *file;
+    int Ny, Nx;
+    unsigned char *gray;        /* Ny x Nx, column-major */
+};
+
+/* 8-bit binary PGM (P5) into a column-major image; returns 0 on error */
+static int readPgm(const char *file, benchImage *im) {
+    FILE *fp = fopen(file, "rb");
+    int v[3], w, h, maxval, x, y, c, k;
+    unsigned char *row;
+    char magic[3] = {0, 0, 0};
+
+    if (fp == NULL) return 0;
+    if (fread(magic, 1, 2, fp) != 2 || strcmp(magic, "P5")) {
+        fclose(fp);
+        return 0;
+    }
+    /* width, height, maxval, with # comments */
+    for (k = 0; k < 3; k++) {
+        while ((c = fgetc(fp)) == '#' || (c != EOF && isspace(c)))
+            if (c == '#')
+                while ((c = fgetc(fp)) != '\n' && c != EOF);
+        if (c == EOF) { fclose(fp); return 0; }
+        ungetc(c, fp);
+        if (fscanf(fp, "%d", v + k) != 1) { fclose(fp); return 0; }
+    }
+    w = v[0]; h = v[1]; maxval = v[2];
+    fgetc(fp);
+    if (w <= 0 || h <= 0 || maxval <= 0 || maxval > 255) {
+        fclose(fp);
+        return 0;
+    }
+    im->file = file;
+    im->Ny = h;
+    im->Nx = w;
+    im->gray = (unsigned char *) malloc((size_t) w * h);
+    row = (unsigned char *) malloc(w);
+    for (y = 0; y < h; y++) {
+        if (fread(row, 1, w, fp) != (size_t) w) {
+            free(row);
+            free(im->gray);
+            fclose(fp);
+            return 0;
+        }
+        for (x = 0; x < w; x++) im->gray[(size_t) x * h + y] = row[x];
+    }
+    free(row);
+    fclose(fp);
+    return 1;
+}
+
+/* a normalised face: double(face) for CreatePosiFeat, integral image
+   for CreateHaarFeat and the features of its sample points */
+struct benchFace {
+    double *faced, *ii, *feat;
+};
+
+static void makeFace(const drowsyModels *m, benchImage *im, drowsyWork *w, benchFace *f) {
+    drowsyFace faces[DROWSY_MAX_FACES];
+    int n = drowsyDetect(m, im->gray, im->Ny, im->Nx, faces), i;
+    double s = 0.5 * (im->Ny < im->Nx ? im->Ny : im->Nx);
+    double rect[4] = {0.5 * (im->Nx - s), 0.5 * (im->Ny - s), s, s};
+    double faceRect[4];
+
+    if (n > 0) {
+        /* as drowsyAnalyseFace */
+        faceRect[0] = faces[0].det[0] - 5;
+        faceRect[1] = faces[0].det[1] - 5;
+        faceRect[2] = faceRect[3] = 1.1 * faces[0].det[2];
+    }
+    if (n == 0 || NormFace(im->gray, im->Ny, im->Nx, faceRect, w->face, w->ii))
+        NormFace(im->gray, im->Ny, im->Nx, rect, w->face, w->ii);
+
+    f->faced = (double *) malloc(DROWSY_FACE * DROWSY_FACE * sizeof(double));
+    f->ii    = (double *) malloc(DROWSY_FACE * DROWSY_FACE * sizeof(double));
+    f->feat  = (double *) malloc((size_t) m->ncoord * m->mdim * sizeof(double));
+    for (i = 0; i < DROWSY_FACE * DROWSY_FACE; i++) f->faced[i] = w->face[i];
+    memcpy(f->ii, w->ii, DROWSY_FACE * DROWSY_FACE * sizeof(double));
+    CreatePosiFeat(f->faced, m->coord, m->ncoord, m->AB, m->nAB, f->feat);
+    CreateHaarFeat(f->ii, DROWSY_FACE, DROWSY_FACE, m->coord, m->ncoord, m->haarPara,
+            m->nhaar, f->feat + (size_t) m->ncoord * m->nAB);
+}
+
+/*------------------------------ kernels ------------------------------*/
+
+class benchKernel {
+public:
+    const char *name;
+    int ninputs;
+
+    benchKernel(const char *name_, int ninputs_) : name(name_), ninputs(ninputs_) {}
+    virtual ~benchKernel() {}
+    /* buffers of nthreads threads */
+    virtual void setup(int /* nthreads */) {}
+    /* one operation on input i by thread t; its check value if verify */
+    virtual double run(int t, int i, int verify) = 0;
+};
+
+enum { DETECT_MLHMSLBP, DETECT_HAAR, DETECT_MBLBP };
+
+class detectKernel : public benchKernel {
+    const drowsyModels *models;
+    std::vector<benchImage> &images;
+    int kind;
+public:
+    detectKernel(const char *name_, int kind_, const drowsyModels *m,
+            std::vector<benchImage> &im)
+        : benchKernel(name_, (int) im.size()), models(m), images(im), kind(kind_) {}
+
+    double run(int, int i, int verify) {
+        benchImage *im = &images[i];
+        double *D, check = 0;
+        int nD = 0, k;
+
+        if (kind == DETECT_MLHMSLBP)
+            D = faceDetect(models->face, im->gray, im->Ny, im->Nx, &nD);
+        else if (kind == DETECT_HAAR)
+            D = benchDetectHaar(im->gray, im->Ny, im->Nx, &nD);
+        else
+            D = benchDetectMblbp(im->gray, im->Ny, im->Nx, &nD);
+        if (verify)
+            for (k = 0; k < 5 * nD; k++) check += D[k];
+        free(D);
+        return check;
+    }
+};
+
+class featKernel : public benchKernel {
+    const drowsyModels *m;
+    std::vector<benchFace> &faces;
+    std::vector<std::vector<double> > out;
+    int haar;
+public:
+    featKernel(const char *name_, int haar_, const drowsyModels *m_, std::vector<benchFace> &f)
+        : benchKernel(name_, (int) f.size()), m(m_), faces(f), haar(haar_) {}
+
+    void setup(int nthreads) {
+        out.assign(nthreads, std::vector<double>((size_t) m->ncoord *
+                (haar ? m->nhaar : m->nAB)));
+    }
+
+    double run(int t, int i, int verify) {
+        double *o = &out[t][0], check = 0;
+        size_t k;
+
+        if (haar)
+            CreateHaarFeat(faces[i].ii, DROWSY_FACE, DROWSY_FACE, m->coord, m->ncoord,
+                    m->haarPara, m->nhaar, o);
+        else
+            CreatePosiFeat(faces[i].faced, m->coord, m->ncoord, m->AB, m->nAB, o);
+        if (verify)
+            for (k = 0; k < out[t].size(); k++) check += o[k];
+        return check;
+    }
+};
+
+class regionsKernel : public benchKernel {
+    const drowsyModels *m;
+    std::vector<benchFace> &faces;
+    std::vector<drowsyWork> work;
+public:
+    regionsKernel(const drowsyModels *m_, std::vector<benchFace> &f)
+        : benchKernel("regions", (int) f.size()), m(m_), faces(f) {}
+
+    ~regionsKernel() {
+        setup(0);
+    }
+
+    void setup(int nthreads) {
+        size_t k;
+
+        for (k = 0; k < work.size(); k++) drowsyFreeWork(&work[k]);
+        work.resize(nthreads);
+        for (k = 0; k < work.size(); k++) drowsyNewWork(m, &work[k]);
+    }
+
+    double run(int t, int i, int verify) {
+        drowsyWork *w = &work[t];
+        double *own = w->feat, check = 0;
+        int k;
+
+        w->feat = faces[i].feat;
+        drowsyLabelRegions(m, w);
+        w->feat = own;
+        if (verify)
+            for (k = 0; k < m->ncoord; k++) check += w->label[k];
+        return check;
+    }
+};
+
+#define TWONORM_ROWS 300
+#define TWONORM_COLS 20
+/* odd: with two classes the votes never tie, but classForestVote still
+   draws from the random generator of RF_Class_C, which is not thread-safe,
+   for every sample; each thread breaks the ties with a generator of its own */
+#define TWONORM_NTREE 501
+
+/* xorshift32 in [0,1) for classForestVoteRand */
+static double twonormRand(void *state) {
+    unsigned int *r = (unsigned int *) state;
+
+    *r ^= *r << 13;
+    *r ^= *r >> 17;
+    *r ^= *r << 5;
+    return *r / 4294967296.0;
+}
+
+class twonormKernel : public benchKernel {
+    int mdim, ntest, nclass, ntree, nrnodes, maxcat;
+    std::vector<double> X, xbestsplit, classwt, cutoff;
+    std::vector<int> Y, cat, ndbigtree, nodestatus, bestvar, treemap, nodeclass;
+    struct buffers {
+        std::vector<double> countts;
+        std::vector<int> jts, jet, node;
+        unsigned int rand;
+    };
+    std::vector<buffers> buf;
+public:
+    int ok;
+
+    twonormKernel(const char *dir)
+            : benchKernel("twonorm", 1), mdim(TWONORM_COLS), ntest(TWONORM_ROWS), nclass(2),
+              ntree(TWONORM_NTREE), nrnodes(0), maxcat(1), ok(0) {
+        char file[1024], str[100];
+        FILE *fx, *fy;
+        int i;
+
+        X.resize(TWONORM_ROWS * TWONORM_COLS);
+        Y.resize(TWONORM_ROWS);
+        snprintf(file, sizeof(file), "%s/X_twonorm.txt", dir);
+        fx = fopen(file, "r");
+        snprintf(file, sizeof(file), "%s/Y_twonorm.txt", dir);
+        fy = fopen(file, "r");
+        if (fx && fy) {
+            ok = 1;
+            for (i = 0; i < TWONORM_ROWS * TWONORM_COLS && ok; i++) {
+                ok = fscanf(fx, "%99s ", str) == 1;
+                X[i] = atof(str);
+            }
+            for (i = 0; i < TWONORM_ROWS && ok; i++) {
+                ok = fscanf(fy, "%99s ", str) == 1;
+                Y[i] = (int) atof(str);
+            }
+        }
+        if (fx) fclose(fx);
+        if (fy) fclose(fy);
+        if (ok) train();
+    }
+
+    /* same settings as RF_Class_C/src/twonorm_C_wrapper.cpp, without the trace */
+    void train() {
+        int dimx[2] = {mdim, ntest}, sampsize = ntest, strata = 1, ipi = 0, nodesize = 1;
+        int Options[] = {0, 0, 0, 0, 0, 0, 1, 1, 0, 0};
+        int mtry = (int) floor(sqrt((double) mdim));
+        int testdat = 0, clts = 1, nts = 0, outclts = 0, labelts = 0;
+        double prox = 1, impSD = 1, impmat = 1, xts = 1, proxts = 1, errts = 1, countts = 0;
+        std::vector<int> outcl(ntest), counttr(nclass * ntest), inbag(ntest);
+        std::vector<double> impout(mdim), errtr((nclass + 1) * ntree);
+
+        cat.assign(mdim, 1);
+        classwt.assign(nclass, 1.0);
+        cutoff.assign(nclass, 1.0 / nclass);
+        nrnodes = 2 * ntest / nodesize + 1;
+        ndbigtree.resize(ntree);
+        nodestatus.resize((size_t) ntree * nrnodes);
+        bestvar.resize((size_t) ntree * nrnodes);
+        treemap.resize((size_t) ntree * 2 * nrnodes);
+        nodeclass.resize((size_t) ntree * nrnodes);
+        xbestsplit.resize((size_t) ntree * nrnodes);
+        classRF(&X[0], dimx, &Y[0], &nclass, &cat[0], &maxcat, &sampsize, &strata, Options,
+                &ntree, &mtry, &ipi, &classwt[0], &cutoff[0], &nodesize, &outcl[0],
+                &counttr[0], &prox, &impout[0], &impSD, &impmat, &nrnodes, &ndbigtree[0],
+                &nodestatus[0], &bestvar[0], &treemap[0], &nodeclass[0], &xbestsplit[0],
+                &errtr[0], &testdat, &xts, &clts, &nts, &countts, &outclts, labelts,
+                &proxts, &errts, &inbag[0]);
+    }
+
+    void setup(int nthreads) {
+        int k;
+
+        buf.resize(nthreads);
+        for (k = 0; k < nthreads; k++) {
+            buf[k].countts.resize(nclass * ntest);
+            buf[k].jts.resize(ntest);
+            buf[k].jet.resize(ntest);
+            buf[k].node.resize(ntest);
+            buf[k].rand = 2463534242u + k;
+        }
+    }
+
+    /* the labels of the 300 samples; check: training errors */
+    double run(int t, int, int verify) {
+        buffers *b = &buf[t];
+        size_t idx;
+        int j, k, errors = 0;
+
+        /* classForest without keepPred, proximities and nodes */
+        std::fill(b->countts.begin(), b->countts.end(), 0.0);
+        for (j = 0; j < ntree; j++) {
+            idx = (size_t) j * nrnodes;
+            predictClassTree(&X[0], ntest, mdim, &treemap[2 * idx], &nodestatus[idx],
+                    &xbestsplit[idx], &bestvar[idx], &nodeclass[idx], ndbigtree[j], &cat[0],
+                    nclass, &b->jts[0], &b->node[0], maxcat);
+            for (k = 0; k < ntest; k++) b->countts[b->jts[k] - 1 + k * nclass] += 1.0;
+        }
+        classForestVoteRand(&b->countts[0], &cutoff[0], ntree, nclass, ntest, &b->jet[0],
+                twonormRand, &b->rand);
+        if (verify)
+            for (k = 0; k < ntest; k++) errors += b->jet[k] != Y[k];
+        return errors;
+    }
+};
+
+/*------------------------------ driver ------------------------------*/
+
+static double percentile(const std::vector<double> &v, double p) {
+    size_t k = (size_t) ceil(p / 100.0 * v.size());
+
+    if (v.empty()) return 0;
+    return v[k > 0 ? (k > v.size() ? v.size() - 1 : k - 1) : 0];
+}
+
+static void runKernel(benchKernel *k, int nthreads, int reps, double check, FILE *json) {
+    std::vector<std::vector<double> > lat(nthreads);
+    std::vector<std::thread> threads;
+    std::vector<double> all;
+    std::atomic<int> ready(0), go(0);
+    long long count0, bytes0, ops;
+    double t0, T, mean = 0;
+    long rss;
+    int t, rssReset;
+    size_t j;
+
+    k->setup(nthreads);
+    for (t = 0; t < nthreads; t++) lat[t].reserve((size_t) reps * k->ninputs);
+    rssReset = resetPeakRss();
+
+    for (t = 0; t < nthreads; t++)
+        threads.push_back(std::thread([&, t]() {
+            int r, i, idx;
+            double s;
+
+            ready.fetch_add(1);
+            while (!go.load()) std::this_thread::yield();
+            for (r = 0; r < reps; r++)
+                for (i = 0; i < k->ninputs; i++) {
+                    idx = (i + t) % k->ninputs;
+                    s = pipelineNow();
+                    k->run(t, idx, 0);
+                    lat[t].push_back(pipelineNow() - s);
+                }
+        }));
+    while (ready.load() < nthreads) std::this_thread::yield();
+    count0 = allocCount.load();
+    bytes0 = allocBytes.load();
+    t0 = pipelineNow();
+    go.store(1);
+    for (t = 0; t < nthreads; t++) threads[t].join();
+    T = pipelineNow() - t0;
+    count0 = allocCount.load() - count0;
+    bytes0 = allocBytes.load() - bytes0;
+    rss = peakRss();
+
+    for (t = 0; t < nthreads; t++) all.insert(all.end(), lat[t].begin(), lat[t].end());
+    std::sort(all.begin(), all.end());
+    for (j = 0; j < all.size(); j++) mean += all[j];
+    ops = (long long) all.size();
+    mean = ops ? mean / ops : 0;
+
+    printf("%-9s %7d %7lld %10.2f %9.3f %9.3f %9.3f %9.3f %9.3f %9.1f %10.1f %9.1f %s %.10g\n",
+            k->name, nthreads, ops, T > 0 ? ops / T : 0.0, 1e3 * mean,
+            1e3 * percentile(all, 50), 1e3 * percentile(all, 90), 1e3 * percentile(all, 99),
+            ops ? 1e3 * all.back() : 0.0, ops ? (double) count0 / ops : 0.0,
+            ops ? bytes0 / 1024.0 / ops : 0.0, rss / 1024.0, rssReset ? " " : "*", check);
+    fflush(stdout);
+    if (json)
+        fprintf(json, "{\"kernel\":\"%s\",\"threads\":%d,\"inputs\":%d,\"reps\":%d,\"ops\":%lld,"
+                "\"seconds\":%.6f,\"ops_per_s\":%.6g,\"mean_ms\":%.6g,\"p50_ms\":%.6g,"
+                "\"p90_ms\":%.6g,\"p99_ms\":%.6g,\"max_ms\":%.6g,\"allocs_per_op\":%.6g,"
+                "\"bytes_per_op\":%.6g,\"peak_rss_kb\":%ld,\"peak_rss_reset\":%s,\"check\":%.17g}\n",
+                k->name, nthreads, k->ninputs, reps, ops, T, T > 0 ? ops / T : 0.0, 1e3 * mean,
+                1e3 * percentile(all, 50), 1e3 * percentile(all, 90), 1e3 * percentile(all, 99),
+                ops ? 1e3 * all.back() : 0.0, ops ? (double) count0 / ops : 0.0,
+                ops ? (double) bytes0 / ops : 0.0, rss, rssReset ? "true" : "false", check);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: drowsy_bench models.bin image.pgm [image.pgm ...] [-threads 1,2,4] "
+            "[-reps N] [-kernels k1,k2,...]\n"
+            "       [-twonorm DIR] [-o results.jsonl]\n"
+            "kernels: mlhmslbp haar mblbp posifeat haarfeat regions twonorm\n");
+    exit(1);
+}
+
+/* comma separated list, or NULL for all */
+static int selected(const char *list, const char *name) {
+    const char *p = list;
+    size_t n = strlen(name);
+
+    if (list == NULL) return 1;
+    while ((p = strstr(p, name)) != NULL) {
+        if ((p == list || p[-1] == ',') && (p[n] == ',' || p[n] == 0)) return 1;
+        p += n;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    drowsyModels models;
+    drowsyWork work;
+    std::vector<benchImage> images;
+    std::vector<benchFace> faces;
+    std::vector<benchKernel *> kernels;
+    std::vector<int> nthreads;
+    const char *threadList = NULL, *kernelList = NULL, *outFile = NULL;
+    const char *twonormDir = "../RF_Class_C/data";
+    char err[256];
+    FILE *json = NULL;
+    int reps = 3, i, t, n;
+    double check;
+    size_t k;
+
+    if (argc < 3) usage();
+    for (i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            threadList = argv[++i];
+        else if (!strcmp(argv[i], "-reps") && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-kernels") && i + 1 < argc)
+            kernelList = argv[++i];
+        else if (!strcmp(argv[i], "-twonorm") && i + 1 < argc)
+            twonormDir = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            outFile = argv[++i];
+        else if (argv[i][0] == '-')
+            usage();
+        else {
+            benchImage im;
+            if (!readPgm(argv[i], &im)) {
+                fprintf(stderr, "%s is not an 8-bit binary PGM\n", argv[i]);
+                return 1;
+            }
+            images.push_back(im);
+        }
+    }
+    if (images.empty() || reps < 1) usage();
+    if (threadList) {
+        const char *p = threadList;
+        while (*p) {
+            t = atoi(p);
+            if (t < 1) usage();
+            nthreads.push_back(t);
+            p += strcspn(p, ",");
+            if (*p == ',') p++;
+        }
+    } else {
+        nthreads.push_back(1);
+        n = (int) std::thread::hardware_concurrency();
+        if (n > 1) nthreads.push_back(n);
+    }
+
+    if (drowsyLoadModels(argv[1], &models, err, sizeof(err))) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+    if (outFile && (json = fopen(outFile, "w")) == NULL) {
+        fprintf(stderr, "cannot write %s\n", outFile);
+        drowsyFreeModels(&models);
+        return 1;
+    }
+    benchDetectorsInit();
+    drowsyNewWork(&models, &work);
+    faces.resize(images.size());
+    for (k = 0; k < images.size(); k++) makeFace(&models, &images[k], &work, &faces[k]);
+    drowsyFreeWork(&work);
+
+    if (selected(kernelList, "mlhmslbp"))
+        kernels.push_back(new detectKernel("mlhmslbp", DETECT_MLHMSLBP, &models, images));
+    if (selected(kernelList, "haar"))
+        kernels.push_back(new detectKernel("haar", DETECT_HAAR, &models, images));
+    if (selected(kernelList, "mblbp"))
+        kernels.push_back(new detectKernel("mblbp", DETECT_MBLBP, &models, images));
+    if (selected(kernelList, "posifeat"))
+        kernels.push_back(new featKernel("posifeat", 0, &models, faces));
+    if (selected(kernelList, "haarfeat"))
+        kernels.push_back(new featKernel("haarfeat", 1, &models, faces));
+    if (selected(kernelList, "regions"))
+        kernels.push_back(new regionsKernel(&models, faces));
+    if (selected(kernelList, "twonorm")) {
+        twonormKernel *tn = new twonormKernel(twonormDir);
+        if (!tn->ok) {
+            fprintf(stderr, "cannot read %s/X_twonorm.txt and Y_twonorm.txt (-twonorm DIR)\n",
+                    twonormDir);
+            if (json) fclose(json);
+            drowsyFreeModels(&models);
+            return 1;
+        }
+        kernels.push_back(tn);
+    }
+
+    printf("%d images, %d reps, peak RSS %s\n", (int) images.size(), reps,
+            resetPeakRss() ? "per run" : "of the process so far (*)");
+    printf("%-9s %7s %7s %10s %9s %9s %9s %9s %9s %9s %10s %9s   %s\n", "kernel", "threads",
+            "ops", "ops/s", "mean(ms)", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)",
+            "allocs/op", "KB/op", "rss(MB)", "check");
+    for (k = 0; k < kernels.size(); k++) {
+        kernels[k]->setup(1);
+        check = 0;
+        for (i = 0; i < kernels[k]->ninputs; i++) check += kernels[k]->run(0, i, 1);
+        for (t = 0; t < (int) nthreads.size(); t++)
+            runKernel(kernels[k], nthreads[t], reps, check, json);
+        delete kernels[k];
+    }
+
+    if (json) fclose(json);
+    for (k = 0; k < images.size(); k++) {
+        free(images[k].gray);
+        free(faces[k].faced);
+        free(faces[k].ii);
+        free(faces[k].feat);
+    }
+    benchDetectorsFree();
+    drowsyFreeModels(&models);
+    return 0;
+}
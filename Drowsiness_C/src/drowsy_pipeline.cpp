@@ -0,0 +1,86 @@
+/**************************************************************
+ * drowsy_pipeline: runs the threaded pipeline on a raw gray video
+ *
+ *   drowsy_pipeline models.bin video.gray WIDTH HEIGHT [-fps F] [-depth N]
+ *                   [-drop] [-o results.csv] [-trace trace.json] [-hist latency.hgrm]
+ *
+ * models.bin is written by export_models.m, video.gray by
+ *   ffmpeg -i video.avi -f rawvideo -pix_fmt gray video.gray
+ * ("-" reads the frames from stdin). -fps paces the source as a camera
+ * would, -drop lets the detection and eye stages drop frames instead
+ * of waiting. The per-stage statistics are printed at the end; with
+ * -trace/-hist the latencies of the stages of the detector and of the
+ * eye analysis are recorded too (trace.h): Chrome trace JSON, HDR
+ * histograms and their p50/p99.
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+#include "trace.h"
+
+static void usage() {
+    fprintf(stderr, "usage: drowsy_pipeline models.bin video.gray WIDTH HEIGHT "
+            "[-fps F] [-depth N] [-drop] [-o results.csv]\n"
+            "       [-trace trace.json] [-hist latency.hgrm]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    pipelineOptions opt;
+    drowsyModels models;
+    frameSource *src;
+    char err[256];
+    const char *outFile = NULL, *traceFile = NULL, *histFile = NULL;
+    int i;
+
+    if (argc < 5) usage();
+    defaultPipelineOptions(&opt);
+    for (i = 5; i < argc; i++) {
+        if (!strcmp(argv[i], "-fps") && i + 1 < argc)
+            opt.fps = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+            opt.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-drop"))
+            opt.dropWhenFull = 1;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            outFile = argv[++i];
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (!strcmp(argv[i], "-hist") && i + 1 < argc)
+            histFile = argv[++i];
+        else
+            usage();
+    }
+
+    if (drowsyLoadModels(argv[1], &models, err, sizeof(err))) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+    src = openRawGray(argv[2], atoi(argv[3]), atoi(argv[4]));
+    if (src == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[2]);
+        drowsyFreeModels(&models);
+        return 1;
+    }
+    if (outFile) {
+        opt.out = fopen(outFile, "w");
+        if (opt.out == NULL) {
+            fprintf(stderr, "cannot write %s\n", outFile);
+            delete src;
+            drowsyFreeModels(&models);
+            return 1;
+        }
+    }
+
+    if (traceFile || histFile) traceStart(traceFile ? TRACE_EVENTS : 0);
+    drowsyPipeline pipeline(&models, src, opt);
+    pipeline.run();
+    pipeline.printStats(stdout);
+    traceReport(stdout, traceFile, histFile);
+
+    if (opt.out) fclose(opt.out);
+    delete src;
+    drowsyFreeModels(&models);
+    return 0;
+}
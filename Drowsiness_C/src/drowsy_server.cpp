@@ -0,0 +1,96 @@
+/**************************************************************
+ * drowsy_server: many streams on one host
+ *
+ *   drowsy_server models.bin WIDTH HEIGHT video.gray [video.gray ...]
+ *                 [-copies N] [-threads N] [-fps F] [-loops N] [-o results.csv]
+ *                 [-trace trace.json] [-hist latency.hgrm]
+ *
+ * Every raw gray video (see drowsy_pipeline) is replayed as a camera:
+ * -copies opens each file N times as separate streams, -fps paces
+ * them (0: as fast as the workers go), -loops replays them N times.
+ * -threads sets the size of the worker pool (default: one per core).
+ * The per-stream and per-worker statistics are printed at the end;
+ * -trace/-hist record the stage latencies as in drowsy_pipeline.
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server.h"
+#include "trace.h"
+
+static void usage() {
+    fprintf(stderr, "usage: drowsy_server models.bin WIDTH HEIGHT video.gray [video.gray ...] "
+            "[-copies N] [-threads N] [-fps F] [-loops N] [-o results.csv]\n"
+            "       [-trace trace.json] [-hist latency.hgrm]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    drowsyModels models;
+    std::vector<const char *> files;
+    const char *outFile = NULL, *traceFile = NULL, *histFile = NULL;
+    int width, height, copies = 1, nthreads = 0, loops = 1, i, c;
+    double fps = 0;
+    FILE *out = NULL;
+    frameSource *src;
+    char err[256];
+    size_t k;
+
+    if (argc < 5) usage();
+    width = atoi(argv[2]);
+    height = atoi(argv[3]);
+    for (i = 4; i < argc; i++) {
+        if (!strcmp(argv[i], "-copies") && i + 1 < argc)
+            copies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            nthreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-fps") && i + 1 < argc)
+            fps = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-loops") && i + 1 < argc)
+            loops = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            outFile = argv[++i];
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (!strcmp(argv[i], "-hist") && i + 1 < argc)
+            histFile = argv[++i];
+        else if (argv[i][0] == '-')
+            usage();
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty() || copies < 1) usage();
+
+    if (drowsyLoadModels(argv[1], &models, err, sizeof(err))) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+    if (outFile && (out = fopen(outFile, "w")) == NULL) {
+        fprintf(stderr, "cannot write %s\n", outFile);
+        drowsyFreeModels(&models);
+        return 1;
+    }
+
+    {
+        drowsyServer server(&models, nthreads, out);
+        for (k = 0; k < files.size(); k++)
+            for (c = 0; c < copies; c++) {
+                src = openReplay(files[k], width, height, fps, loops);
+                if (src == NULL) {
+                    fprintf(stderr, "cannot replay %s\n", files[k]);
+                    if (out) fclose(out);
+                    drowsyFreeModels(&models);
+                    return 1;
+                }
+                server.addStream(src);
+            }
+        if (traceFile || histFile) traceStart(traceFile ? TRACE_EVENTS : 0);
+        server.run();
+        server.printStats(stdout);
+        traceReport(stdout, traceFile, histFile);
+    }
+
+    if (out) fclose(out);
+    drowsyFreeModels(&models);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**************************************************************
+ * Face detector of the native drowsiness pipeline
+ *
+ * detector_mlhmslbp_spyr.c of fdtool is compiled here as plain C
+ * (NO_MEXFUNCTION); faceDetectorNew fills its struct model the way
+ * its mexFunction does from the MATLAB model structure. Its
+ * STAGE_BEGIN/STAGE_END hooks record the INTEGRAL, LBP, SCAN and MERGE
+ * stages in trace.h.
+ *************************************************************/
+#include "trace.h"
+
+#define NO_MEXFUNCTION
+#define STAGE_BEGIN(stage) long long stage##_t0 = traceBegin()
+#define STAGE_END(stage)   traceEnd(TRACE_##stage, stage##_t0)
+#include "../../fdtool_release/fdtool_release/detector_mlhmslbp_spyr.c"
+
+#include <stdio.h>
+#include <string.h>
+#include "face_detector.h"
+
+struct faceDetector {
+    struct model m;
+};
+
+static const drowsyArray *findArray(const drowsyArray *arrays, int narrays,
+        const char *prefix, const char *field) {
+    int i, lp = (int) strlen(prefix);
+
+    for (i = 0; i < narrays; i++)
+        if (!strncmp(arrays[i].name, prefix, lp) && !strcmp(arrays[i].name + lp, field))
+            return arrays + i;
+    return NULL;
+}
+
+static double *copyOf(const double *src, int n) {
+    double *dst = (double *) malloc((n > 0 ? n : 1) * sizeof(double));
+    if (src) memcpy(dst, src, n * sizeof(double));
+    return dst;
+}
+
+/* scalar field, or def when absent */
+static double scalarOr(const drowsyArray *arrays, int narrays, const char *prefix,
+        const char *field, double def) {
+    const drowsyArray *a = findArray(arrays, narrays, prefix, field);
+    return (a && a->rows * a->cols > 0) ? a->data[0] : def;
+}
+
+faceDetector *faceDetectorNew(const drowsyArray *arrays, int narrays,
+        const char *prefix, char *err, int errlen) {
+    double scalingbox_default[3] = {2 , 1.4 , 1.8};
+    double mergingbox_default[3] = {1.0/2 , 1.0/2 , 0.8};
+    double norm_default[3]       = {0 , 0 , 4};
+    double spyr_default[5]       = {1 , 1 , 1 , 1 , 1};
+    double scale_default         = 1.0;
+    const drowsyArray *a;
+    faceDetector *d;
+    struct model *m;
+
+    a = findArray(arrays, narrays, prefix, "w");
+    if (a == NULL) {
+        snprintf(err, errlen, "%sw is missing", prefix);
+        return NULL;
+    }
+    d = (faceDetector *) calloc(1, sizeof(faceDetector));
+    m = &d->m;
+
+    m->nw             = a->rows * a->cols;
+    m->w              = copyOf(a->data, m->nw);
+    m->addbias        = (int) scalarOr(arrays, narrays, prefix, "addbias", 0);
+    m->n              = (int) scalarOr(arrays, narrays, prefix, "n", 0);
+    m->L              = scalarOr(arrays, narrays, prefix, "L", 0.5);
+    m->kerneltype     = (int) scalarOr(arrays, narrays, prefix, "kerneltype", 0);
+    m->numsubdiv      = (int) scalarOr(arrays, narrays, prefix, "numsubdiv", 8);
+    m->minexponent    = (int) scalarOr(arrays, narrays, prefix, "minexponent", -20);
+    m->maxexponent    = (int) scalarOr(arrays, narrays, prefix, "maxexponent", 8);
+    m->cs_opt         = (int) scalarOr(arrays, narrays, prefix, "cs_opt", 0);
+    m->improvedLBP    = m->cs_opt ? 0 : (int) scalarOr(arrays, narrays, prefix, "improvedLBP", 0);
+    m->rmextremebins  = (int) scalarOr(arrays, narrays, prefix, "rmextremebins", 1);
+    m->clamp          = scalarOr(arrays, narrays, prefix, "clamp", 0.2);
+    m->maptable       = (int) scalarOr(arrays, narrays, prefix, "maptable", 0);
+    m->postprocessing = (int) scalarOr(arrays, narrays, prefix, "postprocessing", 1);
+    m->max_detections = (int) scalarOr(arrays, narrays, prefix, "max_detections", 500);
+    m->ny             = 24;
+    m->nx             = 24;
+
+    a = findArray(arrays, narrays, prefix, "dimsIscan");
+    if (a && a->rows * a->cols == 2) {
+        m->ny = (int) a->data[0];
+        m->nx = (int) a->data[1];
+    }
+
+    a = findArray(arrays, narrays, prefix, "scale");
+    m->nscale = a ? a->rows * a->cols : 1;
+    m->scale  = copyOf(a ? a->data : &scale_default, m->nscale);
+
+    a = findArray(arrays, narrays, prefix, "spyr");
+    if (a && a->cols != 5) {
+        snprintf(err, errlen, "%sspyr must be (nspyr x 5)", prefix);
+        faceDetectorFree(d);
+        return NULL;
+    }
+    m->nspyr = a ? a->rows : 1;
+    m->spyr  = copyOf(a ? a->data : spyr_default, 5 * m->nspyr);
+    m->nH    = (int) scalarOr(arrays, narrays, prefix, "nH",
+            number_histo_lbp(m->spyr, m->nspyr, m->nscale));
+
+    a = findArray(arrays, narrays, prefix, "norm");
+    m->norm       = copyOf((a && a->rows * a->cols == 3) ? a->data : norm_default, 3);
+    a = findArray(arrays, narrays, prefix, "scalingbox");
+    m->scalingbox = copyOf((a && a->rows * a->cols == 3) ? a->data : scalingbox_default, 3);
+    a = findArray(arrays, narrays, prefix, "mergingbox");
+    m->mergingbox = copyOf((a && a->rows * a->cols == 3) ? a->data : mergingbox_default, 3);
+
+    m->homtable  = NULL;
+    m->nhomtable = 0;
+    if (m->n > 0) {
+        m->nhomtable = (2*m->n + 1) * (m->maxexponent - m->minexponent + 1) * m->numsubdiv;
+        a = findArray(arrays, narrays, prefix, "homtable");
+        if (a && a->rows * a->cols != m->nhomtable) {
+            snprintf(err, errlen, "%shomtable must be (1 x (2*n+1)*(maxexponent - minexponent + 1)*numsubdiv)", prefix);
+            faceDetectorFree(d);
+            return NULL;
+        }
+        m->homtable = copyOf(a ? a->data : NULL, m->nhomtable);
+        if (a == NULL) homkertable(*m, m->homtable);
+    }
+
+    return d;
+}
+
+void faceDetectorFree(faceDetector *d) {
+    if (d == NULL) return;
+    free(d->m.w);
+    free(d->m.scale);
+    free(d->m.spyr);
+    free(d->m.norm);
+    free(d->m.scalingbox);
+    free(d->m.mergingbox);
+    free(d->m.homtable);
+    free(d);
+}
+
+double *faceDetect(const faceDetector *d, unsigned char *I, int Ny, int Nx, int *nD) {
+    double stat[2];
+
+    *nD = 0;
+    if (Ny < d->m.ny || Nx < d->m.nx) return (double *) calloc(1, sizeof(double));
+    return detector_mlhmslbp_spyr(I, Ny, Nx, d->m, nD, stat);
+}
@@ -0,0 +1,42 @@
+/**************************************************************
+ * Face detector of the native drowsiness pipeline
+ * (detector_mlhmslbp_spyr of fdtool, without MATLAB)
+ *************************************************************/
+#ifndef FACE_DETECTOR_H
+#define FACE_DETECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a named double matrix of the model file (rows x cols, column-major) */
+typedef struct {
+    const char *name;
+    int rows, cols;
+    double *data;
+} drowsyArray;
+
+typedef struct faceDetector faceDetector;
+
+/*
+ * builds the detector from the arrays named prefix<field>, where <field> is
+ * a field of the MATLAB model structure (w, spyr, scale, ...). Missing
+ * fields take the defaults of detector_mlhmslbp_spyr. Returns NULL and
+ * fills err if w is missing or a field has the wrong size.
+ */
+faceDetector *faceDetectorNew(const drowsyArray *arrays, int narrays,
+        const char *prefix, char *err, int errlen);
+void faceDetectorFree(faceDetector *d);
+
+/*
+ * detections of the (Ny x Nx) UINT8 image I (column-major as in MATLAB):
+ * returns a malloc'ed (5 x nD) matrix [x ; y ; size ; merged ; value]
+ * as D of detector_mlhmslbp_spyr, to be freed by the caller.
+ */
+double *faceDetect(const faceDetector *d, unsigned char *I, int Ny, int Nx, int *nD);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
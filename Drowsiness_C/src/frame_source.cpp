@@ -0,0 +1,193 @@
+/**************************************************************
+ * Frame sources of the native drowsiness pipeline
+ *************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "frame_source.h"
+#include "trace.h"
+
+double pipelineNow() {
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* row-major width x height buffer to the column-major (Ny x Nx) frame */
+static void transposeGray(const unsigned char *rows, int Ny, int Nx, unsigned char *gray) {
+    int x, y;
+
+    for (x = 0; x < Nx; x++)
+        for (y = 0; y < Ny; y++)
+            gray[y + (size_t) x * Ny] = rows[x + (size_t) y * Nx];
+}
+
+/* raw planar video: the luma (or gray) plane of every frame, then chroma
+   bytes skipped; in a Y4M stream every frame starts with a FRAME line */
+class rawGraySource : public frameSource {
+public:
+    rawGraySource(FILE *fp_, int width, int height, size_t chroma_ = 0, int y4m_ = 0)
+            : fp(fp_), chroma(chroma_), y4m(y4m_) {
+        Ny = height;
+        Nx = width;
+        rows = (unsigned char *) malloc((size_t) Ny * Nx + chroma);
+    }
+    ~rawGraySource() {
+        if (fp != stdin) fclose(fp);
+        free(rows);
+    }
+    int read(unsigned char *gray) {
+        size_t size = (size_t) Ny * Nx + chroma;
+        char tag[5];
+        int c;
+
+        TRACE_BEGIN(t0);
+        if (y4m) {
+            if (fread(tag, 1, 5, fp) != 5 || memcmp(tag, "FRAME", 5)) return 0;
+            while ((c = fgetc(fp)) != '\n')
+                if (c == EOF) return 0;
+        }
+        if (fread(rows, 1, size, fp) != size) return 0;
+        TRACE_END(TRACE_CAPTURE, t0);
+        TRACE_BEGIN(t1);
+        transposeGray(rows, Ny, Nx, gray);
+        TRACE_END(TRACE_GRAY, t1);
+        frame++;
+        return 1;
+    }
+
+private:
+    FILE *fp;
+    unsigned char *rows;
+    size_t chroma;
+    int y4m;
+};
+
+static FILE *openInput(const char *file) {
+    return strcmp(file, "-") ? fopen(file, "rb") : stdin;
+}
+
+frameSource *openRawGray(const char *file, int width, int height) {
+    FILE *fp = openInput(file);
+
+    if (fp == NULL || width <= 0 || height <= 0) {
+        if (fp && fp != stdin) fclose(fp);
+        return NULL;
+    }
+    return new rawGraySource(fp, width, height);
+}
+
+frameSource *openRawYuv420(const char *file, int width, int height) {
+    FILE *fp = openInput(file);
+
+    if (fp == NULL || width <= 0 || height <= 0) {
+        if (fp && fp != stdin) fclose(fp);
+        return NULL;
+    }
+    return new rawGraySource(fp, width, height,
+            2 * (size_t) ((width + 1) / 2) * ((height + 1) / 2));
+}
+
+frameSource *openY4M(const char *file) {
+    FILE *fp = openInput(file);
+    char header[512], *tok, *save;
+    const char *cs = "420";
+    int width = 0, height = 0, num = 0, den = 0;
+    size_t cw, ch;
+    frameSource *src;
+
+    if (fp == NULL) return NULL;
+    /* the whole header line, or the file is not taken */
+    if (fgets(header, sizeof(header), fp) == NULL || strncmp(header, "YUV4MPEG2 ", 10) ||
+            strchr(header, '\n') == NULL) {
+        if (fp != stdin) fclose(fp);
+        return NULL;
+    }
+    for (tok = strtok_r(header + 10, " \n", &save); tok; tok = strtok_r(NULL, " \n", &save)) {
+        if (tok[0] == 'W') width = atoi(tok + 1);
+        else if (tok[0] == 'H') height = atoi(tok + 1);
+        else if (tok[0] == 'F') sscanf(tok + 1, "%d:%d", &num, &den);
+        else if (tok[0] == 'C') cs = tok + 1;
+    }
+    /* size of each of the two chroma planes; 8-bit layouts only (C420p10,
+       C444alpha, ... have other sample or plane sizes) */
+    cw = (size_t) (width + 1) / 2;
+    ch = (size_t) (height + 1) / 2;
+    if (!strcmp(cs, "422")) ch = height;
+    else if (!strcmp(cs, "444")) { cw = width; ch = height; }
+    else if (!strcmp(cs, "mono")) cw = ch = 0;
+    else if (strcmp(cs, "420") && strcmp(cs, "420jpeg") && strcmp(cs, "420paldv") &&
+            strcmp(cs, "420mpeg2")) width = 0;
+    if (width <= 0 || height <= 0) {
+        if (fp != stdin) fclose(fp);
+        return NULL;
+    }
+    src = new rawGraySource(fp, width, height, 2 * cw * ch, 1);
+    if (num > 0 && den > 0) src->fps = (double) num / den;
+    return src;
+}
+
+class replaySource : public frameSource {
+public:
+    replaySource(FILE *fp_, int width, int height, long long nframes_, double fps, int loops)
+            : fp(fp_), nframes(nframes_), total(nframes_ * loops), next(0), t0(0) {
+        Ny = height;
+        Nx = width;
+        period = fps > 0 ? 1.0 / fps : 0;
+        rows = (unsigned char *) malloc((size_t) Ny * Nx);
+    }
+    ~replaySource() {
+        fclose(fp);
+        free(rows);
+    }
+    int read(unsigned char *gray) {
+        size_t size = (size_t) Ny * Nx;
+        long long k;
+
+        if (period > 0) {
+            if (next == 0) t0 = pipelineNow();
+            k = (long long) floor((pipelineNow() - t0) / period);
+            if (k > next) {
+                skipped += (k < total ? k : total) - next;
+                next = k;
+            }
+        }
+        if (next >= total) return 0;
+        TRACE_BEGIN(t0);
+        if (next != frame + 1 || next % nframes == 0)
+            fseek(fp, (long) ((next % nframes) * size), SEEK_SET);
+        if (fread(rows, 1, size, fp) != size) return 0;
+        TRACE_END(TRACE_CAPTURE, t0);
+        TRACE_BEGIN(t1);
+        transposeGray(rows, Ny, Nx, gray);
+        TRACE_END(TRACE_GRAY, t1);
+        frame = next++;
+        return 1;
+    }
+    double due() const {
+        return (period > 0 && next > 0) ? t0 + next * period : 0;
+    }
+
+private:
+    FILE *fp;
+    unsigned char *rows;
+    long long nframes, total, next;
+    double period, t0;
+};
+
+frameSource *openReplay(const char *file, int width, int height, double fps, int loops) {
+    FILE *fp;
+    long size;
+
+    if (width <= 0 || height <= 0 || loops < 1) return NULL;
+    fp = fopen(file, "rb");
+    if (fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size < (long) width * height) {
+        fclose(fp);
+        return NULL;
+    }
+    return new replaySource(fp, width, height, size / ((long) width * height), fps, loops);
+}
@@ -0,0 +1,58 @@
+/**************************************************************
+ * Frame sources of the native drowsiness pipeline
+ *************************************************************/
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <stdio.h>
+
+/* seconds on a monotonic clock, shared by the sources and the pipelines */
+double pipelineNow();
+
+class frameSource {
+public:
+    int Ny, Nx;                 /* frame size */
+    long long frame;            /* index of the last frame read */
+    long long skipped;          /* frames passed over by a paced source */
+    double fps;                 /* frame rate given by the file (Y4M), 0 if unknown */
+
+    frameSource() : Ny(0), Nx(0), frame(-1), skipped(0), fps(0) {}
+    virtual ~frameSource() {}
+    /* next gray frame into gray (Ny x Nx, column-major as in MATLAB);
+       returns 0 at the end of the source */
+    virtual int read(unsigned char *gray) = 0;
+    /* pipelineNow() time at which the next frame is available, 0 if now */
+    virtual double due() const { return 0; }
+};
+
+/*
+ * raw 8-bit gray video: width x height bytes per frame, row after row
+ * (ffmpeg -i in.avi -f rawvideo -pix_fmt gray out.gray); "-" reads
+ * stdin. Returns NULL if the file cannot be opened.
+ */
+frameSource *openRawGray(const char *file, int width, int height);
+
+/*
+ * raw planar YUV 4:2:0 video (yuv420p/I420, YV12, NV12): the luma plane
+ * of every frame is the gray frame, the chroma planes are skipped.
+ */
+frameSource *openRawYuv420(const char *file, int width, int height);
+
+/*
+ * YUV4MPEG2 video (ffmpeg -i in.avi -f yuv4mpegpipe out.y4m): size,
+ * frame rate and chroma layout from the header, luma plane as the gray
+ * frame. Only 8-bit layouts are read (C420, C420jpeg, C420paldv,
+ * C420mpeg2, C422, C444, Cmono); returns NULL for any other, or if the
+ * header is not understood.
+ */
+frameSource *openY4M(const char *file);
+
+/*
+ * raw 8-bit gray video file replayed loops times as a camera at fps
+ * frames/s: the clock starts at the first read, and the frames whose
+ * time has passed while the reader was busy are skipped (counted in
+ * skipped). fps = 0 reads every frame as fast as asked.
+ */
+frameSource *openReplay(const char *file, int width, int height, double fps, int loops);
+
+#endif
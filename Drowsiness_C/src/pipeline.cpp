@@ -0,0 +1,259 @@
+/**************************************************************
+ * Threaded capture / detection / eye-state / output pipeline
+ *
+ * See pipeline.h. A stage that finds its input queue empty (output
+ * queue full) yields, then sleeps by short steps; the end of the source
+ * travels down the queues as a NULL frame.
+ *************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "pipeline.h"
+#include "trace.h"
+
+const char *stageNames[NSTAGE] = {"capture", "detect", "eye", "output"};
+
+void defaultPipelineOptions(pipelineOptions *opt) {
+    opt->depth = 4;
+    opt->fps = 0;
+    opt->dropWhenFull = 0;
+    opt->out = NULL;
+}
+
+static void backoff(int *spins) {
+    if (++*spins < 64)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+drowsyPipeline::drowsyPipeline(const drowsyModels *models_, frameSource *src_,
+        const pipelineOptions &opt_) : models(models_), src(src_), opt(opt_) {
+    size_t frameSize = (size_t) src->Ny * src->Nx;
+    int i;
+
+    if (opt.depth < 1) opt.depth = 1;
+    /* a full queue in front of each of the last three stages, and one
+       frame in the hands of each stage */
+    npool  = 3 * opt.depth + NSTAGE;
+    pool   = new pipelineFrame[npool];
+    pixels = (unsigned char *) malloc(frameSize * (npool + 1));
+    scratch = pixels + frameSize * npool;
+
+    for (i = 0; i < NSTAGE; i++) {
+        queue[i] = (i == STAGE_CAPTURE) ? NULL : new spscRing<pipelineFrame *>(opt.depth);
+        freed[i] = new spscRing<pipelineFrame *>(npool);
+    }
+    for (i = 0; i < npool; i++) {
+        memset(pool + i, 0, sizeof(pipelineFrame));
+        pool[i].gray = pixels + frameSize * i;
+        freed[STAGE_CAPTURE]->push(pool + i);
+    }
+    stopping.store(false);
+
+    memset(st, 0, sizeof(st));
+    nLatency = 0;
+    sumLatency = maxLatency = 0;
+    tStart = tEnd = 0;
+}
+
+drowsyPipeline::~drowsyPipeline() {
+    int i;
+
+    for (i = 0; i < NSTAGE; i++) {
+        delete queue[i];
+        delete freed[i];
+    }
+    delete[] pool;
+    free(pixels);
+}
+
+void drowsyPipeline::run() {
+    if (opt.out)
+        fprintf(opt.out, "frame,faces,analysed,value,thresh,closed,level,warning,latency_ms\n");
+
+    tStart = pipelineNow();
+    std::thread capture(&drowsyPipeline::captureLoop, this);
+    std::thread detect(&drowsyPipeline::detectLoop, this);
+    std::thread eye(&drowsyPipeline::eyeLoop, this);
+    std::thread output(&drowsyPipeline::outputLoop, this);
+    capture.join();
+    detect.join();
+    eye.join();
+    output.join();
+    tEnd = pipelineNow();
+}
+
+/* a frame recycled by any stage */
+bool drowsyPipeline::getFree(pipelineFrame *&f) {
+    int i;
+
+    for (i = 0; i < NSTAGE; i++)
+        if (freed[i]->pop(f)) return true;
+    return false;
+}
+
+/* hands f (or the NULL end of stream) to the next stage */
+void drowsyPipeline::forward(int stage, spscRing<pipelineFrame *> *q, pipelineFrame *f) {
+    double t0 = pipelineNow();
+    int spins = 0;
+
+    if (f) {
+        f->tQueued = t0;
+        if (opt.dropWhenFull && !q->push(f)) {
+            st[stage].dropped++;
+            freed[stage]->push(f);
+            return;
+        }
+    }
+    if (f == NULL || !opt.dropWhenFull) {
+        while (!q->push(f)) backoff(&spins);
+        st[stage].blocked += pipelineNow() - t0;
+    }
+}
+
+pipelineFrame *drowsyPipeline::next(int stage, spscRing<pipelineFrame *> *q) {
+    pipelineFrame *f;
+    int spins = 0;
+
+    while (!q->pop(f)) backoff(&spins);
+    if (f) st[stage].wait += pipelineNow() - f->tQueued;
+    return f;
+}
+
+static void addBusy(stageStats *s, double t) {
+    s->frames++;
+    s->busy += t;
+    if (t > s->busyMax) s->busyMax = t;
+}
+
+void drowsyPipeline::captureLoop() {
+    stageStats *s = st + STAGE_CAPTURE;
+    double period = opt.fps > 0 ? 1.0 / opt.fps : 0, tNext = pipelineNow(), t0;
+    long long id = 0;
+    pipelineFrame *f;
+    int spins;
+
+    traceThreadName("capture");
+    while (!stopping.load()) {
+        if (period > 0) {
+            /* the camera delivers a frame every period, taken or not */
+            t0 = pipelineNow();
+            if (t0 < tNext)
+                std::this_thread::sleep_for(std::chrono::duration<double>(tNext - t0));
+            tNext += period;
+            traceSetFrame(0, id);
+            if (!getFree(f)) {
+                if (!src->read(scratch)) break;
+                id++;
+                s->dropped++;
+                continue;
+            }
+        } else {
+            spins = 0;
+            while (!getFree(f) && !stopping.load()) backoff(&spins);
+            if (stopping.load()) break;
+        }
+
+        traceSetFrame(0, id);
+        t0 = pipelineNow();
+        if (!src->read(f->gray)) {
+            freed[STAGE_CAPTURE]->push(f);
+            break;
+        }
+        f->id = id++;
+        f->tCapture = t0;
+        f->nfaces = 0;
+        addBusy(s, pipelineNow() - t0);
+
+        if (period > 0) {
+            f->tQueued = pipelineNow();
+            if (!queue[STAGE_DETECT]->push(f)) {
+                s->dropped++;
+                freed[STAGE_CAPTURE]->push(f);
+            }
+        } else
+            forward(STAGE_CAPTURE, queue[STAGE_DETECT], f);
+    }
+    forward(STAGE_CAPTURE, queue[STAGE_DETECT], NULL);
+}
+
+void drowsyPipeline::detectLoop() {
+    stageStats *s = st + STAGE_DETECT;
+    pipelineFrame *f;
+    double t0;
+
+    traceThreadName("detect");
+    while ((f = next(STAGE_DETECT, queue[STAGE_DETECT])) != NULL) {
+        traceSetFrame(0, f->id);
+        t0 = pipelineNow();
+        f->nfaces = drowsyDetect(models, f->gray, src->Ny, src->Nx, f->faces);
+        addBusy(s, pipelineNow() - t0);
+        forward(STAGE_DETECT, queue[STAGE_EYE], f);
+    }
+    forward(STAGE_DETECT, queue[STAGE_EYE], NULL);
+}
+
+void drowsyPipeline::eyeLoop() {
+    stageStats *s = st + STAGE_EYE;
+    drowsyWork work;
+    drowsyState state;
+    pipelineFrame *f;
+    double t0;
+    int i;
+
+    drowsyNewWork(models, &work);
+    drowsyInitState(&state);
+    traceThreadName("eye");
+    while ((f = next(STAGE_EYE, queue[STAGE_EYE])) != NULL) {
+        traceSetFrame(0, f->id);
+        t0 = pipelineNow();
+        for (i = 0; i < f->nfaces; i++)
+            drowsyAnalyseFace(models, f->gray, src->Ny, src->Nx, &work, f->faces + i);
+        drowsyUpdate(&state, f->faces, f->nfaces, &f->result);
+        addBusy(s, pipelineNow() - t0);
+        forward(STAGE_EYE, queue[STAGE_OUTPUT], f);
+    }
+    drowsyFreeWork(&work);
+    forward(STAGE_EYE, queue[STAGE_OUTPUT], NULL);
+}
+
+void drowsyPipeline::outputLoop() {
+    stageStats *s = st + STAGE_OUTPUT;
+    pipelineFrame *f;
+    const drowsyResult *r;
+    double t0, latency;
+
+    while ((f = next(STAGE_OUTPUT, queue[STAGE_OUTPUT])) != NULL) {
+        t0 = pipelineNow();
+        r = &f->result;
+        latency = t0 - f->tCapture;
+        if (opt.out)
+            fprintf(opt.out, "%lld,%d,%d,%g,%g,%d,%g,%d,%.3f\n", f->id, r->nfaces,
+                    r->analysed, r->value, r->thresh, r->closed, r->level, r->warning,
+                    1e3 * latency);
+        nLatency++;
+        sumLatency += latency;
+        if (latency > maxLatency) maxLatency = latency;
+        addBusy(s, pipelineNow() - t0);
+        freed[STAGE_OUTPUT]->push(f);
+    }
+}
+
+void drowsyPipeline::printStats(FILE *fp) const {
+    double T = elapsed();
+    int i;
+
+    fprintf(fp, "%-8s %8s %8s %10s %10s %10s %10s\n", "stage", "frames", "dropped",
+            "busy(ms)", "max(ms)", "wait(ms)", "blocked(s)");
+    for (i = 0; i < NSTAGE; i++) {
+        const stageStats &s = st[i];
+        double n = s.frames ? (double) s.frames : 1.0;
+        fprintf(fp, "%-8s %8lld %8lld %10.3f %10.3f %10.3f %10.3f\n", stageNames[i],
+                s.frames, s.dropped, 1e3 * s.busy / n, 1e3 * s.busyMax,
+                1e3 * s.wait / n, s.blocked);
+    }
+    fprintf(fp, "%lld frames in %.3f s (%.2f fps), latency mean %.3f ms, max %.3f ms\n",
+            nLatency, T, T > 0 ? nLatency / T : 0.0, 1e3 * latencyMean(), 1e3 * maxLatency);
+}
@@ -0,0 +1,113 @@
+/**************************************************************
+ * Threaded capture / detection / eye-state / output pipeline
+ *
+ * Each stage runs on its own thread; consecutive stages are connected
+ * by bounded spscRing queues of frame pointers, and the frames return
+ * to the capture stage through one free ring per stage, so no frame is
+ * allocated once the pipeline runs. Every stage counts the frames it
+ * handled or dropped, its service time, the time the frames waited in
+ * its input queue and the time it waited for room in its output queue.
+ *
+ *   capture  reads the source; with a pace (fps > 0) it behaves as a
+ *            camera and drops the frame when no buffer is free or the
+ *            detection queue is full, otherwise it waits
+ *   detect   drowsyDetect
+ *   eye      drowsyAnalyseFace of every face and drowsyUpdate, in
+ *            frame order
+ *   output   writes one line per frame and recycles the frame
+ *
+ * The detection and eye stages wait for room in their output queue, or
+ * drop the frame with dropWhenFull; a dropped frame is recycled at
+ * once. A frame dropped by the detection stage never reaches
+ * drowsyUpdate, as a frame skipped by the timer of the GUI; one dropped
+ * by the eye stage only loses its output line.
+ *************************************************************/
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "ring.h"
+#include "drowsy.h"
+#include "frame_source.h"
+
+enum { STAGE_CAPTURE, STAGE_DETECT, STAGE_EYE, STAGE_OUTPUT, NSTAGE };
+
+extern const char *stageNames[NSTAGE];
+
+struct stageStats {
+    long long frames;           /* frames handled */
+    long long dropped;          /* frames dropped by the stage */
+    double busy, busyMax;       /* service time (s) */
+    double wait;                /* time spent by the frames in the input queue (s) */
+    double blocked;             /* time waiting for room in the output queue (s) */
+};
+
+struct pipelineOptions {
+    int depth;                  /* capacity of every queue */
+    double fps;                 /* pace of the source, 0 to read it as fast as possible */
+    int dropWhenFull;           /* detect/eye stages drop instead of waiting */
+    FILE *out;                  /* per-frame results (CSV), or NULL */
+};
+
+void defaultPipelineOptions(pipelineOptions *opt);
+
+struct pipelineFrame {
+    long long id;               /* index in the source */
+    unsigned char *gray;        /* Ny x Nx */
+    int nfaces;
+    drowsyFace faces[DROWSY_MAX_FACES];
+    drowsyResult result;
+    double tCapture;            /* read from the source */
+    double tQueued;             /* pushed to the current queue */
+};
+
+class drowsyPipeline {
+public:
+    drowsyPipeline(const drowsyModels *models, frameSource *src, const pipelineOptions &opt);
+    ~drowsyPipeline();
+
+    /* runs the stages until the source ends or stop() is called */
+    void run();
+    void stop() { stopping.store(true); }
+
+    const stageStats &stats(int stage) const { return st[stage]; }
+    long long latencyFrames() const { return nLatency; }
+    double latencyMean() const { return nLatency ? sumLatency / nLatency : 0.0; }
+    double latencyMax() const { return maxLatency; }
+    double elapsed() const { return tEnd - tStart; }
+    void printStats(FILE *fp) const;
+
+private:
+    drowsyPipeline(const drowsyPipeline &);
+    drowsyPipeline &operator=(const drowsyPipeline &);
+
+    void captureLoop();
+    void detectLoop();
+    void eyeLoop();
+    void outputLoop();
+
+    bool getFree(pipelineFrame *&f);
+    void forward(int stage, spscRing<pipelineFrame *> *q, pipelineFrame *f);
+    pipelineFrame *next(int stage, spscRing<pipelineFrame *> *q);
+
+    const drowsyModels *models;
+    frameSource *src;
+    pipelineOptions opt;
+
+    int npool;
+    pipelineFrame *pool;
+    unsigned char *pixels;
+    unsigned char *scratch;     /* frames read by the paced capture only to be dropped */
+    spscRing<pipelineFrame *> *queue[NSTAGE];      /* input queue of each stage */
+    spscRing<pipelineFrame *> *freed[NSTAGE];      /* frames recycled by each stage */
+    std::atomic<bool> stopping;
+
+    stageStats st[NSTAGE];
+    long long nLatency;
+    double sumLatency, maxLatency;
+    double tStart, tEnd;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/**************************************************************
+ * Bounded lock-free ring between one producer and one consumer thread
+ *
+ * The producer only writes tail and the consumer only writes head;
+ * each keeps a cached copy of the other index so that the shared
+ * cache lines are read only when the ring looks full (empty).
+ *************************************************************/
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <class T> class spscRing {
+public:
+    explicit spscRing(size_t capacity) : cap(capacity ? capacity : 1) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        mask = n - 1;
+        buf = new T[n];
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        headCache = tailCache = 0;
+    }
+    ~spscRing() { delete[] buf; }
+
+    /* producer: false if the ring holds capacity() items */
+    bool push(const T &v) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache >= cap) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache >= cap) return false;
+        }
+        buf[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* consumer: false if the ring is empty */
+    bool pop(T &v) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache) return false;
+        }
+        v = buf[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* approximate when called by a third thread */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return cap; }
+
+private:
+    spscRing(const spscRing &);
+    spscRing &operator=(const spscRing &);
+
+    /* the two sides on separate cache lines (padding rather than alignas,
+       which plain new does not honour before C++17) */
+    size_t cap, mask;
+    T *buf;
+    char pad0[64];
+    std::atomic<size_t> head;
+    size_t tailCache;                   /* consumer side */
+    char pad1[64];
+    std::atomic<size_t> tail;
+    size_t headCache;                   /* producer side */
+    char pad2[64];
+};
+
+#endif
@@ -0,0 +1,212 @@
+/**************************************************************
+ * Multi-stream drowsiness server
+ *
+ * See server.h. The worker queues are short (a few sessions each) and
+ * touched once per frame, so a mutex per queue is cheap next to the
+ * detection of a frame.
+ *************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "server.h"
+#include "trace.h"
+
+drowsyServer::drowsyServer(const drowsyModels *models_, int nworkers, FILE *results_)
+        : models(models_), results(results_), maxNy(0), maxNx(0), tStart(0), tEnd(0) {
+    int i;
+
+    if (nworkers <= 0) nworkers = (int) std::thread::hardware_concurrency();
+    if (nworkers <= 0) nworkers = 1;
+    for (i = 0; i < nworkers; i++) {
+        serverWorker *w = new serverWorker;
+        w->tasks = w->steals = w->idle = 0;
+        w->busy = 0;
+        workers.push_back(w);
+    }
+    live.store(0);
+}
+
+drowsyServer::~drowsyServer() {
+    size_t i;
+
+    for (i = 0; i < sessions.size(); i++) {
+        delete sessions[i]->src;
+        delete sessions[i];
+    }
+    for (i = 0; i < workers.size(); i++) delete workers[i];
+}
+
+void drowsyServer::addStream(frameSource *src) {
+    drowsySession *s = new drowsySession;
+
+    memset(s, 0, sizeof(drowsySession));
+    s->id = (int) sessions.size();
+    s->src = src;
+    drowsyInitState(&s->state);
+    s->trackFrame = -1;
+    sessions.push_back(s);
+    if (src->Ny > maxNy) maxNy = src->Ny;
+    if (src->Nx > maxNx) maxNx = src->Nx;
+}
+
+void drowsyServer::run() {
+    std::vector<std::thread> threads;
+    size_t i;
+
+    if (results)
+        fprintf(results, "stream,frame,faces,analysed,value,thresh,closed,level,warning\n");
+
+    for (i = 0; i < sessions.size(); i++)
+        workers[i % workers.size()]->queue.push_back(sessions[i]);
+    live.store((int) sessions.size());
+
+    tStart = pipelineNow();
+    for (i = 0; i < workers.size(); i++)
+        threads.push_back(std::thread(&drowsyServer::workerLoop, this, (int) i));
+    for (i = 0; i < threads.size(); i++) threads[i].join();
+    tEnd = pipelineNow();
+}
+
+/* front of the own queue, or the back of another one */
+drowsySession *drowsyServer::take(int w) {
+    int n = (int) workers.size(), k;
+    drowsySession *s = NULL;
+
+    {
+        std::lock_guard<std::mutex> g(workers[w]->lock);
+        if (!workers[w]->queue.empty()) {
+            s = workers[w]->queue.front();
+            workers[w]->queue.pop_front();
+            return s;
+        }
+    }
+    for (k = 1; k < n && s == NULL; k++) {
+        serverWorker *v = workers[(w + k) % n];
+        std::lock_guard<std::mutex> g(v->lock);
+        if (!v->queue.empty()) {
+            s = v->queue.back();
+            v->queue.pop_back();
+            workers[w]->steals++;
+        }
+    }
+    return s;
+}
+
+/* next frame of s; returns 0 at the end of its source */
+int drowsyServer::process(drowsySession *s, unsigned char *gray, drowsyWork *work,
+        drowsyFace *faces) {
+    frameSource *src = s->src;
+    drowsyResult r;
+    double t0 = pipelineNow(), t;
+    int i, n;
+
+    traceSetFrame(s->id, src->frame + 1);
+    if (!src->read(gray)) return 0;
+    traceSetFrame(s->id, src->frame);
+    n = drowsyDetect(models, gray, src->Ny, src->Nx, faces);
+    for (i = 0; i < n; i++)
+        if (drowsyAnalyseFace(models, gray, src->Ny, src->Nx, work, faces + i)) {
+            memcpy(s->track, faces[i].det, sizeof(s->track));
+            s->trackFrame = src->frame;
+        }
+    drowsyUpdate(&s->state, faces, n, &r);
+
+    t = pipelineNow() - t0;
+    s->frames++;
+    s->warnings += r.warning;
+    s->busy += t;
+    if (t > s->busyMax) s->busyMax = t;
+
+    if (results) {
+        std::lock_guard<std::mutex> g(resultsLock);
+        fprintf(results, "%d,%lld,%d,%d,%g,%g,%d,%g,%d\n", s->id, src->frame, r.nfaces,
+                r.analysed, r.value, r.thresh, r.closed, r.level, r.warning);
+    }
+    return 1;
+}
+
+void drowsyServer::workerLoop(int w) {
+    serverWorker *me = workers[w];
+    unsigned char *gray = (unsigned char *) malloc((size_t) maxNy * maxNx);
+    drowsyFace faces[DROWSY_MAX_FACES];
+    drowsyWork work;
+    drowsySession *s;
+    double now, due, wake = 0, t0;
+    size_t waiting = 0, queued;
+    char name[32];
+
+    snprintf(name, sizeof(name), "worker %d", w);
+    traceThreadName(name);
+    drowsyNewWork(models, &work);
+    while (live.load() > 0) {
+        s = take(w);
+        if (s == NULL) {
+            me->idle++;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        now = pipelineNow();
+        due = s->src->due();
+        if (due > now) {
+            /* not due yet: back to the queue; once every queued session
+               was found waiting, sleep until the first is due (<= 1 ms) */
+            {
+                std::lock_guard<std::mutex> g(me->lock);
+                me->queue.push_back(s);
+                queued = me->queue.size();
+            }
+            wake = (waiting == 0 || due < wake) ? due : wake;
+            if (++waiting >= queued) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(fmin(wake - now, 1e-3)));
+                waiting = 0;
+            }
+            continue;
+        }
+        waiting = 0;
+
+        t0 = now;
+        if (!process(s, gray, &work, faces)) {
+            live.fetch_sub(1);
+            continue;
+        }
+        me->tasks++;
+        me->busy += pipelineNow() - t0;
+        std::lock_guard<std::mutex> g(me->lock);
+        me->queue.push_back(s);
+    }
+    drowsyFreeWork(&work);
+    free(gray);
+}
+
+void drowsyServer::printStats(FILE *fp) const {
+    double T = elapsed();
+    long long total = 0, skipped = 0;
+    size_t i;
+
+    fprintf(fp, "%-6s %8s %8s %8s %10s %10s %8s %s\n", "stream", "frames", "skipped",
+            "fps", "busy(ms)", "max(ms)", "warnings", "track");
+    for (i = 0; i < sessions.size(); i++) {
+        const drowsySession *s = sessions[i];
+        double n = s->frames ? (double) s->frames : 1.0;
+        fprintf(fp, "%-6d %8lld %8lld %8.2f %10.3f %10.3f %8lld", s->id, s->frames,
+                s->src->skipped, T > 0 ? s->frames / T : 0.0, 1e3 * s->busy / n,
+                1e3 * s->busyMax, s->warnings);
+        if (s->trackFrame >= 0)
+            fprintf(fp, " [%g %g %g] @%lld\n", s->track[0], s->track[1], s->track[2],
+                    s->trackFrame);
+        else
+            fprintf(fp, " -\n");
+        total += s->frames;
+        skipped += s->src->skipped;
+    }
+    fprintf(fp, "%-6s %8s %8s %8s %8s\n", "worker", "tasks", "steals", "busy(%)", "idle");
+    for (i = 0; i < workers.size(); i++) {
+        const serverWorker *w = workers[i];
+        fprintf(fp, "%-6d %8lld %8lld %8.1f %8lld\n", (int) i, w->tasks, w->steals,
+                T > 0 ? 100 * w->busy / T : 0.0, w->idle);
+    }
+    fprintf(fp, "%d streams, %lld frames (%lld skipped) in %.3f s (%.2f fps)\n",
+            (int) sessions.size(), total, skipped, T, T > 0 ? total / T : 0.0);
+}
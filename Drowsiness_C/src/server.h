@@ -0,0 +1,82 @@
+/**************************************************************
+ * Multi-stream drowsiness server
+ *
+ * One session per stream: its source and the compact state of
+ * DetectDrowsiness (drowsyState), the face it tracks and its counters.
+ * The models are shared read-only by all sessions. A fixed pool of
+ * workers processes the frames; a task is "next frame of a session"
+ * (read, detect, analyse the faces, update the state), and a session
+ * is in at most one worker at a time, so its frames stay in order.
+ *
+ * Every worker has its own queue of sessions, taken round robin from
+ * the front; an idle worker steals from the back of the queue of
+ * another worker. A session whose source has no frame due yet (paced
+ * replay) goes back to the queue. The frame and the drowsyWork buffers
+ * belong to the workers, so a session only costs its state.
+ *************************************************************/
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "drowsy.h"
+#include "frame_source.h"
+
+struct drowsySession {
+    int id;
+    frameSource *src;
+    drowsyState state;
+    /* track: last face analysed, at frame trackFrame (-1: none yet) */
+    double track[5];
+    long long trackFrame;
+    /* counters */
+    long long frames, warnings;
+    double busy, busyMax;
+};
+
+struct serverWorker {
+    std::mutex lock;
+    std::deque<drowsySession *> queue;
+    long long tasks, steals, idle;
+    double busy;
+};
+
+class drowsyServer {
+public:
+    /* nworkers threads, 0 for one per core; results (CSV) or NULL */
+    drowsyServer(const drowsyModels *models, int nworkers, FILE *results);
+    ~drowsyServer();
+
+    /* the server owns src from now on */
+    void addStream(frameSource *src);
+    /* processes every stream until its source ends */
+    void run();
+
+    int streams() const { return (int) sessions.size(); }
+    const drowsySession &session(int i) const { return *sessions[i]; }
+    double elapsed() const { return tEnd - tStart; }
+    void printStats(FILE *fp) const;
+
+private:
+    drowsyServer(const drowsyServer &);
+    drowsyServer &operator=(const drowsyServer &);
+
+    void workerLoop(int w);
+    drowsySession *take(int w);
+    int process(drowsySession *s, unsigned char *gray, drowsyWork *work, drowsyFace *faces);
+
+    const drowsyModels *models;
+    FILE *results;
+    std::mutex resultsLock;
+    std::vector<drowsySession *> sessions;
+    std::vector<serverWorker *> workers;
+    std::atomic<int> live;
+    int maxNy, maxNx;
+    double tStart, tEnd;
+};
+
+#endif
@@ -0,0 +1,338 @@
+/**************************************************************
+ * Per-stage latency instrumentation of the native runtime
+ *
+ * See trace.h. The histograms are log-linear as in HdrHistogram: 128
+ * exact values, then 64 sub-buckets per power of 2 (about 1.5% wide),
+ * up to 2^47 ns. Only the owner thread writes its buffers; the
+ * counters are relaxed atomics so that an export may read them at any
+ * time.
+ *************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include "trace.h"
+
+#define TRACE_MAX_THREADS 256
+#define HDR_SUB           64
+#define HDR_BUCKETS       (42*HDR_SUB + HDR_SUB)
+
+const char *traceStageNames[NTRACE] = {"capture", "gray", "integral", "lbp", "scan",
+    "merge", "normface", "features", "forest", "eye", "state"};
+
+struct traceEvent {
+    long long t0, t1, frame;
+    int stream, stage;
+};
+
+struct traceThread {
+    int tid;
+    char name[32];
+    int stream;                 /* set by traceSetFrame */
+    long long frame;
+    traceEvent *events;         /* ring of cap events */
+    size_t cap;
+    std::atomic<size_t> head;
+    std::atomic<unsigned long long> hist[NTRACE][HDR_BUCKETS];
+    std::atomic<long long> count[NTRACE], sum[NTRACE], max[NTRACE];
+};
+
+static std::atomic<traceThread *> threads[TRACE_MAX_THREADS];
+static std::atomic<int> nthreads(0);
+static std::atomic<int> enabled(0);
+static int eventsCap = 0;
+static thread_local traceThread *self = NULL;
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int hdrIndex(unsigned long long v) {
+    int e, i;
+
+    if (v < 2*HDR_SUB) return (int) v;
+    e = 63 - __builtin_clzll(v) - 6;
+    i = e*HDR_SUB + (int) (v >> e);
+    return i < HDR_BUCKETS ? i : HDR_BUCKETS - 1;
+}
+
+/* highest value (ns) counted in bucket i */
+static double hdrValue(int i) {
+    int e, m;
+
+    if (i < 2*HDR_SUB) return i;
+    e = i / HDR_SUB - 1;
+    m = i - e*HDR_SUB;
+    return ldexp((double) (m + 1), e) - 1;
+}
+
+static traceThread *getThread() {
+    traceThread *t;
+    int i, s;
+
+    if (self) return self;
+    i = nthreads.fetch_add(1);
+    if (i >= TRACE_MAX_THREADS) return NULL;
+    t = new traceThread;
+    t->tid = i;
+    snprintf(t->name, sizeof(t->name), "thread %d", i);
+    t->stream = 0;
+    t->frame = -1;
+    t->cap = eventsCap;
+    t->events = t->cap ? new traceEvent[t->cap] : NULL;
+    t->head.store(0, std::memory_order_relaxed);
+    for (s = 0; s < NTRACE; s++) {
+        for (i = 0; i < HDR_BUCKETS; i++) t->hist[s][i].store(0, std::memory_order_relaxed);
+        t->count[s].store(0, std::memory_order_relaxed);
+        t->sum[s].store(0, std::memory_order_relaxed);
+        t->max[s].store(0, std::memory_order_relaxed);
+    }
+    threads[t->tid].store(t, std::memory_order_release);
+    return self = t;
+}
+
+int traceStart(int eventsPerThread) {
+    if (enabled.load() || nthreads.load()) return 1;
+    eventsCap = eventsPerThread > 0 ? eventsPerThread : 0;
+    enabled.store(1);
+    return 0;
+}
+
+void traceStop(void) {
+    enabled.store(0);
+}
+
+int traceEnabled(void) {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+long long traceBegin(void) {
+    return enabled.load(std::memory_order_relaxed) ? nowNs() : 0;
+}
+
+template <class T> static void relaxedAdd(std::atomic<T> &a, T v) {
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+void traceEnd(int stage, long long t0) {
+    traceThread *t;
+    long long t1, d;
+    size_t h;
+
+    if (t0 == 0 || (t = getThread()) == NULL) return;
+    t1 = nowNs();
+    d = t1 - t0;
+
+    relaxedAdd(t->hist[stage][hdrIndex(d)], 1ULL);
+    relaxedAdd(t->count[stage], 1LL);
+    relaxedAdd(t->sum[stage], d);
+    if (d > t->max[stage].load(std::memory_order_relaxed))
+        t->max[stage].store(d, std::memory_order_relaxed);
+
+    if (t->cap) {
+        h = t->head.load(std::memory_order_relaxed);
+        traceEvent &e = t->events[h % t->cap];
+        e.t0 = t0;
+        e.t1 = t1;
+        e.frame = t->frame;
+        e.stream = t->stream;
+        e.stage = stage;
+        t->head.store(h + 1, std::memory_order_release);
+    }
+}
+
+void traceSetFrame(int stream, long long frame) {
+    traceThread *t;
+
+    if (!traceEnabled() || (t = getThread()) == NULL) return;
+    t->stream = stream;
+    t->frame = frame;
+}
+
+void traceThreadName(const char *name) {
+    traceThread *t;
+
+    if (!traceEnabled() || (t = getThread()) == NULL) return;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+}
+
+static int threadCount() {
+    int n = nthreads.load();
+    return n < TRACE_MAX_THREADS ? n : TRACE_MAX_THREADS;
+}
+
+/* threads registered so far (the slot may lag behind nthreads) */
+static traceThread *threadAt(int i) {
+    return threads[i].load(std::memory_order_acquire);
+}
+
+/* last events of thread t still in its ring */
+static size_t snapshot(traceThread *t, traceEvent **out) {
+    size_t h1, h2, n, first, k;
+    traceEvent *e;
+
+    *out = NULL;
+    if (t->cap == 0) return 0;
+    h1 = t->head.load(std::memory_order_acquire);
+    n = h1 < t->cap ? h1 : t->cap;
+    e = new traceEvent[n ? n : 1];
+    for (k = 0; k < n; k++) e[k] = t->events[(h1 - n + k) % t->cap];
+    /* drop the events overwritten while copying */
+    h2 = t->head.load(std::memory_order_acquire);
+    first = (h2 > t->cap && h2 - t->cap > h1 - n) ? h2 - t->cap - (h1 - n) : 0;
+    if (first > n) first = n;
+    memmove(e, e + first, (n - first) * sizeof(traceEvent));
+    *out = e;
+    return n - first;
+}
+
+int traceWriteChrome(const char *file) {
+    FILE *fp = fopen(file, "w");
+    int n = threadCount(), i, first = 1;
+    long long origin = 0;
+    traceEvent **ev;
+    size_t *nev, k;
+    traceThread *t;
+
+    if (fp == NULL) return 1;
+    ev = new traceEvent *[n ? n : 1];
+    nev = new size_t[n ? n : 1];
+    for (i = 0; i < n; i++) {
+        t = threadAt(i);
+        nev[i] = t ? snapshot(t, ev + i) : 0;
+        if (!t) ev[i] = NULL;
+        for (k = 0; k < nev[i]; k++)
+            if (origin == 0 || ev[i][k].t0 < origin) origin = ev[i][k].t0;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (i = 0; i < n; i++) {
+        if ((t = threadAt(i)) == NULL) continue;
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", t->tid, t->name);
+        first = 0;
+        for (k = 0; k < nev[i]; k++) {
+            const traceEvent &e = ev[i][k];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"drowsy\",\"ph\":\"X\",\"pid\":1,"
+                    "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"stream\":%d,\"frame\":%lld}}",
+                    traceStageNames[e.stage], t->tid, (e.t0 - origin) / 1e3,
+                    (e.t1 - e.t0) / 1e3, e.stream, e.frame);
+        }
+        delete[] ev[i];
+    }
+    fprintf(fp, "\n]}\n");
+    delete[] ev;
+    delete[] nev;
+    return fclose(fp) != 0;
+}
+
+/* histogram of a stage summed over the threads; returns the count */
+static long long mergeStage(int stage, unsigned long long *h, long long *sum, long long *max) {
+    int n = threadCount(), i, b;
+    long long count = 0;
+    traceThread *t;
+
+    memset(h, 0, HDR_BUCKETS * sizeof(unsigned long long));
+    *sum = *max = 0;
+    for (i = 0; i < n; i++) {
+        if ((t = threadAt(i)) == NULL) continue;
+        for (b = 0; b < HDR_BUCKETS; b++) h[b] += t->hist[stage][b].load(std::memory_order_relaxed);
+        count += t->count[stage].load(std::memory_order_relaxed);
+        *sum += t->sum[stage].load(std::memory_order_relaxed);
+        if (t->max[stage].load(std::memory_order_relaxed) > *max)
+            *max = t->max[stage].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+/* value (ns) below which p percent of the total counts fall */
+static double valueAt(const unsigned long long *h, long long total, long long max, double p) {
+    unsigned long long target, acc = 0;
+    int b;
+
+    if (total == 0) return 0;
+    target = (unsigned long long) ceil(p / 100.0 * total);
+    if (target < 1) target = 1;
+    for (b = 0; b < HDR_BUCKETS; b++) {
+        acc += h[b];
+        if (acc >= target) return fmin(hdrValue(b), (double) max);
+    }
+    return (double) max;
+}
+
+double tracePercentile(int stage, double p) {
+    unsigned long long h[HDR_BUCKETS];
+    long long sum, max, total = mergeStage(stage, h, &sum, &max);
+
+    return valueAt(h, total, max, p) / 1e6;
+}
+
+/* HdrHistogram percentile distribution (outputPercentileDistribution), in ms */
+int traceWriteHistograms(const char *file) {
+    FILE *fp = fopen(file, "w");
+    unsigned long long h[HDR_BUCKETS], acc;
+    long long sum, max, total;
+    double p, v, mean, var;
+    int s, b, k, nb;
+
+    if (fp == NULL) return 1;
+    for (s = 0; s < NTRACE; s++) {
+        total = mergeStage(s, h, &sum, &max);
+        if (total == 0) continue;
+        fprintf(fp, "# %s\n%12s %14s %10s %14s\n\n", traceStageNames[s], "Value",
+                "Percentile", "TotalCount", "1/(1-Percentile)");
+        /* 5 ticks per halving of the distance to 100% */
+        for (k = 0; k < 400; k++) {
+            p = 100.0 * (1.0 - pow(0.5, k / 5.0));
+            v = valueAt(h, total, max, p);
+            for (b = 0, acc = 0; b <= hdrIndex((unsigned long long) v); b++) acc += h[b];
+            if (acc >= (unsigned long long) total) break;
+            fprintf(fp, "%12.6f %14.12f %10llu %14.2f\n", v / 1e6, p / 100, acc,
+                    1.0 / (1.0 - p / 100));
+        }
+        fprintf(fp, "%12.6f %14.12f %10lld\n", max / 1e6, 1.0, total);
+
+        mean = (double) sum / total;
+        for (b = 0, var = 0, nb = 0; b < HDR_BUCKETS; b++) {
+            if (h[b] == 0) continue;
+            var += h[b] * (hdrValue(b) - mean) * (hdrValue(b) - mean);
+            nb++;
+        }
+        fprintf(fp, "#[Mean    = %12.6f, StdDeviation   = %12.6f]\n", mean / 1e6,
+                sqrt(var / total) / 1e6);
+        fprintf(fp, "#[Max     = %12.6f, Total count    = %12lld]\n", max / 1e6, total);
+        fprintf(fp, "#[Buckets = %12d, SubBuckets     = %12d]\n\n", nb, 2*HDR_SUB);
+    }
+    return fclose(fp) != 0;
+}
+
+void tracePrintSummary(FILE *fp) {
+    unsigned long long h[HDR_BUCKETS];
+    long long sum, max, total;
+    int s;
+
+    fprintf(fp, "%-9s %9s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "mean(ms)",
+            "p50", "p90", "p99", "p99.9", "max");
+    for (s = 0; s < NTRACE; s++) {
+        total = mergeStage(s, h, &sum, &max);
+        if (total == 0) continue;
+        fprintf(fp, "%-9s %9lld %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                traceStageNames[s], total, sum / 1e6 / total,
+                valueAt(h, total, max, 50) / 1e6, valueAt(h, total, max, 90) / 1e6,
+                valueAt(h, total, max, 99) / 1e6, valueAt(h, total, max, 99.9) / 1e6,
+                max / 1e6);
+    }
+}
+
+void traceReport(FILE *fp, const char *chromeFile, const char *histFile) {
+    if (!traceEnabled()) return;
+    traceStop();
+    fprintf(fp, "\n");
+    tracePrintSummary(fp);
+    if (chromeFile && traceWriteChrome(chromeFile))
+        fprintf(stderr, "cannot write %s\n", chromeFile);
+    if (histFile && traceWriteHistograms(histFile))
+        fprintf(stderr, "cannot write %s\n", histFile);
+}
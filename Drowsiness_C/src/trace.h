@@ -0,0 +1,81 @@
+/**************************************************************
+ * Per-stage latency instrumentation of the native runtime
+ *
+ * Every thread records its stage timings (steady clock, ns) in its own
+ * ring of events and in its own per-stage HDR histograms; the buffers
+ * have a single writer and are never locked. When tracing is off,
+ * traceBegin is one relaxed load and traceEnd returns at once.
+ *
+ *   traceWriteChrome      events as Chrome trace JSON
+ *                         (chrome://tracing, ui.perfetto.dev)
+ *   traceWriteHistograms  HdrHistogram percentile distributions, one
+ *                         per stage, in ms
+ *   tracePrintSummary     count, mean, p50, p90, p99, p99.9, max per stage
+ *
+ * The ring keeps the last events of every thread; the histograms keep
+ * every event. Export after the threads are joined, or accept that the
+ * events written meanwhile are left out.
+ *
+ * Plain C interface: face_detector.c maps the STAGE_BEGIN/STAGE_END
+ * hooks of the fdtool detector onto it.
+ *************************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    TRACE_CAPTURE,              /* reading the source */
+    TRACE_GRAY,                 /* conversion to the gray frame */
+    TRACE_INTEGRAL,             /* integral image of the frame (detector) */
+    TRACE_LBP,                  /* LBP map and its integral images (detector) */
+    TRACE_SCAN,                 /* window scan (detector) */
+    TRACE_MERGE,                /* merging of the detections (detector) */
+    TRACE_NORMFACE,             /* crop, resize, histeq, integral image of the face */
+    TRACE_FEATURES,             /* pixel-difference and Haar features */
+    TRACE_FOREST,               /* facial regions forest */
+    TRACE_EYE,                  /* eye openness of a face */
+    TRACE_STATE,                /* threshold, eye state, drowsiness level */
+    NTRACE
+};
+
+extern const char *traceStageNames[NTRACE];
+
+/* starts recording, keeping the last eventsPerThread events of every
+   thread (0: histograms only); returns 1 if already started */
+int traceStart(int eventsPerThread);
+void traceStop(void);
+int traceEnabled(void);
+
+/* start time (ns) of a stage, 0 when tracing is off */
+long long traceBegin(void);
+void traceEnd(int stage, long long t0);
+
+/* attached to the next events of the calling thread */
+void traceSetFrame(int stream, long long frame);
+void traceThreadName(const char *name);
+
+int traceWriteChrome(const char *file);
+int traceWriteHistograms(const char *file);
+/* value (ms) at percentile p (0..100) of a stage over all threads */
+double tracePercentile(int stage, double p);
+void tracePrintSummary(FILE *fp);
+/* stops recording, prints the summary to fp and writes the files that
+   are not NULL; nothing if tracing was not started */
+void traceReport(FILE *fp, const char *chromeFile, const char *histFile);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* events kept per thread by the programs for their Chrome trace */
+#define TRACE_EVENTS        (1 << 18)
+
+#define TRACE_BEGIN(t)      long long t = traceBegin()
+#define TRACE_END(stage, t) traceEnd(stage, t)
+
+#endif
@@ -0,0 +1,192 @@
+/******************************************************************************
+ * Function MEX-File: NormFace_mex.cpp
+ *
+ * Purpose:
+ *		Function NORMFACE normalises a detected face for the facial regions
+ *		classifier in one call. It is the fused equivalent of
+ *			aa3 = histeq(imresize(imcrop(aa2,rect),[128 128]));
+ *			ii  = IntImg(double(aa3));
+ *		The crop is sampled directly from the frame at 128x128 with bilinear
+ *		weights while the histogram is built, the histeq LUT is then applied
+ *		to the 16 KB face and the integral image computed in the same pass.
+ *		No intermediate crop or resized image is made.
+ *
+ *		The crop follows imcrop (rows round(y)..round(y+h) and columns
+ *		round(x)..round(x+w), clipped to the frame) and the equalisation is
+ *		that of histeq with its default 64 levels. The resampling is plain
+ *		bilinear as imresize(...,'bilinear','Antialiasing',false), so faces
+ *		much larger than 128 pixels may differ from the bicubic default by
+ *		a few grey levels before the equalisation.
+ *
+ * Record of revision:
+ *		Date			Description of change
+ *	   ======			=====================
+ *	   10/18/26			Original code, NormFace() also built with
+ *						-DNO_MEXFUNCTION for the native pipeline
+ *
+ * Define variables:
+ *      frame       -- <Ny x Nx> uint8 gray scale frame
+ *      rect        -- [x y width height] of the face, as given to imcrop
+ *      face        -- <128 x 128> uint8 normalised face
+ *      ii          -- <128 x 128> integral image of double(face)
+ *
+ * Example:
+ *	[face, ii] = NormFace_mex(frame, [x,y,width,width]);
+ *	posiFeat = CreatePosiFeat_mex(double(face), coord, AB);
+ *	haarFeat = CreateHaarFeat_mex(ii, coord, haarPara);
+ *
+ * Author: Quang Nguyen
+ ******************************************************************************/
+
+#ifndef NO_MEXFUNCTION
+#include <mex.h>
+#include <matrix.h>
+#endif
+#include <math.h>
+
+#define FACE_SIZE	128
+#define NBINS		256
+#define NLEVELS		64		// histeq default
+
+static void ResampleTable(int lo, int n, int *f0, int *f1, double *w);
+static void HisteqLut(const double *hist, int npix, unsigned char *lut);
+int NormFace(const unsigned char *frame, int Ny, int Nx, const double *rect, unsigned char *face, double *ii);
+
+#ifndef NO_MEXFUNCTION
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+// Declare variables
+	unsigned char *frame, *face;			// input frame and normalised face
+	double	*rect, *ii;						// face rectangle and integral image
+	const mwSize *dims;
+	int		Ny, Nx;
+
+	if (nrhs != 2)
+		mexErrMsgTxt("NormFace_mex needs 2 arguments, frame and rect");
+	if (!mxIsUint8(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 2)
+		mexErrMsgTxt("frame must be a (Ny x Nx) UINT8 gray scale image");
+	if (mxGetNumberOfElements(prhs[1]) != 4)
+		mexErrMsgTxt("rect must be [x y width height]");
+
+// Dimension of the given frame
+	dims = mxGetDimensions(prhs[0]);	Ny = (int)dims[0];	Nx = (int)dims[1];
+
+	frame = (unsigned char *)mxGetData(prhs[0]);
+	rect = mxGetPr(prhs[1]);
+
+// associate outputs
+	plhs[0] = mxCreateNumericMatrix(FACE_SIZE, FACE_SIZE, mxUINT8_CLASS, mxREAL);
+	face = (unsigned char *)mxGetData(plhs[0]);
+	plhs[1] = mxCreateDoubleMatrix(FACE_SIZE, FACE_SIZE, mxREAL);
+	ii = mxGetPr(plhs[1]);
+
+	if (NormFace(frame, Ny, Nx, rect, face, ii))
+		mexErrMsgTxt("rect does not overlap the frame");
+}
+#endif
+
+/*
+ * face and ii (FACE_SIZE x FACE_SIZE) of the rect of the (Ny x Nx) frame,
+ * returns 1 if rect does not overlap the frame
+ */
+int NormFace(const unsigned char *frame, int Ny, int Nx, const double *rect, unsigned char *face, double *ii)
+{
+	double	hist[NBINS];					// histogram of the resampled face
+	unsigned char lut[NBINS];				// histeq mapping
+	int		fx0[FACE_SIZE], fx1[FACE_SIZE], fy0[FACE_SIZE], fy1[FACE_SIZE];
+	double	wx[FACE_SIZE], wy[FACE_SIZE];	// weights of fx1 and fy1
+	int		r1, r2, c1, c2;
+	int		i, j;
+	double	colsum;
+
+// Pixels kept by imcrop
+	c1 = (int)floor(rect[0] + 0.5);	c2 = (int)floor(rect[0] + rect[2] + 0.5);
+	r1 = (int)floor(rect[1] + 0.5);	r2 = (int)floor(rect[1] + rect[3] + 0.5);
+	c1 = (c1 < 1) ? 1 : c1;		c2 = (c2 > Nx) ? Nx : c2;
+	r1 = (r1 < 1) ? 1 : r1;		r2 = (r2 > Ny) ? Ny : r2;
+	if (c1 > c2 || r1 > r2)
+		return 1;
+
+// Source rows/columns and weights of every output row/column
+	ResampleTable(c1 - 1, c2 - c1 + 1, fx0, fx1, wx);
+	ResampleTable(r1 - 1, r2 - r1 + 1, fy0, fy1, wy);
+
+// First pass: sample the crop from the frame and build its histogram
+	for (i = 0; i < NBINS; i++) hist[i] = 0.0;
+	for (j = 0; j < FACE_SIZE; j++) {
+		const unsigned char *col0 = frame + (size_t)fx0[j]*Ny;
+		const unsigned char *col1 = frame + (size_t)fx1[j]*Ny;
+		unsigned char *out = face + j*FACE_SIZE;
+		double b = wx[j], a = 1.0 - b;
+		for (i = 0; i < FACE_SIZE; i++) {
+			double top = a*col0[fy0[i]] + b*col1[fy0[i]];
+			double bot = a*col0[fy1[i]] + b*col1[fy1[i]];
+			int v = (int)((1.0 - wy[i])*top + wy[i]*bot + 0.5);
+			v = (v > 255) ? 255 : v;
+			out[i] = (unsigned char)v;
+			hist[v] += 1.0;
+		}
+	}
+
+	HisteqLut(hist, FACE_SIZE*FACE_SIZE, lut);
+
+// Second pass: equalise and integrate, ii = cumsum(cumsum(face),2)
+	for (j = 0; j < FACE_SIZE; j++) {
+		unsigned char *out = face + j*FACE_SIZE;
+		double *cur = ii + j*FACE_SIZE;
+		colsum = 0.0;
+		for (i = 0; i < FACE_SIZE; i++) {
+			out[i] = lut[out[i]];
+			colsum += out[i];
+			cur[i] = (j > 0) ? cur[i - FACE_SIZE] + colsum : colsum;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Bilinear source indices (0-based, in the frame) of the FACE_SIZE output
+ * samples along a crop of n pixels starting at pixel lo, as imresize maps
+ * them: u -> u/scale + 0.5*(1 - 1/scale), out of range taps clamped.
+ */
+static void ResampleTable(int lo, int n, int *f0, int *f1, double *w)
+{
+	double scale = (double)FACE_SIZE/n, u;
+	int k, left;
+
+	for (k = 0; k < FACE_SIZE; k++) {
+		u = (k + 1)/scale + 0.5*(1.0 - 1.0/scale);
+		left = (int)floor(u);
+		w[k] = u - left;
+		f0[k] = (left < 1) ? 0 : ((left > n) ? n - 1 : left - 1);
+		f1[k] = (left + 1 > n) ? n - 1 : ((left + 1 < 1) ? 0 : left);
+		f0[k] += lo;
+		f1[k] += lo;
+	}
+}
+
+/*
+ * histeq(I) for a UINT8 image: every input level k goes to the output
+ * level minimising the error between the cumulative histogram up to k and
+ * the flat NLEVELS cumulative histogram, with half the bin as tolerance
+ * and negative errors beyond rounding excluded.
+ */
+static void HisteqLut(const double *hist, int npix, unsigned char *lut)
+{
+	double cum[NLEVELS], cumd = 0.0, tol, err, best, eps = npix*1.4901161193847656e-08;
+	int k, m, T;
+
+	for (m = 0; m < NLEVELS; m++) cum[m] = (double)npix*(m + 1)/NLEVELS;
+	for (k = 0; k < NBINS; k++) {
+		cumd += hist[k];
+		tol = (k == 0 || k == NBINS - 1) ? 0.0 : hist[k]/2;
+		T = 0;
+		best = 0.0;
+		for (m = 0; m < NLEVELS; m++) {
+			err = cum[m] - cumd + tol;
+			if (err < -eps) err = npix;
+			if (m == 0 || err < best) { best = err; T = m; }
+		}
+		lut[k] = (unsigned char)((double)T/(NLEVELS - 1)*255.0 + 0.5);
+	}
+}
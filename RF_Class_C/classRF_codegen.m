@@ -0,0 +1,44 @@
+%**************************************************************
+%* mex interface to Andy Liaw et al.'s C code (used in R package randomForest)
+%* License: GPLv2
+%
+% Writes a trained classification forest out as C++ source with every
+% split threshold and feature index inlined, for deployments where the
+% model is fixed. Build the generated .cpp into a static library, e.g.
+%    g++ -O2 -c modelRF_forest.cpp && ar rcs libmodelRF_forest.a modelRF_forest.o
+%**************************************************************
+%function classRF_codegen(model, base, name, extra_options)
+% requires 2 arguments
+% model: generated via classRF_train function
+% base: output path without extension, writes base.h and base.cpp
+% name: C++ namespace of the generated code (default 'forest')
+% extra_options.table = 1 emits a static const node table walked by a loop
+%                       instead of nested if/else branches (default 0)
+% extra_options.mdim = number of features (default size(model.importance,1))
+%
+% The generated code exports, in namespace name,
+%    int  predict(const float *x);           class 1..model.nclass
+%    void votes(const float *x, int *count); model.nclass votes
+% where x is one sample (one row of the X given to classRF_predict).
+% predict returns the internal class index, map it back with
+% model.orig_labels(model.new_labels == label). The votes are those of
+% classRF_predict on single(X); ties go to the lowest class.
+
+function classRF_codegen(model, base, name, extra_options)
+
+    if nargin<2
+		error('need atleast 2 parameters, model and output file name');
+    end
+
+    if ~exist('name','var') || isempty(name); name = 'forest'; end
+
+    table = 0;
+    mdim = size(model.importance,1);
+    if exist('extra_options','var')
+        if isfield(extra_options,'table');  table = extra_options.table;  end
+        if isfield(extra_options,'mdim');   mdim = extra_options.mdim;    end
+    end
+
+    mexClassRF_codegen(base,name,table,mdim,model.nrnodes,model.ntree,model.xbestsplit,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass);
+
+    clear mexClassRF_codegen
@@ -11,9 +11,15 @@
 %**************************************************************
 %function [Y_hat votes] = classRF_predict(X,model, extra_options)
 % requires 2 arguments
-% X: data matrix
+% X: data matrix (one sample per row), double or single, passed to the mex file
+%    without transposing or copying once the mex reports that it reads sample-major
+%    data (4th output); X' is passed to older builds of mexClassRF_predict
 % model: generated via classRF_train function
 % extra_options.predict_all = predict_all if set will send all the prediction. 
+% extra_options.early_exit = k > 0 evaluates the trees k at a time and stops for a sample
+%           once no other class can catch up with its leading class. Y_hat is the same as
+%           with all trees (except for ties, broken at random either way); votes only count
+%           the trees evaluated, sum(votes,2) of them; their prediction_per_tree entries are 0.
 %
 %
 % Returns
@@ -37,13 +43,36 @@ function [Y_new, votes, prediction_per_tree] = classRF_predict(X,model, extra_op
         if isfield(extra_options,'predict_all') 
             predict_all = extra_options.predict_all;
         end
+        if isfield(extra_options,'early_exit') 
+            early_exit = extra_options.early_exit;
+        end
     end
     
     if ~exist('predict_all','var'); predict_all=0;end
+    if ~exist('early_exit','var'); early_exit=0;end
             
         
     
-	[Y_hat,prediction_per_tree,votes] = mexClassRF_predict(X',model.nrnodes,model.ntree,model.xbestsplit,model.classwt,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass, predict_all);
+    if ~isa(X,'double') && ~isa(X,'single')
+        X = double(X);
+    end
+    
+    % older builds of mexClassRF_predict ignore sample_major and early_exit and do
+    % not assign the 4th output: probe once with the transposed call, valid for both
+    persistent sample_major
+    if isempty(sample_major)
+        try
+            [Y_hat,prediction_per_tree,votes,version] = mexClassRF_predict(double(X'),model.nrnodes,model.ntree,model.xbestsplit,model.classwt,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass, predict_all, 0, early_exit);
+            sample_major = (version >= 2);
+        catch
+            sample_major = false;
+            [Y_hat,prediction_per_tree,votes] = mexClassRF_predict(double(X'),model.nrnodes,model.ntree,model.xbestsplit,model.classwt,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass, predict_all);
+        end
+    elseif sample_major
+        [Y_hat,prediction_per_tree,votes] = mexClassRF_predict(X,model.nrnodes,model.ntree,model.xbestsplit,model.classwt,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass, predict_all, 1, early_exit);
+    else
+        [Y_hat,prediction_per_tree,votes] = mexClassRF_predict(double(X'),model.nrnodes,model.ntree,model.xbestsplit,model.classwt,model.cutoff,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.nclass, predict_all);
+    end
 	%keyboard
     votes = votes';
     
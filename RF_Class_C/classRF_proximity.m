@@ -0,0 +1,50 @@
+%**************************************************************
+%* mex interface to Andy Liaw et al.'s C code (used in R package randomForest)
+%* License: GPLv2
+%
+% Sparse proximities of a trained forest: the rows of X are bucketed by
+% terminal node in every tree and only pairs sharing a node are visited, so
+% this works far beyond the ~20k rows of the dense proximity of classRF_train.
+% Test-vs-train proximities are rows of classRF_proximity([X_trn; X_tst], model, k).
+%**************************************************************
+%function [P, idx, val] = classRF_proximity(X, model, k, extra_options)
+% requires 3 arguments
+% X: data matrix (one sample per row)
+% model: generated via classRF_train function
+% k: number of proximities kept for every row (the row itself excluded)
+% extra_options.oob_prox = only count the trees where exactly one of the pair is
+%                   in-bag, as oob_prox in classRF_train. X must then be the training
+%                   data and model trained with keep_inbag.
+%
+% Returns
+% P - sparse n x n matrix, row i holding the k largest proximities of row i
+%     (so P is not symmetric)
+% idx, val - the same as k x n matrices: indices of the nearest rows (0 when fewer
+%     than k rows ever share a node with the row) and their proximities
+
+function [P, idx, val] = classRF_proximity(X, model, k, extra_options)
+
+    if nargin<3
+		error('need 3 parameters, X matrix, model and k');
+    end
+
+    oob_prox = 0;
+    if exist('extra_options','var') && isfield(extra_options,'oob_prox')
+        oob_prox = extra_options.oob_prox;
+    end
+
+    inbag = [];
+    if oob_prox
+        inbag = model.inbag;
+        if size(inbag,2)~=model.ntree || size(inbag,1)~=size(X,1)
+            error('oob_prox needs the training data and a model trained with keep_inbag');
+        end
+    end
+
+    [idx,val] = mexClassRF_proximity(double(X'),model.nrnodes,model.ntree,model.xbestsplit,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,k,inbag);
+    clear mexClassRF_proximity
+
+    n = size(X,1);
+    rows = repmat(1:n,k,1);
+    keep = idx>0;
+    P = sparse(rows(keep),double(idx(keep)),val(keep),n,n);
@@ -0,0 +1,38 @@
+%**************************************************************
+%* mex interface to Andy Liaw et al.'s C code (used in R package randomForest)
+%* License: GPLv2
+%
+% Prediction with a forest packed by classRF_quantize
+%**************************************************************
+%function [Y_hat votes] = classRF_qpredict(X,qmodel)
+% requires 2 arguments
+% X: data matrix (one sample per row), integer-valued double or single
+% qmodel: generated via classRF_quantize function
+%
+% Returns
+% Y_hat - prediction for the data
+% votes - unnormalized weights for the model
+
+function [Y_new, votes] = classRF_qpredict(X,qmodel)
+
+    if nargin<2
+		error('need 2 parameters,X matrix and qmodel');
+    end
+
+    if ~isa(X,'double') && ~isa(X,'single')
+        X = double(X);
+    end
+
+    [Y_hat,votes] = mexClassRF_qpredict(X,qmodel.nodes,qmodel.root,qmodel.mdim,qmodel.nclass,qmodel.cutoff);
+    votes = votes';
+
+    clear mexClassRF_qpredict
+
+    Y_new = double(Y_hat);
+    new_labels = qmodel.new_labels;
+    orig_labels = qmodel.orig_labels;
+
+    for i=1:length(orig_labels)
+        Y_new(find(Y_hat==new_labels(i)))=Inf;
+        Y_new(isinf(Y_new))=orig_labels(i);
+    end
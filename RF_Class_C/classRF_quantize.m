@@ -0,0 +1,54 @@
+%**************************************************************
+%* mex interface to Andy Liaw et al.'s C code (used in R package randomForest)
+%* License: GPLv2
+%
+% Packs a trained classification forest into 8 byte nodes for integer-valued
+% features (Haar, pixel differences...): thresholds are rounded down to the
+% integer domain, child links become 16-bit relative offsets, the padding to
+% nrnodes per tree is dropped and subtrees voting for a single class are pruned.
+% The votes of classRF_qpredict are checked against classRF_predict on X_val.
+%**************************************************************
+%function qmodel = classRF_quantize(model, X_val)
+% requires 2 arguments
+% model: generated via classRF_train function
+% X_val: validation data (one sample per row), integer-valued
+%
+% Returns
+% qmodel - to be used with classRF_qpredict. Errors out if the predictions
+%          on X_val are not identical to those of model.
+
+function qmodel = classRF_quantize(model, X_val)
+
+    if nargin<2
+		error('need 2 parameters, model and validation data X_val');
+    end
+
+    mdim = size(model.importance,1);
+    if size(X_val,2)~=mdim
+        error('X_val must have one column per feature of the model');
+    end
+    if any(X_val(:)~=round(X_val(:)))
+        error('X_val is not integer-valued, thresholds can not be quantised');
+    end
+
+    [nodes,root] = mexClassRF_quantize(mdim,model.nrnodes,model.ntree,model.treemap,model.nodestatus,model.nodeclass,model.bestvar,model.ndbigtree,model.xbestsplit);
+    clear mexClassRF_quantize
+
+    qmodel.nodes = nodes;
+    qmodel.root = root;
+    qmodel.mdim = mdim;
+    qmodel.ntree = model.ntree;
+    qmodel.nclass = model.nclass;
+    qmodel.cutoff = model.cutoff;
+    qmodel.orig_labels = model.orig_labels;
+    qmodel.new_labels = model.new_labels;
+
+    %the labels follow from the votes, bar ties broken at random
+    [Y_hat, votes] = classRF_predict(X_val,model);
+    [Y_q, votes_q] = classRF_qpredict(X_val,qmodel);
+    if ~isequal(votes,votes_q)
+        error('quantised forest votes differ from the model on X_val');
+    end
+
+    fprintf('quantised forest: %d nodes (%d bytes), %d before\n', size(nodes,2), ...
+            4*numel(nodes), sum(model.ndbigtree));
@@ -54,6 +54,9 @@
 %                   override importance.)
 %  extra_options.proximity = Should proximity measure among the rows be calculated?
 %  extra_options.oob_prox = Should proximity be calculated only on 'out-of-bag' data?
+%  extra_options.proximity_k = k > 0 keeps only the k largest proximities of every row, as a
+%                   sparse n x n matrix computed by classRF_proximity after training, in place
+%                   of the dense one (which is out of reach beyond ~20k rows).
 %  extra_options.do_trace = If set to TRUE, give a more verbose output as randomForest is run. If set to
 %                   some integer, then running output is printed for every
 %                   do_trace trees.
@@ -87,7 +90,8 @@
 %       estimate)
 % proximity if proximity=TRUE when randomForest is called, a matrix of proximity
 %       measures among the input (based on the frequency that pairs of data points are
-%       in the same terminal nodes).
+%       in the same terminal nodes). Sparse, with proximity_k entries per row, if
+%       proximity_k is set.
 % errtr = first column is OOB Err rate, second is for class 1 and so on
 
 function model=classRF_train(X,Y,ntree,mtry, extra_options)
@@ -121,6 +125,7 @@ function model=classRF_train(X,Y,ntree,mtry, extra_options)
         if isfield(extra_options,'nPerm');  nPerm = extra_options.nPerm;       end
         if isfield(extra_options,'proximity');  proximity = extra_options.proximity;       end
         if isfield(extra_options,'oob_prox');  oob_prox = extra_options.oob_prox;       end
+        if isfield(extra_options,'proximity_k');  proximity_k = extra_options.proximity_k;       end
         %if isfield(extra_options,'norm_votes');  norm_votes = extra_options.norm_votes;       end
         if isfield(extra_options,'do_trace');  do_trace = extra_options.do_trace;       end
         %if isfield(extra_options,'corr_bias');  corr_bias = extra_options.corr_bias;       end
@@ -241,6 +246,17 @@ function model=classRF_train(X,Y,ntree,mtry, extra_options)
         oob_prox = proximity;
     end
     
+    %sparse proximities are computed from the kept forest instead, which needs
+    %the in-bag matrix for oob_prox
+    sparse_prox = exist('proximity_k','var') && proximity_k>0;
+    if sparse_prox
+        sparse_oob = oob_prox;
+        keep_inbag_user = keep_inbag;
+        if sparse_oob; keep_inbag = TRUE; end
+        proximity = 0;
+        oob_prox = 0;
+    end
+    
     %i handle the below in the mex file
 %     if proximity
 %         prox = zeros(N,N);
@@ -375,6 +391,13 @@ function model=classRF_train(X,Y,ntree,mtry, extra_options)
     model.importanceSD = impSD;
     model.errtr = errtr';
     model.inbag = inbag;
+    if sparse_prox
+        prox_options.oob_prox = sparse_oob;
+        model.proximity = classRF_proximity(X,model,proximity_k,prox_options);
+        if sparse_oob && ~keep_inbag_user
+            model.inbag = zeros(size(inbag,1),1,'int32');
+        end
+    end
     model.votes = counttr';
     model.oob_times = sum(counttr)';
  	clear mexClassRF_train
@@ -15,9 +15,17 @@ function compile_windows
     if strcmp(computer,'PCWIN64')
         mex  -DMATLAB -DWIN64 -output mexClassRF_train   src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win64/rfsub.o src/mex_ClassificationRF_train.cpp   src/rfutils.cpp 
         mex  -DMATLAB -DWIN64 -output mexClassRF_predict src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win64/rfsub.o src/mex_ClassificationRF_predict.cpp src/rfutils.cpp 
+        mex  -DMATLAB -DWIN64 -output mexClassRF_codegen src/classRF_codegen.cpp src/mex_ClassificationRF_codegen.cpp 
+        mex  -DMATLAB -DWIN64 -output mexClassRF_quantize src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win64/rfsub.o src/classRF_quant.cpp src/mex_ClassificationRF_quantize.cpp src/rfutils.cpp 
+        mex  -DMATLAB -DWIN64 -output mexClassRF_qpredict src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win64/rfsub.o src/classRF_quant.cpp src/mex_ClassificationRF_qpredict.cpp src/rfutils.cpp 
+        mex  -DMATLAB -DWIN64 -output mexClassRF_proximity src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win64/rfsub.o src/classRF_prox.cpp src/mex_ClassificationRF_proximity.cpp src/rfutils.cpp 
     elseif strcmp(computer,'PCWIN')
         mex  -DMATLAB -output mexClassRF_train   src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win32/rfsub.o src/mex_ClassificationRF_train.cpp   src/rfutils.cpp 
         mex  -DMATLAB -output mexClassRF_predict src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win32/rfsub.o src/mex_ClassificationRF_predict.cpp src/rfutils.cpp 
+        mex  -DMATLAB -output mexClassRF_codegen src/classRF_codegen.cpp src/mex_ClassificationRF_codegen.cpp 
+        mex  -DMATLAB -output mexClassRF_quantize src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win32/rfsub.o src/classRF_quant.cpp src/mex_ClassificationRF_quantize.cpp src/rfutils.cpp 
+        mex  -DMATLAB -output mexClassRF_qpredict src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win32/rfsub.o src/classRF_quant.cpp src/mex_ClassificationRF_qpredict.cpp src/rfutils.cpp 
+        mex  -DMATLAB -output mexClassRF_proximity src/classRF.cpp src/classTree.cpp src/cokus.cpp precompiled_rfsub/win32/rfsub.o src/classRF_prox.cpp src/mex_ClassificationRF_proximity.cpp src/rfutils.cpp 
     else
         error('Wrong script to run on this Comp architecture. I cannot detect any windows system')
     end
@@ -47,6 +47,9 @@
 #include "rf.h"
 #include "stdio.h"
 #include "math.h"
+#ifdef OMP
+#include <omp.h>
+#endif
 
 #ifndef MATLAB
 #define Rprintf printf
@@ -121,13 +124,73 @@ void* S_alloc_alt(int a, int b) {
 void GetRNGstate(){};
 void PutRNGstate(){};
 
-void oob(int nsample, int nclass, int *jin, int *cl, int *jtr, int *jerr,
+void oob(int nsample, int nclass, int *cl, int *jerr,
         int *counttr, int *out, double *errtr, int *jest, double *cutoff);
 
 void TestSetError(double *countts, int *jts, int *clts, int *jet, int ntest,
         int nclass, int nvote, double *errts,
         int labelts, int *nclts, double *cutoff);
 
+/*
+ * Permutation importance of variable m for one tree: the nOOB OOB cases
+ * oobIdx with m replaced by xperm are re-predicted (only those whose path
+ * crosses a split on m, see predictClassTreePermuted) and the decrease in
+ * correct predictions is accumulated into imprt/impsd/impmat as in classRF.
+ * Only the entries of m are written, so variables can run in parallel;
+ * cover/moved/jmoved/nrightimp are the buffers of the calling thread.
+ */
+static void varImportance(int m, double *x, int mdim, int nclass, int *cl,
+        int *jtr, int *oobIdx, int nOOB, double *xperm, int *oobLeaf,
+        int *preNode, int *lastNode, int *treemap, int *nodestatus,
+        double *xbestsplit, int *bestvar, int *nodeclass, int treeSize,
+        int *cat, int *nright, int nrightall, int *nout, int noutall,
+        int localImp, double *imprt, double *impsd, double *impmat,
+        int *cover, int *moved, int *jmoved, int *nrightimp) {
+    int k, n, nmoved, nrightimpall;
+
+    nmoved = predictClassTreePermuted(x, mdim, oobIdx, nOOB, m, xperm,
+            oobLeaf, preNode, lastNode, treemap, nodestatus, xbestsplit,
+            bestvar, nodeclass, treeSize, cat, jtr, cover, moved, jmoved);
+    /* Count how often correct predictions are made with the modified
+     * data; the cases that kept their class count as before. */
+    for (n = 0; n < nclass; ++n) nrightimp[n] = nright[n];
+    nrightimpall = nrightall;
+    for (k = 0; k < nmoved; ++k) {
+        n = oobIdx[moved[k]];
+        if (jtr[n] == cl[n]) {
+            nrightimp[cl[n] - 1]--;
+            nrightimpall--;
+        } else if (jmoved[k] == cl[n]) {
+            nrightimp[cl[n] - 1]++;
+            nrightimpall++;
+        }
+        if (localImp) {
+            if (cl[n] == jmoved[k]) {
+                impmat[m + n*mdim] -= 1.0;
+            } else {
+                impmat[m + n*mdim] += 1.0;
+            }
+        }
+    }
+    /* Accumulate decrease in proportions of correct predictions. */
+    for (n = 0; n < nclass; ++n) {
+        if (nout[n] > 0) {
+            imprt[m + n*mdim] +=
+                    ((double) (nright[n] - nrightimp[n])) / nout[n];
+            impsd[m + n*mdim] +=
+                    ((double) (nright[n] - nrightimp[n]) *
+                    (nright[n] - nrightimp[n])) / nout[n];
+        }
+    }
+    if (noutall > 0) {
+        imprt[m + nclass*mdim] +=
+                ((double)(nrightall - nrightimpall)) / noutall;
+        impsd[m + nclass*mdim] +=
+                ((double) (nrightall - nrightimpall) *
+                (nrightall - nrightimpall)) / noutall;
+    }
+}
+
 /*  Define the R RNG for use from Fortran. */
 #ifdef WIN64
 void _rrand_(double *r) { *r = unif_rand(); }
@@ -188,22 +251,26 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
      ******************************************************************/
     
     int nsample0, mdim, nclass, addClass, mtry, ntest, nsample, ndsize,
-            mimp, nimp, near, nuse, noutall, nrightall, nrightimpall,
+            mimp, near, nuse, noutall, nrightall,
             keepInbag, nstrata;
     int jb, j, n, m, k, idxByNnode, idxByNsample, imp, localImp, iprox,
             oobprox, keepf, replace, stratify, trace, *nright,
-            *nrightimp, *nout, *nclts, Ntree;
+            *nrightimp = NULL, *nout, *nclts, Ntree;
+    int nthread, nbatch, nvarUsed, nOOB, j0, nb, *varList = NULL, *oobIdx = NULL,
+            *oobLeaf = NULL, *preNode = NULL, *lastNode = NULL, *impCover = NULL,
+            *impMoved = NULL, *impJmoved = NULL;
     
     int *out, *bestsplitnext, *bestsplit, *nodepop, *jin, *nodex,
             *nodexts, *nodestart, *ta, *ncase, *jerr, *varUsed,
-            *jtr, *classFreq, *idmove, *jvr,
-            *at, *a, *b, *mind, *nind, *jts, *oobpair;
+            *jtr, *classFreq, *idmove,
+            *at, *a, *b, *mind, *nind, *jts, *oobpair = NULL;
     int **strata_idx, *strata_size, last, ktmp, anyEmpty, ntry;
+    int *proxStart = NULL, *proxOrder = NULL;
     
     double av=0.0;
     
-    double *tgini, *tx, *wl, *classpop, *tclasscat, *tclasspop, *win,
-            *tp, *wr;
+    double *tgini, *wl, *classpop, *tclasscat, *tclasspop, *win,
+            *tp, *wr, *xperm = NULL;
     
     //Do initialization for COKUS's Random generator
     seedMT(2*rand()+1);  //works well with odd number so why don't use that
@@ -227,7 +294,6 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
     ntest    = *nts;
     nsample = addClass ? (nsample0 + nsample0) : nsample0;
     mimp = imp ? mdim : 1;
-    nimp = imp ? nsample : 1;
     near = iprox ? nsample0 : 1;
     if (trace == 0) trace = Ntree + 1;
     
@@ -241,7 +307,6 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
     classpop =   (double *) S_alloc_alt(nclass* *nrnodes, sizeof(double));
     tclasscat =  (double *) S_alloc_alt(nclass*32, sizeof(double));
     tclasspop =  (double *) S_alloc_alt(nclass, sizeof(double));
-    tx =         (double *) S_alloc_alt(nsample, sizeof(double));
     win =        (double *) S_alloc_alt(nsample, sizeof(double));
     tp =         (double *) S_alloc_alt(nsample, sizeof(double));
     
@@ -258,7 +323,6 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
     jerr =          (int *) S_alloc_alt(nsample, sizeof(int));
     varUsed =       (int *) S_alloc_alt(mdim, sizeof(int));
     jtr =           (int *) S_alloc_alt(nsample, sizeof(int));
-    jvr =           (int *) S_alloc_alt(nsample, sizeof(int));
     classFreq =     (int *) S_alloc_alt(nclass, sizeof(int));
     jts =           (int *) S_alloc_alt(ntest, sizeof(int));
     idmove =        (int *) S_alloc_alt(nsample, sizeof(int));
@@ -267,11 +331,35 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
     b =             (int *) S_alloc_alt(mdim*nsample, sizeof(int));
     mind =          (int *) S_alloc_alt(mdim, sizeof(int));
     nright =        (int *) S_alloc_alt(nclass, sizeof(int));
-    nrightimp =     (int *) S_alloc_alt(nclass, sizeof(int));
     nout =          (int *) S_alloc_alt(nclass, sizeof(int));
+    if (imp) {
+        /* importance: per tree, the OOB cases and the preorder position of
+         * their terminal node; per thread, the buffers of varImportance;
+         * the permuted values of nbatch variables at a time */
+        #ifdef OMP
+        nthread = omp_get_max_threads();
+        #else
+        nthread = 1;
+        #endif
+        nbatch = 4 * nthread;
+        varList =   (int *) S_alloc_alt(mdim, sizeof(int));
+        oobIdx =    (int *) S_alloc_alt(nsample, sizeof(int));
+        oobLeaf =   (int *) S_alloc_alt(nsample, sizeof(int));
+        preNode =   (int *) S_alloc_alt(*nrnodes, sizeof(int));
+        lastNode =  (int *) S_alloc_alt(*nrnodes, sizeof(int));
+        impCover =  (int *) S_alloc_alt(nthread * (*nrnodes + 1), sizeof(int));
+        impMoved =  (int *) S_alloc_alt(nthread * nsample, sizeof(int));
+        impJmoved = (int *) S_alloc_alt(nthread * nsample, sizeof(int));
+        nrightimp = (int *) S_alloc_alt(nthread * nclass, sizeof(int));
+        xperm =  (double *) S_alloc_alt(nbatch * nsample, sizeof(double));
+    }
     if (oobprox) {
         oobpair = (int *) S_alloc_alt(near*near, sizeof(int));
     }
+    if (iprox && *testdat) {
+        proxStart = (int *) S_alloc_alt(*nrnodes + 1, sizeof(int));
+        proxOrder = (int *) S_alloc_alt(near, sizeof(int));
+    }
     //printf("nsample=%d\n", nsample);
     /* Count number of cases in each class. */
     zeroInt(classFreq, nclass);
@@ -502,7 +590,7 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
         }
         
         /* Compute out-of-bag error rate. */
-        oob(nsample, nclass, jin, cl, jtr, jerr, counttr, out,
+        oob(nsample, nclass, cl, jerr, counttr, out,
                 errtr + jb*(nclass+1), outcl, cut);
         
         if ((jb+1) % trace == 0) {
@@ -534,58 +622,43 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
                     nrightall++;
                 }
             }
+            /* Only the OOB cases are predicted again, and only for the
+             * variables the tree splits on. */
+            nOOB = 0;
+            for (n = 0; n < nsample; ++n) {
+                if (jin[n] == 0) oobIdx[nOOB++] = n;
+            }
+            treePreorder(treemap + 2*idxByNnode, nodestatus + idxByNnode,
+                    preNode, lastNode);
+            for (n = 0; n < nOOB; ++n) oobLeaf[n] = preNode[nodex[oobIdx[n]] - 1];
+            nvarUsed = 0;
             for (m = 0; m < mdim; ++m) {
-                if (varUsed[m]) {
-                    nrightimpall = 0;
-                    zeroInt(nrightimp, nclass);
-                    for (n = 0; n < nsample; ++n) tx[n] = x[m + n*mdim];
-                    /* Permute the m-th variable. */
-                    permuteOOB(m, x, jin, nsample, mdim);
-                    /* Predict the modified data using the current tree. */
-                    predictClassTree(x, nsample, mdim, treemap + 2*idxByNnode,
-                            nodestatus + idxByNnode,
-                            xbestsplit + idxByNnode,
-                            bestvar + idxByNnode,
-                            nodeclass + idxByNnode, ndbigtree[jb],
-                            cat, nclass, jvr, nodex, *maxcat);
-                    /* Count how often correct predictions are made with
-                     * the modified data. */
-                    for (n = 0; n < nsample; n++) {
-                        if (jin[n] == 0) {
-                            if (jvr[n] == cl[n]) {
-                                nrightimp[cl[n] - 1]++;
-                                nrightimpall++;
-                            }
-                            if (localImp && jvr[n] != jtr[n]) {
-                                if (cl[n] == jvr[n]) {
-                                    impmat[m + n*mdim] -= 1.0;
-                                } else {
-                                    impmat[m + n*mdim] += 1.0;
-                                }
-                            }
-                        }
-                        /* Restore the original data for that variable. */
-                        x[m + n*mdim] = tx[n];
-                    }
-                    /* Accumulate decrease in proportions of correct
-                     * predictions. */
-                    for (n = 0; n < nclass; ++n) {
-                        if (nout[n] > 0) {
-                            imprt[m + n*mdim] +=
-                                    ((double) (nright[n] - nrightimp[n])) /
-                                    nout[n];
-                            impsd[m + n*mdim] +=
-                                    ((double) (nright[n] - nrightimp[n]) *
-                                    (nright[n] - nrightimp[n])) / nout[n];
-                        }
-                    }
-                    if (noutall > 0) {
-                        imprt[m + nclass*mdim] +=
-                                ((double)(nrightall - nrightimpall)) / noutall;
-                        impsd[m + nclass*mdim] +=
-                                ((double) (nrightall - nrightimpall) *
-                                (nrightall - nrightimpall)) / noutall;
-                    }
+                if (varUsed[m]) varList[nvarUsed++] = m;
+            }
+            for (j0 = 0; j0 < nvarUsed; j0 += nbatch) {
+                nb = (nvarUsed - j0 < nbatch) ? nvarUsed - j0 : nbatch;
+                /* Permute the variables in turn, drawing the same random
+                 * numbers as permuteOOB did, then score them in parallel. */
+                for (j = 0; j < nb; ++j)
+                    permuteOOBIdx(varList[j0 + j], x, oobIdx, nOOB, mdim,
+                            xperm + j*nsample);
+                #ifdef OMP
+                #pragma omp parallel for schedule(dynamic)
+                #endif
+                for (j = 0; j < nb; ++j) {
+                    int t = 0;
+                    #ifdef OMP
+                    t = omp_get_thread_num();
+                    #endif
+                    varImportance(varList[j0 + j], x, mdim, nclass, cl, jtr,
+                            oobIdx, nOOB, xperm + j*nsample, oobLeaf,
+                            preNode, lastNode, treemap + 2*idxByNnode,
+                            nodestatus + idxByNnode, xbestsplit + idxByNnode,
+                            bestvar + idxByNnode, nodeclass + idxByNnode,
+                            ndbigtree[jb], cat, nright, nrightall, nout,
+                            noutall, localImp, imprt, impsd, impmat,
+                            impCover + t*(*nrnodes + 1), impMoved + t*nsample,
+                            impJmoved + t*nsample, nrightimp + t*nclass);
                 }
             }
         }
@@ -596,12 +669,12 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
             /* proximity for test data */
             if (*testdat) {
                 computeProximity(proxts, 0, nodexts, jin, oobpair, ntest);
-                /* Compute proximity between testset and training set. */
+                /* Compute proximity between testset and training set,
+                 * only visiting the training cases in the node of each test case. */
+                bucketByNode(nodex, near, ndbigtree[jb], proxStart, proxOrder);
                 for (n = 0; n < ntest; ++n) {
-                    for (k = 0; k < near; ++k) {
-                        if (nodexts[n] == nodex[k])
-                            proxts[n + ntest * (k+ntest)] += 1.0;
-                    }
+                    for (k = proxStart[nodexts[n] - 1]; k < proxStart[nodexts[n]]; ++k)
+                        proxts[n + ntest * (proxOrder[k]+ntest)] += 1.0;
                 }
             }
         }
@@ -665,16 +738,25 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
     
     //frees up the memory
     free(tgini);free(wl);free(wr);free(classpop);free(tclasscat);
-    free(tclasspop);free(tx);free(win);free(tp);free(out);
+    free(tclasspop);free(win);free(tp);free(out);
     free(bestsplitnext);free(bestsplit);free(nodepop);free(nodestart);free(jin);
     free(nodex);free(nodexts);free(ta);free(ncase);free(jerr);
-    free(varUsed);free(jtr);free(jvr);free(classFreq);free(jts);
+    free(varUsed);free(jtr);free(classFreq);free(jts);
     free(idmove);free(at);free(a);free(b);free(mind);
-    free(nright);free(nrightimp);free(nout);
+    free(nright);free(nout);
+    if (imp) {
+        free(varList);free(oobIdx);free(oobLeaf);free(preNode);free(lastNode);
+        free(impCover);free(impMoved);free(impJmoved);free(nrightimp);
+        free(xperm);
+    }
     
     if (oobprox) {
         free(oobpair);
     }
+    if (iprox && *testdat) {
+        free(proxStart);
+        free(proxOrder);
+    }
     
     if (stratify) {
         free(strata_size);
@@ -695,14 +777,69 @@ void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
 }
 
 
-void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
-        int *nrnodes, int *ntree, double *x, double *xbestsplit,
+static double unifRandState(void *) { return unif_rand(); }
+
+/* Aggregated prediction jet is the class with the maximum votes/cutoff */
+void classForestVote(double *countts, double *cutoff, int ntree, int nclass,
+        int ntest, int *jet) {
+    classForestVoteRand(countts, cutoff, ntree, nclass, ntest, jet, unifRandState, NULL);
+}
+
+void classForestVoteRand(double *countts, double *cutoff, int ntree, int nclass,
+        int ntest, int *jet, double (*rnd)(void *), void *state) {
+    int j, n, ntie;
+    double crit, cmax;
+
+    for (n = 0; n < ntest; ++n) {
+        //Rprintf("Ap: ntest %d\n", ntest);
+        cmax = 0.0;
+        ntie = 1;
+        for (j = 0; j < nclass; ++j) {
+            crit = (countts[j + n * nclass] / ntree) / cutoff[j];
+            if (crit > cmax) {
+                jet[n] = j + 1;
+                cmax = crit;
+            }
+            /* Break ties at random: */
+            if (crit == cmax) {
+                ntie++;
+                if (rnd(state) > 1.0 / ntie) jet[n] = j + 1;
+            }
+        }
+    }
+}
+
+/*
+ * 1 if the class leading count/cutoff can not be overtaken (or tied) by
+ * any other class getting all of the remaining votes
+ */
+static int voteDecided(double *count, double *cutoff, int nclass, int remaining) {
+    int j, lead = 0;
+    double crit;
+
+    for (j = 1; j < nclass; ++j)
+        if (count[j] / cutoff[j] > count[lead] / cutoff[lead]) lead = j;
+    crit = count[lead] / cutoff[lead];
+    for (j = 0; j < nclass; ++j)
+        if (j != lead && (count[j] + remaining) / cutoff[j] >= crit) return 0;
+    return 1;
+}
+
+/*
+ * x is (mdim x ntest), or (ntest x mdim) if sampleMajor.
+ * chunk > 0 evaluates the trees by groups of chunk and stops for a sample
+ * once its label is decided (voteDecided): countts then holds the votes of
+ * the trees evaluated for it and jts the label 0 for the trees skipped.
+ * Ignored when proximities are asked for.
+ */
+template <class T> static void classForestT(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, const T *x, int sampleMajor, int chunk, double *xbestsplit,
         double *pid, double *cutoff, double *countts, int *treemap,
         int *nodestatus, int *cat, int *nodeclass, int *jts,
         int *jet, int *bestvar, int *node, int *treeSize,
         int *keepPred, int *prox, double *proxMat, int *nodes) {
-    int j, n, n1, n2, idxNodes, offset1, offset2, *junk, ntie;
-    double crit, cmax;
+    int j, j0, j1, a, n, n1, n2, idxNodes, offset1, offset2, *junk;
+    int *active, nactive, na;
     
     zeroDouble(countts, *nclass * *ntest);
     idxNodes = 0;
@@ -710,48 +847,58 @@ void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
     offset2 = 0;
     junk = NULL;
 
-    //Rprintf("nclass %d\n", *nclass);
-    for (j = 0; j < *ntree; ++j) {
-        //Rprintf("pCT nclass %d \n", *nclass);
-        /* predict by the j-th tree */
-        predictClassTree(x, *ntest, *mdim, treemap + 2*idxNodes,
-                nodestatus + idxNodes, xbestsplit + idxNodes,
-                bestvar + idxNodes, nodeclass + idxNodes,
-                treeSize[j], cat, *nclass,
-                jts + offset1, node + offset2, *maxcat);
-        
-        /* accumulate votes: */
-        for (n = 0; n < *ntest; ++n) {
-            countts[jts[n + offset1] - 1 + n * *nclass] += 1.0;
-        }
-        
-        /* if desired, do proximities for this round */
-        if (*prox) computeProximity(proxMat, 0, node + offset2, junk, junk,
-                *ntest);
-        idxNodes += *nrnodes;
-        if (*keepPred) offset1 += *ntest;
-        if (*nodes)    offset2 += *ntest;
+    /* samples still voting, NULL for all of them */
+    active = NULL;
+    nactive = *ntest;
+    if (chunk > 0 && chunk < *ntree && !*prox) {
+        active = (int *) calloc(*ntest, sizeof(int));
+        for (n = 0; n < *ntest; ++n) active[n] = n;
+        if (*keepPred) zeroInt(jts, *ntest * *ntree);
+    } else {
+        chunk = *ntree;
     }
-    
-    //Rprintf("ntest %d\n", *ntest);
-    /* Aggregated prediction is the class with the maximum votes/cutoff */
-    for (n = 0; n < *ntest; ++n) {
-        //Rprintf("Ap: ntest %d\n", *ntest);
-        cmax = 0.0;
-        ntie = 1;
-        for (j = 0; j < *nclass; ++j) {
-            crit = (countts[j + n * *nclass] / *ntree) / cutoff[j];
-            if (crit > cmax) {
-                jet[n] = j + 1;
-                cmax = crit;
+
+    //Rprintf("nclass %d\n", *nclass);
+    for (j0 = 0; j0 < *ntree && nactive > 0; j0 += chunk) {
+        j1 = (j0 + chunk < *ntree) ? j0 + chunk : *ntree;
+        for (j = j0; j < j1; ++j) {
+            //Rprintf("pCT nclass %d \n", *nclass);
+            /* predict by the j-th tree */
+            predictClassTreeX(x, *ntest, *mdim, sampleMajor, active, nactive,
+                    treemap + 2*idxNodes,
+                    nodestatus + idxNodes, xbestsplit + idxNodes,
+                    bestvar + idxNodes, nodeclass + idxNodes,
+                    treeSize[j], cat, *nclass,
+                    jts + offset1, node + offset2, *maxcat);
+            
+            /* accumulate votes: */
+            for (a = 0; a < nactive; ++a) {
+                n = active ? active[a] : a;
+                countts[jts[n + offset1] - 1 + n * *nclass] += 1.0;
             }
-            /* Break ties at random: */
-            if (crit == cmax) {
-                ntie++;
-                if (unif_rand() > 1.0 / ntie) jet[n] = j + 1;
+            
+            /* if desired, do proximities for this round */
+            if (*prox) computeProximity(proxMat, 0, node + offset2, junk, junk,
+                    *ntest);
+            idxNodes += *nrnodes;
+            if (*keepPred) offset1 += *ntest;
+            if (*nodes)    offset2 += *ntest;
+        }
+        /* drop the samples whose label the remaining trees can not change */
+        if (active) {
+            na = 0;
+            for (a = 0; a < nactive; ++a) {
+                n = active[a];
+                if (!voteDecided(countts + n * *nclass, cutoff, *nclass, *ntree - j1))
+                    active[na++] = n;
             }
+            nactive = na;
         }
     }
+    if (active) free(active);
+    
+    //Rprintf("ntest %d\n", *ntest);
+    classForestVote(countts, cutoff, *ntree, *nclass, *ntest, jet);
     
     //Rprintf("ntest %d\n", *ntest);
     /* if proximities requested, do the final adjustment
@@ -772,11 +919,47 @@ void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
     
 }
 
+void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, double *x, double *xbestsplit,
+        double *pid, double *cutoff, double *countts, int *treemap,
+        int *nodestatus, int *cat, int *nodeclass, int *jts,
+        int *jet, int *bestvar, int *node, int *treeSize,
+        int *keepPred, int *prox, double *proxMat, int *nodes) {
+    classForestT(mdim, ntest, nclass, maxcat, nrnodes, ntree, x, 0, 0,
+            xbestsplit, pid, cutoff, countts, treemap, nodestatus, cat,
+            nodeclass, jts, jet, bestvar, node, treeSize, keepPred, prox,
+            proxMat, nodes);
+}
+
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, const double *x, int sampleMajor, int chunk, double *xbestsplit,
+        double *pid, double *cutoff, double *countts, int *treemap,
+        int *nodestatus, int *cat, int *nodeclass, int *jts,
+        int *jet, int *bestvar, int *node, int *treeSize,
+        int *keepPred, int *prox, double *proxMat, int *nodes) {
+    classForestT(mdim, ntest, nclass, maxcat, nrnodes, ntree, x, sampleMajor, chunk,
+            xbestsplit, pid, cutoff, countts, treemap, nodestatus, cat,
+            nodeclass, jts, jet, bestvar, node, treeSize, keepPred, prox,
+            proxMat, nodes);
+}
+
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, const float *x, int sampleMajor, int chunk, double *xbestsplit,
+        double *pid, double *cutoff, double *countts, int *treemap,
+        int *nodestatus, int *cat, int *nodeclass, int *jts,
+        int *jet, int *bestvar, int *node, int *treeSize,
+        int *keepPred, int *prox, double *proxMat, int *nodes) {
+    classForestT(mdim, ntest, nclass, maxcat, nrnodes, ntree, x, sampleMajor, chunk,
+            xbestsplit, pid, cutoff, countts, treemap, nodestatus, cat,
+            nodeclass, jts, jet, bestvar, node, treeSize, keepPred, prox,
+            proxMat, nodes);
+}
+
 /*
  * Modified by A. Liaw 1/10/2003 (Deal with cutoff)
  * Re-written in C by A. Liaw 3/08/2004
  */
-void oob(int nsample, int nclass, int *jin, int *cl, int *jtr, int *jerr,
+void oob(int nsample, int nclass, int *cl, int *jerr,
         int *counttr, int *out, double *errtr, int *jest,
         double *cutoff) {
     int j, n, noob, *noobcl, ntie;
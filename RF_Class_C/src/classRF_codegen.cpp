@@ -0,0 +1,163 @@
+/**************************************************************
+ * Code generator for a trained classification forest
+ * License: GPLv2
+ *
+ * Writes <base>.h and <base>.cpp that evaluate a fixed forest with
+ * every threshold, feature index and class label as a literal, so
+ * the compiler can inline the whole model. The generated files only
+ * depend on the C++ standard headers and build into a static library
+ * exporting (in namespace <name>)
+ *
+ *   int  predict(const float *x);          class label 1..nclass
+ *   void votes(const float *x, int *count); per class vote count
+ *
+ * x is one sample of mdim features. The split test is done in double
+ * (x[m] <= xbestsplit) exactly as predictClassTree does, so the votes
+ * equal those of classForest on the same float data. Ties in
+ * votes/cutoff go to the lowest class instead of being broken at random.
+ *
+ * table = 0 emits every tree as nested if/else branches,
+ * table = 1 emits one static const node table and a short walk loop
+ * (smaller code for big forests).
+ *
+ * Every split is taken as numerical, as in classRF_predict (the model
+ * does not keep the categories it was trained with).
+ *************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "rf.h"
+
+static void indent(FILE *fp, int depth) {
+    /* cap the indentation, deep trees otherwise blow up the file size */
+    if (depth > 24) depth = 24;
+    fprintf(fp, "%*s", 4 * depth, "");
+}
+
+static void emitBranches(FILE *fp, int k, int depth, int *treemap,
+        int *nodestatus, int *bestvar, int *nodeclass, double *xbestsplit) {
+    indent(fp, depth);
+    if (nodestatus[k] == NODE_TERMINAL) {
+        fprintf(fp, "return %d;\n", nodeclass[k]);
+        return;
+    }
+    fprintf(fp, "if (x[%d] <= %.17g) {\n", bestvar[k] - 1, xbestsplit[k]);
+    emitBranches(fp, treemap[2 * k] - 1, depth + 1, treemap, nodestatus,
+            bestvar, nodeclass, xbestsplit);
+    indent(fp, depth);
+    fprintf(fp, "} else {\n");
+    emitBranches(fp, treemap[2 * k + 1] - 1, depth + 1, treemap, nodestatus,
+            bestvar, nodeclass, xbestsplit);
+    indent(fp, depth);
+    fprintf(fp, "}\n");
+}
+
+/*
+ * base: output path without extension, name: C++ namespace of the model.
+ * The model arrays are laid out as in classForest (nrnodes per tree).
+ * Returns 0 on success, 1 if a file could not be written, 2 if name
+ * is not a valid identifier.
+ */
+int classForestCodegen(const char *base, const char *name, int table,
+        int mdim, int nclass, int ntree, int nrnodes, int *treeSize,
+        int *treemap, int *nodestatus, int *bestvar, int *nodeclass,
+        double *xbestsplit, double *cutoff) {
+    FILE *fp;
+    char fname[1024], guard[256];
+    const char *hdr;
+    int i, j, k, idx, nnode;
+
+    if (!name[0] || strlen(name) >= sizeof(guard) || isdigit((unsigned char)name[0]))
+        return 2;
+    for (i = 0; name[i]; ++i) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') return 2;
+        guard[i] = (char) toupper((unsigned char)name[i]);
+    }
+    guard[i] = '\0';
+    if (strlen(base) + 5 > sizeof(fname)) return 1;
+
+    /* the .cpp includes the header by its file name only */
+    hdr = strrchr(base, '/');
+    if (strrchr(base, '\\') > hdr) hdr = strrchr(base, '\\');
+    hdr = hdr ? hdr + 1 : base;
+
+    sprintf(fname, "%s.h", base);
+    if ((fp = fopen(fname, "w")) == NULL) return 1;
+    fprintf(fp, "/* generated by classForestCodegen, do not edit */\n");
+    fprintf(fp, "#ifndef %s_FOREST_H\n#define %s_FOREST_H\n\n", guard, guard);
+    fprintf(fp, "namespace %s {\n\n", name);
+    fprintf(fp, "enum { mdim = %d, nclass = %d, ntree = %d };\n\n", mdim, nclass, ntree);
+    fprintf(fp, "/* x: mdim features of one sample, returns the class 1..nclass */\n");
+    fprintf(fp, "int predict(const float *x);\n");
+    fprintf(fp, "/* count: nclass votes */\n");
+    fprintf(fp, "void votes(const float *x, int *count);\n\n");
+    fprintf(fp, "}\n\n#endif\n");
+    fclose(fp);
+
+    sprintf(fname, "%s.cpp", base);
+    if ((fp = fopen(fname, "w")) == NULL) return 1;
+    fprintf(fp, "/* generated by classForestCodegen, do not edit */\n");
+    fprintf(fp, "#include \"%s.h\"\n\n", hdr);
+    fprintf(fp, "namespace %s {\n\n", name);
+
+    if (table) {
+        /* leaves have var = -1 and the class label in left */
+        fprintf(fp, "struct node { int var, left, right; double split; };\n\n");
+        fprintf(fp, "static const node nodes[] = {\n");
+        nnode = 0;
+        for (j = 0; j < ntree; ++j) {
+            idx = j * nrnodes;
+            for (k = 0; k < treeSize[j]; ++k) {
+                if (nodestatus[idx + k] == NODE_TERMINAL)
+                    fprintf(fp, "    { -1, %d, 0, 0.0 },\n", nodeclass[idx + k]);
+                else
+                    fprintf(fp, "    { %d, %d, %d, %.17g },\n", bestvar[idx + k] - 1,
+                            nnode + treemap[2 * (idx + k)] - 1,
+                            nnode + treemap[2 * (idx + k) + 1] - 1,
+                            xbestsplit[idx + k]);
+            }
+            nnode += treeSize[j];
+        }
+        fprintf(fp, "};\n\n");
+        fprintf(fp, "static inline int tree(const float *x, int k) {\n");
+        fprintf(fp, "    while (nodes[k].var >= 0)\n");
+        fprintf(fp, "        k = (x[nodes[k].var] <= nodes[k].split) ? nodes[k].left : nodes[k].right;\n");
+        fprintf(fp, "    return nodes[k].left;\n}\n\n");
+    } else {
+        for (j = 0; j < ntree; ++j) {
+            idx = j * nrnodes;
+            fprintf(fp, "static inline int tree%d(const float *x) {\n", j);
+            emitBranches(fp, 0, 1, treemap + 2 * idx, nodestatus + idx,
+                    bestvar + idx, nodeclass + idx, xbestsplit + idx);
+            fprintf(fp, "}\n\n");
+        }
+    }
+
+    fprintf(fp, "void votes(const float *x, int *count) {\n");
+    fprintf(fp, "    for (int j = 0; j < nclass; ++j) count[j] = 0;\n");
+    nnode = 0;
+    for (j = 0; j < ntree; ++j) {
+        if (table)
+            fprintf(fp, "    ++count[tree(x, %d) - 1];\n", nnode);
+        else
+            fprintf(fp, "    ++count[tree%d(x) - 1];\n", j);
+        nnode += treeSize[j];
+    }
+    fprintf(fp, "}\n\n");
+
+    fprintf(fp, "int predict(const float *x) {\n");
+    fprintf(fp, "    static const double cutoff[nclass] = {");
+    for (j = 0; j < nclass; ++j) fprintf(fp, "%s%.17g", j ? ", " : " ", cutoff[j]);
+    fprintf(fp, " };\n");
+    fprintf(fp, "    int count[nclass], j, jet = 1;\n");
+    fprintf(fp, "    double crit, cmax = 0.0;\n");
+    fprintf(fp, "    votes(x, count);\n");
+    fprintf(fp, "    for (j = 0; j < nclass; ++j) {\n");
+    fprintf(fp, "        crit = ((double) count[j] / ntree) / cutoff[j];\n");
+    fprintf(fp, "        if (crit > cmax) { jet = j + 1; cmax = crit; }\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    return jet;\n}\n\n");
+    fprintf(fp, "}\n");
+    fclose(fp);
+    return 0;
+}
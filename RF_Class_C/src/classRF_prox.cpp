@@ -0,0 +1,128 @@
+/**************************************************************
+ * Sparse (top-k per case) proximities of a trained classification forest
+ * License: GPLv2
+ *
+ * The dense n x n proximity of classRF is out of reach beyond some 20k
+ * cases. Here the cases are dropped down every kept tree and bucketed
+ * by terminal node (bucketByNode); the proximities of case i are then
+ * accumulated over the cases sharing its node in each tree only, and
+ * the k largest are kept. The values are those of the dense matrix,
+ * i.e. the fraction of trees where the pair shares a terminal node,
+ * or with inbag (oob_prox) the number of such trees where exactly one
+ * of the pair is in-bag divided by the number of trees where exactly
+ * one is in-bag.
+ *************************************************************/
+#include <stdlib.h>
+#include "rf.h"
+
+typedef unsigned long long uint64;
+
+static int popcount64(uint64 v) {
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((v * 0x0101010101010101ULL) >> 56);
+}
+
+/* keep val/idx sorted by decreasing proximity, ties to the lower case */
+static void insertTopK(int k, int *idx, double *val, int j, double v) {
+    int a = k - 1;
+
+    if (v < val[a] || (v == val[a] && j + 1 > idx[a])) return;
+    while (a > 0 && (v > val[a-1] || (v == val[a-1] && j + 1 < idx[a-1]))) {
+        val[a] = val[a-1];
+        idx[a] = idx[a-1];
+        a--;
+    }
+    val[a] = v;
+    idx[a] = j + 1;
+}
+
+/*
+ * x:       mdim x n cases
+ * inbag:   n x ntree in-bag counts (keep_inbag) for OOB proximities, or NULL
+ * k:       number of proximities kept per case, the case itself excluded
+ * proxIdx: k x n, 1-based indices of the nearest cases (0 if fewer than k
+ *          share a node with the case)
+ * proxVal: k x n, their proximities
+ */
+void classForestProximity(int *mdim, int *n, double *x, int *ntree, int *nrnodes,
+        int *treeSize, int *treemap, int *nodestatus, double *xbestsplit,
+        int *bestvar, int *nodeclass, int *inbag, int *k,
+        int *proxIdx, double *proxVal) {
+    int i, j, t, a, m, idxNodes, nwords, ntouched, den;
+    int *cat, *jts, *nodex, *base, *start, *order, *count, *touched;
+    uint64 *oob = NULL;
+    int N = *n, K = *k, T = *ntree;
+
+    cat = (int *) calloc(*mdim, sizeof(int));
+    for (m = 0; m < *mdim; ++m) cat[m] = 1;
+    jts = (int *) calloc(N, sizeof(int));
+    nodex = (int *) calloc((size_t) N * T, sizeof(int));
+    order = (int *) calloc((size_t) N * T, sizeof(int));
+    base = (int *) calloc(T + 1, sizeof(int));
+    for (t = 0; t < T; ++t) base[t+1] = base[t] + treeSize[t] + 1;
+    start = (int *) calloc(base[T], sizeof(int));
+
+    /* terminal node of every case in every tree, and the cases of every node */
+    idxNodes = 0;
+    for (t = 0; t < T; ++t) {
+        predictClassTree(x, N, *mdim, treemap + 2*idxNodes,
+                nodestatus + idxNodes, xbestsplit + idxNodes,
+                bestvar + idxNodes, nodeclass + idxNodes,
+                treeSize[t], cat, 0, jts, nodex + (size_t) t * N, 1);
+        bucketByNode(nodex + (size_t) t * N, N, treeSize[t], start + base[t],
+                order + (size_t) t * N);
+        idxNodes += *nrnodes;
+    }
+
+    /* bit t of case i set if i is in-bag for tree t */
+    nwords = (T + 63) / 64;
+    if (inbag) {
+        oob = (uint64 *) calloc((size_t) N * nwords, sizeof(uint64));
+        for (t = 0; t < T; ++t)
+            for (i = 0; i < N; ++i)
+                if (inbag[i + (size_t) t * N] > 0)
+                    oob[(size_t) i * nwords + t / 64] |= (uint64) 1 << (t % 64);
+    }
+
+    count = (int *) calloc(N, sizeof(int));
+    touched = (int *) calloc(N, sizeof(int));
+    for (i = 0; i < N; ++i) {
+        int *idx = proxIdx + (size_t) i * K;
+        double *val = proxVal + (size_t) i * K;
+        for (a = 0; a < K; ++a) {
+            idx[a] = 0;
+            val[a] = -1.0;
+        }
+        ntouched = 0;
+        for (t = 0; t < T; ++t) {
+            int *s = start + base[t], *o = order + (size_t) t * N;
+            int in_i = inbag ? inbag[i + (size_t) t * N] > 0 : 0;
+            m = nodex[i + (size_t) t * N];
+            for (a = s[m-1]; a < s[m]; ++a) {
+                j = o[a];
+                if (j == i) continue;
+                if (inbag && !(in_i ^ (inbag[j + (size_t) t * N] > 0))) continue;
+                if (count[j]++ == 0) touched[ntouched++] = j;
+            }
+        }
+        for (a = 0; a < ntouched; ++a) {
+            j = touched[a];
+            den = T;
+            if (inbag) {
+                den = 0;
+                for (t = 0; t < nwords; ++t)
+                    den += popcount64(oob[(size_t) i * nwords + t] ^ oob[(size_t) j * nwords + t]);
+            }
+            insertTopK(K, idx, val, j, (double) count[j] / den);
+            count[j] = 0;
+        }
+        for (a = 0; a < K; ++a)
+            if (idx[a] == 0) val[a] = 0.0;
+    }
+
+    free(cat); free(jts); free(nodex); free(order); free(base); free(start);
+    free(count); free(touched);
+    if (inbag) free(oob);
+}
@@ -0,0 +1,126 @@
+/**************************************************************
+ * Quantised, pruned classification forest
+ * License: GPLv2
+ *
+ * classForestQuantize packs a trained forest into 8 byte qnodes
+ * (see rf.h) instead of the ~28 bytes per node, padded to nrnodes
+ * per tree, of the classRF arrays:
+ *  - thresholds are quantised to the integer domain of the features,
+ *    x <= t being the same as x <= floor(t) for an integer x,
+ *  - trees are laid out in preorder without padding, the left child
+ *    is the next node and the right child a 16-bit relative offset,
+ *  - subtrees whose leaves all vote for the same class are pruned to
+ *    one leaf.
+ * The votes of classForestQ are then those of classForest for any
+ * integer-valued x; classRF_quantize checks this on a validation set.
+ *************************************************************/
+#include <math.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "rf.h"
+
+/* class of all the leaves below node k, 0 if they differ, -1 if a node is not in 0..size-1 */
+static int pureClass(int k, int size, int *treemap, int *nodestatus, int *nodeclass) {
+    int c, c2;
+
+    if (k < 0 || k >= size) return -1;
+    if (nodestatus[k] == NODE_TERMINAL) return nodeclass[k];
+    c = pureClass(treemap[2 * k] - 1, size, treemap, nodestatus, nodeclass);
+    if (c < 0) return c;
+    c2 = pureClass(treemap[2 * k + 1] - 1, size, treemap, nodestatus, nodeclass);
+    if (c2 < 0) return c2;
+    return (c == c2) ? c : 0;
+}
+
+static int quantizeSplit(double t) {
+    t = floor(t);
+    if (t >= (double) INT_MAX) return INT_MAX;
+    if (t <= (double) INT_MIN) return INT_MIN;
+    return (int) t;
+}
+
+/* writes the subtree of node k of a tree of size nodes from nodes[*pos] on, in preorder */
+static int emitNode(int k, int size, int mdim, int *treemap, int *nodestatus, int *bestvar,
+        int *nodeclass, double *xbestsplit, qnode *nodes, int *pos) {
+    int p = (*pos)++, c, ret;
+
+    c = pureClass(k, size, treemap, nodestatus, nodeclass);
+    if (c < 0) return 3;
+    if (c) {
+        nodes[p].split = c;
+        nodes[p].var = QNODE_LEAF;
+        nodes[p].right = 0;
+        return 0;
+    }
+    if (bestvar[k] < 1 || bestvar[k] > mdim || bestvar[k] > QNODE_LEAF) return 2;
+    nodes[p].split = quantizeSplit(xbestsplit[k]);
+    nodes[p].var = (unsigned short) (bestvar[k] - 1);
+    if ((ret = emitNode(treemap[2 * k] - 1, size, mdim, treemap, nodestatus, bestvar,
+            nodeclass, xbestsplit, nodes, pos))) return ret;
+    if (*pos - p > 0xFFFF) return 1;
+    nodes[p].right = (unsigned short) (*pos - p);
+    return emitNode(treemap[2 * k + 1] - 1, size, mdim, treemap, nodestatus, bestvar,
+            nodeclass, xbestsplit, nodes, pos);
+}
+
+/*
+ * nodes must hold sum(treeSize) qnodes; tree j starts at nodes[root[j]]
+ * and the forest uses nnode of them. Returns 0 on success, 1 if a left
+ * subtree has more than 65535 nodes, 2 if a split variable is not in
+ * 1..mdim (or mdim is above 65535), 3 if a node of tree j is not in
+ * 1..treeSize[j].
+ */
+int classForestQuantize(int mdim, int ntree, int nrnodes, int *treeSize,
+        int *treemap, int *nodestatus, int *bestvar, int *nodeclass,
+        double *xbestsplit, qnode *nodes, int *root, int *nnode) {
+    int j, idx, ret;
+
+    *nnode = 0;
+    for (j = 0; j < ntree; ++j) {
+        idx = j * nrnodes;
+        root[j] = *nnode;
+        if ((ret = emitNode(0, treeSize[j], mdim, treemap + 2 * idx, nodestatus + idx,
+                bestvar + idx, nodeclass + idx, xbestsplit + idx, nodes, nnode)))
+            return ret;
+    }
+    return 0;
+}
+
+/*
+ * x is (mdim x ntest), or (ntest x mdim) if sampleMajor. The compact
+ * forest stays in cache, so each sample goes down all the trees in turn.
+ */
+template <class T> static void classForestQT(int mdim, int ntest, int nclass,
+        int ntree, const qnode *nodes, const int *root, const T *x,
+        int sampleMajor, double *cutoff, double *countts, int *jet) {
+    size_t mstride = sampleMajor ? ntest : 1, istride = sampleMajor ? 1 : mdim;
+    int i, j, k;
+
+    for (i = 0; i < ntest * nclass; ++i) countts[i] = 0.0;
+    for (i = 0; i < ntest; ++i) {
+        const T *xi = x + i * istride;
+        double *ci = countts + i * nclass;
+        for (j = 0; j < ntree; ++j) {
+            k = root[j];
+            while (nodes[k].var != QNODE_LEAF)
+                k = ((double) xi[nodes[k].var * mstride] <= nodes[k].split) ?
+                    k + 1 : k + nodes[k].right;
+            ci[nodes[k].split - 1] += 1.0;
+        }
+    }
+    classForestVote(countts, cutoff, ntree, nclass, ntest, jet);
+}
+
+void classForestQ(int mdim, int ntest, int nclass, int ntree, const qnode *nodes,
+        const int *root, const double *x, int sampleMajor, double *cutoff,
+        double *countts, int *jet) {
+    classForestQT(mdim, ntest, nclass, ntree, nodes, root, x, sampleMajor,
+            cutoff, countts, jet);
+}
+
+void classForestQ(int mdim, int ntest, int nclass, int ntree, const qnode *nodes,
+        const int *root, const float *x, int sampleMajor, double *cutoff,
+        double *countts, int *jet) {
+    classForestQT(mdim, ntest, nclass, ntree, nodes, root, x, sampleMajor,
+            cutoff, countts, jet);
+}
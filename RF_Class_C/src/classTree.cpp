@@ -208,12 +208,36 @@ void F77_NAME(catmaxb)
 
 
 
-void predictClassTree(double *x, int n, int mdim, int *treemap,
-		      int *nodestatus, double *xbestsplit,
+/* child of the non-terminal node k reached by the value xv of its split variable m */
+template <class T> static inline int nextNode(T xv, int k, int m, int *treemap,
+		      double *xbestsplit, int *cat, int *cbestsplit, int maxcat) {
+    if (cat[m] == 1) {
+        /* Split by a numerical predictor */
+        return (xv <= xbestsplit[k]) ?
+            treemap[k * 2] - 1 : treemap[1 + k * 2] - 1;
+    }
+    /* Split by a categorical predictor */
+    return cbestsplit[(int) xv - 1 + k * maxcat] ?
+        treemap[k * 2] - 1 : treemap[1 + k * 2] - 1;
+}
+
+#define PREDICT_BLOCK 64
+
+/*
+ * x(m, i) = x[m * mstride + i * istride] : mstride = 1, istride = mdim for a feature-major
+ * (mdim x n) matrix, mstride = n, istride = 1 for a sample-major (n x mdim) matrix.
+ * Feature-major samples are dropped down the tree one at a time. Sample-major samples go
+ * down by blocks of PREDICT_BLOCK, one level at a time, so that each split reads rows of
+ * the block that are close in the column of its variable.
+ * If idx is not NULL only the n samples idx[0..n-1] are predicted, the others keep
+ * their jts/nodex entries.
+ */
+template <class T> static void predictClassTreeT(const T *x, int n, int mstride, int istride,
+		      const int *idx, int *treemap, int *nodestatus, double *xbestsplit,
 		      int *bestvar, int *nodeclass,
 		      int treeSize, int *cat, int nclass,
 		      int *jts, int *nodex, int maxcat) {
-    int m, i, j, k, *cbestsplit;
+    int m, i, j, k, a, *cbestsplit = NULL;
 	unsigned int npack;
 
     //Rprintf("maxcat %d\n",maxcat);
@@ -233,23 +257,151 @@ void predictClassTree(double *x, int n, int mdim, int *treemap,
             }
         }
     }
-    for (i = 0; i < n; ++i) {
+    if (istride != 1) {
+        for (a = 0; a < n; ++a) {
+            i = idx ? idx[a] : a;
+            const T *xi = x + (size_t) i * istride;
+            k = 0;
+            while (nodestatus[k] != NODE_TERMINAL) {
+                m = bestvar[k] - 1;
+                k = nextNode(xi[(size_t) m * mstride], k, m, treemap,
+                        xbestsplit, cat, cbestsplit, maxcat);
+            }
+            /* Terminal node: assign class label */
+            jts[i] = nodeclass[k];
+            nodex[i] = k + 1;
+        }
+    } else {
+        int i0, b, nb, na, nactive, knode[PREDICT_BLOCK], active[PREDICT_BLOCK];
+        int sample[PREDICT_BLOCK];
+
+        for (i0 = 0; i0 < n; i0 += PREDICT_BLOCK) {
+            nb = (n - i0 < PREDICT_BLOCK) ? n - i0 : PREDICT_BLOCK;
+            na = 0;
+            for (b = 0; b < nb; ++b) {
+                sample[b] = idx ? idx[i0 + b] : i0 + b;
+                knode[b] = 0;
+                if (nodestatus[0] != NODE_TERMINAL) active[na++] = b;
+            }
+            /* move the samples of the block still in a non-terminal node one level down */
+            while (na > 0) {
+                nactive = 0;
+                for (a = 0; a < na; ++a) {
+                    b = active[a];
+                    k = knode[b];
+                    m = bestvar[k] - 1;
+                    k = nextNode(x[(size_t) m * mstride + sample[b]], k, m, treemap,
+                            xbestsplit, cat, cbestsplit, maxcat);
+                    knode[b] = k;
+                    if (nodestatus[k] != NODE_TERMINAL) active[nactive++] = b;
+                }
+                na = nactive;
+            }
+            /* Terminal nodes: assign class labels */
+            for (b = 0; b < nb; ++b) {
+                jts[sample[b]] = nodeclass[knode[b]];
+                nodex[sample[b]] = knode[b] + 1;
+            }
+        }
+    }
+    if (maxcat > 1) free(cbestsplit);
+}
+
+void predictClassTree(double *x, int n, int mdim, int *treemap,
+		      int *nodestatus, double *xbestsplit,
+		      int *bestvar, int *nodeclass,
+		      int treeSize, int *cat, int nclass,
+		      int *jts, int *nodex, int maxcat) {
+    predictClassTreeT(x, n, 1, mdim, (const int *) NULL, treemap, nodestatus, xbestsplit,
+            bestvar, nodeclass, treeSize, cat, nclass, jts, nodex, maxcat);
+}
+
+/* numbers the subtree of node k in preorder from p on, returns the next free number */
+static int preorderNode(int k, int *treemap, int *nodestatus, int *pre, int *last, int p) {
+    pre[k] = p++;
+    if (nodestatus[k] != NODE_TERMINAL) {
+        p = preorderNode(treemap[2 * k] - 1, treemap, nodestatus, pre, last, p);
+        p = preorderNode(treemap[2 * k + 1] - 1, treemap, nodestatus, pre, last, p);
+    }
+    last[k] = p - 1;
+    return p;
+}
+
+/* pre[k] = preorder position of node k, pre[k]..last[k] are the positions of its subtree */
+void treePreorder(int *treemap, int *nodestatus, int *pre, int *last) {
+    preorderNode(0, treemap, nodestatus, pre, last, 0);
+}
+
+/*
+ * Drops the samples idx[0..n-1] of x (mdim x *) down the tree again with the
+ * values of variable mperm replaced by xperm[0..n-1] (permutation importance).
+ * A sample can only end in another terminal node if its path goes through a
+ * split on mperm, i.e. if the preorder position leafPre[a] of its terminal node
+ * lies in the subtree of such a split (pre/last from treePreorder); the other
+ * samples are not visited. cover holds treeSize + 1 ints.
+ * Returns the number of samples whose class changed from jold[idx[a]], with
+ * their positions a in moved and their new classes in jmoved.
+ */
+int predictClassTreePermuted(const double *x, int mdim, const int *idx, int n,
+		      int mperm, const double *xperm, const int *leafPre,
+		      const int *pre, const int *last, int *treemap, int *nodestatus,
+		      double *xbestsplit, int *bestvar, int *nodeclass, int treeSize,
+		      int *cat, const int *jold, int *cover, int *moved, int *jmoved) {
+    int a, i, k, m, nmoved = 0;
+    double xv;
+
+    zeroInt(cover, treeSize + 1);
+    for (k = 0; k < treeSize; ++k) {
+        if (nodestatus[k] != NODE_TERMINAL && bestvar[k] - 1 == mperm) {
+            cover[pre[k]]++;
+            cover[last[k] + 1]--;
+        }
+    }
+    for (k = 1; k < treeSize; ++k) cover[k] += cover[k - 1];
+
+    for (a = 0; a < n; ++a) {
+        if (cover[leafPre[a]] == 0) continue;
+        i = idx[a];
         k = 0;
         while (nodestatus[k] != NODE_TERMINAL) {
             m = bestvar[k] - 1;
+            xv = (m == mperm) ? xperm[a] : x[m + (size_t) i * mdim];
             if (cat[m] == 1) {
-                /* Split by a numerical predictor */
-                k = (x[m + i * mdim] <= xbestsplit[k]) ?
-                    treemap[k * 2] - 1 : treemap[1 + k * 2] - 1;
+                k = (xv <= xbestsplit[k]) ? treemap[k * 2] - 1 : treemap[1 + k * 2] - 1;
             } else {
-                /* Split by a categorical predictor */
-                k = cbestsplit[(int) x[m + i * mdim] - 1 + k * maxcat] ?
+                /* bit j of the packed split is category j + 1 */
+                k = (((unsigned int) xbestsplit[k] >> ((int) xv - 1)) & 1) ?
                     treemap[k * 2] - 1 : treemap[1 + k * 2] - 1;
             }
         }
-        /* Terminal node: assign class label */
-        jts[i] = nodeclass[k];
-        nodex[i] = k + 1;
+        if (nodeclass[k] != jold[i]) {
+            moved[nmoved] = a;
+            jmoved[nmoved++] = nodeclass[k];
+        }
     }
-    if (maxcat > 1) free(cbestsplit);
+    return nmoved;
+}
+
+/*
+ * x is (mdim x n), or (n x mdim) if sampleMajor, read in place.
+ * Predicts the samples idx[0..nidx-1], or all n if idx is NULL.
+ */
+void predictClassTreeX(const double *x, int n, int mdim, int sampleMajor,
+		      const int *idx, int nidx, int *treemap, int *nodestatus, double *xbestsplit,
+		      int *bestvar, int *nodeclass,
+		      int treeSize, int *cat, int nclass,
+		      int *jts, int *nodex, int maxcat) {
+    predictClassTreeT(x, idx ? nidx : n, sampleMajor ? n : 1, sampleMajor ? 1 : mdim,
+            idx, treemap, nodestatus, xbestsplit, bestvar, nodeclass,
+            treeSize, cat, nclass, jts, nodex, maxcat);
+}
+
+void predictClassTreeX(const float *x, int n, int mdim, int sampleMajor,
+		      const int *idx, int nidx, int *treemap, int *nodestatus, double *xbestsplit,
+		      int *bestvar, int *nodeclass,
+		      int treeSize, int *cat, int nclass,
+		      int *jts, int *nodex, int maxcat) {
+    predictClassTreeT(x, idx ? nidx : n, sampleMajor ? n : 1, sampleMajor ? 1 : mdim,
+            idx, treemap, nodestatus, xbestsplit, bestvar, nodeclass,
+            treeSize, cat, nclass, jts, nodex, maxcat);
 }
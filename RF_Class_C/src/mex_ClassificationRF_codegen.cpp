@@ -0,0 +1,40 @@
+#include <math.h>
+#include "mex.h"
+#include "rf.h"
+
+/*
+ * mexClassRF_codegen(base, name, table, mdim, nrnodes, ntree, xbestsplit,
+ *                    cutoff, treemap, nodestatus, nodeclass, bestvar, ndbigtree, nclass)
+ * writes base.h and base.cpp, see classRF_codegen.cpp
+ */
+void mexFunction( int nlhs, mxArray *plhs[],
+		  int nrhs, const mxArray*prhs[] )
+{
+    char base[1024], name[256];
+    int ret;
+
+    if (nrhs != 14)
+        mexErrMsgTxt("mexClassRF_codegen needs 14 arguments, call it through classRF_codegen");
+    if (mxGetString(prhs[0], base, sizeof(base)) || mxGetString(prhs[1], name, sizeof(name)))
+        mexErrMsgTxt("base and name must be strings");
+
+    int table = (int)mxGetScalar(prhs[2]);
+    int mdim = (int)mxGetScalar(prhs[3]);
+    int nrnodes = (int)mxGetScalar(prhs[4]);
+    int ntree = (int)mxGetScalar(prhs[5]);
+    double* xbestsplit = (double*)mxGetData(prhs[6]);
+    double* cutoff = (double*)mxGetData(prhs[7]);
+    int* treemap = (int*) mxGetData(prhs[8]);
+    int* nodestatus = (int*) mxGetData(prhs[9]);
+    int* nodeclass = (int*) mxGetData(prhs[10]);
+    int* bestvar = (int*) mxGetData(prhs[11]);
+    int* ndbigtree = (int*) mxGetData(prhs[12]);
+    int nclass = (int)mxGetScalar(prhs[13]);
+
+    ret = classForestCodegen(base, name, table, mdim, nclass, ntree, nrnodes,
+            ndbigtree, treemap, nodestatus, bestvar, nodeclass, xbestsplit, cutoff);
+    if (ret == 1)
+        mexErrMsgTxt("could not write the generated files");
+    if (ret == 2)
+        mexErrMsgTxt("name must be a valid C++ identifier");
+}
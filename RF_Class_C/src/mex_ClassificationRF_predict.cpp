@@ -3,12 +3,34 @@
 #include "memory.h"
 
 #define DEBUG_ON 0
+#define PREDICT_INTERFACE 2    /* 4th output: 2 = sample_major and early_exit arguments */
 void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
         int *nrnodes, int *ntree, double *x, double *xbestsplit,
         double *pid, double *cutoff, double *countts, int *treemap,
         int *nodestatus, int *cat, int *nodeclass, int *jts,
         int *jet, int *bestvar, int *node, int *treeSize,
         int *keepPred, int *prox, double *proxMat, int *nodes);
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, const double *x, int sampleMajor, int chunk, double *xbestsplit,
+        double *pid, double *cutoff, double *countts, int *treemap,
+        int *nodestatus, int *cat, int *nodeclass, int *jts,
+        int *jet, int *bestvar, int *node, int *treeSize,
+        int *keepPred, int *prox, double *proxMat, int *nodes);
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat,
+        int *nrnodes, int *ntree, const float *x, int sampleMajor, int chunk, double *xbestsplit,
+        double *pid, double *cutoff, double *countts, int *treemap,
+        int *nodestatus, int *cat, int *nodeclass, int *jts,
+        int *jet, int *bestvar, int *node, int *treeSize,
+        int *keepPred, int *prox, double *proxMat, int *nodes);
+
+/*
+ * X is (p_size x n_size), or (n_size x p_size) if the optional 14th argument sample_major is 1.
+ * X is double or single and is read in place in either layout.
+ * A 15th argument early_exit > 0 evaluates the trees by groups of early_exit and
+ * stops for a sample once no class can overtake its leading class (classForestX).
+ * A 4th output returns PREDICT_INTERFACE, so that classRF_predict can tell this mex
+ * from older builds, which ignore the 14th and 15th arguments.
+ */
 
 void mexFunction( int nlhs, mxArray *plhs[], 
 		  int nrhs, const mxArray*prhs[] )
@@ -17,8 +39,12 @@ void mexFunction( int nlhs, mxArray *plhs[],
     if (DEBUG_ON) { mexPrintf("Number of parameters passed %d\n",nrhs);fflush(stdout);}
     
     int i;
-    int p_size = mxGetM(prhs[0]);int mdim = p_size;
-    int n_size = mxGetN(prhs[0]);int nsample=n_size;
+    int sampleMajor = (nrhs > 13) ? (int)mxGetScalar(prhs[13]) : 0;
+    int chunk = (nrhs > 14) ? (int)mxGetScalar(prhs[14]) : 0;
+    if (!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]))
+        mexErrMsgTxt("X must be double or single");
+    int p_size = sampleMajor ? mxGetN(prhs[0]) : mxGetM(prhs[0]);int mdim = p_size;
+    int n_size = sampleMajor ? mxGetM(prhs[0]) : mxGetN(prhs[0]);int nsample=n_size;
     int dimx[]={p_size, n_size};
     
     if (DEBUG_ON) { mexPrintf("p_size %d, n_size %d\n",p_size,n_size);fflush(stdout);}
@@ -55,7 +81,6 @@ void mexFunction( int nlhs, mxArray *plhs[],
     double impout=p_size;
     double impSD=1;
     double impmat=1; 
-    double *X = mxGetPr(prhs[0]);
     int nrnodes = (int)mxGetScalar(prhs[1]);
     if (DEBUG_ON) { mexPrintf("nrnodes %d\n",nrnodes);}
         
@@ -131,13 +156,23 @@ void mexFunction( int nlhs, mxArray *plhs[],
     }
     
     countts = (double*)mxGetPr(plhs[2]);
-    
-    classForest(&mdim, &ntest, &nclass, &maxcat,
-        &nrnodes, &ntree, X, xbestsplit,
-        pid, cutoff, countts, treemap,
-        nodestatus, cat, nodeclass, jts,
-        jet, bestvar, nodexts, treeSize,
-        &keepPred, &intProximity, proxMat, &nodes);
+    if (nlhs > 3)
+        plhs[3] = mxCreateDoubleScalar(PREDICT_INTERFACE);
+    
+    if (mxIsSingle(prhs[0]))
+        classForestX(&mdim, &ntest, &nclass, &maxcat,
+            &nrnodes, &ntree, (const float*)mxGetData(prhs[0]), sampleMajor, chunk, xbestsplit,
+            pid, cutoff, countts, treemap,
+            nodestatus, cat, nodeclass, jts,
+            jet, bestvar, nodexts, treeSize,
+            &keepPred, &intProximity, proxMat, &nodes);
+    else
+        classForestX(&mdim, &ntest, &nclass, &maxcat,
+            &nrnodes, &ntree, (const double*)mxGetData(prhs[0]), sampleMajor, chunk, xbestsplit,
+            pid, cutoff, countts, treemap,
+            nodestatus, cat, nodeclass, jts,
+            jet, bestvar, nodexts, treeSize,
+            &keepPred, &intProximity, proxMat, &nodes);
    
     if (DEBUG_ON) { 
         mexPrintf("\n\n\nntest %d\n",ntest);
@@ -0,0 +1,47 @@
+#include <math.h>
+#include "mex.h"
+#include "rf.h"
+
+/*
+ * [proxIdx, proxVal] = mexClassRF_proximity(X, nrnodes, ntree, xbestsplit, treemap,
+ *                          nodestatus, nodeclass, bestvar, ndbigtree, k, inbag)
+ * X: (p_size x n_size) double, inbag: (n_size x ntree) int32 or [] for all trees.
+ * proxIdx (int32) and proxVal are (k x n_size), see classRF_prox.cpp
+ */
+void mexFunction( int nlhs, mxArray *plhs[],
+		  int nrhs, const mxArray*prhs[] )
+{
+    if (nrhs != 11)
+        mexErrMsgTxt("mexClassRF_proximity needs 11 arguments, call it through classRF_proximity");
+    if (!mxIsDouble(prhs[0]))
+        mexErrMsgTxt("X must be double");
+
+    int p_size = mxGetM(prhs[0]);
+    int n_size = mxGetN(prhs[0]);
+    double* X = mxGetPr(prhs[0]);
+    int nrnodes = (int)mxGetScalar(prhs[1]);
+    int ntree = (int)mxGetScalar(prhs[2]);
+    double* xbestsplit = (double*)mxGetData(prhs[3]);
+    int* treemap = (int*) mxGetData(prhs[4]);
+    int* nodestatus = (int*) mxGetData(prhs[5]);
+    int* nodeclass = (int*) mxGetData(prhs[6]);
+    int* bestvar = (int*) mxGetData(prhs[7]);
+    int* ndbigtree = (int*) mxGetData(prhs[8]);
+    int k = (int)mxGetScalar(prhs[9]);
+    int* inbag = NULL;
+
+    if (k < 1)
+        mexErrMsgTxt("k must be at least 1");
+    if (!mxIsEmpty(prhs[10])) {
+        if (!mxIsInt32(prhs[10]) || (int)mxGetM(prhs[10]) != n_size || (int)mxGetN(prhs[10]) != ntree)
+            mexErrMsgTxt("inbag must be the n_size x ntree int32 matrix of keep_inbag");
+        inbag = (int*) mxGetData(prhs[10]);
+    }
+
+    plhs[0] = mxCreateNumericMatrix(k, n_size, mxINT32_CLASS, mxREAL);
+    plhs[1] = mxCreateNumericMatrix(k, n_size, mxDOUBLE_CLASS, mxREAL);
+
+    classForestProximity(&p_size, &n_size, X, &ntree, &nrnodes, ndbigtree,
+            treemap, nodestatus, xbestsplit, bestvar, nodeclass, inbag, &k,
+            (int*)mxGetData(plhs[0]), mxGetPr(plhs[1]));
+}
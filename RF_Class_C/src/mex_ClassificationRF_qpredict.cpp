@@ -0,0 +1,42 @@
+#include <math.h>
+#include "mex.h"
+#include "rf.h"
+
+/*
+ * [Y_hat, votes] = mexClassRF_qpredict(X, nodes, root, mdim, nclass, cutoff)
+ * X: (n_size x mdim) double or single read in place, nodes/root from
+ * mexClassRF_quantize. votes is (nclass x n_size).
+ */
+void mexFunction( int nlhs, mxArray *plhs[],
+		  int nrhs, const mxArray*prhs[] )
+{
+    if (nrhs != 6)
+        mexErrMsgTxt("mexClassRF_qpredict needs 6 arguments, call it through classRF_qpredict");
+    if (!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]))
+        mexErrMsgTxt("X must be double or single");
+    if (!mxIsUint32(prhs[1]) || mxGetM(prhs[1]) != sizeof(qnode) / 4 || !mxIsInt32(prhs[2]))
+        mexErrMsgTxt("nodes/root do not come from classRF_quantize");
+
+    int n_size = mxGetM(prhs[0]);
+    int mdim = (int)mxGetScalar(prhs[3]);
+    int nclass = (int)mxGetScalar(prhs[4]);
+    int ntree = mxGetNumberOfElements(prhs[2]);
+    double* cutoff = (double*)mxGetData(prhs[5]);
+    const qnode* nodes = (const qnode*)mxGetData(prhs[1]);
+    const int* root = (const int*)mxGetData(prhs[2]);
+
+    if ((int)mxGetN(prhs[0]) != mdim)
+        mexErrMsgTxt("X must have mdim columns");
+
+    plhs[0] = mxCreateNumericMatrix(n_size, 1, mxINT32_CLASS, mxREAL);
+    plhs[1] = mxCreateNumericMatrix(nclass, n_size, mxDOUBLE_CLASS, mxREAL);
+    int* jet = (int*)mxGetData(plhs[0]);
+    double* countts = (double*)mxGetPr(plhs[1]);
+
+    if (mxIsSingle(prhs[0]))
+        classForestQ(mdim, n_size, nclass, ntree, nodes, root,
+                (const float*)mxGetData(prhs[0]), 1, cutoff, countts, jet);
+    else
+        classForestQ(mdim, n_size, nclass, ntree, nodes, root,
+                (const double*)mxGetData(prhs[0]), 1, cutoff, countts, jet);
+}
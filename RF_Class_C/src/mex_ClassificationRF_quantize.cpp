@@ -0,0 +1,46 @@
+#include <math.h>
+#include <string.h>
+#include "mex.h"
+#include "rf.h"
+
+/*
+ * [nodes, root] = mexClassRF_quantize(mdim, nrnodes, ntree, treemap, nodestatus,
+ *                                     nodeclass, bestvar, ndbigtree, xbestsplit)
+ * nodes: (2 x nnode) uint32 holding the qnodes, root: (ntree x 1) int32 first
+ * node of every tree, see classRF_quant.cpp
+ */
+void mexFunction( int nlhs, mxArray *plhs[],
+		  int nrhs, const mxArray*prhs[] )
+{
+    int j, nnode, ret, total = 0;
+
+    if (nrhs != 9)
+        mexErrMsgTxt("mexClassRF_quantize needs 9 arguments, call it through classRF_quantize");
+
+    int mdim = (int)mxGetScalar(prhs[0]);
+    int nrnodes = (int)mxGetScalar(prhs[1]);
+    int ntree = (int)mxGetScalar(prhs[2]);
+    int* treemap = (int*) mxGetData(prhs[3]);
+    int* nodestatus = (int*) mxGetData(prhs[4]);
+    int* nodeclass = (int*) mxGetData(prhs[5]);
+    int* bestvar = (int*) mxGetData(prhs[6]);
+    int* ndbigtree = (int*) mxGetData(prhs[7]);
+    double* xbestsplit = (double*)mxGetData(prhs[8]);
+
+    for (j = 0; j < ntree; j++) total += ndbigtree[j];
+    qnode *nodes = (qnode*)mxCalloc(total, sizeof(qnode));
+    plhs[1] = mxCreateNumericMatrix(ntree, 1, mxINT32_CLASS, mxREAL);
+
+    ret = classForestQuantize(mdim, ntree, nrnodes, ndbigtree, treemap, nodestatus,
+            bestvar, nodeclass, xbestsplit, nodes, (int*)mxGetData(plhs[1]), &nnode);
+    if (ret == 1)
+        mexErrMsgTxt("a subtree has more than 65535 nodes, can not use 16-bit child offsets");
+    if (ret == 2)
+        mexErrMsgTxt("split variable out of 1..mdim (mdim must be at most 65535)");
+    if (ret == 3)
+        mexErrMsgTxt("tree node out of 1..ndbigtree, the model is corrupted");
+
+    plhs[0] = mxCreateNumericMatrix(sizeof(qnode) / 4, nnode, mxUINT32_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[0]), nodes, nnode * sizeof(qnode));
+    mxFree(nodes);
+}
@@ -55,6 +55,60 @@ void classForest(int *mdim, int *ntest, int *nclass, int *maxcat,
                  int *jet, int *bestvar, int *nodexts, int *ndbigtree, 
                  int *keepPred, int *prox, double *proxmatrix, int *nodes);
 
+/* same as classForest on double/float test data, (ntest x mdim) if sampleMajor,
+   stopping early for decided samples if chunk > 0 (see classRF.cpp) */
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat, 
+                 int *nrnodes, int *jbt, const double *xts, int sampleMajor, int chunk, double *xbestsplit, 
+                 double *pid, double *cutoff, double *countts, int *treemap, 
+                 int *nodestatus, int *cat, int *nodeclass, int *jts, 
+                 int *jet, int *bestvar, int *nodexts, int *ndbigtree, 
+                 int *keepPred, int *prox, double *proxmatrix, int *nodes);
+void classForestX(int *mdim, int *ntest, int *nclass, int *maxcat, 
+                 int *nrnodes, int *jbt, const float *xts, int sampleMajor, int chunk, double *xbestsplit, 
+                 double *pid, double *cutoff, double *countts, int *treemap, 
+                 int *nodestatus, int *cat, int *nodeclass, int *jts, 
+                 int *jet, int *bestvar, int *nodexts, int *ndbigtree, 
+                 int *keepPred, int *prox, double *proxmatrix, int *nodes);
+
+/* jet = class with the maximum votes/cutoff, ties broken at random */
+void classForestVote(double *countts, double *cutoff, int ntree, int nclass,
+                 int ntest, int *jet);
+
+/* same as classForestVote with the draws of rnd(state) in [0,1), which are
+   made for every sample (the first class always compares equal to cmax) */
+void classForestVoteRand(double *countts, double *cutoff, int ntree, int nclass,
+                 int ntest, int *jet, double (*rnd)(void *), void *state);
+
+/* 8 byte node of a quantised forest (classRF_quant.cpp), trees stored in preorder */
+typedef struct {
+    int split;             /* go left if x[var] <= split, class label of a leaf */
+    unsigned short var;    /* split variable (0-based), QNODE_LEAF for a leaf */
+    unsigned short right;  /* right child is this node + right, left child the next node */
+} qnode;
+#define QNODE_LEAF 0xFFFF
+
+int classForestQuantize(int mdim, int ntree, int nrnodes, int *treeSize,
+                 int *treemap, int *nodestatus, int *bestvar, int *nodeclass,
+                 double *xbestsplit, qnode *nodes, int *root, int *nnode);
+void classForestQ(int mdim, int ntest, int nclass, int ntree, const qnode *nodes,
+                 const int *root, const double *x, int sampleMajor, double *cutoff,
+                 double *countts, int *jet);
+void classForestQ(int mdim, int ntest, int nclass, int ntree, const qnode *nodes,
+                 const int *root, const float *x, int sampleMajor, double *cutoff,
+                 double *countts, int *jet);
+
+/* k largest proximities of every case, bucketed by terminal node (classRF_prox.cpp) */
+void classForestProximity(int *mdim, int *n, double *x, int *ntree, int *nrnodes,
+                 int *treeSize, int *treemap, int *nodestatus, double *xbestsplit,
+                 int *bestvar, int *nodeclass, int *inbag, int *k,
+                 int *proxIdx, double *proxVal);
+
+/* writes base.h/base.cpp evaluating the forest with inlined splits (classRF_codegen.cpp) */
+int classForestCodegen(const char *base, const char *name, int table,
+                 int mdim, int nclass, int ntree, int nrnodes, int *treeSize,
+                 int *treemap, int *nodestatus, int *bestvar, int *nodeclass,
+                 double *xbestsplit, double *cutoff);
+
 void regTree(double *x, double *y, int mdim, int nsample, 
 	     int *lDaughter, int *rDaughter, double *upper, double *avnode, 
              int *nodestatus, int nrnodes, int *treeSize, int nthsize, 
@@ -77,6 +131,28 @@ void predictClassTree(double *x, int n, int mdim, int *treemap,
 		      int ndbigtree, int *cat, int nclass,
 		      int *jts, int *nodex, int maxcat);
 
+/* same as predictClassTree on double/float data, (n x mdim) if sampleMajor,
+   for the samples idx[0..nidx-1] only if idx is not NULL */
+void predictClassTreeX(const double *x, int n, int mdim, int sampleMajor,
+		      const int *idx, int nidx, int *treemap, int *nodestatus, double *xbestsplit,
+		      int *bestvar, int *nodeclass,
+		      int ndbigtree, int *cat, int nclass,
+		      int *jts, int *nodex, int maxcat);
+void predictClassTreeX(const float *x, int n, int mdim, int sampleMajor,
+		      const int *idx, int nidx, int *treemap, int *nodestatus, double *xbestsplit,
+		      int *bestvar, int *nodeclass,
+		      int ndbigtree, int *cat, int nclass,
+		      int *jts, int *nodex, int maxcat);
+
+/* preorder numbering of a tree and re-prediction with one variable permuted,
+   for the OOB importance of classRF (see classTree.cpp) */
+void treePreorder(int *treemap, int *nodestatus, int *pre, int *last);
+int predictClassTreePermuted(const double *x, int mdim, const int *idx, int n,
+		      int mperm, const double *xperm, const int *leafPre,
+		      const int *pre, const int *last, int *treemap, int *nodestatus,
+		      double *xbestsplit, int *bestvar, int *nodeclass, int treeSize,
+		      int *cat, const int *jold, int *cover, int *moved, int *jmoved);
+
 int pack(int l, int *icat);
 void unpack(unsigned int npack, int *icat);
 
@@ -93,6 +169,9 @@ void Xtranslate(double *x, int mdim, int nrnodes, int nsample,
 		int *bestvar, int *bestsplit, int *bestsplitnext,
 		double *xbestsplit, int *nodestatus, int *cat, int treeSize);
 void permuteOOB(int m, double *x, int *in, int nsample, int mdim);
+void permuteOOBIdx(int m, const double *x, const int *oobIdx, int nOOB, int mdim,
+                  double *tp);
+void bucketByNode(int *node, int n, int nnode, int *start, int *order);
 void computeProximity(double *prox, int oobprox, int *node, int *inbag, 
                       int *oobpair, int n);
 
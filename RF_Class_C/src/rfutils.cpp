@@ -193,18 +193,36 @@ void permuteOOB(int m, double *x, int *in, int nsample, int mdim) {
  *   nsample: number of cases in the data
  *   mdim: number of variables in the data
  */
-    double *tp, tmp;
-    int i, last, k, nOOB = 0;
+    double *tp;
+    int i, *oobIdx, nOOB = 0;
     
     tp = (double *)  calloc(nsample, sizeof(double));
+    oobIdx = (int *) calloc(nsample, sizeof(int));
 
     for (i = 0; i < nsample; ++i) {
-	/* make a copy of the OOB part of the data into tp (for permuting) */
-	if (in[i] == 0) {
-            tp[nOOB] = x[m + i*mdim];
-            nOOB++;
-        }
+	if (in[i] == 0) oobIdx[nOOB++] = i;
     }
+    permuteOOBIdx(m, x, oobIdx, nOOB, mdim, tp);
+
+    /* Copy the permuted OOB data back into x. */
+    for (i = 0; i < nOOB; ++i) x[m + oobIdx[i]*mdim] = tp[i];
+    free(tp);
+    free(oobIdx);
+}
+
+void permuteOOBIdx(int m, const double *x, const int *oobIdx, int nOOB, int mdim,
+                   double *tp) {
+/* Permuted copy of the OOB part of a variable, x is left unchanged.
+ * Argument:
+ *   oobIdx: the nOOB OOB cases
+ *   tp: output, tp[i] is the permuted value for case oobIdx[i]
+ * The random numbers are drawn as in permuteOOB.
+ */
+    double tmp;
+    int i, last, k;
+
+    /* make a copy of the OOB part of the data into tp (for permuting) */
+    for (i = 0; i < nOOB; ++i) tp[i] = x[m + oobIdx[i]*mdim];
     /* Permute tp */
     last = nOOB;
     for (i = 0; i < nOOB; ++i) {
@@ -214,16 +232,22 @@ void permuteOOB(int m, double *x, int *in, int nsample, int mdim) {
 	tp[k] = tmp;
 	last--;
     }
+}
 
-    /* Copy the permuted OOB data back into x. */
-    nOOB = 0;
-    for (i = 0; i < nsample; ++i) {
-	if (in[i] == 0) {
-            x[m + i*mdim] = tp[nOOB];
-            nOOB++;
-	}
-    }
-    free(tp);
+/* Group the cases by terminal node (counting sort). */
+void bucketByNode(int *node, int n, int nnode, int *start, int *order) {
+/* node:  vector of terminal node labels, 1..nnode
+   start: nnode+1 vector, the cases in node m are order[start[m-1]..start[m]-1]
+   order: n vector of case indices, increasing within a node
+*/
+    int i, m;
+    zeroInt(start, nnode + 1);
+    for (i = 0; i < n; ++i) start[node[i]]++;
+    for (m = 1; m <= nnode; ++m) start[m] += start[m-1];
+    for (i = n - 1; i >= 0; --i) order[--start[node[i]]] = i;
+    /* start[m] is now the first case of node m */
+    for (m = 0; m < nnode; ++m) start[m] = start[m+1];
+    start[nnode] = n;
 }
 
 /* Compute proximity. */
@@ -236,8 +260,29 @@ void computeProximity(double *prox, int oobprox, int *node, int *inbag,
    inbag:   indicator of whether a case is in-bag
    oobpair: matrix to accumulate the number of times a pair is OOB together
    n:       total number of cases
+   Without oobprox only the pairs sharing a node are visited.
 */
-    int i, j;
+    int i, j, a, b, m, nnode, *start, *order;
+    if (!oobprox) {
+        nnode = 0;
+        for (i = 0; i < n; ++i) if (node[i] > nnode) nnode = node[i];
+        start = (int *) calloc(nnode + 1, sizeof(int));
+        order = (int *) calloc(n, sizeof(int));
+        bucketByNode(node, n, nnode, start, order);
+        for (m = 0; m < nnode; ++m) {
+            for (a = start[m]; a < start[m+1]; ++a) {
+                for (b = a + 1; b < start[m+1]; ++b) {
+                    i = order[a];
+                    j = order[b];
+                    prox[j*n + i] += 1.0;
+                    prox[i*n + j] += 1.0;
+                }
+            }
+        }
+        free(start);
+        free(order);
+        return;
+    }
     for (i = 0; i < n; ++i) {
         for (j = i+1; j < n; ++j) {
             if (oobprox) {
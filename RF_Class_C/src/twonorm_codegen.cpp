@@ -0,0 +1,227 @@
+/********************************************************************
+ * Benchmark of the generated forest (classRF_codegen.cpp) against classForest
+ * License: GPLv2
+ *
+ * Built twice by 'make twonorm_codegen':
+ *
+ *  twonorm_codegen [table]: trains the twonorm forest as in
+ *      twonorm_C_wrapper.cpp, writes tempbuild/twonorm_forest.{h,cpp}
+ *      (nested branches, or a node table if table is 1) and dumps the
+ *      model to tempbuild/twonorm_forest.model
+ *
+ *  twonorm_codegen_bench (-DFOREST_BENCH, linked with the static
+ *      library built from tempbuild/twonorm_forest.cpp): reads the
+ *      model back, predicts the twonorm data with classForest and with
+ *      twonorm_forest::predict, checks that the votes and labels are
+ *      identical and prints the time per sample of both.
+ *
+ * Run from RF_Class_C (reads data/X_twonorm.txt and data/Y_twonorm.txt).
+ *******************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "rf.h"
+#ifdef FOREST_BENCH
+#include "twonorm_forest.h"
+#endif
+
+#define ROWS 300
+#define COLS 20
+#define NCLASS 2
+#define NTREE 500
+#define MODEL_FILE "tempbuild/twonorm_forest.model"
+
+void classRF(double *x, int *dimx, int *cl, int *ncl, int *cat, int *maxcat,
+	     int *sampsize, int *strata, int *Options, int *ntree, int *nvar,
+	     int *ipi, double *classwt, double *cut, int *nodesize,
+	     int *outcl, int *counttr, double *prox,
+	     double *imprt, double *impsd, double *impmat, int *nrnodes,
+	     int *ndbigtree, int *nodestatus, int *bestvar, int *treemap,
+	     int *nodeclass, double *xbestsplit, double *errtr,
+	     int *testdat, double *xts, int *clts, int *nts, double *countts,
+	     int *outclts, int labelts, double *proxts, double *errts,
+             int *inbag);
+
+/* X is (COLS x ROWS), one sample per column as classRF wants it */
+static void readTwonorm(double *X, int *Y) {
+    FILE *fp_X = fopen("data/X_twonorm.txt", "r");
+    FILE *fp_Y = fopen("data/Y_twonorm.txt", "r");
+    char dum_str[100];
+    int i;
+
+    if (fp_X == NULL || fp_Y == NULL) {
+        printf("cannot find files for data\n"); exit(1);
+    }
+    for (i = 0; i < ROWS * COLS; i++) {
+        fscanf(fp_X, "%s ", dum_str);
+        X[i] = atof(dum_str);
+    }
+    for (i = 0; i < ROWS; i++) {
+        fscanf(fp_Y, "%s ", dum_str);
+        Y[i] = (int)atof(dum_str);
+    }
+    fclose(fp_X);
+    fclose(fp_Y);
+}
+
+#ifndef FOREST_BENCH
+
+int main(int argc, char **argv) {
+    int i, p_size = COLS, n_size = ROWS, nclass = NCLASS, ntree = NTREE;
+    int table = (argc > 1) ? atoi(argv[1]) : 0;
+    double *X = (double*)calloc(ROWS * COLS, sizeof(double));
+    int *Y = (int*)calloc(ROWS, sizeof(int));
+    int dimx[] = {p_size, n_size};
+    int *cat = (int*)calloc(p_size, sizeof(int));
+
+    readTwonorm(X, Y);
+    for (i = 0; i < p_size; i++) cat[i] = 1;
+
+    /* same settings as twonorm_C_wrapper.cpp, without the trace */
+    int maxcat = 1, sampsize = n_size, nsum = sampsize, strata = 1;
+    int Options[] = {0, 0, 0, 0, 0, 0, 1, 1, 0, 0};
+    int mtry = (int)floor(sqrt(p_size));
+    int ipi = 0;
+    double classwt[NCLASS], cutoff[NCLASS];
+    for (i = 0; i < nclass; i++) {
+        classwt[i] = 1;
+        cutoff[i] = 1.0 / ((double)nclass);
+    }
+    int nodesize = 1;
+    int *outcl = (int*)calloc(n_size, sizeof(int));
+    int *counttr = (int*)calloc(nclass * n_size, sizeof(int));
+    double prox = 1, impSD = 1, impmat = 1;
+    double *impout = (double*)calloc(p_size, sizeof(double));
+    int nrnodes = 2 * (int)floor(nsum / nodesize) + 1;
+    int *ndbigtree = (int*)calloc(ntree, sizeof(int));
+    int *nodestatus = (int*)calloc(ntree * nrnodes, sizeof(int));
+    int *bestvar = (int*)calloc(ntree * nrnodes, sizeof(int));
+    int *treemap = (int*)calloc(ntree * 2 * nrnodes, sizeof(int));
+    int *nodeclass = (int*)calloc(ntree * nrnodes, sizeof(int));
+    double *xbestsplit = (double*)calloc(ntree * nrnodes, sizeof(double));
+    double *errtr = (double*)calloc((nclass + 1) * ntree, sizeof(double));
+    int testdat = 0, clts = 1, nts = 0, outclts = 0, labelts = 0;
+    double xts = 1, proxts = 1, errts = 1, countts = 0;
+    int *inbag = (int*)calloc(n_size, sizeof(int));
+
+    classRF(X, dimx, Y, &nclass, cat, &maxcat,
+	     &sampsize, &strata, Options, &ntree, &mtry, &ipi,
+         classwt, cutoff, &nodesize, outcl, counttr, &prox,
+	     impout, &impSD, &impmat, &nrnodes, ndbigtree, nodestatus,
+         bestvar, treemap, nodeclass, xbestsplit, errtr, &testdat,
+         &xts, &clts, &nts, &countts, &outclts, labelts,
+         &proxts, &errts, inbag);
+
+    if (classForestCodegen("tempbuild/twonorm_forest", "twonorm_forest", table,
+            p_size, nclass, ntree, nrnodes, ndbigtree, treemap, nodestatus,
+            bestvar, nodeclass, xbestsplit, cutoff)) {
+        printf("cannot write tempbuild/twonorm_forest.{h,cpp}\n"); return 1;
+    }
+
+    FILE *fp = fopen(MODEL_FILE, "wb");
+    if (fp == NULL) { printf("cannot write %s\n", MODEL_FILE); return 1; }
+    fwrite(&nrnodes, sizeof(int), 1, fp);
+    fwrite(ndbigtree, sizeof(int), ntree, fp);
+    fwrite(nodestatus, sizeof(int), ntree * nrnodes, fp);
+    fwrite(bestvar, sizeof(int), ntree * nrnodes, fp);
+    fwrite(treemap, sizeof(int), ntree * 2 * nrnodes, fp);
+    fwrite(nodeclass, sizeof(int), ntree * nrnodes, fp);
+    fwrite(xbestsplit, sizeof(double), ntree * nrnodes, fp);
+    fwrite(cutoff, sizeof(double), nclass, fp);
+    fclose(fp);
+
+    printf("wrote tempbuild/twonorm_forest.{h,cpp} (%s) and %s\n",
+            table ? "node table" : "nested branches", MODEL_FILE);
+    return 0;
+}
+
+#else
+
+static void readModel(FILE *fp, void *p, size_t size, size_t n) {
+    if (fread(p, size, n, fp) != n) {
+        printf("%s is truncated, rerun twonorm_codegen\n", MODEL_FILE); exit(1);
+    }
+}
+
+int main() {
+    int i, j, r, p_size = COLS, n_size = ROWS, nclass = NCLASS, ntree = NTREE;
+    int nrnodes, maxcat = 1, keepPred = 0, intProximity = 0, nodes = 0;
+    int reps = 200, bad_votes = 0, bad_labels = 0, ties = 0, errors = 0;
+    double *X = (double*)calloc(ROWS * COLS, sizeof(double));
+    float *Xf = (float*)calloc(ROWS * COLS, sizeof(float));
+    int *Y = (int*)calloc(ROWS, sizeof(int));
+    int *cat = (int*)calloc(p_size, sizeof(int));
+    double cutoff[NCLASS], classwt[NCLASS], proxMat = 1;
+    clock_t t0;
+    double t_generic, t_generated;
+
+    if (twonorm_forest::mdim != COLS || twonorm_forest::nclass != NCLASS ||
+            twonorm_forest::ntree != NTREE) {
+        printf("twonorm_forest.h does not match this benchmark\n"); return 1;
+    }
+    readTwonorm(X, Y);
+    for (i = 0; i < ROWS * COLS; i++) Xf[i] = (float)X[i];
+    for (i = 0; i < p_size; i++) cat[i] = 1;
+    for (i = 0; i < nclass; i++) classwt[i] = 1;
+
+    FILE *fp = fopen(MODEL_FILE, "rb");
+    if (fp == NULL) { printf("cannot find %s, run twonorm_codegen\n", MODEL_FILE); return 1; }
+    readModel(fp, &nrnodes, sizeof(int), 1);
+    int *ndbigtree = (int*)calloc(ntree, sizeof(int));
+    int *nodestatus = (int*)calloc(ntree * nrnodes, sizeof(int));
+    int *bestvar = (int*)calloc(ntree * nrnodes, sizeof(int));
+    int *treemap = (int*)calloc(ntree * 2 * nrnodes, sizeof(int));
+    int *nodeclass = (int*)calloc(ntree * nrnodes, sizeof(int));
+    double *xbestsplit = (double*)calloc(ntree * nrnodes, sizeof(double));
+    readModel(fp, ndbigtree, sizeof(int), ntree);
+    readModel(fp, nodestatus, sizeof(int), ntree * nrnodes);
+    readModel(fp, bestvar, sizeof(int), ntree * nrnodes);
+    readModel(fp, treemap, sizeof(int), ntree * 2 * nrnodes);
+    readModel(fp, nodeclass, sizeof(int), ntree * nrnodes);
+    readModel(fp, xbestsplit, sizeof(double), ntree * nrnodes);
+    readModel(fp, cutoff, sizeof(double), nclass);
+    fclose(fp);
+
+    double *countts = (double*)calloc(nclass * n_size, sizeof(double));
+    int *jts = (int*)calloc(n_size, sizeof(int));
+    int *jet = (int*)calloc(n_size, sizeof(int));
+    int *node = (int*)calloc(n_size, sizeof(int));
+    int *jgen = (int*)calloc(n_size, sizeof(int));
+    int count[NCLASS];
+
+    /* generic path on the same float data the generated code reads */
+    t0 = clock();
+    for (r = 0; r < reps; r++)
+        classForestX(&p_size, &n_size, &nclass, &maxcat, &nrnodes, &ntree,
+                Xf, 0, 0, xbestsplit, classwt, cutoff, countts, treemap,
+                nodestatus, cat, nodeclass, jts, jet, bestvar, node, ndbigtree,
+                &keepPred, &intProximity, &proxMat, &nodes);
+    t_generic = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+    t0 = clock();
+    for (r = 0; r < reps; r++)
+        for (i = 0; i < n_size; i++)
+            jgen[i] = twonorm_forest::predict(Xf + i * p_size);
+    t_generated = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < n_size; i++) {
+        twonorm_forest::votes(Xf + i * p_size, count);
+        for (j = 0; j < nclass; j++)
+            if (count[j] != (int)countts[j + i * nclass]) { bad_votes++; break; }
+        /* classForest breaks ties at random, compare labels elsewhere only */
+        if (count[0] == count[1]) ties++;
+        else if (jgen[i] != jet[i]) bad_labels++;
+        if (jgen[i] != Y[i]) errors++;
+    }
+
+    printf("samples with different votes %d, different labels %d (ties %d)\n",
+            bad_votes, bad_labels, ties);
+    printf("generated forest misclassified %d out of %d\n", errors, n_size);
+    printf("classForest     %8.3f us/sample\n", 1e6 * t_generic / (reps * n_size));
+    printf("twonorm_forest  %8.3f us/sample\n", 1e6 * t_generated / (reps * n_size));
+    return (bad_votes || bad_labels) ? 1 : 0;
+}
+
+#endif
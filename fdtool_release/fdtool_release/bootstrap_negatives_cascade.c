@@ -0,0 +1,1270 @@
+
+/*
+
+  Bootstrap negatives examples passing through a trained Haar/MBLBP cascade (hard negative mining)
+
+  Usage
+  ------
+
+  [X , stat] = bootstrap_negatives_cascade(I , options);
+
+
+  Inputs
+  -------
+
+  I                                     Negatives pictures. Cell array (1 x nI) where each cell is an image (Ny x Nx) in UINT8 format.
+                                        A single (Ny x Nx) UINT8 image is also accepted.
+
+  options                               Options structure (see train_cascade function)
+
+             typefeat                   Type of features used by the current cascade : 0 <=> Haar features, 1 <=> MBLBP features (default typefeat = 0)
+             weaklearner                Choice of the weak learner used in the training phase (default weaklearner = 2)
+			                            weaklearner = 0 <=> minimizing the weighted error : sum(w * |z - h(x;(th,a,b))|^2) / sum(w), where h(x;(th,a,b)) = (a*(x>th) + b) in R
+			                            weaklearner = 1 <=> minimizing the weighted error : sum(w * |z - h(x;(a,b))|^2), where h(x;(a,b)) = sigmoid(x ; a,b) in R
+			                            weaklearner = 2 <=> minimizing the weighted error : sum(w * |z - h(x;(th,a))|), where h(x;(th,a)) = a*sign(z - th)  in [-1,1] for discrete adaboost
+             param                      Trained parameters matrix (4 x T) of the current cascade. If param is empty, every scanned subwindow is kept
+             dimsItraining              Size of the train images, i.e. (ny x nx ) (default dimsItraining = [24 , 24])
+             rect_param                 Feature's rectangles dictionnary (10 x nR) in double format (requiered if typefeat = 0)
+             F                          Feature's parameters (6 x nF) for Haar or (5 x nF) for MBLBP in UINT32 format
+             map                        Mapping of the mblbp (1 x 256) in UINT8 format (typefeat = 1, default map = 0:255)
+             cascade_type               Type of cascade structure : 0 for coventional cascade, 1 for multi-exit cascade (default cascade_type = 0)
+             cascade                    Cascade parameters (2 x Ncascade) (default cascade = [T ; 0])
+             standardize                Standardize each extracted subwindow before evaluation as in generate_data_cascade (default standardize = 1)
+             Nneg                       Number of negatives to bootstrap. Mining stops as soon as Nneg subwindows passing the cascade are found (default Nneg = 1000)
+             scalemin                   Minimum scaling factor of the scanned subwindows (default scalemin = 1)
+             scalemax                   Maximum scaling factor of the scanned subwindows (default scalemax = 5)
+             scale_inc                  Increment of the scaling factor between two scan scales (default scale_inc = 1.25)
+             step_ini                   Overlapping subwindows factor such that delta = ceil(step_ini*scale) (default step_ini = 2)
+             maxperimage                Maximum number of negatives extracted from the same picture (default maxperimage = 50)
+             seed                       Seed of the pseudo-random scan order of each picture (default seed = 5489)
+
+If compiled with the "OMP" compilation flag
+
+             num_threads                Number of threads. If num_threads = -1, num_threads = number of core  (default num_threads = -1)
+
+  Outputs
+  -------
+
+  X                                     Bootstrapped negatives (ny x nx x nneg) in UINT8 format, nneg <= Nneg
+
+  stat                                  Statistics (1 x 3) : [nneg , number of evaluated subwindows , number of pictures visited]
+
+  Each picture is scanned with the same windows enumerator than detector_haar/detector_mblbp over
+  [scalemin , scalemax]. Subwindows are visited in a pseudo-random order (an affine permutation of the
+  window indexes seeded by seed) so that the maxperimage negatives kept in a picture are spread over
+  positions and scales. Each visited subwindow is resized to (ny x nx), standardized and evaluated exactly
+  as eval_haar/eval_mblbp would do on the same patch. Pictures are dispatched dynamically over threads and
+  every thread stops scanning once Nneg negatives have been collected.
+
+
+  To compile
+  ----------
+
+
+  mex  -g -output bootstrap_negatives_cascade.dll bootstrap_negatives_cascade.c
+
+  mex  -f mexopts_intel10.bat -output bootstrap_negatives_cascade.dll bootstrap_negatives_cascade.c
+
+  If OMP directive is added, OpenMP support for multicore computation
+
+  mex -v -DOMP -f mexopts_intel10.bat -output bootstrap_negatives_cascade.dll bootstrap_negatives_cascade.c "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_core.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_c.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_thread.lib" "C:\Program Files\Intel\Compiler\11.1\065\lib\ia32\libiomp5md.lib"
+
+
+  Example 1
+  ---------
+
+  load model_detector_haar_24x24.mat
+
+  options                     = model;
+  options.typefeat            = 0;
+  options.Nneg                = 2000;
+  options.scalemin            = 1;
+  options.scalemax            = 6;
+
+  directory                   = dir(fullfile(pwd , 'images' , 'train' , 'negatives' , '*.jpg'));
+  I                           = cell(1 , length(directory));
+  for i = 1:length(directory)
+     Itemp                    = imread(fullfile(pwd , 'images' , 'train' , 'negatives' , directory(i).name));
+     if(size(Itemp , 3) == 3)
+         Itemp                = rgb2gray(Itemp);
+     end
+     I{i}                     = Itemp;
+  end
+
+  tic,[X , stat]              = bootstrap_negatives_cascade(I , options);,toc
+  [fx , y]                    = eval_haar(X , options);
+
+  display_database(X);
+  title(sprintf('P_{fa} = %6.5f' , stat(1)/stat(2)))
+
+
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mex.h>
+
+#ifdef OMP
+ #include <omp.h>
+#endif
+
+#ifndef max
+    #define max(a,b) (a >= b ? a : b)
+    #define min(a,b) (a <= b ? a : b)
+#endif
+
+#ifndef MAX_THREADS
+#define MAX_THREADS 64
+#endif
+
+#define MAX_SCALES 128
+#define tiny       1e-7
+#define sign(a)    ((a) >= (0) ? (1.0) : (-1.0))
+
+struct opts
+{
+	int            typefeat;
+	int            weaklearner;
+	double         epsi;
+	double        *param;
+	int            T;
+	double        *dimsItraining;
+	int            ny;
+	int            nx;
+	double        *rect_param;
+	int            nR;
+	unsigned int  *F;
+	int            nF;
+	unsigned char *map;
+	double        *cascade;
+	int            Ncascade;
+	int            cascade_type;
+	int            standardize;
+	int            Nneg;
+	double         scalemin;
+	double         scalemax;
+	double         scale_inc;
+	double         step_ini;
+	int            maxperimage;
+	unsigned int   seed;
+#ifdef OMP
+    int            num_threads;
+#endif
+};
+
+/*-------------------------------------------------------------------------------------------------------------- */
+/* Function prototypes */
+
+int Round(double);
+int number_haar_features(int , int , double * , int );
+void haar_featlist(int , int , double * , int  , unsigned int * );
+int number_mblbp_features(int , int );
+void mblbp_featlist(int  , int , unsigned int *);
+void MakeIntegralImage(unsigned char *, unsigned int *, int , int , unsigned int *);
+unsigned int Area(unsigned int * , int , int , int , int , int );
+double haar_feat(unsigned int *  , int  , double * , unsigned int * , int );
+int eval_haar_patch(unsigned char * , unsigned int * , unsigned int * , struct opts , double *);
+int eval_mblbp_patch(unsigned char * , unsigned int * , unsigned int * , struct opts , double *);
+int crop_resize_standardize(unsigned char * , int , int , int , int , int , int , int , int , int , double * , unsigned char *);
+unsigned int coprime_step(unsigned int , unsigned int);
+unsigned int gcd(unsigned int , unsigned int);
+int bootstrap_negatives(unsigned char ** , int * , int * , int , struct opts , unsigned char * , double *);
+
+/*-------------------------------------------------------------------------------------------------------------- */
+void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
+{
+	struct opts options;
+	unsigned char **I , *X , *Xtemp;
+	int *Ny , *Nx;
+	double	rect_param_default[40]  = {1 , 1 , 2 , 2 , 1 , 0 , 0 , 1 , 1 , 1 , 1 , 1 , 2 , 2 , 2 , 0 , 1 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 1 , 0 , 0 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 2 , 1 , 0 , 1 , 1 , 1};
+	mxArray *mxtemp , *mxcell;
+	mwSize dimsX[3];
+	double *stat , *tmp;
+	int i , nI , nneg , NyNx , tempint , powN = 256 , Tcascade = 0;
+
+	options.typefeat       = 0;
+	options.weaklearner    = 2;
+	options.epsi           = 0.1;
+	options.T              = 0;
+	options.ny             = 24;
+	options.nx             = 24;
+	options.nR             = 4;
+	options.cascade_type   = 0;
+	options.Ncascade       = 0;
+	options.standardize    = 1;
+	options.Nneg           = 1000;
+	options.scalemin       = 1.0;
+	options.scalemax       = 5.0;
+	options.scale_inc      = 1.25;
+	options.step_ini       = 2.0;
+	options.maxperimage    = 50;
+	options.seed           = 5489;
+
+#ifdef OMP
+    options.num_threads    = -1;
+#endif
+
+	if ((nrhs < 2) || (nlhs > 2))
+	{
+		mexPrintf(
+			"\n"
+			"\n"
+			"Bootstrap negatives examples passing through a trained Haar/MBLBP cascade\n"
+			"\n"
+			"\n"
+			"Usage\n"
+			"-----\n"
+			"\n"
+			"\n"
+			"[X , stat] = bootstrap_negatives_cascade(I , options);\n"
+			"\n"
+			"\n"
+			"Inputs\n"
+			"------\n"
+			"\n"
+			"\n"
+			"I                          Negatives pictures, cell (1 x nI) of (Ny x Nx) UINT8 images\n"
+			"\n"
+			"options                    Options structure (see train_cascade). Main fields :\n"
+			"     typefeat              0 <=> Haar features, 1 <=> MBLBP features (default typefeat = 0)\n"
+			"     param, cascade        Current cascade (4 x T) and (2 x Ncascade)\n"
+			"     Nneg                  Number of negatives to bootstrap (default Nneg = 1000)\n"
+			"     scalemin, scalemax    Range of scanned scales (default [1 , 5])\n"
+			"     scale_inc             Scale increment (default scale_inc = 1.25)\n"
+			"     step_ini              Overlapping subwindows factor (default step_ini = 2)\n"
+			"     maxperimage           Maximum number of negatives per picture (default maxperimage = 50)\n"
+			"     seed                  Seed of the scan order (default seed = 5489)\n"
+#ifdef OMP
+			"     num_threads           Number of threads. If num_threads = -1, num_threads = number of core  (default num_threads = -1)\n"
+#endif
+			"\n"
+			"\n"
+			"Outputs\n"
+			"-------\n"
+			"\n"
+			"X                          Bootstrapped negatives (ny x nx x nneg) in UINT8 format\n"
+			"stat                       [nneg , number of evaluated subwindows , number of pictures visited]\n"
+			);
+		return;
+	}
+
+    /* Input 1  */
+
+	if(mxIsCell(prhs[0]))
+	{
+		nI                 = (int)mxGetNumberOfElements(prhs[0]);
+		I                  = (unsigned char **)mxMalloc(nI*sizeof(unsigned char *));
+		Ny                 = (int *)mxMalloc(nI*sizeof(int));
+		Nx                 = (int *)mxMalloc(nI*sizeof(int));
+		for(i = 0 ; i < nI ; i++)
+		{
+			mxcell         = mxGetCell(prhs[0] , i);
+			if( (mxcell == NULL) || !mxIsUint8(mxcell) || (mxGetNumberOfDimensions(mxcell) > 2) )
+			{
+				mexErrMsgTxt("Each cell of I must be (Ny x Nx) in UINT8 format");
+			}
+			I[i]           = (unsigned char *)mxGetData(mxcell);
+			Ny[i]          = (int)mxGetM(mxcell);
+			Nx[i]          = (int)mxGetN(mxcell);
+		}
+	}
+	else
+	{
+		if( !mxIsUint8(prhs[0]) || (mxGetNumberOfDimensions(prhs[0]) > 2) )
+		{
+			mexErrMsgTxt("I must be (Ny x Nx) in UINT8 format or a cell of (Ny x Nx) UINT8 images");
+		}
+		nI                 = 1;
+		I                  = (unsigned char **)mxMalloc(sizeof(unsigned char *));
+		Ny                 = (int *)mxMalloc(sizeof(int));
+		Nx                 = (int *)mxMalloc(sizeof(int));
+		I[0]               = (unsigned char *)mxGetData(prhs[0]);
+		Ny[0]              = (int)mxGetM(prhs[0]);
+		Nx[0]              = (int)mxGetN(prhs[0]);
+	}
+
+    /* Input 2  */
+
+	if(!mxIsStruct(prhs[1]))
+	{
+		mexErrMsgTxt("options must be a structure");
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "typefeat" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if((tempint < 0) || (tempint > 1))
+		{
+			mexPrintf("typefeat = {0,1}, force to 0");
+			options.typefeat          = 0;
+		}
+		else
+		{
+			options.typefeat          = tempint;
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "weaklearner" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if((tempint < 0) || (tempint > 2))
+		{
+			mexPrintf("weaklearner = {0,1,2}, force to 2");
+			options.weaklearner       = 2;
+		}
+		else
+		{
+			options.weaklearner       = tempint;
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "epsi" );
+	if(mxtemp != NULL)
+	{
+		tmp                           = mxGetPr(mxtemp);
+		if(tmp[0] < 0.0 )
+		{
+			mexPrintf("epsi must be > 0, force to 0.1");
+			options.epsi              = 0.1;
+		}
+		else
+		{
+			options.epsi              = tmp[0];
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "param" );
+	if((mxtemp != NULL) && !mxIsEmpty(mxtemp))
+	{
+		if(mxGetM(mxtemp) != 4)
+		{
+			mexErrMsgTxt("param must be (4 x T)");
+		}
+		options.param                 = mxGetPr(mxtemp);
+		options.T                     = (int)mxGetN(mxtemp);
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "dimsItraining" );
+	if(mxtemp != NULL)
+	{
+		options.dimsItraining         = mxGetPr(mxtemp);
+		options.ny                    = (int)options.dimsItraining[0];
+		options.nx                    = (int)options.dimsItraining[1];
+	}
+
+	if(options.typefeat == 0)
+	{
+		mxtemp                        = mxGetField( prhs[1] , 0, "rect_param" );
+		if(mxtemp != NULL)
+		{
+			if((mxGetM(mxtemp) != 10) || !mxIsDouble(mxtemp) )
+			{
+				mexErrMsgTxt("rect_param must be (10 x nR) in DOUBLE format");
+			}
+			options.rect_param        = mxGetPr(mxtemp);
+			options.nR                = (int)mxGetN(mxtemp);
+		}
+		else
+		{
+			options.rect_param        = (double *)mxMalloc(40*sizeof(double));
+			for(i = 0 ; i < 40 ; i++)
+			{
+				options.rect_param[i] = rect_param_default[i];
+			}
+		}
+
+		mxtemp                        = mxGetField( prhs[1] , 0, "F" );
+		if(mxtemp != NULL)
+		{
+			options.F                 = (unsigned int *)mxGetData(mxtemp);
+			options.nF                = (int)mxGetN(mxtemp);
+		}
+		else
+		{
+			options.nF                = number_haar_features(options.ny , options.nx , options.rect_param , options.nR);
+			options.F                 = (unsigned int *)mxMalloc(6*options.nF*sizeof(unsigned int));
+			haar_featlist(options.ny , options.nx , options.rect_param , options.nR , options.F);
+		}
+	}
+	else
+	{
+		mxtemp                        = mxGetField( prhs[1] , 0, "F" );
+		if(mxtemp != NULL)
+		{
+			options.F                 = (unsigned int *)mxGetData(mxtemp);
+			options.nF                = (int)mxGetN(mxtemp);
+		}
+		else
+		{
+			options.nF                = number_mblbp_features(options.ny , options.nx);
+			options.F                 = (unsigned int *)mxMalloc(5*options.nF*sizeof(unsigned int));
+			mblbp_featlist(options.ny , options.nx , options.F);
+		}
+
+		mxtemp                        = mxGetField( prhs[1] , 0, "map" );
+		if(mxtemp != NULL)
+		{
+			if(mxGetNumberOfElements(mxtemp) != powN)
+			{
+				mexErrMsgTxt("map must be (1 x 256) in UINT8 format");
+			}
+			options.map               = (unsigned char *)mxGetData(mxtemp);
+		}
+		else
+		{
+			options.map               = (unsigned char *)mxMalloc(powN*sizeof(unsigned char));
+			for(i = 0 ; i < powN ; i++)
+			{
+				options.map[i]        = (unsigned char) i;
+			}
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "cascade_type" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if((tempint < 0) || (tempint > 1))
+		{
+			mexPrintf("cascade_type = {0,1}, force to 0");
+			options.cascade_type      = 0;
+		}
+		else
+		{
+			options.cascade_type      = tempint;
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "cascade" );
+	if((mxtemp != NULL) && !mxIsEmpty(mxtemp))
+	{
+		if(mxGetM(mxtemp) != 2)
+		{
+			mexErrMsgTxt("cascade must be (2 x Ncascade)");
+		}
+		options.cascade               = mxGetPr(mxtemp);
+		options.Ncascade              = (int)mxGetN(mxtemp);
+		for(i = 0 ; i < 2*options.Ncascade ; i=i+2)
+		{
+			Tcascade                 += (int) options.cascade[i];
+		}
+		if(Tcascade > options.T)
+		{
+			mexErrMsgTxt("sum(cascade(1 , :)) <= T");
+		}
+	}
+	else
+	{
+		options.cascade               = (double *)mxMalloc(2*sizeof(double));
+		options.cascade[0]            = (double) options.T;
+		options.cascade[1]            = 0.0;
+		options.Ncascade              = (options.T > 0) ? 1 : 0;
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "standardize" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if((tempint < 0) || (tempint > 1))
+		{
+			mexPrintf("standardize = {0,1}, force to 1");
+			options.standardize       = 1;
+		}
+		else
+		{
+			options.standardize       = tempint;
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "Nneg" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if(tempint < 0)
+		{
+			mexPrintf("Nneg must be >= 0, force to 1000");
+			options.Nneg              = 1000;
+		}
+		else
+		{
+			options.Nneg              = tempint;
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "scalemin" );
+	if(mxtemp != NULL)
+	{
+		options.scalemin              = max(1.0 , mxGetScalar(mxtemp));
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "scalemax" );
+	if(mxtemp != NULL)
+	{
+		options.scalemax              = max(options.scalemin , mxGetScalar(mxtemp));
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "scale_inc" );
+	if(mxtemp != NULL)
+	{
+		tmp                           = mxGetPr(mxtemp);
+		if(tmp[0] <= 1.0)
+		{
+			mexPrintf("scale_inc must be > 1, force to 1.25");
+			options.scale_inc         = 1.25;
+		}
+		else
+		{
+			options.scale_inc         = tmp[0];
+		}
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "step_ini" );
+	if(mxtemp != NULL)
+	{
+		options.step_ini              = max(1.0 , mxGetScalar(mxtemp));
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "maxperimage" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		options.maxperimage           = (tempint < 1) ? 50 : tempint;
+	}
+
+	mxtemp                            = mxGetField( prhs[1] , 0, "seed" );
+	if(mxtemp != NULL)
+	{
+		options.seed                  = (unsigned int) mxGetScalar(mxtemp);
+	}
+
+#ifdef OMP
+	mxtemp                            = mxGetField( prhs[1] , 0, "num_threads" );
+	if(mxtemp != NULL)
+	{
+		tempint                       = (int) mxGetScalar(mxtemp);
+		if((tempint < -2))
+		{
+			options.num_threads       = -1;
+		}
+		else
+		{
+			options.num_threads       = tempint;
+		}
+	}
+#endif
+
+    /*------------------------ Main Call ----------------------------*/
+
+	NyNx                       = options.ny*options.nx;
+	Xtemp                      = (unsigned char *)mxMalloc(max(1 , options.Nneg)*NyNx*sizeof(unsigned char));
+
+	plhs[1]                    = mxCreateDoubleMatrix(1 , 3 , mxREAL);
+	stat                       = mxGetPr(plhs[1]);
+
+	nneg                       = bootstrap_negatives(I , Ny , Nx , nI , options , Xtemp , stat);
+
+    /*------------------------ Output ----------------------------*/
+
+	dimsX[0]                   = options.ny;
+	dimsX[1]                   = options.nx;
+	dimsX[2]                   = nneg;
+	plhs[0]                    = mxCreateNumericArray(3 , dimsX , mxUINT8_CLASS , mxREAL);
+	X                          = (unsigned char *)mxGetData(plhs[0]);
+	for(i = 0 ; i < nneg*NyNx ; i++)
+	{
+		X[i]                   = Xtemp[i];
+	}
+
+	/*--------------------------- Free memory -----------------------*/
+
+	mxFree(Xtemp);
+	mxFree(I);
+	mxFree(Ny);
+	mxFree(Nx);
+
+	if(options.typefeat == 0)
+	{
+		if ( mxGetField( prhs[1] , 0 , "rect_param" ) == NULL )
+		{
+			mxFree(options.rect_param);
+		}
+		if ( mxGetField( prhs[1] , 0 , "F" ) == NULL )
+		{
+			mxFree(options.F);
+		}
+	}
+	else
+	{
+		if ( mxGetField( prhs[1] , 0 , "F" ) == NULL )
+		{
+			mxFree(options.F);
+		}
+		if ( mxGetField( prhs[1] , 0 , "map" ) == NULL )
+		{
+			mxFree(options.map);
+		}
+	}
+	mxtemp                     = mxGetField( prhs[1] , 0 , "cascade" );
+	if ( (mxtemp == NULL) || mxIsEmpty(mxtemp) )
+	{
+		mxFree(options.cascade);
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int bootstrap_negatives(unsigned char **I , int *Ny , int *Nx , int nI , struct opts options , unsigned char *X , double *stat)
+{
+	int ny = options.ny , nx = options.nx , NyNx = ny*nx , Nneg = options.Nneg , maxperimage = options.maxperimage , typefeat = options.typefeat;
+	double scalemin = options.scalemin , scalemax = options.scalemax , scale_inc = options.scale_inc , step_ini = options.step_ini;
+	unsigned int seed = options.seed;
+#ifdef OMP
+    int num_threads = options.num_threads;
+#endif
+	int n , s , l , nscales , nys , nxs , Ly , Lx , Deltay , Deltax , Origy , Origx , yest , kept , done = 0 , stop , nneg = 0 , slot;
+	int nyss[MAX_SCALES] , nxss[MAX_SCALES] , Lys[MAX_SCALES] , Deltas[MAX_SCALES];
+	unsigned int L , Ls[MAX_SCALES + 1] , k , idx , a , b , rem;
+	double scale , fx , sumeval = 0.0 , sumvisited = 0.0;
+	unsigned char *patch;
+	unsigned int *II , *Itemp;
+
+	if((Nneg == 0) || (nI == 0))
+	{
+		stat[0] = 0.0;
+		stat[1] = 0.0;
+		stat[2] = 0.0;
+		return 0;
+	}
+
+#ifdef OMP
+    num_threads          = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
+    omp_set_num_threads(num_threads);
+#endif
+
+#ifdef OMP
+#pragma omp parallel default(none) private(n,s,l,nscales,nys,nxs,Ly,Lx,Deltay,Deltax,Origy,Origx,yest,kept,stop,slot,nyss,nxss,Lys,Deltas,L,Ls,k,idx,a,b,rem,scale,fx,patch,II,Itemp) shared(I,Ny,Nx,nI,X,options,ny,nx,NyNx,Nneg,maxperimage,typefeat,scalemin,scalemax,scale_inc,step_ini,seed,done,nneg) reduction(+:sumeval,sumvisited)
+#endif
+	{
+		patch            = (unsigned char *) malloc(NyNx*sizeof(unsigned char));
+		II               = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+		Itemp            = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+
+#ifdef OMP
+#pragma omp for schedule(dynamic,1) nowait
+#endif
+		for(n = 0 ; n < nI ; n++)
+		{
+			/* done is set inside bootstrap_store, read it atomically outside */
+#ifdef OMP
+#pragma omp atomic read
+#endif
+			stop         = done;
+			if(stop)
+			{
+				continue;
+			}
+			sumvisited  += 1.0;
+
+			/* Windows enumerator : same scanning than detector_haar/detector_mblbp restricted to [scalemin , scalemax] */
+
+			nscales      = 0;
+			L            = 0;
+			Ls[0]        = 0;
+			scale        = scalemin;
+			while((scale <= scalemax) && (nscales < MAX_SCALES))
+			{
+				nys      = Round(ny*scale);
+				nxs      = Round(nx*scale);
+				if((nys > Ny[n]) || (nxs > Nx[n]))
+				{
+					break;
+				}
+				Deltay   = (int)ceil(step_ini*scale);
+				Deltax   = Deltay;
+				Ly       = (Ny[n] - nys)/Deltay + 1;
+				Lx       = (Nx[n] - nxs)/Deltax + 1;
+
+				nyss[nscales]     = nys;
+				nxss[nscales]     = nxs;
+				Lys[nscales]      = Ly;
+				Deltas[nscales]   = Deltay;
+				L                += (unsigned int)(Ly*Lx);
+				Ls[nscales + 1]   = L;
+				nscales++;
+				scale            *= scale_inc;
+			}
+			if(L == 0)
+			{
+				continue;
+			}
+
+			/* Pseudo-random visiting order : idx = (a*k + b) mod L with gcd(a , L) = 1 */
+
+			b            = (seed + 2654435761u*(unsigned int)(n + 1)) % L;
+			a            = coprime_step(L , seed ^ (unsigned int)(n*40503u));
+			kept         = 0;
+			idx          = b;
+
+			for(k = 0 ; k < L ; k++)
+			{
+#ifdef OMP
+#pragma omp atomic read
+#endif
+				stop     = done;
+				if(stop || (kept >= maxperimage))
+				{
+					break;
+				}
+				s        = 0;
+				while(idx >= Ls[s + 1])
+				{
+					s++;
+				}
+				rem      = idx - Ls[s];
+				l        = (int)(rem / (unsigned int)Lys[s]);
+				Origx    = l*Deltas[s];
+				Origy    = (int)(rem - (unsigned int)(l*Lys[s]))*Deltas[s];
+
+				idx      = (unsigned int)(((unsigned long long)idx + a) % L);
+
+				if(!crop_resize_standardize(I[n] , Ny[n] , Nx[n] , Origy , Origx , nyss[s] , nxss[s] , ny , nx , options.standardize , &fx , patch))
+				{
+					continue;
+				}
+				sumeval += 1.0;
+
+				if(typefeat == 0)
+				{
+					yest     = eval_haar_patch(patch , II , Itemp , options , &fx);
+				}
+				else
+				{
+					yest     = eval_mblbp_patch(patch , II , Itemp , options , &fx);
+				}
+
+				if(yest == 1)
+				{
+					slot     = -1;
+#ifdef OMP
+#pragma omp critical(bootstrap_store)
+#endif
+					{
+						if(nneg < Nneg)
+						{
+							slot     = nneg;
+							nneg++;
+							if(nneg == Nneg)
+							{
+#ifdef OMP
+#pragma omp atomic write
+#endif
+								done = 1;
+							}
+						}
+					}
+					if(slot >= 0)
+					{
+						memcpy(X + slot*NyNx , patch , NyNx*sizeof(unsigned char));
+						kept++;
+					}
+				}
+			}
+		}
+		free(patch);
+		free(II);
+		free(Itemp);
+	}
+
+	stat[0] = (double)nneg;
+	stat[1] = sumeval;
+	stat[2] = sumvisited;
+
+	return nneg;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int crop_resize_standardize(unsigned char *I , int Ny , int Nx , int Origy , int Origx , int nys , int nxs , int ny , int nx , int standardize , double *fx , unsigned char *patch)
+{
+	/* Bilinear resize of I(Origy:Origy+nys-1 , Origx:Origx+nxs-1) to (ny x nx) (as imresize.c) followed by the
+	   standardization of generate_data_cascade (X/std(X) then stretched to [0 , 255]). Return 0 if the patch is constant */
+
+	int i , j , fyi , fxi , idx , idx1 , indny , indfx , NyNx = ny*nx;
+	double deltay = (nys-1)/((double)(ny-1) + tiny) , deltax = (nxs-1)/((double)(nx-1) + tiny);
+	double y , x , ty , ty1 , tx , tx1 , v , vmin = 255.0 , vmax = 0.0 , cte;
+	unsigned char *Iorig = I + Origy + Origx*Ny;
+
+	for(i = 0 ; i < nx ; i++)
+	{
+		x                 = i*deltax;
+		indny             = i*ny;
+		fxi               = (int)floor(x);
+		tx                = x - fxi;
+		tx1               = 1.0 - tx;
+		if(fxi >= nxs - 1)
+		{
+			fxi           = nxs - 2;
+			tx            = 1.0;
+			tx1           = 0.0;
+		}
+		indfx             = fxi*Ny;
+		for(j = 0 ; j < ny ; j++)
+		{
+			y             = j*deltay;
+			fyi           = (int)floor(y);
+			ty            = y - fyi;
+			ty1           = 1.0 - ty;
+			if(fyi >= nys - 1)
+			{
+				fyi       = nys - 2;
+				ty        = 1.0;
+				ty1       = 0.0;
+			}
+			idx           = fyi + indfx;
+			idx1          = idx + Ny;
+			patch[j + indny] = (unsigned char)((Iorig[idx]*ty1 + Iorig[idx + 1]*ty)*tx1 + ( Iorig[idx1]*ty1 + Iorig[idx1 + 1]*ty )*tx);
+		}
+	}
+
+	for(i = 0 ; i < NyNx ; i++)
+	{
+		v                 = (double)patch[i];
+		vmin              = min(vmin , v);
+		vmax              = max(vmax , v);
+	}
+	if(vmax == vmin)
+	{
+		return 0;
+	}
+	if(standardize)
+	{
+		/* Division by std(X) cancels in the min/max stretching */
+
+		cte               = 255.0/(vmax - vmin);
+		for(i = 0 ; i < NyNx ; i++)
+		{
+			patch[i]      = (unsigned char)floor(cte*(patch[i] - vmin));
+		}
+	}
+	fx[0]                 = 0.0;
+	return 1;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int eval_haar_patch(unsigned char *patch , unsigned int *II , unsigned int *Itemp , struct opts options , double *fx)
+{
+	double   *param = options.param , *rect_param = options.rect_param , *cascade = options.cascade;
+	unsigned int *F = options.F;
+	int weaklearner = options.weaklearner , Ncascade = options.Ncascade , cascade_type = options.cascade_type , ny = options.ny , nx = options.nx;
+	double epsi = options.epsi;
+	double z , sum = 0.0 , sum_total = 0.0 , a , b , th , thresc;
+	int i , c , f , Tc , NyNx = ny*nx , indf = 0 , indc = 0 , idxF;
+	unsigned int tempI;
+	double  var = 0.0 , mean , std , cteNyNx = 1.0/NyNx;
+
+	MakeIntegralImage(patch , II , nx , ny , Itemp);
+
+	std                = 1.0;
+	if(options.standardize)
+	{
+		for(i = 0 ; i < NyNx ; i++)
+		{
+			tempI      = patch[i];
+			var       += (tempI*tempI);
+		}
+		var           *= cteNyNx;
+		mean           = II[NyNx - 1]*cteNyNx;
+		std            = 1.0/sqrt(var - mean*mean);
+	}
+
+	for (c = 0 ; c < Ncascade ; c++)
+	{
+		Tc     = (int) cascade[0 + indc];
+		thresc = cascade[1 + indc];
+		sum    = 0.0;
+		for (f = 0 ; f < Tc ; f++)
+		{
+			idxF  = ((int) param[0 + indf] - 1);
+			z     = haar_feat(II , idxF , rect_param , F , ny)*std;
+			th    =  param[1 + indf];
+			a     =  param[2 + indf];
+			b     =  param[3 + indf];
+
+			if(weaklearner == 0)
+			{
+				sum    += (a*( z > th ) + b);
+			}
+			else if(weaklearner == 1)
+			{
+				sum    += ((2.0/(1.0 + exp(-2.0*epsi*(a*z + b)))) - 1.0);
+			}
+			else if(weaklearner == 2)
+			{
+				sum    += a*sign(z - th);
+			}
+			indf      += 4;
+		}
+		sum_total     += sum;
+
+		if((sum_total < thresc) && (cascade_type == 1))
+		{
+			fx[0]     = sum_total;
+			return -1;
+		}
+		else if((sum < thresc) && (cascade_type == 0))
+		{
+			fx[0]     = sum;
+			return -1;
+		}
+		indc      += 2;
+	}
+	fx[0]         = (cascade_type == 1) ? sum_total : sum;
+	return 1;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int eval_mblbp_patch(unsigned char *patch , unsigned int *II , unsigned int *Itemp , struct opts options , double *fx)
+{
+	double   *param = options.param , *cascade = options.cascade;
+	unsigned char *map = options.map;
+	unsigned int *F = options.F;
+	int Ncascade = options.Ncascade , weaklearner = options.weaklearner , cascade_type = options.cascade_type , ny = options.ny , nx = options.nx;
+	double epsi = options.epsi;
+	int xc , yc , xnw , ynw , xse , yse , w , h;
+	unsigned int Ac;
+	unsigned char valF , z;
+	double sum = 0.0 , sum_total = 0.0 , a , b , th , thresc;
+	int c , f , Tc , indf = 0 , indc = 0 , idxF;
+
+	MakeIntegralImage(patch , II , nx , ny , Itemp);
+
+	for (c = 0 ; c < Ncascade ; c++)
+	{
+		Tc        = (int) cascade[0 + indc];
+		thresc    = cascade[1 + indc];
+		sum       = 0.0;
+
+		for (f = 0 ; f < Tc ; f++)
+		{
+			idxF  = ((int) param[0 + indf] - 1)*5;
+			th    = param[1 + indf];
+			a     = param[2 + indf];
+			b     = param[3 + indf];
+
+			xc    = F[1 + idxF];
+			yc    = F[2 + idxF];
+			w     = F[3 + idxF];
+			h     = F[4 + idxF];
+
+			xnw   = xc - w;
+			ynw   = yc - h;
+			xse   = xc + w;
+			yse   = yc + h;
+
+			Ac    = Area(II , xc  , yc  , w , h , ny);
+
+			valF  = 0;
+			if(Area(II , xnw , ynw , w , h , ny) > Ac)
+			{
+				valF |= 0x01;
+			}
+			if(Area(II , xc  , ynw , w , h , ny) > Ac)
+			{
+				valF |= 0x02;
+			}
+			if(Area(II , xse , ynw , w , h , ny) > Ac)
+			{
+				valF |= 0x04;
+			}
+			if(Area(II , xse , yc  , w , h , ny) > Ac)
+			{
+				valF |= 0x08;
+			}
+			if(Area(II , xse , yse , w , h , ny) > Ac)
+			{
+				valF |= 0x10;
+			}
+			if(Area(II , xc  , yse , w , h , ny) > Ac)
+			{
+				valF |= 0x20;
+			}
+			if(Area(II , xnw , yse , w , h , ny) > Ac)
+			{
+				valF |= 0x40;
+			}
+			if(Area(II , xnw , yc  , w , h , ny) > Ac)
+			{
+				valF |= 0x80;
+			}
+
+			z           = map[valF];
+			if(weaklearner == 0)
+			{
+				sum    += (a*( z > th ) + b);
+			}
+			else if(weaklearner == 1)
+			{
+				sum    += ((2.0/(1.0 + exp(-2.0*epsi*(a*z + b)))) - 1.0);
+			}
+			else if(weaklearner == 2)
+			{
+				sum    += a*sign(z - th);
+			}
+			indf      += 4;
+		}
+		sum_total     += sum;
+
+		if((sum_total < thresc) && (cascade_type == 1))
+		{
+			fx[0]     = sum_total;
+			return -1;
+		}
+		else if((sum < thresc) && (cascade_type == 0))
+		{
+			fx[0]     = sum;
+			return -1;
+		}
+		indc      += 2;
+	}
+	fx[0]         = (cascade_type == 1) ? sum_total : sum;
+	return 1;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+unsigned int gcd(unsigned int a , unsigned int b)
+{
+	unsigned int t;
+	while(b != 0)
+	{
+		t = b;
+		b = a % b;
+		a = t;
+	}
+	return a;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+unsigned int coprime_step(unsigned int L , unsigned int seed)
+{
+	/* Step a in [L/3 , L) with gcd(a , L) = 1 in order that k -> (a*k + b) mod L spans all windows once */
+
+	unsigned int a;
+
+	if(L < 3)
+	{
+		return 1;
+	}
+	a = L/3 + (seed*2246822519u) % (L - L/3);
+	while(gcd(a , L) != 1)
+	{
+		a++;
+		if(a >= L)
+		{
+			a = 1;
+		}
+	}
+	return a;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+double haar_feat(unsigned int *II , int featidx , double *rect_param , unsigned int *F , int Ny)
+{
+	int x , xr , y , yr , w , wr , h , hr , r ,  R , indR , indF = featidx*6;
+	int coeffw , coeffh;
+	double val = 0.0 , s;
+
+	x     = F[1 + indF];
+	y     = F[2 + indF];
+	w     = F[3 + indF];
+	h     = F[4 + indF];
+	indR  = F[5 + indF];
+	R     = (int) rect_param[3 + indR];
+
+	for (r = 0 ; r < R ; r++)
+	{
+		coeffw  = w/(int)rect_param[1 + indR];
+		coeffh  = h/(int)rect_param[2 + indR];
+		xr      = x + coeffw*(int)rect_param[5 + indR];
+		yr      = y + coeffh*(int)rect_param[6 + indR];
+		wr      = coeffw*(int)(rect_param[7 + indR]);
+		hr      = coeffh*(int)(rect_param[8 + indR]);
+		s       = rect_param[9 + indR];
+		val    += s*Area(II , xr  , yr  , wr , hr , Ny);
+		indR   += 10;
+	}
+	return val;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void haar_featlist(int ny , int nx , double *rect_param , int nR , unsigned int *F )
+{
+	int  r , indF = 0 , indrect = 0 , currentfeat = 0 , temp , W , H , w , h , x , y;
+	int nx1 = nx + 1, ny1 = ny + 1;
+
+	for (r = 0 ; r < nR ; r++)
+	{
+		temp            = (int) rect_param[0 + indrect];
+		if(currentfeat != temp)
+		{
+			currentfeat = temp;
+			W           = (int) rect_param[1 + indrect];
+			H           = (int) rect_param[2 + indrect];
+
+			for(w = W ; w < nx1 ; w +=W)
+			{
+				for(h = H ; h < ny1 ; h +=H)
+				{
+					for(y = 0 ; y + h < ny1 ; y++)
+					{
+						for(x = 0 ; x + w < nx1 ; x++)
+						{
+							F[0 + indF]   = currentfeat;
+							F[1 + indF]   = x;
+							F[2 + indF]   = y;
+							F[3 + indF]   = w;
+							F[4 + indF]   = h;
+							F[5 + indF]   = indrect;
+							indF         += 6;
+						}
+					}
+				}
+			}
+		}
+		indrect        += 10;
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int number_haar_features(int ny , int nx , double *rect_param , int nR)
+{
+	int i , temp , indrect = 0 , currentfeat = 0 , nF = 0 , h , w;
+	int Y , X;
+	int nx1 = nx + 1, ny1 = ny + 1;
+
+	for (i = 0 ; i < nR ; i++)
+	{
+		temp            = (int) rect_param[0 + indrect];
+		if(currentfeat != temp)
+		{
+			currentfeat = temp;
+			w           = (int) rect_param[1 + indrect];
+			h           = (int) rect_param[2 + indrect];
+			X           = (int) floor(nx/w);
+			Y           = (int) floor(ny/h);
+			nF         += (int) (X*Y*(nx1 - w*(X+1)*0.5)*(ny1 - h*(Y+1)*0.5));
+		}
+		indrect   += 10;
+	}
+	return nF;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void mblbp_featlist(int ny , int nx , unsigned int *F)
+{
+	int i , j , w = 1 , h , nofeat = 1 , co = 0;
+
+	while(nx >= 3*w)
+	{
+		h    = 1;
+		while(ny >= 3*h)
+		{
+			for (j = w ; j <= nx-2*w ; j++)
+			{
+				for (i = h ; i <= ny-2*h ; i++)
+				{
+					F[0 + co] = nofeat;
+					F[1 + co] = j;
+					F[2 + co] = i;
+					F[3 + co] = w;
+					F[4 + co] = h;
+					co       += 5;
+				}
+			}
+			h++;
+			nofeat++;
+		}
+		w++;
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int number_mblbp_features(int ny , int nx)
+{
+	int nF = 0 , X , Y  , nx1 = nx + 1 , ny1 = ny + 1 ;
+
+	X           = (int) floor(nx/3);
+	Y           = (int) floor(ny/3);
+	nF          = (int) (X*Y*(nx1 - (X+1)*1.5)*(ny1 - (Y+1)*1.5));
+	return nF;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------------*/
+void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+{
+	/* Variable declaration */
+	int x , y , indx = 0;
+
+	for(x=0 ; x<iXmax ; x++)
+	{
+		pTemp[indx]     = (unsigned int) pIn[indx];
+		indx           += iYmax;
+	}
+	for(y = 1 ; y<iYmax ; y++)
+	{
+		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
+	}
+	pOut[0]             = (unsigned int) pIn[0];
+	indx                = iYmax;
+	for(x=1 ; x<iXmax ; x++)
+	{
+		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
+		indx           += iYmax;
+	}
+	for(y = 1 ; y<iYmax ; y++)
+	{
+		pOut[y]         = pOut[y - 1] + (unsigned int) pIn[y];
+	}
+
+	/* Calculate integral image */
+
+	indx                = iYmax;
+	for(x = 1 ; x < iXmax ; x++)
+	{
+		for(y = 1 ; y < iYmax ; y++)
+		{
+			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int) pIn[y + indx];
+			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+		}
+		indx += iYmax;
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------------*/
+unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
+{
+	int h1 = h-1, w1 = w-1 , x1 = x-1, y1 = y-1;
+	if( (x == 0) && (y==0))
+	{
+		return (II[h1 + w1*Ny]);
+	}
+	if( x==0 )
+	{
+		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);
+	}
+	if( y==0 )
+	{
+		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);
+	}
+	else
+	{
+		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int Round(double x)
+{
+	return (int)(x + 0.5);
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
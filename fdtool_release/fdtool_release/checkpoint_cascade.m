@@ -0,0 +1,56 @@
+function checkpoint_cascade(options , state , stage)
+
+%
+%  Save a checkpoint of the cascade training (see train_cascade function)
+%
+%  Usage
+%  ------
+%
+%  checkpoint_cascade(options , state)
+%  checkpoint_cascade(options , [] , stage)
+%
+%  Inputs
+%  -------
+%
+%  options          Options struture (see train_cascade function). options.checkpoint is the MAT-file name.
+%                   options.F, options.G and options.moments are not saved since they are rebuilt by train_cascade
+%  state            Training state. Between two stages state.Xfa contains the false alarms of the last stage.
+%                   Inside a stage, state contains stat, the weights vector wtrain and the boosting variables
+%                   (m, K, alpham, betam, ...) of the current stage
+%  stage            Data of the current stage (fields Xtrain and Xtest), saved once per stage in the MAT-file
+%                   [options.checkpoint , '.stage'] instead of the checkpoint itself, so that the checkpoints
+%                   saved inside a stage only hold the weights and the boosting variables
+%
+%  The state of the default random stream is saved in randstate. The files are first written in a
+%  temporary file and then renamed, a crash while saving does not destroy the previous checkpoint.
+%  On resume, the features of the stage (integral images, MBLBP/Haar features of Xtrain) are
+%  computed again from the saved Xtrain, the weaklearners already trained are not.
+%
+%
+%  Author : Sbastien PARIS : sebastien.paris@lsis.org
+%  -------  Date : 10/18/2026
+%
+%
+
+if(nargin > 2)
+    Xtrain              = stage.Xtrain;
+    Xtest               = stage.Xtest;
+    tmpfile             = [options.checkpoint , '.stage.tmp'];
+    save(tmpfile , 'Xtrain' , 'Xtest' , '-mat');
+    movefile(tmpfile , [options.checkpoint , '.stage'] , 'f');
+    return;
+end
+if(any(strcmp(fieldnames(options) , 'F')))
+    options.F           = [];
+end
+if(any(strcmp(fieldnames(options) , 'G')))
+    options.G           = [];
+end
+if(any(strcmp(fieldnames(options) , 'moments')))
+    options.moments     = [];
+end
+s                       = RandStream.getDefaultStream;
+randstate               = s.State;
+tmpfile                 = [options.checkpoint , '.tmp'];
+save(tmpfile , 'options' , 'state' , 'randstate' , '-mat');
+movefile(tmpfile , options.checkpoint , 'f');
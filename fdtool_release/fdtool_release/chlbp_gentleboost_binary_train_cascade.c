@@ -22,6 +22,10 @@
 	     max_ite                        Maximum number of iteration  (default max_ite = 10)
 	     epsi                           Sigmoid parameter (default epsi = 1)
          premodel                       Classifier's premodels parameter up to n-1 stage (4 x Npremodels)(default premodel = [] for stage n=1)
+         trimming                       Weight trimming for the decision stump (weaklearner = 0): except every trimming_period rounds, the stump of a round
+                                        is only searched on the samples with largest weights covering (1 - trimming) of the weight mass. Weights of all
+                                        samples are always updated (default trimming = 0 <=> no trimming)
+         trimming_period                Number of rounds between two stump searches on all samples (default trimming_period = 10)
 
 If compiled with the "OMP" compilation flag
 	     num_threads                    Number of threads. If num_threads = -1, num_threads = number of core  (default num_threads = -1)
@@ -148,6 +152,8 @@ struct opts
   int    T;
   double *premodel;
   int    Npremodel;
+  double trimming;
+  int    trimming_period;
 #ifdef OMP 
     int   num_threads;
 #endif
@@ -158,6 +164,8 @@ struct opts
 
 void randini(void);
 void qsindex( unsigned int * , int * , int , int  );
+void qsindexw( double * , int * , int , int  );
+int trim_weights(double * , int , double , double * , int * , char * , double *);
 void transpose(unsigned int *, unsigned int * , int , int);
 void  gentelboost_decision_stump(unsigned int * , char * , struct opts , int , int , double *);
 void  gentelboost_perceptron(unsigned int * , char * , struct opts , int , int , double *);
@@ -179,6 +187,8 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
     options.max_ite     = 10;
 	options.T           = 100;
 	options.Npremodel   = 0;
+	options.trimming    = 0.0;
+	options.trimming_period = 10;
 #ifdef OMP 
     options.num_threads = -1;
 #endif
@@ -285,6 +295,37 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 			options.premodel                      =  mxGetPr(mxtemp);
 			options.Npremodel                     =  mxGetN(mxtemp);
 		}
+
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			if((tmp[0] < 0.0) || (tmp[0] >= 1.0))
+			{
+				mexPrintf("0 <= trimming < 1, force to 0");
+				options.trimming          = 0.0;
+			}
+			else
+			{
+				options.trimming          = tmp[0];
+			}
+		}
+
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming_period");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			tempint                       = (int) tmp[0];
+			if(tempint < 1)
+			{
+				mexPrintf("trimming_period > 0, force to 10");
+				options.trimming_period   = 10;
+			}
+			else
+			{
+				options.trimming_period   = tempint;
+			}
+		}
 #ifdef OMP 
 		mxtemp                            = mxGetField( prhs[2] , 0, "num_threads" );
 		if(mxtemp != NULL)
@@ -333,18 +374,32 @@ void  gentelboost_decision_stump(unsigned int *X , char *y , struct opts options
 	int indM , indice ;
 	
 	double *w , *wtemp;
-	int *Xt , *xtemp ;
+	int *Xt , *xtemp , *Xa = NULL , *Xs;
 	char *ytemp;
 	int *indexF;
-	int *idX;
+	int *idX , *idXa = NULL , *idXs;
 	double atemp , btemp  , sumSw , Eyw , fm  , sumwyy , error , errormin, th_opt , a_opt , b_opt;
 	double Syw, Sw , temp;
 	double cteN =1.0/(double)N;
+	double trimming = options.trimming , mass , cteW;
+	int trimming_period = options.trimming_period , Na , Na1 , n;
+	double *wsort;
+	int *idw;
+	char *active;
 	
     idX              = (int *)malloc(Nd*sizeof(int));
 	Xt               = (int *)malloc(Nd*sizeof(int ));
 	w                = (double *)malloc(N*sizeof(double));
 	indexF           = (int *)malloc(d*sizeof(int));
+	wsort            = (double *)malloc(N*sizeof(double));
+	idw              = (int *)malloc(N*sizeof(int));
+	active           = (char *)malloc(N*sizeof(char));
+	if(trimming > 0.0)
+	{
+		/* compacted presorted lists of the trimmed rounds, stride Na <= N */
+		Xa           = (int *)malloc(Nd*sizeof(int));
+		idXa         = (int *)malloc(Nd*sizeof(int));
+	}
 	
 #ifdef OMP 
 
@@ -430,23 +485,79 @@ void  gentelboost_decision_stump(unsigned int *X , char *y , struct opts options
 	
 	for(t = 0 ; t < T ; t++)
 	{		
+		/* Weight trimming : restrict the stump search to the samples carrying (1 - trimming) of the weight mass */
+
+		if((trimming > 0.0) && (t % trimming_period))
+		{
+			Na                   = trim_weights(w , N , trimming , wsort , idw , active , &mass);
+			cteW                 = 1.0/mass;
+		}
+		else
+		{
+			for(i = 0 ; i < N ; i++)
+			{
+				active[i]        = 1;
+			}
+			Na                   = N;
+			cteW                 = 1.0;
+		}
+		Na1                      = Na - 1;
+
+		/* Presorted lists restricted to the active samples, filtered once per round : the stump search is then O(Na) per feature */
+
+		if(Na < N)
+		{
+#ifdef OMP 
+#pragma omp parallel for default(none) private(j,i,n,ind,indN,indice) shared(d,N,Na,indexF,idX,Xt,idXa,Xa,active)
+#endif
+			for(j = 0 ; j < d ; j++)
+			{
+				if(indexF[j] != -1)
+				{
+					indN             = j*N;
+					n                = j*Na;
+					for(i = 0 ; i < N ; i++)
+					{
+						ind          = i + indN;
+						indice       = idX[ind];
+						if(active[indice])
+						{
+							Xa[n]    = Xt[ind];
+							idXa[n]  = indice;
+							n++;
+						}
+					}
+				}
+			}
+			Xs                   = Xa;
+			idXs                 = idXa;
+		}
+		else
+		{
+			Xs                   = Xt;
+			idXs                 = idX;
+		}
+
 		Eyw              = 0.0;
 		sumwyy           = 0.0;
 
 #ifdef OMP 
-#pragma omp parallel for  default(none) private(i,temp) shared(y,w,N) reduction(+:Eyw,sumwyy)
+#pragma omp parallel for  default(none) private(i,temp) shared(y,w,N,active,cteW) reduction(+:Eyw,sumwyy)
 #endif		
 		for(i = 0 ; i < N ; i++)
 		{
-			temp        = y[i]*w[i];	
-			Eyw        += temp;
-			sumwyy     += y[i]*temp;			
+			if(active[i])
+			{
+				temp    = y[i]*w[i]*cteW;
+				Eyw    += temp;
+				sumwyy += y[i]*temp;
+			}
 		}
 
 		errormin        = huge;
 
 #ifdef OMP 
-#pragma omp parallel  default(none) private(xtemp,ind,indice,ytemp,wtemp,j,i,atemp,error,Syw,Sw,indN,btemp) shared(d,N,N1,indexF,idX,Xt,w,y,Eyw,sumwyy,featuresIdx_opt,th_opt,a_opt,b_opt, errormin)
+#pragma omp parallel  default(none) private(xtemp,ind,indice,ytemp,wtemp,j,i,atemp,error,Syw,Sw,indN,btemp) shared(d,N,Na,Na1,cteW,indexF,idXs,Xs,w,y,Eyw,sumwyy,featuresIdx_opt,th_opt,a_opt,b_opt, errormin)
 #endif
 		{
 #ifdef OMP 
@@ -461,21 +572,21 @@ void  gentelboost_decision_stump(unsigned int *X , char *y , struct opts options
 #endif
 			for(j = 0 ; j < d  ; j++)
 			{
-				indN         = j*N;
+				indN         = j*Na;
 				if(indexF[j] != -1)
 				{
-					for(i = 0 ; i < N ; i++)		
+					for(i = 0 ; i < Na ; i++)	
 					{
-						ind         = i + indN;	
-						indice      = idX[ind];
-						xtemp[i]    = Xt[ind];
-						wtemp[i]    = w[indice];
+						ind         = i + indN;
+						indice      = idXs[ind];
+						xtemp[i]    = Xs[ind];
+						wtemp[i]    = w[indice]*cteW;
 						ytemp[i]    = y[indice];
 					}
 					Sw              = 0.0;
 					Syw             = 0.0;
 
-					for(i = 0 ; i < N ; i++)		
+					for(i = 0 ; i < Na ; i++)		
 					{			
 						Sw      += wtemp[i];		
 						Syw     += ytemp[i]*wtemp[i];
@@ -496,7 +607,7 @@ void  gentelboost_decision_stump(unsigned int *X , char *y , struct opts options
 						{
 							errormin        = error;			
 							featuresIdx_opt = j;
-							if(i < N1)
+							if(i < Na1)
 							{	
 								th_opt     = (xtemp[i] + xtemp[i + 1])/2;	
 							}
@@ -553,6 +664,14 @@ void  gentelboost_decision_stump(unsigned int *X , char *y , struct opts options
 	free(Xt);
 	free(w);
 	free(indexF);
+	free(wsort);
+	free(idw);
+	free(active);
+	if(trimming > 0.0)
+	{
+		free(Xa);
+		free(idXa);
+	}
 
 #ifdef OMP
 
@@ -699,6 +818,61 @@ void  gentelboost_perceptron(unsigned int *X , char *y , struct opts options , i
 	free(indexF);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
+int trim_weights(double *w , int N , double trimming , double *wsort , int *idw , char *active , double *mass)
+{
+	/* Flag the samples with largest weights covering (1 - trimming) of the total weight mass.
+	   Return their number and their mass in mass */
+
+	int i , Na = 0;
+	double total = 0.0 , cum = 0.0 , target;
+
+	for(i = 0 ; i < N ; i++)
+	{
+		wsort[i]      = w[i];
+		idw[i]        = i;
+		active[i]     = 0;
+		total        += w[i];
+	}
+	qsindexw(wsort , idw , 0 , N - 1);
+
+	target            = (1.0 - trimming)*total;
+	for(i = N - 1 ; (i >= 0) && (cum < target) ; i--)
+	{
+		cum          += wsort[i];
+		active[idw[i]] = 1;
+		Na++;
+	}
+	*mass             = cum;
+	return Na;
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void qsindexw (double  *a, int *index , int lo, int hi)
+{
+    int i=lo, j=hi , ind;
+    double x=a[(lo+hi)/2] , h;
+
+    do
+    {    
+        while (a[i]<x) i++; 
+        while (a[j]>x) j--;
+        if (i<=j)
+        {
+            h        = a[i]; 
+			a[i]     = a[j]; 
+			a[j]     = h;
+			ind      = index[i];
+			index[i] = index[j];
+			index[j] = ind;
+            i++; 
+			j--;
+        }
+    }
+	while (i<=j);
+
+    if (lo<j) qsindexw(a , index , lo , j);
+    if (i<hi) qsindexw(a , index , i , hi);
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
 void qsindex (unsigned int  *a, int *index , int lo, int hi)
 {
 /*  lo is the lower index, hi is the upper index
@@ -83,14 +83,8 @@ indn                                   = find(ytrain ==-1);
 
 % mlhmslbp_spyr  Features
 d                                      = options.nbin*options.nH*options.nscale*options.ncolor;
-Hmblbp                                 = zeros(d , length(indextrain));
-Hmblgp                                 = zeros(d , length(indextrain));
-
-for i = 1 : length(indextrain)
-    %   Htrain(: , i)                       = mlhmslbp_spyr(X(:,:,indextrain(i)) , options);
-    [fxtemp , ytemp , Hmblbp(: , i)]    = eval_hmblbp_spyr_subwindow(X(:,:,indextrain(i)) , options);
-    [fxtemp , ytemp , Hmblgp(: , i)]    = eval_hmblgp_spyr_subwindow(X(:,:,indextrain(i)) , options);
-end
+[fxtemp , ytemp , Hmblbp]              = eval_hmblbp_spyr_subwindow(X(: , : , indextrain) , options);
+[fxtemp , ytemp , Hmblgp]              = eval_hmblgp_spyr_subwindow(X(: , : , indextrain) , options);
 
 
 Hmblbp_p = mean(Hmblbp( : , 1:N) , 2);
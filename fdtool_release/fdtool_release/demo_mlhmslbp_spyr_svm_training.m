@@ -77,24 +77,13 @@ indn                                   = find(ytest ==-1);
 
 %% mlhmslbp_spyr  Features%%
 
-Htrain                                 = zeros(options.nbin*options.nH*options.nscale*options.ncolor , length(indextrain));
-for i = 1 : length(indextrain)
-    %   Htrain(: , i)                       = mlhmslbp_spyr(X(:,:,indextrain(i)) , options);
-    [fxtemp , ytemp , Htrain(: , i)]    = eval_hmblbp_spyr_subwindow(X(:,:,indextrain(i)) , options);
-end
+[fxtemp , ytemp , Htrain]              = eval_hmblbp_spyr_subwindow(X(: , : , indextrain) , options);
 
-if(options.n > 0)
-    Htrain                             = homkermap(Htrain , options );
-end
+% homogeneous kernel map (options.n > 0) applied implicitly by train_dense, Htrain is not expanded
 
-options.model                          = train_dense(double(ytrain)' , Htrain , '-s 2 -B 1 -c 100' , 'col');
+options.model                          = train_dense(double(ytrain)' , Htrain , '-s 2 -B 1 -c 100' , 'col' , options);
 
-Htest                                  = zeros(options.nbin*options.nH*options.nscale*options.ncolor , length(indextest));
-
-for i = 1 : length(indextest)
-    %   Htest(: , i)                       = mlhmslbp_spyr(X(:,:,indextest(i)) , options);
-    [fxtemp , ytemp , Htest(: , i)]    = eval_hmblbp_spyr_subwindow(X(:,:,indextest(i)) , options);
-end
+[fxtemp , ytemp , Htest]               = eval_hmblbp_spyr_subwindow(X(: , : , indextest) , options);
 
 if(options.n > 0)
     Htest                              = homkermap(Htest , options );
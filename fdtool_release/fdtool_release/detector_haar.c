@@ -91,6 +91,11 @@ If compiled with the "OMP" compilation flag
   mex -v -Dmatfx -DOMP -f mexopts_intel10.bat -output detector_haar.dll detector_haar.c "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_core.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_c.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_thread.lib" "C:\Program Files\Intel\Compiler\11.1\065\lib\ia32\libiomp5md.lib"
 
 
+  With -DNO_MEXFUNCTION, mex.h and mexFunction are left out and the file can be
+  included in plain C code calling detect_haar directly with the default model below
+  (see Drowsiness_C/src/bench_detectors.cpp).
+
+
   Example 1
   ---------
 
@@ -364,7 +369,11 @@ If compiled with the "OMP" compilation flag
 */
 
 #include <math.h>
+#ifndef NO_MEXFUNCTION
 #include <mex.h>
+#else
+#include <stdlib.h>
+#endif
 
 
 #ifdef OMP 
@@ -380,6 +389,10 @@ If compiled with the "OMP" compilation flag
 #define MAX_THREADS 64
 #endif
 
+#ifndef HAAR_BATCH
+#define HAAR_BATCH 512
+#endif
+
 #define sign(a)    ((a) >= (0) ? (1.0) : (-1.0))
  
 
@@ -409,17 +422,52 @@ struct model
 #endif
 };
 
+struct haar_rect                            /* Rectangle of a weak learner at a given scan scale */
+{
+	int            br;                      /* Corner offsets in the padded integral image, relative to the subwindow origin */
+	int            tr;
+	int            bl;
+	int            tl;
+	int            s;                       /* Rectangle weight */
+};
+
+struct haar_weak                            /* Weak learner of the compiled cascade */
+{
+	int            first;                   /* Index of its first rectangle in the rectangles table */
+	int            R;                       /* Number of rectangles */
+	double         th;
+	double         a;
+	double         b;
+};
+
+struct haar_cascade                         /* Cascade compiled for one scan scale */
+{
+	int               Ncascade;
+	int              *stage_end;            /* Weak learners of stage c are [stage_end[c-1] , stage_end[c]) */
+	double           *stage_th;
+	struct haar_weak *weak;
+	struct haar_rect *rect;
+	int               otl;                  /* Subwindow corners used for its mean/variance */
+	int               otr;
+	int               obl;
+	int               obr;
+	double            invscale2;
+	double            ctecurwin;
+};
+
 /*------------------------------------------------------------------------------------------------------------------------------------------------------- */
 /* Function prototypes */
 
 int Round(double);
 int number_haar_features(int , int , double * , int );
 void haar_featlist(int , int , double * , int  , unsigned int * );
-void MakeIntegralImage(unsigned char *, unsigned int *, int , int , unsigned int *);
-void MakeIntegralImagesquare(unsigned short int *, unsigned int *, int , int , unsigned int *);
-unsigned int Area(unsigned int * , int , int , int , int , int );
+void MakeIntegralImagePad(unsigned char *, unsigned int *, int , int );
+void MakeIntegralImagesquarePad(unsigned short int *, unsigned int *, int , int );
 void qsindex (double  *, int * , int , int );
-int eval_haar_subwindow(unsigned int * , unsigned int * , int , int , int  , double  , double , int , struct model , double *);
+void alloc_haar_cascade(struct model , struct haar_cascade *);
+void free_haar_cascade(struct haar_cascade *);
+void compile_haar_cascade(struct model , double , double , int , int , struct haar_cascade *);
+int eval_haar_batch(unsigned int * , unsigned int * , int * , int * , int , struct haar_cascade * , struct model , double * , double * , double * , double * , double * , int *);
 #ifdef matfx
 double * detect_haar(unsigned char * , int  , int , struct model  , int * , double * , double *);
 #else
@@ -427,6 +475,13 @@ double * detect_haar(unsigned char * , int  , int , struct model  , int * , doub
 #endif
 /*------------------------------------------------------------------------------------------------------------------------------------------------------- */
 
+double rect_param_default[40]   = {1 , 1 , 2 , 2 , 1 , 0 , 0 , 1 , 1 , 1 , 1 , 1 , 2 , 2 , 2 , 0 , 1 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 1 , 0 , 0 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 2 , 1 , 0 , 1 , 1 , 1};
+double param_default[400]       = {10992.0000,-6.1626,-0.7788,0.0000,76371.0000,24.2334,0.6785,0.0000,4623.0000,-0.6328,-0.5489,0.0000,58198.0000,-4.4234,-0.5018,0.0000,67935.0000,-12.8916,-0.4099,0.0000,19360.0000,-1.7222,0.1743,0.0000,60243.0000,-1.9187,-0.2518,0.0000,3737.0000,-0.9260,0.1791,0.0000,58281.0000,-16.1455,-0.2447,0.0000,13245.0000,-1.6818,0.2183,0.0000,4459.0000,1.7972,0.2043,0.0000,7765.0000,3.0506,0.1665,0.0000,10105.0000,-2.0763,0.1764,0.0000,2301.0000,-2.4221,-0.1526,0.0000,4250.0000,-0.2044,0.1077,0.0000,59328.0000,24.8328,0.2129,0.0000,10127.0000,-2.1996,0.1746,0.0000,65144.0000,-35.6228,-0.2307,0.0000,43255.0000,-0.5288,0.1970,0.0000,57175.0000,-0.2119,0.0597,0.0000,59724.0000,-27.5468,-0.2059,0.0000,13278.0000,-2.1100,0.1895,0.0000,55098.0000,22.4124,0.1913,0.0000,13238.0000,-1.7093,0.1707,0.0000,62386.0000,0.3067,0.1283,0.0000,24039.0000,6.9595,0.1639,0.0000,43211.0000,-0.5982,0.1188,0.0000,62852.0000,9.6709,0.1652,0.0000,43236.0000,-0.6296,0.1530,0.0000,45833.0000,1.7152,0.1974,0.0000,7095.0000,-1.2430,0.1269,0.0000,76347.0000,-27.4002,-0.1801,0.0000,3737.0000,-0.8826,0.1462,0.0000,65143.0000,36.2253,0.1581,0.0000,13160.0000,-2.5302,0.1469,0.0000,4845.0000,0.7053,-0.0690,0.0000,52810.0000,-13.5220,-0.1594,0.0000,43234.0000,0.5907,-0.1420,0.0000,60847.0000,39.2252,0.1563,0.0000,43234.0000,-0.5423,0.1417,0.0000,56659.0000,0.7945,0.1387,0.0000,56930.0000,-1.3875,-0.1496,0.0000,13224.0000,-1.5798,0.1080,0.0000,63154.0000,14.8166,0.1961,0.0000,13162.0000,-2.3354,0.1639,0.0000,10722.0000,0.6559,0.2141,0.0000,7528.0000,1.1026,0.1077,0.0000,4263.0000,0.1324,-0.0485,0.0000,45151.0000,-1.4198,-0.1234,0.0000,7095.0000,1.5141,-0.1367,0.0000,68446.0000,-25.0890,-0.1744,0.0000,43277.0000,-0.5919,0.1564,0.0000,3613.0000,-0.5823,-0.1439,0.0000,5418.0000,3.9535,-0.1502,0.0000,58985.0000,24.7405,0.1754,0.0000,43785.0000,-0.9376,0.1194,0.0000,46582.0000,-5.8589,-0.1286,0.0000,43470.0000,-0.6392,0.1396,0.0000,10262.0000,-2.9209,-0.1251,0.0000,10105.0000,-2.0250,0.0960,0.0000,3555.0000,0.7341,0.1348,0.0000,10115.0000,1.6321,-0.1274,0.0000,76579.0000,-39.8316,-0.1442,0.0000,10228.0000,1.8771,-0.1245,0.0000,57005.0000,2.3937,0.1431,0.0000,43830.0000,-0.7996,0.0652,0.0000,48673.0000,8.8965,0.1181,0.0000,18845.0000,-2.2572,0.0872,0.0000,50225.0000,-1.5850,-0.1181,0.0000,43284.0000,0.5782,-0.1278,0.0000,72000.0000,-8.5961,-0.1282,0.0000,43214.0000,-0.6367,0.1053,0.0000,72559.0000,23.7860,0.1368,0.0000,43792.0000,1.0846,-0.1150,0.0000,56537.0000,-0.1965,-0.1262,0.0000,13421.0000,8.9499,0.0433,0.0000,172.0000,0.5319,-0.0946,0.0000,68220.0000,20.5078,0.1688,0.0000,16105.0000,-1.8842,0.1081,0.0000,79153.0000,5.8776,0.1301,0.0000,19180.0000,2.0606,0.1314,0.0000,13.0000,0.5438,-0.0802,0.0000,67201.0000,-6.6425,-0.1443,0.0000,43210.0000,0.5881,-0.1349,0.0000,65075.0000,-44.1279,-0.1170,0.0000,43214.0000,0.5392,-0.0840,0.0000,139.0000,0.2841,0.1480,0.0000,10209.0000,1.8835,-0.0957,0.0000,44409.0000,-1.0357,-0.1648,0.0000,43210.0000,-0.5252,0.1002,0.0000,47431.0000,6.8252,0.0927,0.0000,10235.0000,-1.3325,0.0795,0.0000,14896.0000,-12.2989,-0.0802,0.0000,1752.0000,-0.8487,-0.1193,0.0000,6964.0000,-1.7033,0.0944,0.0000,64124.0000,32.1583,0.1058,0.0000,43215.0000,-0.6988,0.0997,0.0000,76579.0000,-39.5722,-0.0932,0.0000,43966.0000,1.0216,-0.0926,0.0000,68446.0000,-25.5175,-0.1295,0.0000};
+double cascade_default[16]      = {1, -0.75 , 2 , -0.5 , 3 ,  -0.5 , 4 , -0.25 , 10 , 0 , 20 , 0 , 30 , 0 , 30 , 0};
+double scalingbox_default[3]    = {2 , 1.4 , 1.8};
+double mergingbox_default[3]    = {1/2 , 1/2 , 1/3};
+
+#ifndef NO_MEXFUNCTION
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 {  
     unsigned char *I;
@@ -434,11 +489,6 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
     const int *dimsI ;
     int numdimsI , Tcascade = 0;
     double *D , *Dtemp=NULL , *stat;
-	double rect_param_default[40]   = {1 , 1 , 2 , 2 , 1 , 0 , 0 , 1 , 1 , 1 , 1 , 1 , 2 , 2 , 2 , 0 , 1 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 1 , 0 , 0 , 1 , 1 , -1 , 2 , 2 , 1 , 2 , 2 , 1 , 0 , 1 , 1 , 1};
-	double param_default[400]       = {10992.0000,-6.1626,-0.7788,0.0000,76371.0000,24.2334,0.6785,0.0000,4623.0000,-0.6328,-0.5489,0.0000,58198.0000,-4.4234,-0.5018,0.0000,67935.0000,-12.8916,-0.4099,0.0000,19360.0000,-1.7222,0.1743,0.0000,60243.0000,-1.9187,-0.2518,0.0000,3737.0000,-0.9260,0.1791,0.0000,58281.0000,-16.1455,-0.2447,0.0000,13245.0000,-1.6818,0.2183,0.0000,4459.0000,1.7972,0.2043,0.0000,7765.0000,3.0506,0.1665,0.0000,10105.0000,-2.0763,0.1764,0.0000,2301.0000,-2.4221,-0.1526,0.0000,4250.0000,-0.2044,0.1077,0.0000,59328.0000,24.8328,0.2129,0.0000,10127.0000,-2.1996,0.1746,0.0000,65144.0000,-35.6228,-0.2307,0.0000,43255.0000,-0.5288,0.1970,0.0000,57175.0000,-0.2119,0.0597,0.0000,59724.0000,-27.5468,-0.2059,0.0000,13278.0000,-2.1100,0.1895,0.0000,55098.0000,22.4124,0.1913,0.0000,13238.0000,-1.7093,0.1707,0.0000,62386.0000,0.3067,0.1283,0.0000,24039.0000,6.9595,0.1639,0.0000,43211.0000,-0.5982,0.1188,0.0000,62852.0000,9.6709,0.1652,0.0000,43236.0000,-0.6296,0.1530,0.0000,45833.0000,1.7152,0.1974,0.0000,7095.0000,-1.2430,0.1269,0.0000,76347.0000,-27.4002,-0.1801,0.0000,3737.0000,-0.8826,0.1462,0.0000,65143.0000,36.2253,0.1581,0.0000,13160.0000,-2.5302,0.1469,0.0000,4845.0000,0.7053,-0.0690,0.0000,52810.0000,-13.5220,-0.1594,0.0000,43234.0000,0.5907,-0.1420,0.0000,60847.0000,39.2252,0.1563,0.0000,43234.0000,-0.5423,0.1417,0.0000,56659.0000,0.7945,0.1387,0.0000,56930.0000,-1.3875,-0.1496,0.0000,13224.0000,-1.5798,0.1080,0.0000,63154.0000,14.8166,0.1961,0.0000,13162.0000,-2.3354,0.1639,0.0000,10722.0000,0.6559,0.2141,0.0000,7528.0000,1.1026,0.1077,0.0000,4263.0000,0.1324,-0.0485,0.0000,45151.0000,-1.4198,-0.1234,0.0000,7095.0000,1.5141,-0.1367,0.0000,68446.0000,-25.0890,-0.1744,0.0000,43277.0000,-0.5919,0.1564,0.0000,3613.0000,-0.5823,-0.1439,0.0000,5418.0000,3.9535,-0.1502,0.0000,58985.0000,24.7405,0.1754,0.0000,43785.0000,-0.9376,0.1194,0.0000,46582.0000,-5.8589,-0.1286,0.0000,43470.0000,-0.6392,0.1396,0.0000,10262.0000,-2.9209,-0.1251,0.0000,10105.0000,-2.0250,0.0960,0.0000,3555.0000,0.7341,0.1348,0.0000,10115.0000,1.6321,-0.1274,0.0000,76579.0000,-39.8316,-0.1442,0.0000,10228.0000,1.8771,-0.1245,0.0000,57005.0000,2.3937,0.1431,0.0000,43830.0000,-0.7996,0.0652,0.0000,48673.0000,8.8965,0.1181,0.0000,18845.0000,-2.2572,0.0872,0.0000,50225.0000,-1.5850,-0.1181,0.0000,43284.0000,0.5782,-0.1278,0.0000,72000.0000,-8.5961,-0.1282,0.0000,43214.0000,-0.6367,0.1053,0.0000,72559.0000,23.7860,0.1368,0.0000,43792.0000,1.0846,-0.1150,0.0000,56537.0000,-0.1965,-0.1262,0.0000,13421.0000,8.9499,0.0433,0.0000,172.0000,0.5319,-0.0946,0.0000,68220.0000,20.5078,0.1688,0.0000,16105.0000,-1.8842,0.1081,0.0000,79153.0000,5.8776,0.1301,0.0000,19180.0000,2.0606,0.1314,0.0000,13.0000,0.5438,-0.0802,0.0000,67201.0000,-6.6425,-0.1443,0.0000,43210.0000,0.5881,-0.1349,0.0000,65075.0000,-44.1279,-0.1170,0.0000,43214.0000,0.5392,-0.0840,0.0000,139.0000,0.2841,0.1480,0.0000,10209.0000,1.8835,-0.0957,0.0000,44409.0000,-1.0357,-0.1648,0.0000,43210.0000,-0.5252,0.1002,0.0000,47431.0000,6.8252,0.0927,0.0000,10235.0000,-1.3325,0.0795,0.0000,14896.0000,-12.2989,-0.0802,0.0000,1752.0000,-0.8487,-0.1193,0.0000,6964.0000,-1.7033,0.0944,0.0000,64124.0000,32.1583,0.1058,0.0000,43215.0000,-0.6988,0.0997,0.0000,76579.0000,-39.5722,-0.0932,0.0000,43966.0000,1.0216,-0.0926,0.0000,68446.0000,-25.5175,-0.1295,0.0000};
-	double cascade_default[16]      = {1, -0.75 , 2 , -0.5 , 3 ,  -0.5 , 4 , -0.25 , 10 , 0 , 20 , 0 , 30 , 0 , 30 , 0};
-	double scalingbox_default[3]    = {2 , 1.4 , 1.8};
-	double mergingbox_default[3]    = {1/2 , 1/2 , 1/3};
 
 	mxArray *mxtemp;	    
 	int i , Ny , Nx  , nD = 0 , tempint , r = 5;
@@ -887,6 +937,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 			mxFree(detector.cascade);
 	}	
 }
+#endif
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 #ifdef matfx
 double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector , int *nD , double *stat , double *fxmat )		 
@@ -902,38 +953,38 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 #endif
 	double tempx , tempy, scale , invscale2, powScaleInc;
 	double si , sj , sij;
-	unsigned int *II , *Itemp;
-	unsigned int *IIsquare;
+	unsigned int *II , *IIsquare;
 	unsigned short int *Isquare , tempI;
     double *D , *Draw;
 	double *possize;
 	int *indexsize;
 	
-	int i , j , l , m ;
-	int yest  , Deltay , Deltax , Ly , Lx , Offsety , Offsetx , Origy , Origx , r = 5;	
+	int i , j , l , m , k ;
+	int Deltay , Deltax , Ly , Lx , Offsety , Offsetx , Origy , Origx , r = 5;	
 	int sizeDataBase = max(nx , ny), halfsizeDataBase = sizeDataBase/2 , current_sizewindow , current_stepwindow, minN = min(Ny,Nx);
-	double fx , scale_ini = scalingbox[0] , scale_inc = scalingbox[1] , step_ini = scalingbox[2];
+	double scale_ini = scalingbox[0] , scale_inc = scalingbox[1] , step_ini = scalingbox[2];
 	double overlap_same = mergingbox[0] , overlap_diff = mergingbox[1] , dist_ini = mergingbox[2];
 	double dsizeDataBase = (double) sizeDataBase , tmp , nb_detect_total  , nb_detect , nb_detect1 ,  Xinf, Yinf, Xsup , Ysup;
+	int Ny1 = Ny + 1 , NyNx1 = Ny1*(Nx + 1) , nwin , Lblock , nblock , l0 , l1 , nb;
+	int *yestwin , *base , *win;
+	struct haar_cascade hc;
+	double *fxwin , *std , *sum , *sum_total , *zs;
 
-#ifdef matfx
-	int indOrigx;
-#endif
-
-	II                   = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	IIsquare             = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	Itemp                = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+	II                   = (unsigned int *) malloc(NyNx1*sizeof(unsigned int));
+	IIsquare             = (unsigned int *) malloc(NyNx1*sizeof(unsigned int));
 	Isquare              = (unsigned short int *) malloc(NyNx*sizeof(unsigned short int));	   
     Draw                 = (double *) malloc(r*Pos_current*sizeof(double));
 
+	alloc_haar_cascade(detector , &hc);
 
 #ifdef OMP 
     num_threads          = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
     omp_set_num_threads(num_threads);
 #endif
 
+	/* Integral images are zero-padded ((Ny+1) x (Nx+1)) so that any rectangle sum is 4 loads without border tests */
 
-	MakeIntegralImage(I , II , Nx , Ny , Itemp);
+	MakeIntegralImagePad(I , II , Nx , Ny);
 
 	for(i = 0 ; i < NyNx ; i++)
 	{
@@ -941,7 +992,7 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 		Isquare[i] = tempI*tempI;
 	}
 
-	MakeIntegralImagesquare(Isquare , IIsquare , Nx , Ny , Itemp);
+	MakeIntegralImagesquarePad(Isquare , IIsquare , Nx , Ny);
 		
 	current_sizewindow   = halfsizeDataBase*Round(2.0*scale_ini);	
 	current_stepwindow   = Round(step_ini*scale_ini);
@@ -963,43 +1014,69 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
         
         Lx         = max(1 , (int) (floor(((Nx - nxs)/(double) Deltax))) + 1);
         Offsetx    = max(0 , (int) ( floor(Nx - ( (Lx-1)*Deltax + nxs + 1)) ));
+
+		compile_haar_cascade(detector , scale , invscale2 , current_sizewindow , Ny1 , &hc);
+
+		/* Subwindows are evaluated by blocks of Lblock columns (about HAAR_BATCH windows) with early-reject compaction */
+
+		nwin       = Lx*Ly;
+		Lblock     = max(1 , HAAR_BATCH/Ly);
+		nblock     = (Lx + Lblock - 1)/Lblock;
+		yestwin    = (int *) malloc(nwin*sizeof(int));
+		fxwin      = (double *) malloc(nwin*sizeof(double));
+
 #ifdef OMP 
-#ifdef matfx
-#pragma omp parallel for default(none) private(m,Origy,yest,fx,index,l,Origx,indOrigx) shared(fxmat,Pos,Negs,Pos_current,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Draw,II,IIsquare,Ny,r,scale,invscale2,current_sizewindow,detector) 
-#else
-#pragma omp parallel for default(none) private(m,Origy,yest,fx,index,l,Origx) shared(Pos,Negs,Pos_current,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Draw,II,IIsquare,Ny,r,scale,invscale2,current_sizewindow,detector) 
+#pragma omp parallel default(none) private(k,l,m,l0,l1,nb,base,win,std,sum,sum_total,zs) shared(nblock,Lblock,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Ny1,II,IIsquare,hc,detector,yestwin,fxwin) 
 #endif
+		{
+			nb         = Lblock*Ly;
+			base       = (int *) malloc(nb*sizeof(int));
+			win        = (int *) malloc(nb*sizeof(int));
+			std        = (double *) malloc(nb*sizeof(double));
+			sum        = (double *) malloc(nb*sizeof(double));
+			sum_total  = (double *) malloc(nb*sizeof(double));
+			zs         = (double *) malloc(nb*sizeof(double));
+
+#ifdef OMP 
+#pragma omp for schedule(dynamic,1) nowait
 #endif
-		/* Shift subwindows */
+			for(k = 0 ; k < nblock ; k++)
+			{
+				l0     = k*Lblock;
+				l1     = min(Lx , l0 + Lblock);
+				nb     = 0;
+				for(l = l0 ; l < l1 ; l++) /* Loop shift on x-axis  */
+				{
+					for(m = 0 ; m < Ly  ; m++)   /* Loop shift on y-axis  */
+					{
+						base[nb] = (Offsety + m*Deltay) + (Offsetx + l*Deltax)*Ny1;
+						win[nb]  = m + l*Ly;
+						nb++;
+					}
+				}
+				eval_haar_batch(II , IIsquare , base , win , nb , &hc , detector , std , sum , sum_total , zs , fxwin , yestwin);
+			}
+			free(base);
+			free(win);
+			free(std);
+			free(sum);
+			free(sum_total);
+			free(zs);
+		}
 
-		for(l = 0 ; l < Lx ; l++) /* Loop shift on x-axis  */
+		/* Collect raw detections in scanning order */
+
+		for(l = 0 ; l < Lx ; l++)
 		{
 			Origx          = Offsetx + l*Deltax ;
-#ifdef matfx
-			indOrigx       = Ny*Origx;
-#endif		
-/*
-#ifdef OMP 
-#ifdef matfx
-#pragma omp parallel for default(none) private(m,Origy,yest,index,fx,indOrigx) shared(fxmat,Pos,Negs,Pos_current,Ly,Origx,Offsety,Deltay,Draw,II,IIsquare,Ny,r,scale,invscale2,current_sizewindow,detector) 
-#else
-#pragma omp parallel for default(none) private(m,Origy,yest,index) shared(Pos,Negs,Pos_current,Ly,Origx,Offsety,Deltay,Draw,II,IIsquare,Ny,r,scale,invscale2,current_sizewindow,detector) 
-#endif
-#endif
-*/
-			for(m = 0 ; m < Ly  ; m++)   /* Loop shift on y-axis  */
+			for(m = 0 ; m < Ly  ; m++)
 			{				
 				Origy      = Offsety + m*Deltay ;				
-					
-				/* Evaluate cascade in (Origy , Origx)*/
-				yest                      = eval_haar_subwindow(II,IIsquare,Origy,Origx,Ny,scale,invscale2,current_sizewindow,detector,&fx);
-					
+				k          = m + l*Ly;
 #ifdef matfx
-				fxmat[Origy + indOrigx]  += fx;
+				fxmat[Origy + Ny*Origx]  += fxwin[k];
 #endif			
-
-
-				if(yest == 1) /* New raw detection  */		
+				if(yestwin[k] == 1) /* New raw detection  */		
 				{
 					if(Pos < Pos_current)
 					{
@@ -1008,7 +1085,7 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 						Draw[1 + index]           = (double)Origx;				
 						Draw[2 + index]           = (double)Origy;
 						Draw[3 + index]           = (double)current_sizewindow;
-						Draw[4 + index]           = fx;
+						Draw[4 + index]           = fxwin[k];
 						Pos++;
 					}
 				}	
@@ -1018,11 +1095,13 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 				}	
 			}
 		}
+		free(yestwin);
+		free(fxwin);
+
 		current_sizewindow        = halfsizeDataBase*Round(2.0*scale_ini*powScaleInc);	
 		current_stepwindow        = (int)ceil(step_ini*scale_ini*powScaleInc);
 		powScaleInc              *= scale_inc; 	
 	}
-
 	if(postprocessing == 0) /* Raw detections */
 	{
 		nD[0]    = Pos;
@@ -1300,11 +1379,11 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 
 	/* Free pointers */
 	
-	free(Itemp);
 	free(II);
 	free(Isquare);
 	free(IIsquare);
     free(Draw);
+	free_haar_cascade(&hc);
 	
 	stat[0] = (double)Pos;
 	stat[1] = (double)Negs;
@@ -1313,105 +1392,222 @@ double * detect_haar(unsigned char *I , int Ny , int Nx  , struct model detector
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------------------------------- */
-int eval_haar_subwindow(unsigned int *II , unsigned int *IIsquare , int Origy , int Origx , int Ny , double scale , double invscale2 , int current_sizewindow , struct model detector  , double *fx)
+void alloc_haar_cascade(struct model detector , struct haar_cascade *hc)
 {
-    double   *param = detector.param , *rect_param = detector.rect_param , *cascade = detector.cascade;
+	double *param = detector.param , *rect_param = detector.rect_param , *cascade = detector.cascade;
 	unsigned int *F = detector.F;
-	int Ncascade = detector.Ncascade , weaklearner = detector.weaklearner , cascade_type = detector.cascade_type;
-	double epsi  = detector.epsi , sum , sum_total = 0.0, a , b , th , thresh ;
-	double var , mean , std;
-	int z , c , f , Tc , indc = 0 , indf = 0, idxF ,  x , xr , y , yr , w , wr , h , hr , r , s  , R , indR , coeffw , coeffh;
-	int curwin1 = (current_sizewindow - 1) , indbl = Origy + curwin1 , indtl = Origx*Ny , indtr = (Origx + curwin1)*Ny; 
-	double ctecurwin = 1.0/(double)(current_sizewindow*current_sizewindow);
-
-	var      = (IIsquare[indbl + indtr] - (IIsquare[Origy + indtr] + IIsquare[indbl + indtl]) + IIsquare[Origy + indtl])*ctecurwin;
-	mean     = (II[indbl + indtr] - (II[Origy + indtr] + II[indbl + indtl]) + II[Origy + indtl])*ctecurwin;
+	int c , f , Tcascade = 0 , nrect = 0 , indf = 0;
 
-/*
-    var      = Area(IIsquare , Origx  , Origy  , current_sizewindow , current_sizewindow , Ny)*ctecurwin;
-    mean     = Area(II , Origx  , Origy  , current_sizewindow , current_sizewindow , Ny)*ctecurwin;
-*/
-	std      = sqrt(var - mean*mean);
-
-	if(std == 0.0)
+	for(c = 0 ; c < detector.Ncascade ; c++)
+	{
+		Tcascade      += (int) cascade[2*c];
+	}
+	for(f = 0 ; f < Tcascade ; f++)
 	{
-		return 0;
+		nrect         += (int) rect_param[3 + F[5 + ((int) param[indf] - 1)*6]];
+		indf          += 4;
 	}
+	hc->Ncascade       = detector.Ncascade;
+	hc->stage_end      = (int *) malloc(max(1 , detector.Ncascade)*sizeof(int));
+	hc->stage_th       = (double *) malloc(max(1 , detector.Ncascade)*sizeof(double));
+	hc->weak           = (struct haar_weak *) malloc(max(1 , Tcascade)*sizeof(struct haar_weak));
+	hc->rect           = (struct haar_rect *) malloc(max(1 , nrect)*sizeof(struct haar_rect));
+}
 
-	std      = invscale2/std;
-	
-	for (c = 0 ; c < Ncascade ; c++)
-	{	
-		Tc     = (int) cascade[0 + indc];
-		thresh = cascade[1 + indc];
-		sum    = 0.0;
-		
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void free_haar_cascade(struct haar_cascade *hc)
+{
+	free(hc->stage_end);
+	free(hc->stage_th);
+	free(hc->weak);
+	free(hc->rect);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void compile_haar_cascade(struct model detector , double scale , double invscale2 , int current_sizewindow , int Ny1 , struct haar_cascade *hc)
+{
+	/* Decode param/F/rect_param once for the current scan scale: rectangles are scaled, rounded and turned into
+	   4 corner offsets of the padded integral image, so that subwindows are evaluated with integer loads/adds only */
+
+	double *param = detector.param , *rect_param = detector.rect_param , *cascade = detector.cascade;
+	unsigned int *F = detector.F;
+	int c , f , t , Tc , nw = 0 , nr = 0 , indf = 0 , idxF , x , y , w , h , xr , yr , wr , hr , R , indR , coeffw , coeffh;
+	struct haar_rect *rect;
+
+	hc->invscale2      = invscale2;
+	hc->ctecurwin      = 1.0/(double)(current_sizewindow*current_sizewindow);
+	hc->otl            = 1 + Ny1;
+	hc->otr            = 1 + current_sizewindow*Ny1;
+	hc->obl            = current_sizewindow + Ny1;
+	hc->obr            = current_sizewindow + current_sizewindow*Ny1;
+
+	for (c = 0 ; c < hc->Ncascade ; c++)
+	{
+		Tc                 = (int) cascade[0 + 2*c];
+		hc->stage_th[c]    = cascade[1 + 2*c];
 		for (f = 0 ; f < Tc ; f++)
-		{	
+		{
 			idxF  = ((int) param[0 + indf] - 1)*6;
-			th    =  param[1 + indf];
-			a     =  param[2 + indf];
-			b     =  param[3 + indf];
-				
 			x     =  F[1 + idxF];
 			y     =  F[2 + idxF];
 			w     =  F[3 + idxF];
 			h     =  F[4 + idxF];
-
 			indR  =  F[5 + idxF];
 			R     = (int) rect_param[3 + indR];
 
-			z     = 0;
-			for (r = 0 ; r < R ; r++)
+			hc->weak[nw].first = nr;
+			hc->weak[nw].R     = R;
+			hc->weak[nw].th    = param[1 + indf];
+			hc->weak[nw].a     = param[2 + indf];
+			hc->weak[nw].b     = param[3 + indf];
+
+			for (t = 0 ; t < R ; t++)
 			{	
-				coeffw  = w/(int)rect_param[1 + indR];			
-				coeffh  = h/(int)rect_param[2 + indR];
-				xr      = Round(scale*(x + (coeffw*(int)rect_param[5 + indR]))) + Origx;
-				yr      = Round(scale*(y + (coeffh*(int)rect_param[6 + indR]))) + Origy;
-				wr      = Round(scale*(coeffw*(int)(rect_param[7 + indR])));
-				hr      = Round(scale*(coeffh*(int)(rect_param[8 + indR])));
-				s       = (int)rect_param[9 + indR];
-				z      += s*Area(II , xr  , yr  , wr , hr , Ny);				
-				indR   += 10;
-			}				
+				coeffw    = w/(int)rect_param[1 + indR];			
+				coeffh    = h/(int)rect_param[2 + indR];
+				xr        = Round(scale*(x + (coeffw*(int)rect_param[5 + indR])));
+				yr        = Round(scale*(y + (coeffh*(int)rect_param[6 + indR])));
+				wr        = Round(scale*(coeffw*(int)(rect_param[7 + indR])));
+				hr        = Round(scale*(coeffh*(int)(rect_param[8 + indR])));
+				rect      = hc->rect + nr;
+				rect->br  = (yr + hr) + (xr + wr)*Ny1;
+				rect->tr  = yr + (xr + wr)*Ny1;
+				rect->bl  = (yr + hr) + xr*Ny1;
+				rect->tl  = yr + xr*Ny1;
+				rect->s   = (int)rect_param[9 + indR];
+				nr++;
+				indR     += 10;
+			}
+			nw++;
+			indf         += 4;
+		}
+		hc->stage_end[c]  = nw;
+	}
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int eval_haar_batch(unsigned int *II , unsigned int *IIsquare , int *base , int *win , int nb , struct haar_cascade *hc , struct model detector , double *std , double *sum , double *sum_total , double *zs , double *fx , int *yest)
+{
+	/* Evaluate the compiled cascade hc on nb subwindows with top-left corners base[j] in the padded integral image.
+	   Each stage runs over the dense array of surviving windows which is compacted before the next stage.
+	   Results are written in fx[win[j]] and yest[win[j]]. Return the number of windows passing the cascade */
+
+	int weaklearner = detector.weaklearner , cascade_type = detector.cascade_type;
+	double epsi  = detector.epsi , a , b , th , thresh , var , mean , stdj ;
+	int z , c , f = 0 , j , n , nn , t , R ;
+	int otl = hc->otl , otr = hc->otr , obl = hc->obl , obr = hc->obr;
+	double invscale2 = hc->invscale2 , ctecurwin = hc->ctecurwin;
+	unsigned int *IIb;
+	struct haar_rect *rect;
+
+	n        = 0;
+	for(j = 0 ; j < nb ; j++)
+	{
+		IIb      = IIsquare + base[j];
+		var      = (IIb[obr] - (IIb[otr] + IIb[obl]) + IIb[otl])*ctecurwin;
+		IIb      = II + base[j];
+		mean     = (IIb[obr] - (IIb[otr] + IIb[obl]) + IIb[otl])*ctecurwin;
+		stdj     = sqrt(var - mean*mean);
+		if(stdj == 0.0)
+		{
+			fx[win[j]]     = 0.0;
+			yest[win[j]]   = 0;
+		}
+		else
+		{
+			base[n]        = base[j];
+			win[n]         = win[j];
+			std[n]         = invscale2/stdj;
+			sum[n]         = 0.0;
+			sum_total[n]   = 0.0;
+			n++;
+		}
+	}
+	
+	for (c = 0 ; (c < hc->Ncascade) && (n > 0) ; c++)
+	{	
+		thresh = hc->stage_th[c];
+		for(j = 0 ; j < n ; j++)
+		{
+			sum[j]     = 0.0;
+		}
+		
+		for ( ; f < hc->stage_end[c] ; f++)
+		{	
+			th    = hc->weak[f].th;
+			a     = hc->weak[f].a;
+			b     = hc->weak[f].b;
+			R     = hc->weak[f].R;
+			rect  = hc->rect + hc->weak[f].first;
+
+			for(j = 0 ; j < n ; j++)
+			{
+				IIb     = II + base[j];
+				z       = 0;
+				for (t = 0 ; t < R ; t++)
+				{
+					z  += rect[t].s*(IIb[rect[t].br] - (IIb[rect[t].tr] + IIb[rect[t].bl]) + IIb[rect[t].tl]);
+				}
+				zs[j]   = z*std[j];
+			}
+
 			if(weaklearner == 0)			
 			{
-				sum    += (a*( (z*std) > th ) + b);	
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += (a*( zs[j] > th ) + b);	
+				}
 			}
-			if(weaklearner == 1)
+			else if(weaklearner == 1)
 			{	
-				sum    += ((2.0/(1.0 + exp(-2.0*epsi*(th*(z*std) + b)))) - 1.0);	
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += ((2.0/(1.0 + exp(-2.0*epsi*(th*zs[j] + b)))) - 1.0);	
+				}
 			}
-			if(weaklearner == 2)
+			else if(weaklearner == 2)
 			{
-				sum    += a*sign((z*std) - th);
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += a*sign(zs[j] - th);
+				}
 			}						
-			indf      += 4;			
 		}
-		
-		sum_total     += sum;
 
-		if((sum_total < thresh) && (cascade_type == 1))
-		{
-			fx[0]     = sum_total;
-			return 0;
-		}		
-		else if((sum < thresh) && (cascade_type == 0))
+		/* Early-reject compaction */
+		
+		nn     = 0;
+		for(j = 0 ; j < n ; j++)
 		{
-			fx[0]     = sum;
-			return 0;				
-		}			
-		indc      += 2; 
-	}
-	if(cascade_type == 1)
-	{
-		fx[0]     = sum_total;	
+			sum_total[j]      += sum[j];
+			if((sum_total[j] < thresh) && (cascade_type == 1))
+			{
+				fx[win[j]]     = sum_total[j];
+				yest[win[j]]   = 0;
+			}		
+			else if((sum[j] < thresh) && (cascade_type == 0))
+			{
+				fx[win[j]]     = sum[j];
+				yest[win[j]]   = 0;
+			}
+			else
+			{
+				base[nn]       = base[j];
+				win[nn]        = win[j];
+				std[nn]        = std[j];
+				sum[nn]        = sum[j];
+				sum_total[nn]  = sum_total[j];
+				nn++;
+			}
+		}
+		n          = nn;
 	}
-	else if(cascade_type == 0)
+	for(j = 0 ; j < n ; j++)
 	{
-		fx[0]     = sum;	
+		fx[win[j]]     = (cascade_type == 1) ? sum_total[j] : sum[j];
+		yest[win[j]]   = 1;
 	}
-	return 1;
+	return n;
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
@@ -1478,111 +1674,51 @@ int number_haar_features(int ny , int nx , double *rect_param , int nR)
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------------*/
 
-void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagePad(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-
-	int x , y , indx = 0;
-		
-	for(x=0 ; x<iXmax ; x++)
-	{
-		pTemp[indx]     = (unsigned int)pIn[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
-	pOut[0]             = (unsigned int)pIn[0];
-	indx                = iYmax;
+	/* Integral image of size ((iYmax+1) x (iXmax+1)) with a zero first row and first column */
 
-	for(x=1 ; x<iXmax ; x++)
+	int x , y , iYmax1 = iYmax + 1 , indx = 0 , indx1 = iYmax1;
+	unsigned int colsum;
+	
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
+		pOut[y]         = 0;
 	}
-	for(y = 1 ; y<iYmax ; y++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		pOut[y]         = pOut[y - 1] + (unsigned int)pIn[y];
-	}
-	
-	/* Calculate integral image */
-
-	indx                = iYmax;
-
-	for(x = 1 ; x < iXmax ; x++)
-	{
-		for(y = 1 ; y < iYmax ; y++)
+		colsum          = 0;
+		pOut[indx1]     = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int)pIn[y + indx];	
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			colsum                 += (unsigned int) pIn[y + indx];
+			pOut[y + 1 + indx1]     = pOut[y + 1 + indx1 - iYmax1] + colsum;
 		}
-		indx += iYmax;
+		indx           += iYmax;
+		indx1          += iYmax1;
 	}
 }
-
 /*----------------------------------------------------------------------------------------------------------------------------------------------*/
-void MakeIntegralImagesquare(unsigned short int *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagesquarePad(unsigned short int *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-
-	int x , y , indx  = 0;
-		
-	for(x=0 ; x<iXmax ; x++)
-	{
-		pTemp[indx]     = (unsigned int)pIn[indx];
-		indx           += iYmax;
-	}	
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
+	int x , y , iYmax1 = iYmax + 1 , indx = 0 , indx1 = iYmax1;
+	unsigned int colsum;
 	
-	pOut[0]             = (unsigned int)pIn[0];
-	indx                = iYmax;
-	for(x=1 ; x<iXmax ; x++)
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
+		pOut[y]         = 0;
 	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pOut[y]         = pOut[y - 1] + (unsigned int)pIn[y];
-	}
-	
-	/* Calculate integral image */
-
-	indx                = iYmax;
-	for(x = 1 ; x < iXmax ; x++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		for(y = 1 ; y < iYmax ; y++)
+		colsum          = 0;
+		pOut[indx1]     = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int)pIn[y + indx];
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			colsum                 += (unsigned int) pIn[y + indx];
+			pOut[y + 1 + indx1]     = pOut[y + 1 + indx1 - iYmax1] + colsum;
 		}
-		indx += iYmax;
-	}
-}
-/*----------------------------------------------------------------------------------------------------------------------------------------------*/
-unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
-{
-	int h1 = h-1 , w1 = w-1 , x1 = x-1, y1 = y-1;
-		
-	if( (x == 0) && (y==0))
-	{	
-		return (II[h1 + w1*Ny]);	
-	}
-	if( x==0 ) 
-	{
-		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);
-	}
-	if( y==0 )
-	{
-		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);	
-	}
-	else
-	{	
-		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);
+		indx           += iYmax;
+		indx1          += iYmax1;
 	}
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
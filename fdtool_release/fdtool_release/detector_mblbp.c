@@ -90,6 +90,11 @@ If compiled with the "OMP" compilation flag
 
 
 
+  With -DNO_MEXFUNCTION, mex.h and mexFunction are left out and the file can be
+  included in plain C code calling detect_mblbp directly with the default model below
+  (see Drowsiness_C/src/bench_detectors.cpp).
+
+
   Example 1
   ---------
 
@@ -223,7 +228,11 @@ If compiled with the "OMP" compilation flag
 
 
 #include <math.h>
+#ifndef NO_MEXFUNCTION
 #include <mex.h>
+#else
+#include <stdlib.h>
+#endif
 
 #ifdef OMP 
  #include <omp.h>
@@ -240,6 +249,10 @@ If compiled with the "OMP" compilation flag
 #define MAX_THREADS 64
 #endif
 
+#ifndef MBLBP_BATCH
+#define MBLBP_BATCH 512
+#endif
+
 struct model
 {
 	int             weaklearner;
@@ -271,9 +284,8 @@ struct model
 int Round(double );
 int number_mblbp_features(int , int );
 void mblbp_featlist(int  , int , unsigned int *);
-void MakeIntegralImage(unsigned char *, unsigned int *, int , int , unsigned int *);
-unsigned int Area(unsigned int * , int , int , int , int , int );
-int eval_mblbp_subwindow(unsigned int * , int , int , int , double  , struct model , double *);
+void MakeIntegralImagePad(unsigned char *, unsigned int *, int , int );
+int eval_mblbp_batch(unsigned int * , int , int * , int * , int , double , struct model , int * , double * , double * , double * , double * , int *);
 void qsindex (double  *, int * , int , int );
 
 #ifdef matfx
@@ -284,6 +296,12 @@ double * detect_mblbp(unsigned char * , int  , int  , struct model  ,  int * , d
 
 /*-------------------------------------------------------------------------------------------------------------- */
 
+double param_default[400]       = {4608.0000,240.0000, 1.1750,-0.6868,8396.0000, 7.0000,-1.0774, 0.6278,4717.0000,12.0000,-0.9667, 0.5909,6130.0000,223.5000, 0.7644,-0.3870,4776.0000,127.0000,-0.7657, 0.2433,5027.0000, 1.5000,-0.8168, 0.6111,2399.0000,192.0000, 0.6640,-0.3146,986.0000,240.0000, 0.6726,-0.2658,5289.0000,63.0000,-0.5540, 0.2837,1002.0000,227.5000, 0.6053,-0.2320,2571.0000,161.0000, 0.5391,-0.2587,6774.0000,46.0000,-0.5479, 0.3235,5389.0000,220.0000, 0.5034,-0.1697,986.0000,48.0000, 0.7172,-0.6259,3067.0000,234.0000,-0.7112, 0.0879,822.0000,228.0000,-0.6506, 0.0896,2411.0000,190.0000, 0.4595,-0.2182,185.0000,32.0000, 0.5747,-0.4633,4239.0000,143.0000,-0.5122, 0.1384,1309.0000,183.0000, 0.4818,-0.2120,4131.0000,64.0000,-0.4564, 0.2447,1145.0000,119.0000, 0.4988,-0.3431,2274.0000,195.0000, 0.4599,-0.2104,2753.0000,237.0000,-0.6033, 0.1039,2805.0000,24.0000, 0.6233,-0.5368,1611.0000,56.0000, 0.5743,-0.4798,5769.0000,225.0000,-0.5952, 0.0857,715.0000,128.0000, 0.4319,-0.2546,7914.0000,233.0000,-0.6488, 0.0804,2896.0000,241.0000, 0.4893,-0.1312,6555.0000,225.0000,-0.7045, 0.0771,2450.0000,14.0000, 0.6013,-0.5252,96.0000, 2.0000, 0.7296,-0.6644,1223.0000, 8.0000, 0.6591,-0.5927,308.0000, 2.0000, 0.7811,-0.7270,136.0000,207.0000,-0.5026, 0.0877,349.0000,237.0000,-0.5503, 0.0791,2164.0000,31.0000, 0.5243,-0.4402,4100.0000,157.0000, 0.3848,-0.1920,4078.0000,224.0000,-0.5150, 0.1033,2330.0000,60.0000, 0.4320,-0.3157,768.0000,252.0000,-0.8387, 0.0613,751.0000, 8.0000, 0.5779,-0.5144,1000.0000, 6.0000, 0.7844,-0.7250,74.0000, 8.0000, 0.5917,-0.5229,892.0000,191.0000, 0.3999,-0.1474,7986.0000,64.0000,-0.3796, 0.2177,2667.0000,48.0000, 0.4651,-0.3600,6691.0000,191.0000, 0.4077,-0.1707,2153.0000,63.0000,-0.3979, 0.2135,7633.0000,56.0000, 0.4288,-0.3232,6274.0000,68.0000,-0.3929, 0.2427,3818.0000,63.0000,-0.3822, 0.1872,586.0000,239.0000, 0.4054,-0.1366,3901.0000, 8.0000, 0.5937,-0.5174,238.0000,229.0000, 0.4361,-0.1072,2825.0000,95.0000,-0.3792, 0.2139,2031.0000,193.0000, 0.4069,-0.1689,2577.0000,143.0000,-0.4686, 0.1123,326.0000,55.0000, 0.4383,-0.3149,4119.0000,24.0000, 0.5279,-0.4414,928.0000,246.0000,-0.5931, 0.0655,2411.0000,227.0000,-0.5046, 0.0793,2334.0000,10.0000, 0.5918,-0.5350,2362.0000,11.0000, 0.5816,-0.5155,424.0000,25.0000, 0.4660,-0.3772,3088.0000,211.5000,-0.4360, 0.0976,2408.0000,26.0000, 0.5043,-0.4183,316.0000,223.0000, 0.3862,-0.1356,263.0000, 6.0000, 0.5788,-0.5087,2157.0000,227.0000,-0.5186, 0.0681,6581.0000,12.0000, 0.5558,-0.4945,1197.0000,227.0000,-0.4703, 0.0799,402.0000, 0.0000, 0.7701,-0.7340,2814.0000,12.0000, 0.5069,-0.4388,5812.0000,246.0000, 0.3962,-0.1081,197.0000,31.0000,-0.3743, 0.2453,2135.0000,12.0000, 0.5345,-0.4676,608.0000,249.0000,-0.7812, 0.0486,74.0000,62.0000,-0.3577, 0.2071,74.0000,193.0000, 0.3861,-0.1436,6545.0000,253.0000, 0.5373,-0.0608,302.0000,60.0000, 0.4138,-0.2837,2785.0000,192.0000, 0.3753,-0.1568,3153.0000,247.0000,-0.8017, 0.0470,7534.0000,14.0000,-0.4093, 0.2770,619.0000, 6.0000, 0.6074,-0.5501,2690.0000,252.0000,-0.6929, 0.0480,6657.0000,227.0000,-0.5275, 0.0568,5959.0000, 0.0000,-0.5938, 0.5327,163.0000,56.0000, 0.4318,-0.3468,3418.0000, 4.0000,-0.5357, 0.4684,1336.0000,246.0000, 0.4439,-0.0912,3609.0000, 0.0000,-0.5008, 0.4336,3013.0000,126.0000, 0.3753,-0.2499,1959.0000,244.0000, 0.5115,-0.0858,2703.0000,251.0000, 0.5093,-0.0679,5731.0000,253.0000,-0.7091, 0.0533,157.0000,131.0000,-0.3844, 0.1128,136.0000,249.0000,-0.6834, 0.0491};
+double cascade_default[16]      = {1, -0.75 , 2 , -0.5 , 3 ,  -0.5 , 4 , -0.25 , 10 , 0 , 20 , 0 , 30 , 0 , 30 , 0};
+double scalingbox_default[3]    = {2 , 1.4 , 1.8};
+double mergingbox_default[3]    = {1/2 , 1/2 , 0.8};
+
+#ifndef NO_MEXFUNCTION
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 {
 	unsigned char *I;
@@ -292,11 +310,6 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	int numdimsI , Tcascade = 0;
 	double *D , *Dtemp=NULL , *stat;
 
-	double param_default[400]       = {4608.0000,240.0000, 1.1750,-0.6868,8396.0000, 7.0000,-1.0774, 0.6278,4717.0000,12.0000,-0.9667, 0.5909,6130.0000,223.5000, 0.7644,-0.3870,4776.0000,127.0000,-0.7657, 0.2433,5027.0000, 1.5000,-0.8168, 0.6111,2399.0000,192.0000, 0.6640,-0.3146,986.0000,240.0000, 0.6726,-0.2658,5289.0000,63.0000,-0.5540, 0.2837,1002.0000,227.5000, 0.6053,-0.2320,2571.0000,161.0000, 0.5391,-0.2587,6774.0000,46.0000,-0.5479, 0.3235,5389.0000,220.0000, 0.5034,-0.1697,986.0000,48.0000, 0.7172,-0.6259,3067.0000,234.0000,-0.7112, 0.0879,822.0000,228.0000,-0.6506, 0.0896,2411.0000,190.0000, 0.4595,-0.2182,185.0000,32.0000, 0.5747,-0.4633,4239.0000,143.0000,-0.5122, 0.1384,1309.0000,183.0000, 0.4818,-0.2120,4131.0000,64.0000,-0.4564, 0.2447,1145.0000,119.0000, 0.4988,-0.3431,2274.0000,195.0000, 0.4599,-0.2104,2753.0000,237.0000,-0.6033, 0.1039,2805.0000,24.0000, 0.6233,-0.5368,1611.0000,56.0000, 0.5743,-0.4798,5769.0000,225.0000,-0.5952, 0.0857,715.0000,128.0000, 0.4319,-0.2546,7914.0000,233.0000,-0.6488, 0.0804,2896.0000,241.0000, 0.4893,-0.1312,6555.0000,225.0000,-0.7045, 0.0771,2450.0000,14.0000, 0.6013,-0.5252,96.0000, 2.0000, 0.7296,-0.6644,1223.0000, 8.0000, 0.6591,-0.5927,308.0000, 2.0000, 0.7811,-0.7270,136.0000,207.0000,-0.5026, 0.0877,349.0000,237.0000,-0.5503, 0.0791,2164.0000,31.0000, 0.5243,-0.4402,4100.0000,157.0000, 0.3848,-0.1920,4078.0000,224.0000,-0.5150, 0.1033,2330.0000,60.0000, 0.4320,-0.3157,768.0000,252.0000,-0.8387, 0.0613,751.0000, 8.0000, 0.5779,-0.5144,1000.0000, 6.0000, 0.7844,-0.7250,74.0000, 8.0000, 0.5917,-0.5229,892.0000,191.0000, 0.3999,-0.1474,7986.0000,64.0000,-0.3796, 0.2177,2667.0000,48.0000, 0.4651,-0.3600,6691.0000,191.0000, 0.4077,-0.1707,2153.0000,63.0000,-0.3979, 0.2135,7633.0000,56.0000, 0.4288,-0.3232,6274.0000,68.0000,-0.3929, 0.2427,3818.0000,63.0000,-0.3822, 0.1872,586.0000,239.0000, 0.4054,-0.1366,3901.0000, 8.0000, 0.5937,-0.5174,238.0000,229.0000, 0.4361,-0.1072,2825.0000,95.0000,-0.3792, 0.2139,2031.0000,193.0000, 0.4069,-0.1689,2577.0000,143.0000,-0.4686, 0.1123,326.0000,55.0000, 0.4383,-0.3149,4119.0000,24.0000, 0.5279,-0.4414,928.0000,246.0000,-0.5931, 0.0655,2411.0000,227.0000,-0.5046, 0.0793,2334.0000,10.0000, 0.5918,-0.5350,2362.0000,11.0000, 0.5816,-0.5155,424.0000,25.0000, 0.4660,-0.3772,3088.0000,211.5000,-0.4360, 0.0976,2408.0000,26.0000, 0.5043,-0.4183,316.0000,223.0000, 0.3862,-0.1356,263.0000, 6.0000, 0.5788,-0.5087,2157.0000,227.0000,-0.5186, 0.0681,6581.0000,12.0000, 0.5558,-0.4945,1197.0000,227.0000,-0.4703, 0.0799,402.0000, 0.0000, 0.7701,-0.7340,2814.0000,12.0000, 0.5069,-0.4388,5812.0000,246.0000, 0.3962,-0.1081,197.0000,31.0000,-0.3743, 0.2453,2135.0000,12.0000, 0.5345,-0.4676,608.0000,249.0000,-0.7812, 0.0486,74.0000,62.0000,-0.3577, 0.2071,74.0000,193.0000, 0.3861,-0.1436,6545.0000,253.0000, 0.5373,-0.0608,302.0000,60.0000, 0.4138,-0.2837,2785.0000,192.0000, 0.3753,-0.1568,3153.0000,247.0000,-0.8017, 0.0470,7534.0000,14.0000,-0.4093, 0.2770,619.0000, 6.0000, 0.6074,-0.5501,2690.0000,252.0000,-0.6929, 0.0480,6657.0000,227.0000,-0.5275, 0.0568,5959.0000, 0.0000,-0.5938, 0.5327,163.0000,56.0000, 0.4318,-0.3468,3418.0000, 4.0000,-0.5357, 0.4684,1336.0000,246.0000, 0.4439,-0.0912,3609.0000, 0.0000,-0.5008, 0.4336,3013.0000,126.0000, 0.3753,-0.2499,1959.0000,244.0000, 0.5115,-0.0858,2703.0000,251.0000, 0.5093,-0.0679,5731.0000,253.0000,-0.7091, 0.0533,157.0000,131.0000,-0.3844, 0.1128,136.0000,249.0000,-0.6834, 0.0491};
-	double cascade_default[16]      = {1, -0.75 , 2 , -0.5 , 3 ,  -0.5 , 4 , -0.25 , 10 , 0 , 20 , 0 , 30 , 0 , 30 , 0};
-	double scalingbox_default[3]    = {2 , 1.4 , 1.8};
-	double mergingbox_default[3]    = {1/2 , 1/2 , 0.8};
-
 	mxArray *mxtemp;	    
 	int i , Ny , Nx , powN  = 256 , nD = 0 , tempint , r = 5;
 	double *tmp;
@@ -742,6 +755,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		mxFree(detector.cascade);
 	}
 }
+#endif
 
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 
@@ -753,7 +767,7 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 {
 	double *scalingbox = detector.scalingbox , *mergingbox = detector.mergingbox;
 	double *D , *Draw;
-	unsigned int *II , *Itemp;
+	unsigned int *II;
 	double *possize;
 	int *indexsize;
 
@@ -761,24 +775,22 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 	double overlap_same = mergingbox[0] , overlap_diff = mergingbox[1] , dist_ini = mergingbox[2];
 	double si , sj , sij;
 
-	int ny = detector.ny , nx = detector.nx , NyNx = Ny*Nx , postprocessing = detector.postprocessing;
+	int ny = detector.ny , nx = detector.nx , postprocessing = detector.postprocessing;
 	int sizeDataBase = max(nx , ny), halfsizeDataBase = sizeDataBase/2 , current_sizewindow , current_stepwindow;
 	int Pos_current = detector.max_detections, Pos=0 , Pos1, Negs=0 , ind = 0 , index = 0 , indi , indj,minN = min(Ny,Nx);
 #ifdef OMP 
     int num_threads = detector.num_threads;
 #endif
-	int i , j , l , m ;
-	int yest , Deltay , Deltax , Ly , Lx , Offsety , Offsetx , Origy , Origx , nys, nxs , r = 5;
+	int i , j , l , m , k ;
+	int Deltay , Deltax , Ly , Lx , Offsety , Offsetx , Origy , Origx , nys, nxs , r = 5;
+	int Ny1 = Ny + 1 , NyNx1 = Ny1*(Nx + 1) , nwin , Lblock , nblock , l0 , l1 , nb;
+	int *yestwin , *base , *win , *off;
+	double *fxwin , *sum , *sum_total , *zs;
 
 	double tempx , tempy, scale , powScaleInc , dsizeDataBase = (double) sizeDataBase;
-	double tmp , nb_detect_total , nb_detect , nb_detect1, Xinf, Yinf, Xsup, Ysup , fx;
-
-#ifdef matfx
-	int indOrigx;
-#endif
+	double tmp , nb_detect_total , nb_detect , nb_detect1, Xinf, Yinf, Xsup, Ysup;
 
-	II                              = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	Itemp                           = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+	II                              = (unsigned int *) malloc(NyNx1*sizeof(unsigned int));
 	Draw                            = (double *) malloc(r*Pos_current*sizeof(double));
 
 #ifdef OMP 
@@ -786,8 +798,9 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
     omp_set_num_threads(num_threads);
 #endif
 
+	/* Integral image is zero-padded ((Ny+1) x (Nx+1)) so that any block sum is 4 loads without border tests */
 
-	MakeIntegralImage(I , II , Nx , Ny , Itemp);
+	MakeIntegralImagePad(I , II , Nx , Ny);
 
 	current_sizewindow              = halfsizeDataBase*Round(2.0*scale_ini);	
 	current_stepwindow              = Round(step_ini*scale_ini);
@@ -810,36 +823,66 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 		Lx         = max(1 , (int) (floor(((Nx - nxs)/(double) Deltax))) + 1);
 		Offsetx    = max(0 , (int)( floor(Nx - ( (Lx-1)*Deltax + nxs + 1)) ));
 
+		/* Subwindows are evaluated by blocks of Lblock columns (about MBLBP_BATCH windows) with early-reject compaction */
+
+		nwin       = Lx*Ly;
+		Lblock     = max(1 , MBLBP_BATCH/Ly);
+		nblock     = (Lx + Lblock - 1)/Lblock;
+		yestwin    = (int *) malloc(nwin*sizeof(int));
+		fxwin      = (double *) malloc(nwin*sizeof(double));
+
 #ifdef OMP 
-#ifdef matfx
-#pragma omp parallel for default(none) private(m,Origy,yest,fx,index,l,Origx,indOrigx) shared(fxmat,Pos,Negs,Pos_current,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Draw,II,Ny,r,scale,current_sizewindow,detector) 
-#else
-#pragma omp parallel for default(none) private(m,Origy,yest,fx,index,l,Origx) shared(Pos,Negs,Pos_current,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Draw,II,Ny,r,scale,current_sizewindow,detector) 
+#pragma omp parallel default(none) private(k,l,m,l0,l1,nb,base,win,off,sum,sum_total,zs) shared(nblock,Lblock,Lx,Ly,Offsetx,Offsety,Deltax,Deltay,Ny1,II,scale,detector,yestwin,fxwin) 
 #endif
+		{
+			nb         = Lblock*Ly;
+			base       = (int *) malloc(nb*sizeof(int));
+			win        = (int *) malloc(nb*sizeof(int));
+			off        = (int *) malloc(16*sizeof(int));
+			sum        = (double *) malloc(nb*sizeof(double));
+			sum_total  = (double *) malloc(nb*sizeof(double));
+			zs         = (double *) malloc(nb*sizeof(double));
+
+#ifdef OMP 
+#pragma omp for schedule(dynamic,1) nowait
 #endif
+			for(k = 0 ; k < nblock ; k++)
+			{
+				l0     = k*Lblock;
+				l1     = min(Lx , l0 + Lblock);
+				nb     = 0;
+				for(l = l0 ; l < l1 ; l++) /* Loop shift on x-axis */
+				{
+					for(m = 0 ; m < Ly ; m++)   /* Loop shift on y-axis  */
+					{
+						base[nb] = (Offsety + m*Deltay) + (Offsetx + l*Deltax)*Ny1;
+						win[nb]  = m + l*Ly;
+						nb++;
+					}
+				}
+				eval_mblbp_batch(II , Ny1 , base , win , nb , scale , detector , off , sum , sum_total , zs , fxwin , yestwin);
+			}
+			free(base);
+			free(win);
+			free(off);
+			free(sum);
+			free(sum_total);
+			free(zs);
+		}
 
-		/* Shift subwindows */
+		/* Collect raw detections in scanning order */
 
-		for(l = 0 ; l < Lx ; l++) /* Loop shift on x-axis */
+		for(l = 0 ; l < Lx ; l++)
 		{
 			Origx          = Offsetx + l*Deltax ;
-
-#ifdef matfx
-			indOrigx       = Ny*Origx;
-#endif
-
-			for(m = 0 ; m < Ly ; m++)   /* Loop shift on y-axis  */
+			for(m = 0 ; m < Ly ; m++)
 			{
 				Origy      = Offsety + m*Deltay ;				
-
-				/* Evaluate cascade in (Origy , Origx)*/
-
-				yest                      = eval_mblbp_subwindow(II , Origy , Origx , Ny , scale , detector , &fx);
-
+				k          = m + l*Ly;
 #ifdef matfx
-				fxmat[Origy + indOrigx]  += fx;
+				fxmat[Origy + Ny*Origx]  += fxwin[k];
 #endif
-				if(yest == 1) /* New raw detection  */
+				if(yestwin[k] == 1) /* New raw detection  */
 				{
 					if(Pos < Pos_current)
 					{
@@ -848,7 +891,7 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 						Draw[1 + index]           = (double)Origx;				
 						Draw[2 + index]           = (double)Origy;
 						Draw[3 + index]           = (double)current_sizewindow;
-						Draw[4 + index]           = fx;
+						Draw[4 + index]           = fxwin[k];
 						Pos++;		
 					}
 				}	
@@ -858,6 +901,8 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 				}	
 			}			
 		}
+		free(yestwin);
+		free(fxwin);
 
 		current_sizewindow        = halfsizeDataBase*Round(2.0*scale_ini*powScaleInc);	
 		current_stepwindow        = (int)ceil(step_ini*scale_ini*powScaleInc);
@@ -1142,7 +1187,6 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 
 	/* Free pointers */
 
-	free(Itemp);
 	free(II);
 	free(Draw);
 
@@ -1152,24 +1196,38 @@ double * detect_mblbp(unsigned char *I , int Ny , int Nx  , struct model detecto
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
-int eval_mblbp_subwindow(unsigned int *I , int Origy , int Origx , int Ny , double scale , struct model detector  , double *fx)
+int eval_mblbp_batch(unsigned int *II , int Ny1 , int *base , int *win , int nb , double scale , struct model detector , int *off , double *sum , double *sum_total , double *zs , double *fx , int *yest)
 {
+	/* Evaluate the cascade on nb subwindows with top-left corners base[j] in the padded integral image.
+	   Each stage runs over the dense array of surviving windows which is compacted before the next stage.
+	   Results are written in fx[win[j]] and yest[win[j]]. Return the number of windows passing the cascade */
+
 	double   *param = detector.param , *cascade = detector.cascade;
 	unsigned int *F = detector.F;
 	unsigned char *map = detector.map;
 	int Ncascade = detector.Ncascade, weaklearner = detector.weaklearner , cascade_type = detector.cascade_type;
 	double epsi = detector.epsi;
-	int xc , yc , xnw , ynw , xse , yse , w , h;
-	unsigned int Ac ;
-	unsigned char valF , z;
-	double sum , sum_total = 0.0, a , b , th , thresh;
-	int c , f , Tc , indc = 0 , indf = 0, idxF;
+	int xc , yc , w , h , gx , gy;
+	unsigned int Ac , *IIb , v[16];
+	unsigned char valF;
+	double a , b , th , thresh;
+	int c , f , j , n = nb , nn , Tc , indc = 0 , indf = 0, idxF;
+
+	for(j = 0 ; j < n ; j++)
+	{
+		sum[j]         = 0.0;
+		sum_total[j]   = 0.0;
+	}
 
-	for (c = 0 ; c < Ncascade ; c++)
+	for (c = 0 ; (c < Ncascade) && (n > 0) ; c++)
 	{
 		Tc     = (int) cascade[0 + indc];		
 		thresh = cascade[1 + indc];
-		sum    = 0.0;
+		for(j = 0 ; j < n ; j++)
+		{
+			sum[j]     = 0.0;
+		}
+
 		for (f = 0 ; f < Tc ; f++)
 		{
 			idxF  = ((int) param[0 + indf] - 1)*5;
@@ -1177,91 +1235,126 @@ int eval_mblbp_subwindow(unsigned int *I , int Origy , int Origx , int Ny , doub
 			a     = param[2 + indf];
 			b     = param[3 + indf];
 
-			xc    = Round(scale*(F[1 + idxF])) + Origx;
-			yc    = Round(scale*(F[2 + idxF])) + Origy;
+			xc    = Round(scale*(F[1 + idxF]));
+			yc    = Round(scale*(F[2 + idxF]));
 
 			w     = Round(scale*F[3 + idxF]);
 			h     = Round(scale*F[4 + idxF]);
 
-			xnw   = xc - w;
-			ynw   = yc - h;
-			xse   = xc + w;
-			yse   = yc + h;
-
-			Ac    = Area(I , xc  , yc  , w , h , Ny);
+			/* 4 x 4 lattice of corners of the 3 x 3 blocks, decoded once for the whole batch */
 
-			valF  = 0;
-			if(Area(I , xnw , ynw , w , h , Ny) > Ac)
+			for(gx = 0 ; gx < 4 ; gx++)
 			{
-				valF |= 0x01;
-			}
-			if(Area(I , xc  , ynw , w , h , Ny) > Ac)
-			{
-				valF |= 0x02;
-			}
-			if(Area(I , xse , ynw , w , h , Ny) > Ac)
-			{
-				valF |= 0x04;				
-			}
-			if(Area(I , xse , yc  , w , h , Ny) > Ac)
-			{
-				valF |= 0x08;		
-			}
-			if(Area(I , xse , yse , w , h , Ny) > Ac)
-			{
-				valF |= 0x10;
-			}
-			if(Area(I , xc  , yse , w , h , Ny) > Ac)
-			{
-				valF |= 0x20;
-			}
-			if(Area(I , xnw , yse , w , h , Ny) > Ac)
-			{
-				valF |= 0x40;
+				for(gy = 0 ; gy < 4 ; gy++)
+				{
+					off[gy + 4*gx] = (yc - h + gy*h) + (xc - w + gx*w)*Ny1;
+				}
 			}
-			if(Area(I , xnw , yc  , w , h , Ny) > Ac)
+
+			for(j = 0 ; j < n ; j++)
 			{
-				valF |= 0x80;
+				IIb   = II + base[j];
+				for(gx = 0 ; gx < 16 ; gx++)
+				{
+					v[gx]  = IIb[off[gx]];
+				}
+
+				Ac    = v[10] - (v[9] + v[6]) + v[5];
+
+				valF  = 0;
+				if((v[5] - (v[4] + v[1]) + v[0]) > Ac)       /* (xnw , ynw) */
+				{
+					valF |= 0x01;
+				}
+				if((v[9] - (v[8] + v[5]) + v[4]) > Ac)       /* (xc  , ynw) */
+				{
+					valF |= 0x02;
+				}
+				if((v[13] - (v[12] + v[9]) + v[8]) > Ac)     /* (xse , ynw) */
+				{
+					valF |= 0x04;				
+				}
+				if((v[14] - (v[13] + v[10]) + v[9]) > Ac)    /* (xse , yc)  */
+				{
+					valF |= 0x08;		
+				}
+				if((v[15] - (v[14] + v[11]) + v[10]) > Ac)   /* (xse , yse) */
+				{
+					valF |= 0x10;
+				}
+				if((v[11] - (v[10] + v[7]) + v[6]) > Ac)     /* (xc  , yse) */
+				{
+					valF |= 0x20;
+				}
+				if((v[7] - (v[6] + v[3]) + v[2]) > Ac)       /* (xnw , yse) */
+				{
+					valF |= 0x40;
+				}
+				if((v[6] - (v[5] + v[2]) + v[1]) > Ac)       /* (xnw , yc)  */
+				{
+					valF |= 0x80;
+				}
+				zs[j]        = (double) map[valF];
 			}
-			z        = map[valF];
 
 			if(weaklearner == 0)			
 			{
-				sum    += (a*( z > th ) + b);	
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += (a*( zs[j] > th ) + b);	
+				}
 			}
 			else if(weaklearner == 1)
 			{
-				sum    += ((2.0/(1.0 + exp(-2.0*epsi*(th*z + b)))) - 1.0);	
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += ((2.0/(1.0 + exp(-2.0*epsi*(th*zs[j] + b)))) - 1.0);	
+				}
 			}
 			else if(weaklearner == 2)
 			{
-				sum    += a*sign(z - th);	
+				for(j = 0 ; j < n ; j++)
+				{
+					sum[j]    += a*sign(zs[j] - th);	
+				}
 			}
 			indf      += 4;		
 		}
-		sum_total     += sum;
 
-		if((sum_total < thresh) && (cascade_type == 1))		
-		{
-			fx[0]     = sum_total;
-			return 0;
-		}
-		else if((sum < thresh) && (cascade_type == 0))	
+		/* Early-reject compaction */
+
+		nn     = 0;
+		for(j = 0 ; j < n ; j++)
 		{
-			fx[0]     = sum;
-			return 0;
+			sum_total[j]      += sum[j];
+			if((sum_total[j] < thresh) && (cascade_type == 1))		
+			{
+				fx[win[j]]     = sum_total[j];
+				yest[win[j]]   = 0;
+			}
+			else if((sum[j] < thresh) && (cascade_type == 0))	
+			{
+				fx[win[j]]     = sum[j];
+				yest[win[j]]   = 0;
+			}
+			else
+			{
+				base[nn]       = base[j];
+				win[nn]        = win[j];
+				sum[nn]        = sum[j];
+				sum_total[nn]  = sum_total[j];
+				nn++;
+			}
 		}
+		n          = nn;
 		indc      += 2; 
 	}
-	if(cascade_type == 1 )
-	{
-		fx[0]     = sum_total;	
-	}
-	else if(cascade_type == 0 )
+	for(j = 0 ; j < n ; j++)
 	{
-		fx[0]     = sum;	
+		fx[win[j]]     = (cascade_type == 1) ? sum_total[j] : sum[j];
+		yest[win[j]]   = 1;
 	}
-	return 1;
+	return n;
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void mblbp_featlist(int ny , int nx , unsigned int *F)
@@ -1302,64 +1395,28 @@ int number_mblbp_features(int ny , int nx)
 
 	return nF;
 }/*----------------------------------------------------------------------------------------------------------------------------------------------*/
-void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagePad(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-	int x , y , indx = 0;
+	/* Integral image of size ((iYmax+1) x (iXmax+1)) with a zero first row and first column */
 
-	for(x=0 ; x<iXmax ; x++)
-	{
-		pTemp[indx]     = (unsigned int)pIn[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
-	pOut[0]             = (unsigned int)pIn[0];
-	indx                = iYmax;
-
-	for(x=1 ; x<iXmax ; x++)
-	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
+	int x , y , iYmax1 = iYmax + 1 , indx = 0 , indx1 = iYmax1;
+	unsigned int colsum;
+	
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pOut[y]         = pOut[y - 1] + (unsigned int)pIn[y];
+		pOut[y]         = 0;
 	}
-	/* Calculate integral image */
-
-	indx                = iYmax;
-	for(x = 1 ; x < iXmax ; x++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		for(y = 1 ; y < iYmax ; y++)
+		colsum          = 0;
+		pOut[indx1]     = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int)pIn[y + indx];		
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			colsum                 += (unsigned int) pIn[y + indx];
+			pOut[y + 1 + indx1]     = pOut[y + 1 + indx1 - iYmax1] + colsum;
 		}
-		indx += iYmax;
-	}
-}
-/*----------------------------------------------------------------------------------------------------------------------------------------------*/
-unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
-{	
-	int h1 = h-1 , w1 = w-1 , x1 = x-1, y1 = y-1;
-	if( (x == 0) && (y==0))
-	{
-		return (II[h1 + w1*Ny]);	
-	}
-	if( (x==0) ) 
-	{
-		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);
-	}
-	if( (y==0) )
-	{
-		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);
-	}
-	else
-	{	
-		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);
+		indx           += iYmax;
+		indx1          += iYmax1;
 	}
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
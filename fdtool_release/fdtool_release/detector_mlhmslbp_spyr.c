@@ -104,6 +104,11 @@ If compiled with the "OMP" compilation flag
 
   mex -v -DOMP -Dmatfx -f mexopts_intel10.bat detector_mlhmslbp_spyr.c "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_core.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_c.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_thread.lib" "C:\Program Files\Intel\Compiler\C++\10.1.013\IA32\lib\libiomp5md.lib"
 
+  With -DNO_MEXFUNCTION, mex.h and mexFunction are left out and the file can be
+  included in plain C code calling detector_mlhmslbp_spyr directly (see Drowsiness_C).
+  The including code may define STAGE_BEGIN(stage)/STAGE_END(stage) to time the
+  INTEGRAL, LBP, SCAN and MERGE stages of the detector (empty by default).
+
 
   Example 1
   ---------
@@ -466,7 +471,11 @@ plot(1:size(HI,1) , H(: , 1) , 1:size(HI,1) , H1(: , 1) , 'r' , 1:size(HI,1) , H
 
 
 #include <math.h>
+#ifndef NO_MEXFUNCTION
 #include <mex.h>
+#else
+#include <stdlib.h>
+#endif
 
 #ifdef OMP 
  #include <omp.h>
@@ -486,6 +495,11 @@ plot(1:size(HI,1) , H(: , 1) , 1:size(HI,1) , H1(: , 1) , 'r' , 1:size(HI,1) , H
 #define MAX_THREADS 64
 #endif
 
+#ifndef STAGE_BEGIN
+#define STAGE_BEGIN(stage)
+#define STAGE_END(stage)
+#endif
+
 struct model
 {
 	double         *w;
@@ -544,6 +558,7 @@ double * detector_mlhmslbp_spyr(unsigned char * , int  , int  , struct model  ,
 #endif
 
 /*-------------------------------------------------------------------------------------------------------------- */
+#ifndef NO_MEXFUNCTION
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 {
 	unsigned char *I;
@@ -1213,6 +1228,8 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	}
 }
 
+#endif
+
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 #ifdef matfx
 double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct model detector , int *nD , double *stat , double *fxmat)
@@ -1310,7 +1327,7 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 	NbinsnscalenH                   = Nbinsnscale*nH;
 
 	IIR                             = (unsigned int *) malloc(NyNx*Nbinsnscale*sizeof(unsigned int));
-	R                               = (unsigned char *) malloc(NyNx*Nbinsnscale*sizeof(unsigned char));
+	R                               = (unsigned char *) calloc(NyNx*Nbinsnscale , sizeof(unsigned char)); /* compute_mblbp only sets the ones */
 	II                              = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 	Draw                            = (double *) malloc(r*Pos_current*sizeof(double));
 	table                           = (unsigned int *) malloc((powN*(improvedLBP+1))*sizeof(unsigned int));
@@ -1430,6 +1447,7 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 	}
 
 
+	STAGE_BEGIN(INTEGRAL);
 #ifdef OMP	
 	Itemp                          = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 #endif
@@ -1439,7 +1457,9 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 #ifdef OMP	
 	free(Itemp);
 #endif
+	STAGE_END(INTEGRAL);
 
+	STAGE_BEGIN(LBP);
 	compute_mblbp(II , table , detector , Ny , Nx , Nbins , R);
 
 #ifdef OMP 
@@ -1462,7 +1482,9 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 #else
 #endif
 	}
+	STAGE_END(LBP);
 
+	STAGE_BEGIN(SCAN);
 	current_sizewindow              = halfsizeDataBase*Round(2.0*scale_ini);	
 	current_stepwindow              = Round(step_ini*scale_ini);
 	powScaleInc                     = scale_inc;
@@ -1553,6 +1575,9 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 		current_stepwindow        = (int)ceil(step_ini*scale_ini*powScaleInc);
 		powScaleInc              *= scale_inc; 
 	}
+	STAGE_END(SCAN);
+
+	STAGE_BEGIN(MERGE);
 	if(postprocessing == 0) 
 	{
 		nD[0]    = Pos;
@@ -1799,6 +1824,7 @@ double * detector_mlhmslbp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 		free(possize);
 		free(indexsize);
 	}
+	STAGE_END(MERGE);
 
 	free(IIR);
 	free(R);
@@ -1310,7 +1310,7 @@ double * detector_mlhmslgp_spyr(unsigned char *I , int Ny , int Nx  , struct mod
 	NbinsnscalenH                   = Nbinsnscale*nH;
 
 	IIR                             = (unsigned int *) malloc(NyNx*Nbinsnscale*sizeof(unsigned int));
-	R                               = (unsigned char *) malloc(NyNx*Nbinsnscale*sizeof(unsigned char));
+	R                               = (unsigned char *) calloc(NyNx*Nbinsnscale , sizeof(unsigned char)); /* compute_mblgp only sets the ones */
 	II                              = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 	Draw                            = (double *) malloc(r*Pos_current*sizeof(double));
 	table                           = (unsigned int *) malloc((powN*(improvedLGP+1))*sizeof(unsigned int));
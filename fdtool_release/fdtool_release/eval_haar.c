@@ -180,6 +180,10 @@
     #define min(a,b) (a <= b ? a : b)
 #endif
 
+#ifndef HAAR_BATCH
+#define HAAR_BATCH 256
+#endif
+
 #define sign(a)    ((a) >= (0) ? (1.0) : (-1.0))
  
 struct model
@@ -206,9 +210,7 @@ struct model
 
 int number_haar_features(int , int , double * , int );
 void haar_featlist(int , int , double * , int  , unsigned int * );
-unsigned int Area(unsigned int * , int , int , int , int , int );
-double haar_feat(unsigned int *  , int  , double * , unsigned int * , int , int , int );
-void MakeIntegralImage(unsigned char *, unsigned int *, int , int , unsigned int *);
+void MakeIntegralImagePad(unsigned char *, unsigned int *, int , int );
 void eval_haar(unsigned char * , int , int , int , struct model , double * , double *);
 
 /*-------------------------------------------------------------------------------------------------------------- */
@@ -348,7 +350,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		else		
 		{
 			detector.nF                    = number_haar_features(Ny , Nx , detector.rect_param , detector.nR);
-			detector.F                     = (unsigned int *)mxMalloc(5*detector.nF*sizeof(unsigned int));
+			detector.F                     = (unsigned int *)mxMalloc(6*detector.nF*sizeof(unsigned int));
 			haar_featlist(Ny , Nx , detector.rect_param , detector.nR , detector.F);	
 		}
 
@@ -430,7 +432,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		}			
 
 		detector.nF                    = number_haar_features(Ny , Nx , detector.rect_param , detector.nR);
-		detector.F                     = (unsigned int *)mxMalloc(5*detector.nF*sizeof(unsigned int));
+		detector.F                     = (unsigned int *)mxMalloc(6*detector.nF*sizeof(unsigned int));
 		haar_featlist(Ny , Nx , detector.rect_param , detector.nR , detector.F);	
 
 		detector.cascade                = (double *)mxMalloc(2*sizeof(double));
@@ -449,7 +451,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 
     /*------------------------ Main Call ----------------------------*/
 	
-	eval_haar(I , Ny , Ny , V , detector  , fx , y);
+	eval_haar(I , Ny , Nx , V , detector  , fx , y);
 	
 	/*--------------------------- Free memory -----------------------*/
 	
@@ -483,156 +485,188 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void eval_haar(unsigned char *I , int Ny , int Nx , int V , struct model detector , double *fx , double *y)			   
 {
+	/* Samples are processed by batches of HAAR_BATCH. Each stage runs over the dense array of surviving samples
+	   which is compacted before the next stage, so later stages only touch the few samples still alive */
+
     double   *param = detector.param , *rect_param = detector.rect_param , *cascade = detector.cascade;
-    unsigned int  *II , *Itemp , tempI;
-	unsigned int*F = detector.F;
+    unsigned int  *II , *IIb , tempI;
+	unsigned int *F = detector.F;
 	int weaklearner = detector.weaklearner , Ncascade = detector.Ncascade;
-	int nR = detector.nR , nF = detector.nF , cascade_type = detector.cascade_type , standardize = detector.standardize;
+	int nR = detector.nR , cascade_type = detector.cascade_type , standardize = detector.standardize;
 	double epsi = detector.epsi;	
-	double z , sum , sum_total , a , b , th , thresc;
-	int i , v , c , f , Tc , NyNx = Ny*Nx , indNyNx = 0 , indf , indc  , idxF , last = NyNx - 1;
-	double  var  , mean , std , cteNyNx = 1.0/NyNx;
+	double z , a , b , th , thresc , *std , *sum , *sum_total , *zs , *s;
+	double  var  , mean , cteNyNx = 1.0/(Ny*Nx);
+	int i , v , v0 , j , n , nn , nb , c , f , t , o , Tc , NyNx = Ny*Nx , Ny1 = Ny + 1 , NyNx1 = (Ny + 1)*(Nx + 1) , indf , indc  , idxF , last = NyNx1 - 1;
+	int xf , xr , yf , yr , w , wr , h , hr , R , indR , coeffw , coeffh , maxR = 0 , *base , *win , *off;
 	
-	II                   = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	Itemp                = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	
-	if(standardize)
+	for(i = 0 ; i < 10*nR ; i += 10)
 	{
-		for(v = 0 ; v < V ; v++)
+		maxR             = max(maxR , (int) rect_param[3 + i]);
+	}
+
+	nb                   = min(V , HAAR_BATCH);
+	II                   = (unsigned int *) malloc(nb*NyNx1*sizeof(unsigned int));
+	base                 = (int *) malloc(nb*sizeof(int));
+	win                  = (int *) malloc(nb*sizeof(int));
+	std                  = (double *) malloc(nb*sizeof(double));
+	sum                  = (double *) malloc(nb*sizeof(double));
+	sum_total            = (double *) malloc(nb*sizeof(double));
+	zs                   = (double *) malloc(nb*sizeof(double));
+	off                  = (int *) malloc(4*maxR*sizeof(int));
+	s                    = (double *) malloc(maxR*sizeof(double));
+
+	for(v0 = 0 ; v0 < V ; v0 += HAAR_BATCH)
+	{
+		n                = min(V - v0 , HAAR_BATCH);
+		for(j = 0 ; j < n ; j++)
 		{
-			MakeIntegralImage(I + indNyNx , II , Nx , Ny  , Itemp);
-			var           = 0.0;
-			y[v]          = 1.0;
-			
-			for(i = 0 ; i < NyNx ; i++)
-			{				
-				tempI      = I[i + indNyNx];		
-				var       += (tempI*tempI);	
+			v            = v0 + j;
+			base[j]      = j*NyNx1;
+			win[j]       = v;
+			sum[j]       = 0.0;
+			sum_total[j] = 0.0;
+			std[j]       = 1.0;
+			y[v]         = 1.0;
+			MakeIntegralImagePad(I + v*NyNx , II + base[j] , Nx , Ny);
+
+			if(standardize)
+			{
+				var           = 0.0;
+				for(i = v*NyNx ; i < (v + 1)*NyNx ; i++)
+				{				
+					tempI      = I[i];		
+					var       += (tempI*tempI);	
+				}
+				var          *= cteNyNx;
+				mean          = II[base[j] + last]*cteNyNx;
+				std[j]        = 1.0/sqrt(var - mean*mean);
 			}
-			
-			var          *= cteNyNx;
-			mean          = II[last]*cteNyNx;
-			std           = 1.0/sqrt(var - mean*mean);
-
-			indf          = 0;
-			indc          = 0;
-			sum_total     = 0.0;
-			for (c = 0 ; c < Ncascade ; c++)
-			{		
-				Tc     = (int) cascade[0 + indc];	
-				thresc = cascade[1 + indc];
-				sum    = 0.0;
-				for (f = 0 ; f < Tc ; f++)
+		}
+
+		indf          = 0;
+		indc          = 0;
+		for (c = 0 ; (c < Ncascade) && (n > 0) ; c++)
+		{		
+			Tc     = (int) cascade[0 + indc];	
+			thresc = cascade[1 + indc];
+			for(j = 0 ; j < n ; j++)
+			{
+				sum[j]     = 0.0;
+			}
+			for (f = 0 ; f < Tc ; f++)
+			{
+				idxF  = ((int) param[0 + indf] - 1)*6;	
+				th    =  param[1 + indf];
+				a     =  param[2 + indf];
+				b     =  param[3 + indf];
+
+				xf    = F[1 + idxF];
+				yf    = F[2 + idxF];
+				w     = F[3 + idxF];
+				h     = F[4 + idxF];
+				indR  = F[5 + idxF];
+				R     = (int) rect_param[3 + indR];
+
+				/* Decode the rectangles of the feature once for the whole batch */
+
+				o     = 0;
+				for (t = 0 ; t < R ; t++)
+				{	
+					coeffw  = w/(int)rect_param[1 + indR];	
+					coeffh  = h/(int)rect_param[2 + indR];
+					xr      = xf + coeffw*(int)rect_param[5 + indR];
+					yr      = yf + coeffh*(int)rect_param[6 + indR];
+					wr      = coeffw*(int)(rect_param[7 + indR]);
+					hr      = coeffh*(int)(rect_param[8 + indR]);
+					s[t]    = rect_param[9 + indR];
+					off[o]  = (yr + hr) + (xr + wr)*Ny1;
+					off[o+1]= yr + (xr + wr)*Ny1;
+					off[o+2]= (yr + hr) + xr*Ny1;
+					off[o+3]= yr + xr*Ny1;
+					o      += 4;
+					indR   += 10;
+				}
+
+				for(j = 0 ; j < n ; j++)
 				{
-					idxF  = ((int) param[0 + indf] - 1);	
-					z     = haar_feat(II , idxF , rect_param , F , Ny , nR , nF);
-					
-					th    =  param[1 + indf];
-					a     =  param[2 + indf];
-					b     =  param[3 + indf];
+					IIb     = II + base[j];
+					z       = 0.0;
+					o       = 0;
+					for (t = 0 ; t < R ; t++)
+					{
+						z  += s[t]*(IIb[off[o]] - (IIb[off[o+1]] + IIb[off[o+2]]) + IIb[off[o+3]]);
+						o  += 4;
+					}
+					zs[j]   = z*std[j];
+				}
 					
-					if(weaklearner == 0)						
-					{					
-						sum    += (a*( (z*std) > th ) + b);	
-					}			
-					else if(weaklearner == 1)
+				if(weaklearner == 0)						
+				{					
+					for(j = 0 ; j < n ; j++)
 					{
-						sum    += ((2.0/(1.0 + exp(-2.0*epsi*(a*(z*std) + b)))) - 1.0);	
+						sum[j]    += (a*( zs[j] > th ) + b);	
 					}
-					else if(weaklearner == 2)
-					{	
-						sum    += a*sign((z*std) - th);	
-					}	
-					indf      += 4;
 				}			
-				sum_total     += sum;
-	
-				if((sum_total < thresc) && (cascade_type == 1))			
+				else if(weaklearner == 1)
 				{
-					y[v]  = -1.0;
-					break;	
-				}
-				else if((sum < thresc) && (cascade_type == 0))	
-				{
-					y[v]  = -1.0;
-					break;	
-				}			
-				indc      += 2; 
-			}
-			if(cascade_type == 1 )
-			{
-				fx[v]     = sum_total;	
-			}
-			else if (cascade_type == 0 )
-			{
-				fx[v]     = sum;	
-			}
-			indNyNx  += NyNx;	
-		}
-	}
-	else
-	{
-		for(v = 0 ; v < V ; v++)
-		{		
-			MakeIntegralImage(I + indNyNx , II , Nx , Ny  , Itemp);	
-			indf          = 0;
-			indc          = 0;
-			sum_total     = 0.0;
-			
-			for (c = 0 ; c < Ncascade ; c++)
-			{
-				Tc     = (int) cascade[0 + indc];	
-				thresc = cascade[1 + indc];
-				sum    = 0.0;
-				
-				for (f = 0 ; f < Tc ; f++)
-				{			
-					idxF  = ((int) param[0 + indf] - 1);
-
-					z     =  haar_feat(II , idxF , rect_param , F , Ny , nR , nF);
-					th    =  param[1 + indf];
-					a     =  param[2 + indf];
-					b     =  param[3 + indf];
-
-					if(weaklearner == 0)				
-					{					
-						sum    += (a*( z > th ) + b);	
-					}			
-					else if(weaklearner == 1)
+					for(j = 0 ; j < n ; j++)
 					{
-						sum    += ((2.0/(1.0 + exp(-2.0*epsi*(a*z + b)))) - 1.0);	
+						sum[j]    += ((2.0/(1.0 + exp(-2.0*epsi*(a*zs[j] + b)))) - 1.0);	
 					}
-					else if(weaklearner == 2)
-					{			
-						sum    += a*sign(z - th);	
+				}
+				else if(weaklearner == 2)
+				{	
+					for(j = 0 ; j < n ; j++)
+					{
+						sum[j]    += a*sign(zs[j] - th);	
 					}
-					indf      += 4;	
+				}	
+				indf      += 4;
+			}			
+
+			/* Early-reject compaction */
+
+			nn     = 0;
+			for(j = 0 ; j < n ; j++)
+			{
+				sum_total[j]      += sum[j];
+				if((sum_total[j] < thresc) && (cascade_type == 1))			
+				{
+					fx[win[j]]     = sum_total[j];
+					y[win[j]]      = -1.0;
 				}
-				
-				sum_total     += sum;
-				if((sum_total < thresc) && (cascade_type == 1))
+				else if((sum[j] < thresc) && (cascade_type == 0))	
 				{
-					break;	
+					fx[win[j]]     = sum[j];
+					y[win[j]]      = -1.0;
 				}
-				else if((sum < thresc) && (cascade_type == 0))	
+				else
 				{
-					break;	
-				}	
-				indc      += 2; 
-			}		
-			if(cascade_type == 1)	
-			{
-				fx[v]     = sum_total;	
-			}
-			else if (cascade_type == 0)
-			{				
-				fx[v]     = sum;	
+					base[nn]       = base[j];
+					win[nn]        = win[j];
+					std[nn]        = std[j];
+					sum[nn]        = sum[j];
+					sum_total[nn]  = sum_total[j];
+					nn++;
+				}
 			}
-			indNyNx  += NyNx;	
-		}	
+			n          = nn;
+			indc      += 2; 
+		}
+		for(j = 0 ; j < n ; j++)
+		{
+			fx[win[j]]     = (cascade_type == 1) ? sum_total[j] : sum[j];
+		}
 	}
 	free(II);
-	free(Itemp);
+	free(base);
+	free(win);
+	free(std);
+	free(sum);
+	free(sum_total);
+	free(zs);
+	free(off);
+	free(s);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void haar_featlist(int ny , int nx , double *rect_param , int nR , unsigned int *F )
@@ -697,92 +731,28 @@ int number_haar_features(int ny , int nx , double *rect_param , int nR)
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------------*/
-void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagePad(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-	int x , y , indx = 0;
+	/* Integral image of size ((iYmax+1) x (iXmax+1)) with a zero first row and first column */
+
+	int x , y , iYmax1 = iYmax + 1 , indx = 0 , indx1 = iYmax1;
+	unsigned int colsum;
 	
-	for(x=0 ; x<iXmax ; x++)
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pTemp[indx]     = (unsigned int) pIn[indx];	
-		indx           += iYmax;
+		pOut[y]         = 0;
 	}
-	for(y = 1 ; y<iYmax ; y++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
-	pOut[0]             = (unsigned int) pIn[0];
-	indx                = iYmax;
-	for(x=1 ; x<iXmax ; x++)
-	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pOut[y]         = pOut[y - 1] + (unsigned int) pIn[y];
-	}
-	
-	/* Calculate integral image */
-
-	indx                = iYmax;
-	for(x = 1 ; x < iXmax ; x++)
-	{
-		for(y = 1 ; y < iYmax ; y++)
+		colsum          = 0;
+		pOut[indx1]     = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int) pIn[y + indx];		
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			colsum                 += (unsigned int) pIn[y + indx];
+			pOut[y + 1 + indx1]     = pOut[y + 1 + indx1 - iYmax1] + colsum;
 		}
-		indx += iYmax;
-	}
-}
-/*----------------------------------------------------------------------------------------------------------------------------------------------*/
-unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
-{
-	int h1 = h-1, w1 = w-1 , x1 = x-1, y1 = y-1;
-	if( (x == 0) && (y==0))
-	{
-		return (II[h1 + w1*Ny]);	
-	}
-	if( x==0 )
-	{
-		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);	
-	}
-	if( y==0 )
-	{	
-		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);		
-	}
-	else
-	{	
-		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);	
-	}
-}
-/*----------------------------------------------------------------------------------------------------------------------------------------- */
-double haar_feat(unsigned int *II , int featidx , double *rect_param , unsigned int *F , int Ny , int nR , int nF)
-{
-	int x , xr , y , yr , w , wr , h , hr , r ,  R , indR , indF = featidx*6;
-	int coeffw , coeffh;
-	double val = 0.0 , s;
-
-	x     = F[1 + indF];
-	y     = F[2 + indF];
-	w     = F[3 + indF];
-	h     = F[4 + indF];
-	indR  = F[5 + indF];
-	R     = (int) rect_param[3 + indR];
-
-	for (r = 0 ; r < R ; r++)
-	{	
-		coeffw  = w/(int)rect_param[1 + indR];	
-		coeffh  = h/(int)rect_param[2 + indR];
-		xr      = x + coeffw*(int)rect_param[5 + indR];
-		yr      = y + coeffh*(int)rect_param[6 + indR];
-		wr      = coeffw*(int)(rect_param[7 + indR]);
-		hr      = coeffh*(int)(rect_param[8 + indR]);
-		s       = rect_param[9 + indR];
-		val    += s*Area(II , xr  , yr  , wr , hr , Ny);
-		indR   += 10;
+		indx           += iYmax;
+		indx1          += iYmax1;
 	}
-	return val;		
 }
 /*---------------------------------------------------------------------------------------------------------------------------------------------- */
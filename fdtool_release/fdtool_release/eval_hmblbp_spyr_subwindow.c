@@ -11,7 +11,7 @@
   Inputs
   -------
 
-  I                                     Input image (Ny x Nx) in UINT8 format
+  I                                     Input image (Ny x Nx) or images (Ny x Nx x N) in UINT8 format
   
   model                                 Trained model structure
 
@@ -53,11 +53,11 @@
   Outputs
   -------
   
-  fx                                    Predicted value for image I 
-  y                                     Predicted label, i.e. y = sign(fx)
-  H                                     Histogram of MBLBP computed for image I through fast Histogram Integral ((1+improvedLBP)*Nbins*nH*nscale) x 1)
-  IIR                                   Integral Images for each bin and scale (Ny x Nx x(1+improvedLBP)*Nbins*nscale) in UINT32 format
-  R                                     MBLBP maps per bin value (Ny x Nx x(1+improvedLBP)*Nbins*nscale) in UINT8 format
+  fx                                    Predicted value for image I (1 x N)
+  y                                     Predicted label, i.e. y = sign(fx) (1 x N)
+  H                                     Histogram of MBLBP computed for image I through fast Histogram Integral ((1+improvedLBP)*Nbins*nH*nscale) x N)
+  IIR                                   Integral Images for each bin and scale (Ny x Nx x(1+improvedLBP)*Nbins*nscale) in UINT32 format (empty if N > 1)
+  R                                     MBLBP maps per bin value (Ny x Nx x(1+improvedLBP)*Nbins*nscale) in UINT8 format (empty if N > 1)
 
   To compile
   ----------
@@ -368,7 +368,7 @@ void compute_mblbp(unsigned int * , unsigned int * , struct model , int , int ,
 int eval_hmblbp_spyr_subwindow(unsigned int * , double * , int , int , int , int , double  , struct model   , double *);
 int eval_hmblbp_spyr_subwindow_hom(unsigned int * , double * , int , int , int , int , double  , struct model   , double *);
 void homkertable(struct model  , double * );
-void eval_hmblbp_spyr(unsigned char * , int , int , struct model , double * , double *, double *, unsigned int * , unsigned char *);
+void eval_hmblbp_spyr(unsigned char * , int , int , int , struct model , double * , double *, double *, unsigned int * , unsigned char *);
 /*-------------------------------------------------------------------------------------------------------------- */
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 {
@@ -382,7 +382,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	unsigned char *R;
 	double norm_default[3] = {0 , 0 , 4};
 	mxArray *mxtemp;	    
-	int Ny , Nx , tempint , Nbins = 256 , i;
+	int Ny , Nx , N = 1 , tempint , Nbins = 256 , i;
 	double *tmp;
 	double temp;
 
@@ -419,7 +419,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	numdimsI             = mxGetNumberOfDimensions(prhs[0]);
 	if( (numdimsI > 2) && !mxIsUint8(prhs[0]) )
 	{  
-		mexErrMsgTxt("I must be (Ny x Nx) in UINT8 format");   
+		mexErrMsgTxt("I must be (Ny x Nx x N) in UINT8 format");   
 	}
 
 	I           = (unsigned char *)mxGetData(prhs[0]); 
@@ -427,6 +427,10 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 
 	Ny          = dimsI[0];  
 	Nx          = dimsI[1];
+	if(numdimsI > 2)
+	{
+		N       = dimsI[2];
+	}
 
 	/* Input 2  */
 
@@ -822,18 +826,27 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	}
 
 
-	plhs[0]                            = mxCreateDoubleMatrix(1 , 1 , mxREAL);
+	plhs[0]                            = mxCreateDoubleMatrix(1 , N , mxREAL);
 	fx                                 = mxGetPr(plhs[0]);
 
-	plhs[1]                            = mxCreateDoubleMatrix(1 , 1 , mxREAL);
+	plhs[1]                            = mxCreateDoubleMatrix(1 , N , mxREAL);
 	y                                  = mxGetPr(plhs[1]);
 
-	plhs[2]                            = mxCreateDoubleMatrix(detector.Nbins*detector.nH*detector.nscale , 1 , mxREAL);
+	plhs[2]                            = mxCreateDoubleMatrix(detector.Nbins*detector.nH*detector.nscale , N , mxREAL);
 	H                                  = mxGetPr(plhs[2]);
 
-	dimsR[0]                           = Ny;
-	dimsR[1]                           = Nx;
-	dimsR[2]                           = detector.Nbins*detector.nscale;
+	if(N == 1)
+	{
+		dimsR[0]                       = Ny;
+		dimsR[1]                       = Nx;
+		dimsR[2]                       = detector.Nbins*detector.nscale;
+	}
+	else
+	{
+		dimsR[0]                       = 0;
+		dimsR[1]                       = 0;
+		dimsR[2]                       = 0;
+	}
 
 	plhs[3]                            = mxCreateNumericArray(3 , dimsR , mxUINT32_CLASS , mxREAL);
 	IIR                                = (unsigned int *)mxGetPr(plhs[3]);
@@ -844,7 +857,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 
 	/*------------------------ Main Call ----------------------------*/
 
-	eval_hmblbp_spyr(I , Ny , Nx  , detector , y , fx , H , IIR , R);
+	eval_hmblbp_spyr(I , Ny , Nx , N , detector , y , fx , H , IIR , R);
 
   /*--------------------------------------------------------------------- */
 
@@ -885,9 +898,10 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
-void eval_hmblbp_spyr(unsigned char *I , int Ny , int Nx  , struct model detector , double *yfx , double *fx , double *H , unsigned int *IIR , unsigned char *R)
+void eval_hmblbp_spyr(unsigned char *I , int Ny , int Nx , int N , struct model detector , double *yfx , double *fx , double *H , unsigned int *IIR , unsigned char *R)
 {
-	unsigned int *II , *Itemp;
+	unsigned int *II , *Itemp , *IIs , *Itemps , *IIRs;
+	unsigned char *Rs;
 	int nscale = detector.nscale  , nH = detector.nH;
 	int Nbins = detector.Nbins , cs_opt = detector.cs_opt;
 	int maptable = detector.maptable , improvedLBP = detector.improvedLBP , n = detector.n;
@@ -895,8 +909,8 @@ void eval_hmblbp_spyr(unsigned char *I , int Ny , int Nx  , struct model detecto
 #ifdef OMP 
     int num_threads = detector.num_threads;
 #endif
-	int i , l , m , v ;
-	int yest;
+	int i , j , l , m , v ;
+	int yest , NyNxNbinsnscale;
 	double maxfactor = 0.0;
 
 	unsigned int table_normal_8[256] = {0 , 1 , 2 , 3 , 4 , 5 , 6 , 7 , 8 , 9 , 10 , 11 , 12 , 13 , 14 , 15 , 16 , 17 , 18 , 19 , 20 , 21 , 22 , 23 , 24 , 25 , 26 , 27 , 28 , 29 , 30 , 31 , 32 , 33 , 34 , 35 , 36 , 37 , 38 , 39 , 40 , 41 , 42 , 43 , 44 , 45 , 46 , 47 , 48 , 49 , 50 , 51 , 52 , 53 , 54 , 55 , 56 , 57 , 58 , 59 , 60 , 61 , 62 , 63 , 64 , 65 , 66 , 67 , 68 , 69 , 70 , 71 , 72 , 73 , 74 , 75 , 76 , 77 , 78 , 79 , 80 , 81 , 82 , 83 , 84 , 85 , 86 , 87 , 88 , 89 , 90 , 91 , 92 , 93 , 94 , 95 , 96 , 97 , 98 , 99 , 100 , 101 , 102 , 103 , 104 , 105 , 106 , 107 , 108 , 109 , 110 , 111 , 112 , 113 , 114 , 115 , 116 , 117 , 118 , 119 , 120 , 121 , 122 , 123 , 124 , 125 , 126 , 127 , 128 , 129 , 130 , 131 , 132 , 133 , 134 , 135 , 136 , 137 , 138 , 139 , 140 , 141 , 142 , 143 , 144 , 145 , 146 , 147 , 148 , 149 , 150 , 151 , 152 , 153 , 154 , 155 , 156 , 157 , 158 , 159 , 160 , 161 , 162 , 163 , 164 , 165 , 166 , 167 , 168 , 169 , 170 , 171 , 172 , 173 , 174 , 175 , 176 , 177 , 178 , 179 , 180 , 181 , 182 , 183 , 184 , 185 , 186 , 187 , 188 , 189 , 190 , 191 , 192 , 193 , 194 , 195 , 196 , 197 , 198 , 199 , 200 , 201 , 202 , 203 , 204 , 205 , 206 , 207 , 208 , 209 , 210 , 211 , 212 , 213 , 214 , 215 , 216 , 217 , 218 , 219 , 220 , 221 , 222 , 223 , 224 , 225 , 226 , 227 , 228 , 229 , 230 , 231 , 232 , 233 , 234 , 235 , 236 , 237 , 238 , 239 , 240 , 241 , 242 , 243 , 244 , 245 , 246 , 247 , 248 , 249 , 250 , 251 , 252 , 253 , 254 , 255};
@@ -910,6 +924,12 @@ void eval_hmblbp_spyr(unsigned char *I , int Ny , int Nx  , struct model detecto
 	unsigned int table_riu2_4[16]   = {0 , 1 , 1 , 2 , 1 , 5 , 2 , 3 , 1 , 2 , 5 , 3 , 2 , 3 , 3 , 4};
 	unsigned int *table;
 
+	if(N == 0)
+	{
+		/* empty dataset : fx, y, H, IIR and R are all empty */
+		return;
+	}
+
 	Nbinsnscale                     = Nbins*nscale;
 	NbinsnscalenH                   = Nbinsnscale*nH;
 
@@ -1037,50 +1057,103 @@ void eval_hmblbp_spyr(unsigned char *I , int Ny , int Nx  , struct model detecto
 	}
 
 
+	if(N != 1)
+	{
+		/* Dataset of N images : one image per task, each thread reuses its own MBLBP maps and integral histograms, H filled column by column */
+
+		NyNxNbinsnscale              = NyNx*Nbinsnscale;
+
+#ifdef OMP 
+#pragma omp parallel default(none) private(i,j,IIs,Itemps,Rs,IIRs,yest) shared(I,H,fx,yfx,table,detector,N,Ny,Nx,NyNx,Nbins,Nbinsnscale,NbinsnscalenH,NyNxNbinsnscale,maxfactor,n)
+#endif
+		{
+			IIs                       = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+			Itemps                    = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+			IIRs                      = (unsigned int *) malloc(NyNxNbinsnscale*sizeof(unsigned int));
+			Rs                        = (unsigned char *) malloc(NyNxNbinsnscale*sizeof(unsigned char));
+
+#ifdef OMP 
+#pragma omp for schedule(dynamic,16) nowait
+#endif
+			for (j = 0 ; j < N ; j++)
+			{
+				MakeIntegralImage(I + j*NyNx , IIs , Nx , Ny , Itemps);
+
+				for (i = 0 ; i < NyNxNbinsnscale ; i++)
+				{
+					Rs[i]             = 0;
+				}
+				compute_mblbp(IIs , table , detector , Ny , Nx , Nbins , Rs);
+
+				for (i = 0 ; i < Nbinsnscale  ; i++)
+				{		
+					MakeIntegralImage(Rs + i*NyNx , IIRs + i*NyNx , Nx , Ny , Itemps);
+				}
+
+				if(n > 0)
+				{
+					yest              = eval_hmblbp_spyr_subwindow_hom(IIRs , H + j*NbinsnscalenH , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx + j);
+				}
+				else
+				{
+					yest              = eval_hmblbp_spyr_subwindow(IIRs , H + j*NbinsnscalenH , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx + j);
+				}
+				yfx[j]                = (double) yest;
+			}
+
+			free(IIs);
+			free(Itemps);
+			free(IIRs);
+			free(Rs);
+		}
+	}
+	else
+	{
 #ifdef OMP	
-	Itemp                      = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+		Itemp                      = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 #endif	
 
-	MakeIntegralImage(I , II , Nx , Ny , Itemp);
+		MakeIntegralImage(I , II , Nx , Ny , Itemp);
 
 #ifdef OMP	
-	free(Itemp);
+		free(Itemp);
 #endif
 
-	compute_mblbp(II , table , detector , Ny , Nx , Nbins , R);
+		compute_mblbp(II , table , detector , Ny , Nx , Nbins , R);
 
 #ifdef OMP 
 #pragma omp parallel default(none) private(i,Itemp) shared(R,IIR,NyNx,Nx,Ny,Nbinsnscale)
 #endif
-	{
+		{
 #ifdef OMP 
-		Itemp                   = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
+			Itemp                   = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 #else
 #endif
 #ifdef OMP 
 #pragma omp for	nowait	
 #endif
-		for (i = 0 ; i < Nbinsnscale  ; i++)
-		{		
-			MakeIntegralImage(R + i*NyNx , IIR + i*NyNx , Nx , Ny , Itemp);
-		}
+			for (i = 0 ; i < Nbinsnscale  ; i++)
+			{		
+				MakeIntegralImage(R + i*NyNx , IIR + i*NyNx , Nx , Ny , Itemp);
+			}
 #ifdef OMP
-		free(Itemp);
+			free(Itemp);
 #else
 #endif
-	}
+		}
 
-	if(n > 0)
-	{
-		yest      = eval_hmblbp_spyr_subwindow_hom(IIR , H  , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx);
-	}
-	else
-	{
-		yest      = eval_hmblbp_spyr_subwindow(IIR , H  , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx);
-	}
+		if(n > 0)
+		{
+			yest      = eval_hmblbp_spyr_subwindow_hom(IIR , H  , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx);
+		}
+		else
+		{
+			yest      = eval_hmblbp_spyr_subwindow(IIR , H  , Ny , Nx  , Nbins , NbinsnscalenH  , maxfactor , detector , fx);
+		}
 
 
-	yfx[0]    = (double) yest;
+		yfx[0]    = (double) yest;
+	}
 
 	free(II);
 	free(table);
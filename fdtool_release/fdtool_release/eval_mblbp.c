@@ -121,6 +121,10 @@ If compiled with the "OMP" compilation flag
 #define MAX_THREADS 64
 #endif
 
+#ifndef MBLBP_BATCH
+#define MBLBP_BATCH 256
+#endif
+
 #ifndef max
     #define max(a,b) (a >= b ? a : b)
     #define min(a,b) (a <= b ? a : b)
@@ -153,8 +157,7 @@ struct model
 
 int number_mblbp_features(int , int );
 void mblbp_featlist(int  , int , unsigned int *);
-void MakeIntegralImage(unsigned char *, unsigned int *, int , int , unsigned int *);
-unsigned int Area(unsigned int * , int , int , int , int , int );
+void MakeIntegralImagePad(unsigned char *, unsigned int *, int , int );
 void eval_mblbp(unsigned char * , int , int , int , struct model  , double * , double *);
 
 /*-------------------------------------------------------------------------------------------------------------- */
@@ -403,7 +406,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 
     /*------------------------ Main Call ----------------------------*/
 	
-	eval_mblbp(I , Ny , Ny , V , detector , fx , y);
+	eval_mblbp(I , Ny , Nx , V , detector , fx , y);
 	
 	/*--------------------------- Free memory -----------------------*/
 	
@@ -438,139 +441,202 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void eval_mblbp(unsigned char *I , int Ny , int Nx , int V , struct model detector, double *fx , double *y)				
 {
+	/* Samples are processed by batches of MBLBP_BATCH. Each stage runs over the dense array of surviving samples
+	   which is compacted before the next stage, so later stages only touch the few samples still alive */
+
     double   *param = detector.param , *cascade = detector.cascade;
 	unsigned char *map = detector.map;
-	unsigned int *II , *Itemp , *F = detector.F;
+	unsigned int *II , *IIb , *F = detector.F;
 	int Ncascade = detector.Ncascade , weaklearner = detector.weaklearner , cascade_type = detector.cascade_type;
 #ifdef OMP 
     int num_threads = detector.num_threads;
 #endif
 	double epsi = detector.epsi;
-	int xc , yc , xnw , ynw , xse , yse , w , h;
-	unsigned int Ac;
-	unsigned char valF , z;
-	double sum , sum_total , a , b , th , thresc;
-	int v , c , f , Tc , NyNx = Ny*Nx , indf , indc  , idxF;
+	int xc , yc , w , h , gx , gy , off[16];
+	unsigned int Ac , vc[16];
+	unsigned char valF;
+	double a , b , th , thresc , *sum , *sum_total , *zs;
+	int v0 , j , n , nn , nb , nbatch , k , c , f , Tc , NyNx = Ny*Nx , Ny1 = Ny + 1 , NyNx1 = (Ny + 1)*(Nx + 1) , indf , indc  , idxF , *base , *win;
 
 #ifdef OMP 
     num_threads       = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
     omp_set_num_threads(num_threads);
 #endif
-	
-	II                = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
-	Itemp             = (unsigned int *) malloc(NyNx*sizeof(unsigned int));
 
-	for(v = 0 ; v < V ; v++)
-	{		
-		MakeIntegralImage(I + v*NyNx , II , Nx , Ny  , Itemp);	
-		indf          = 0;
-		sum_total     = 0.0;	
-		y[v]          = 1.0;
+	nbatch            = (V + MBLBP_BATCH - 1)/MBLBP_BATCH;
 
-		for (c = 0 ; c < Ncascade ; c++)
-		{
-			indc      = c*2;
-			Tc        = (int) cascade[0 + indc];
-			thresc    = cascade[1 + indc];
-			sum       = 0.0;
+#ifdef OMP 
+#pragma omp parallel default(none) private(k,v0,j,n,nn,nb,c,f,Tc,indf,indc,idxF,th,a,b,thresc,xc,yc,w,h,gx,gy,off,Ac,vc,valF,II,IIb,base,win,sum,sum_total,zs) shared(I,V,Ny,Nx,Ny1,NyNx,NyNx1,nbatch,param,cascade,map,F,Ncascade,weaklearner,cascade_type,epsi,fx,y) 
+#endif
+	{
+		nb                = min(V , MBLBP_BATCH);
+		II                = (unsigned int *) malloc(nb*NyNx1*sizeof(unsigned int));
+		base              = (int *) malloc(nb*sizeof(int));
+		win               = (int *) malloc(nb*sizeof(int));
+		sum               = (double *) malloc(nb*sizeof(double));
+		sum_total         = (double *) malloc(nb*sizeof(double));
+		zs                = (double *) malloc(nb*sizeof(double));
 
 #ifdef OMP 
-#pragma omp parallel for default(none) private(f,idxF,th,a,b,xc,yc,w,h,xnw,ynw,xse,yse,Ac,valF,z) shared(II,Ncascade,Tc,param,F,Ny,map,weaklearner,epsi,cascade_type,sum_total,indf,sum) /* reduction (+:) */
+#pragma omp for schedule(dynamic,1) nowait
 #endif
-			for (f = 0 ; f < Tc ; f++)
+		for(k = 0 ; k < nbatch ; k++)
+		{
+			v0                = k*MBLBP_BATCH;
+			n                 = min(V - v0 , MBLBP_BATCH);
+			for(j = 0 ; j < n ; j++)
 			{
-				idxF  = ((int) param[0 + indf] - 1)*5;
-				th    = param[1 + indf];
-				a     = param[2 + indf];
-				b     = param[3 + indf];
-
-				xc    = F[1 + idxF];
-				yc    = F[2 + idxF];
-				w     = F[3 + idxF];
-				h     = F[4 + idxF];
-
-				xnw   = xc - w;
-				ynw   = yc - h;
-				xse   = xc + w;
-				yse   = yc + h;
-
-				Ac    = Area(II , xc  , yc  , w , h , Ny);
+				base[j]       = j*NyNx1;
+				win[j]        = v0 + j;
+				sum[j]        = 0.0;
+				sum_total[j]  = 0.0;
+				y[v0 + j]     = 1.0;
+				MakeIntegralImagePad(I + (v0 + j)*NyNx , II + base[j] , Nx , Ny);
+			}
 
-				valF  = 0;
-				if(Area(II , xnw , ynw , w , h , Ny) > Ac)
-				{
-					valF |= 0x01;
-				}
-				if(Area(II , xc  , ynw , w , h , Ny)  > Ac)
-				{
-					valF |= 0x02;
-				}
-				if(Area(II , xse , ynw , w , h , Ny) > Ac)
-				{
-					valF |= 0x04;
-				}
-				if(Area(II , xse , yc  , w , h , Ny)  > Ac)
-				{
-					valF |= 0x08;
-				}				
-				if(Area(II , xse , yse , w , h , Ny) > Ac)
-				{
-					valF |= 0x10;
-				}
-				if(Area(II , xc  , yse , w , h , Ny) > Ac)
-				{
-					valF |= 0x020;
-				}
-				if(Area(II , xnw , yse , w , h , Ny) > Ac)
-				{
-					valF |= 0x040;
-				}
-				if(Area(II , xnw , yc  , w , h , Ny)  > Ac)
+			indf          = 0;
+			indc          = 0;
+			for (c = 0 ; (c < Ncascade) && (n > 0) ; c++)
+			{
+				Tc        = (int) cascade[0 + indc];
+				thresc    = cascade[1 + indc];
+				for(j = 0 ; j < n ; j++)
 				{
-					valF |= 0x080;
+					sum[j]     = 0.0;
 				}
 
-				z           = map[valF];
-				if(weaklearner == 0)
-				{					
-					sum    += (a*( z > th ) + b);	
-				}
-				if(weaklearner == 1)
+				for (f = 0 ; f < Tc ; f++)
 				{
-					sum    += ((2.0/(1.0 + exp(-2.0*epsi*(a*z + b)))) - 1.0);
+					idxF  = ((int) param[0 + indf] - 1)*5;
+					th    = param[1 + indf];
+					a     = param[2 + indf];
+					b     = param[3 + indf];
+
+					xc    = F[1 + idxF];
+					yc    = F[2 + idxF];
+					w     = F[3 + idxF];
+					h     = F[4 + idxF];
+
+					/* 4 x 4 lattice of corners of the 3 x 3 blocks, decoded once for the whole batch */
+
+					for(gx = 0 ; gx < 4 ; gx++)
+					{
+						for(gy = 0 ; gy < 4 ; gy++)
+						{
+							off[gy + 4*gx] = (yc - h + gy*h) + (xc - w + gx*w)*Ny1;
+						}
+					}
+
+					for(j = 0 ; j < n ; j++)
+					{
+						IIb   = II + base[j];
+						for(gx = 0 ; gx < 16 ; gx++)
+						{
+							vc[gx]  = IIb[off[gx]];
+						}
+
+						Ac    = vc[10] - (vc[9] + vc[6]) + vc[5];
+
+						valF  = 0;
+						if((vc[5] - (vc[4] + vc[1]) + vc[0]) > Ac)       /* (xnw , ynw) */
+						{
+							valF |= 0x01;
+						}
+						if((vc[9] - (vc[8] + vc[5]) + vc[4]) > Ac)       /* (xc  , ynw) */
+						{
+							valF |= 0x02;
+						}
+						if((vc[13] - (vc[12] + vc[9]) + vc[8]) > Ac)     /* (xse , ynw) */
+						{
+							valF |= 0x04;
+						}
+						if((vc[14] - (vc[13] + vc[10]) + vc[9]) > Ac)    /* (xse , yc)  */
+						{
+							valF |= 0x08;
+						}				
+						if((vc[15] - (vc[14] + vc[11]) + vc[10]) > Ac)   /* (xse , yse) */
+						{
+							valF |= 0x10;
+						}
+						if((vc[11] - (vc[10] + vc[7]) + vc[6]) > Ac)     /* (xc  , yse) */
+						{
+							valF |= 0x20;
+						}
+						if((vc[7] - (vc[6] + vc[3]) + vc[2]) > Ac)       /* (xnw , yse) */
+						{
+							valF |= 0x40;
+						}
+						if((vc[6] - (vc[5] + vc[2]) + vc[1]) > Ac)       /* (xnw , yc)  */
+						{
+							valF |= 0x80;
+						}
+						zs[j]        = (double) map[valF];
+					}
+
+					if(weaklearner == 0)
+					{					
+						for(j = 0 ; j < n ; j++)
+						{
+							sum[j]    += (a*( zs[j] > th ) + b);	
+						}
+					}
+					else if(weaklearner == 1)
+					{
+						for(j = 0 ; j < n ; j++)
+						{
+							sum[j]    += ((2.0/(1.0 + exp(-2.0*epsi*(a*zs[j] + b)))) - 1.0);
+						}
+					}
+					else if(weaklearner == 2)
+					{
+						for(j = 0 ; j < n ; j++)
+						{
+							sum[j]    += a*sign(zs[j] - th);
+						}
+					}
+					indf      += 4;
 				}
-				if(weaklearner == 2)
-				{
-					sum    += a*sign(z - th);
-				}
-				indf      += 4;
-			}
 
-			sum_total     += sum;
+				/* Early-reject compaction */
 
-			if((sum_total < thresc) && (cascade_type == 1))	
-			{
-				y[v]      = -1.0;
-				break;	
+				nn     = 0;
+				for(j = 0 ; j < n ; j++)
+				{
+					sum_total[j]      += sum[j];
+					if((sum_total[j] < thresc) && (cascade_type == 1))	
+					{
+						fx[win[j]]     = sum_total[j];
+						y[win[j]]      = -1.0;
+					}
+					else if((sum[j] < thresc) && (cascade_type == 0))
+					{
+						fx[win[j]]     = sum[j];
+						y[win[j]]      = -1.0;
+					}
+					else
+					{
+						base[nn]       = base[j];
+						win[nn]        = win[j];
+						sum[nn]        = sum[j];
+						sum_total[nn]  = sum_total[j];
+						nn++;
+					}
+				}
+				n          = nn;
+				indc      += 2;
 			}
-			else if((sum < thresc) && (cascade_type == 0))
+			for(j = 0 ; j < n ; j++)
 			{
-				y[v]      = -1.0;
-				break;	
+				fx[win[j]]     = (cascade_type == 1) ? sum_total[j] : sum[j];
 			}
 		}
-
-		if(cascade_type == 1)
-		{
-			fx[v]     = sum_total;
-		}
-		else if(cascade_type == 0)
-		{
-			fx[v]     = sum;
-		}
+		free(II);
+		free(base);
+		free(win);
+		free(sum);
+		free(sum_total);
+		free(zs);
 	}
-	free(II);
-	free(Itemp);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void mblbp_featlist(int ny , int nx , unsigned int *F)
@@ -611,66 +677,28 @@ int number_mblbp_features(int ny , int nx)
 	return nF;
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------------*/
-void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagePad(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-	int x , y , indx = 0;
-		
-	for(x=0 ; x<iXmax ; x++)
-	{
-		pTemp[indx]     = (unsigned int)pIn[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
-	pOut[0]             = (unsigned int)pIn[0];
-	indx                = iYmax;
+	/* Integral image of size ((iYmax+1) x (iXmax+1)) with a zero first row and first column */
 
-	for(x=1 ; x<iXmax ; x++)
+	int x , y , iYmax1 = iYmax + 1 , indx = 0 , indx1 = iYmax1;
+	unsigned int colsum;
+	
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
+		pOut[y]         = 0;
 	}
-	for(y = 1 ; y<iYmax ; y++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		pOut[y]         = pOut[y - 1] + (unsigned int)pIn[y];
-	}
-	
-	/* Calculate integral image */
-
-	indx                = iYmax;
-	for(x = 1 ; x < iXmax ; x++)
-	{
-		for(y = 1 ; y < iYmax ; y++)
+		colsum          = 0;
+		pOut[indx1]     = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int)pIn[y + indx];	
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			colsum                 += (unsigned int) pIn[y + indx];
+			pOut[y + 1 + indx1]     = pOut[y + 1 + indx1 - iYmax1] + colsum;
 		}
-		indx += iYmax;
-	}
-}
-/*----------------------------------------------------------------------------------------------------------------------------------------------*/
-unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
-{
-	int h1 = h-1, w1 = w-1 , x1 = x-1, y1 = y-1;
-	
-	if( (x == 0) && (y==0))
-	{		
-		return (II[h1 + w1*Ny]);	
-	}
-	if( (x==0) )
-	{
-		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);	
-	}
-	if( (y==0) )
-	{	
-		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);		
-	}
-	else
-	{	
-		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);	
+		indx           += iYmax;
+		indx1          += iYmax1;
 	}
 }
 /*---------------------------------------------------------------------------------------------------------------------------------------------- */
@@ -6,7 +6,7 @@
   Usage
   ------
 
-  [model , wnew]      = fast_haar_ada_weaklearner(II , y  , w , options);
+  [model , wnew , [moments]] = fast_haar_ada_weaklearner(II , y  , w , options);
 
   
   Inputs
@@ -19,6 +19,8 @@
               G                         Features sparse matrix (Ny*Nx x nF) (see Haar_matG function)  
 			  indexF                    Index of accesible weaklearners (default index = int32(0:nF-1));
 			  fine_threshold            Fine threshold estimation with a Nelder Mead optimization algorithm (yes = 1/no = 0) (default fine_threshold = 0)
+			  moments                   Weighted moments returned by the previous call (see outputs). If w is proportional to moments.w, class covariances
+			                            are obtained by rescaling them instead of being recomputed from all the samples (default moments = [])
 
 If compiled with the "OMP" compilation flag
 
@@ -33,6 +35,12 @@ If compiled with the "OMP" compilation flag
 		b                               Zeros , i.e. b = zeros(1 , 1)
 
   wnew                                  Updated weights (1 x N) at stage m+1 
+  moments                               Weighted moments of positives/negatives for the weights wnew, to be given in options.moments at the next call
+              S1 , S2                   Second moments sum(wnew_i*x_i*x_i') (Ny*Nx x Ny*Nx, lower part)
+			  s1 , s2                   First moments sum(wnew_i*x_i) (Ny*Nx x 1)
+			  w                         Weights wnew (1 x N) 
+			  nupdate                   Number of low-rank updates since the last full computation. They are recomputed from scratch
+			                            every MAX_UPDATES updates
 
 
   To compile
@@ -116,6 +124,11 @@ If compiled with the "OMP" compilation flag
 
 
 #define sign(a) ((a) >= (0) ? (1.0) : (-1.0))
+
+#define BLOCK_SAMPLES   256
+#define MAX_UPDATES     32
+#define tolw            1e-8
+#define FEAT_BLOCK      64
 #ifndef max
     #define max(a,b) (a >= b ? a : b)
     #define min(a,b) (a <= b ? a : b)
@@ -146,6 +159,16 @@ struct opts
 #endif
 };
 
+struct moments
+{
+  double   *S1;
+  double   *S2;
+  double   *s1;
+  double   *s2;
+  double   *w;
+  double   *nupdate;
+};
+
 /*-------------------------------------------------------------------------------------------------------------- */
 
 /* Function prototypes */
@@ -159,7 +182,8 @@ double fast_haar_feat(double * , int , double * , int *, int *);
 double erf(double);
 double error_fcn (double , double , double , double , double , double , double);
 double neldermead_error_fcn(double * , double , double , double , double , double , double );
-void   fast_haar_ada_weaklearner(double * , char * , double * , int , int , int , struct opts , double * , double *);
+void   syrk_samples(double * , double * , int * , int , int , double * , double , double * , double *);
+void   fast_haar_ada_weaklearner(double * , char * , double * , int , int , int , struct opts , struct moments * , struct moments * , double * , double *);
 
 /*-------------------------------------------------------------------------------------------------------------- */
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
@@ -174,10 +198,12 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 #endif
 	double *model , *wnew;
 	int i , Ny , Nx , NyNx , N; 
-	mxArray *mxtemp;
+	mxArray *mxtemp , *mxS1 , *mxS2 , *mxs1 , *mxs2 , *mxw , *mxnupdate;
     int tempint;
 	double *tmp;
 	struct opts options;
+	struct moments momin , momout , *pmomin = NULL , *pmomout = NULL;
+	const char *fieldnames_moments[6] = {"S1" , "S2" , "s1" , "s2" , "w" , "nupdate"};
 
 	options.fine_threshold = 0;
 #ifdef OMP 
@@ -272,6 +298,32 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 				options.fine_threshold    = tempint;	
 			}			
 		}
+
+		mxtemp                            = mxGetField( prhs[3] , 0, "moments" );
+		if((mxtemp != NULL) && mxIsStruct(mxtemp))
+		{
+			mxS1                          = mxGetField(mxtemp , 0 , "S1");
+			mxS2                          = mxGetField(mxtemp , 0 , "S2");
+			mxs1                          = mxGetField(mxtemp , 0 , "s1");
+			mxs2                          = mxGetField(mxtemp , 0 , "s2");
+			mxw                           = mxGetField(mxtemp , 0 , "w");
+			mxnupdate                     = mxGetField(mxtemp , 0 , "nupdate");
+
+			/* Moments of another training set are ignored */
+
+			if( (mxS1 != NULL) && (mxS2 != NULL) && (mxs1 != NULL) && (mxs2 != NULL) && (mxw != NULL) && (mxnupdate != NULL) &&
+				(mxGetNumberOfElements(mxS1) == NyNx*NyNx) && (mxGetNumberOfElements(mxS2) == NyNx*NyNx) && (mxGetNumberOfElements(mxs1) == NyNx) && 
+				(mxGetNumberOfElements(mxs2) == NyNx) && (mxGetNumberOfElements(mxw) == N) )
+			{
+				momin.S1                  = mxGetPr(mxS1);
+				momin.S2                  = mxGetPr(mxS2);
+				momin.s1                  = mxGetPr(mxs1);
+				momin.s2                  = mxGetPr(mxs2);
+				momin.w                   = mxGetPr(mxw);
+				momin.nupdate             = mxGetPr(mxnupdate);
+				pmomin                    = &momin;
+			}
+		}
 #ifdef OMP 
 		mxtemp                            = mxGetField( prhs[3] , 0, "num_threads" );
 		if(mxtemp != NULL)
@@ -306,9 +358,33 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	plhs[1]              = mxCreateNumericMatrix(1 , N , mxDOUBLE_CLASS,mxREAL);
 	wnew                 = mxGetPr(plhs[1]);
 
+	if(nlhs > 2)
+	{
+		plhs[2]          = mxCreateStructMatrix(1 , 1 , 6 , fieldnames_moments);
+		mxS1             = mxCreateDoubleMatrix(NyNx , NyNx , mxREAL);
+		mxS2             = mxCreateDoubleMatrix(NyNx , NyNx , mxREAL);
+		mxs1             = mxCreateDoubleMatrix(NyNx , 1 , mxREAL);
+		mxs2             = mxCreateDoubleMatrix(NyNx , 1 , mxREAL);
+		mxw              = mxCreateDoubleMatrix(1 , N , mxREAL);
+		mxnupdate        = mxCreateDoubleMatrix(1 , 1 , mxREAL);
+		momout.S1        = mxGetPr(mxS1);
+		momout.S2        = mxGetPr(mxS2);
+		momout.s1        = mxGetPr(mxs1);
+		momout.s2        = mxGetPr(mxs2);
+		momout.w         = mxGetPr(mxw);
+		momout.nupdate   = mxGetPr(mxnupdate);
+		mxSetField(plhs[2] , 0 , "S1" , mxS1);
+		mxSetField(plhs[2] , 0 , "S2" , mxS2);
+		mxSetField(plhs[2] , 0 , "s1" , mxs1);
+		mxSetField(plhs[2] , 0 , "s2" , mxs2);
+		mxSetField(plhs[2] , 0 , "w" , mxw);
+		mxSetField(plhs[2] , 0 , "nupdate" , mxnupdate);
+		pmomout          = &momout;
+	}
+
 	/*------------------------ Main Call ----------------------------*/
 
-	fast_haar_ada_weaklearner(II , y , wold , Ny , Nx , N , options , model , wnew);
+	fast_haar_ada_weaklearner(II , y , wold , Ny , Nx , N , options , pmomin , pmomout , model , wnew);
 
 	/*----------------- Free Memory --------------------------------*/
 
@@ -329,7 +405,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 
-void  fast_haar_ada_weaklearner(double *II , char *y , double *wold , int Ny , int Nx , int N  , struct opts options , double *model , double *wnew )							 								 
+void  fast_haar_ada_weaklearner(double *II , char *y , double *wold , int Ny , int Nx , int N  , struct opts options , struct moments *momin , struct moments *momout , double *model , double *wnew )							 								 
 {
 	double *G = options.G;
 #ifdef OS64
@@ -342,15 +418,17 @@ void  fast_haar_ada_weaklearner(double *II , char *y , double *wold , int Ny , i
 #ifdef OMP 
     int num_threads = options.num_threads;
 #endif
-	int i , j , f ;
-	int NyNx = Ny*Nx , indNyNx , ind1NyNx , ind2NyNx , N1 = 0, N2 = 0 , featuresIdx_opt , indGi , indGj;
+	int i , j , f , b , k ;
+	int NyNx = Ny*Nx , NyNx2 , indNyNx , N1 = 0, N2 = 0 , n1 , n2 , featuresIdx_opt , indGi , indGj , reuse = 0;
+	int nactive , nnzmax , nnz , floc;
 	double  Errormin , errm , cm , wtemp  , temp1 , temp2 , th_opt , z ;
-	double *my1 , *my2  , *Z1c , *Z2c , *cov1c , *cov2c;
+	double *my1 , *my2  , *cov1c , *cov2c , *cov12 , *cov12i , *Zb , *cw , *S1 , *S2 , *s1 , *s2 , *Gs;
+	double Errloc , thloc , aloc;
+	int *idx , *countF , *orderF , *indGs;
 	char *h;
-	double   a_opt , p1  , p2 , invp1 , invp2 , sqrtw , one = 1.0 , zero = 0.0 , Gi , Gj , ctep , alpha , beta , gamma , delta , sqrtdelta;
-	double x1 , x2 , Err;
+	double   a_opt , p1  , p2 , invp1 , invp2 , Gi , ctep , alpha , beta , gamma , delta , sqrtdelta;
+	double x1 , x2 , Err , c , sumw , em , ep;
 	double  m1c , m2c , var1c , var2c , std1c , std2c;
-	char uplo = 'L' , trans = 'N';
 
 #ifdef OMP 
 #pragma omp parallel for private(i) shared (y,N) reduction (+:N1,N2)
@@ -367,222 +445,360 @@ void  fast_haar_ada_weaklearner(double *II , char *y , double *wold , int Ny , i
 		}	
 	}
 
-	Z1c                  = (double *)malloc(NyNx*N1*sizeof(double));
-	Z2c                  = (double *)malloc(NyNx*N2*sizeof(double));
-	cov1c                = (double *)malloc(NyNx*NyNx*sizeof(double));
-	cov2c                = (double *)malloc(NyNx*NyNx*sizeof(double));
+	NyNx2                = NyNx*NyNx;
+	cov1c                = (double *)calloc(NyNx2,sizeof(double));
+	cov2c                = (double *)calloc(NyNx2,sizeof(double));
+	cov12                = (double *)malloc(2*NyNx2*sizeof(double));
+	countF               = (int *)malloc((NyNx + 1)*sizeof(int));
+	orderF               = (int *)malloc(nF*sizeof(int));
 	my1                  = (double *)calloc(NyNx,sizeof(double));
 	my2                  = (double *)calloc(NyNx,sizeof(double));
 	h                    = (char *)malloc(N*sizeof(char));
+	idx                  = (int *)malloc(N*sizeof(int));
+	cw                   = (double *)malloc(N*sizeof(double));
+	Zb                   = (double *)malloc(NyNx*BLOCK_SAMPLES*sizeof(double));
 
 #ifdef OMP 
     num_threads          = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
     omp_set_num_threads(num_threads);
 #endif
 
-
 	Errormin             = huge;
 	p1                   = 0.0;
 	p2                   = 0.0;
 
- /* 
-#ifdef OMP 
-#pragma omp parallel for default(none) private(i,j,indNyNx,wtemp) shared (II,y,my1,my2,wold,N,NyNx) reduction (+:p1,p2)
-#endif
- */
+	/* Positives indexes in idx[0 , ... , N1-1], negatives in idx[N1 , ... , N-1] */
+
+	n1                   = 0;
+	n2                   = N1;
 	for(i = 0 ; i < N ; i++)
 	{
-		indNyNx    = i*NyNx;
 		if(y[i] == 1)
 		{
-			wtemp   = wold[i];
-			p1     += wtemp;
+			p1          += wold[i];
+			idx[n1++]    = i;
+		}
+		else
+		{
+			p2          += wold[i];
+			idx[n2++]    = i;
+		}
+	}
+	invp1               = 1.0/p1;
+	invp2               = 1.0/p2;
+
+	/* Moments of the previous call can be reused if wold is proportional to their weights */
+
+	if((momout != NULL) && (momin != NULL) && (momin->nupdate[0] < MAX_UPDATES))
+	{
+		sumw            = 0.0;
+		for(i = 0 ; i < N ; i++)
+		{
+			sumw       += momin->w[i];
+		}
+		c               = (p1 + p2)/sumw;
+		reuse           = 1;
+		for(i = 0 ; i < N ; i++)
+		{
+			if(fabs(wold[i] - c*momin->w[i]) > tolw*wold[i])
+			{
+				reuse   = 0;
+				break;
+			}
+		}
+	}
+
+	if(reuse)
+	{
+		S1              = momout->S1;
+		S2              = momout->S2;
+		s1              = momout->s1;
+		s2              = momout->s2;
+		for(i = 0 ; i < NyNx2 ; i++)
+		{
+			S1[i]       = c*momin->S1[i];
+			S2[i]       = c*momin->S2[i];
+		}
+		for(j = 0 ; j < NyNx ; j++)
+		{
+			s1[j]       = c*momin->s1[j];
+			s2[j]       = c*momin->s2[j];
+			my1[j]      = s1[j]*invp1;
+			my2[j]      = s2[j]*invp2;
+		}
+		momout->nupdate[0] = momin->nupdate[0];
+	}
+	else
+	{
+		for(i = 0 ; i < N1 ; i++)
+		{
+			wtemp       = wold[idx[i]];
+			indNyNx     = idx[i]*NyNx;
 			for (j = 0 ; j < NyNx ; j++)
 			{
-				my1[j]    += wtemp*II[j + indNyNx];
+				my1[j] += wtemp*II[j + indNyNx];
 			}
 		}
-		else
-		{			
-			wtemp   = wold[i];
-			p2     += wtemp;
+		for(i = N1 ; i < N ; i++)
+		{
+			wtemp       = wold[idx[i]];
+			indNyNx     = idx[i]*NyNx;
 			for (j = 0 ; j < NyNx ; j++)
 			{
-				my2[j]    += wtemp*II[j + indNyNx];
-			}		
+				my2[j] += wtemp*II[j + indNyNx];
+			}
+		}
+		if(momout != NULL)
+		{
+			s1          = momout->s1;
+			s2          = momout->s2;
+			for(j = 0 ; j < NyNx ; j++)
+			{
+				s1[j]   = my1[j];
+				s2[j]   = my2[j];
+			}
+		}
+		for(j = 0 ; j < NyNx ; j++)
+		{
+			my1[j]     *= invp1;
+			my2[j]     *= invp2;
 		}
 	}
 
-	invp1       = 1.0/p1;
-	invp2       = 1.0/p2;
-/*
-#ifdef OMP 
-#pragma omp parallel for private(j) shared (my1,my2,NyNx,invp1,invp2)
-#endif
-*/
-	for(j = 0 ; j < NyNx ; j++)
+	if(momout == NULL)
 	{
-		my1[j]  *= invp1;
-		my2[j]  *= invp2;
-	}
-
+		/* Centered weighted covariances accumulated by blocks of samples */
 
-	ind1NyNx    = 0;
-	ind2NyNx    = 0;
-
- /*
-#ifdef OMP 
-#pragma omp parallel for default(none) private(i,j,sqrtw,wtemp,indNyNx) shared (II,y,wold,my1,my2,Z1c,Z2c,invp1,invp2,N,NyNx) reduction (+:ind1NyNx,ind2NyNx)
-#endif
- */
-	for(i = 0 ; i < N ; i++)
+		for(i = 0 ; i < N1 ; i++)
+		{
+			cw[i]       = wold[idx[i]]*invp1;
+		}
+		for(i = N1 ; i < N ; i++)
+		{
+			cw[i]       = wold[idx[i]]*invp2;
+		}
+		syrk_samples(II , cw , idx , N1 , NyNx , my1 , 1.0 , cov1c , Zb);
+		syrk_samples(II , cw + N1 , idx + N1 , N2 , NyNx , my2 , 1.0 , cov2c , Zb);
+	}
+	else
 	{
-		indNyNx                     = i*NyNx;
-		if(y[i] == 1)
+		S1              = momout->S1;
+		S2              = momout->S2;
+		if(!reuse)
 		{
-			sqrtw                   = sqrt(wold[i]*invp1);
-			for( j = 0 ; j < NyNx ; j++)
+			for(i = 0 ; i < NyNx2 ; i++)
+			{
+				S1[i]   = 0.0;
+				S2[i]   = 0.0;
+			}
+			for(i = 0 ; i < N ; i++)
 			{
-				Z1c[j + ind1NyNx]   = sqrtw*(II[j + indNyNx] - my1[j]);
+				cw[i]   = wold[idx[i]];
 			}
-			ind1NyNx               += NyNx;
+			syrk_samples(II , cw , idx , N1 , NyNx , NULL , 1.0 , S1 , Zb);
+			syrk_samples(II , cw + N1 , idx + N1 , N2 , NyNx , NULL , 1.0 , S2 , Zb);
+			momout->nupdate[0] = 0.0;
 		}
-		else
+
+		/* cov = S/p - my*my' (lower part) */
+
+		for(j = 0 ; j < NyNx ; j++)
 		{
-			sqrtw                   = sqrt(wold[i]*invp2);
-			for( j = 0 ; j < NyNx ; j++)
+			indNyNx     = j*NyNx;
+			for(i = j ; i < NyNx ; i++)
 			{
-				Z2c[j + ind2NyNx]   = sqrtw*(II[j + indNyNx] - my2[j]);
+				cov1c[i + indNyNx] = S1[i + indNyNx]*invp1 - my1[i]*my1[j];
+				cov2c[i + indNyNx] = S2[i + indNyNx]*invp2 - my2[i]*my2[j];
 			}
-			ind2NyNx               += NyNx;
 		}
 	}
 
+	/* Both class covariances interleaved in a full symmetric matrix : cov12[2*(i + j*NyNx)] = cov1c(i,j) , cov12[2*(i + j*NyNx) + 1] = cov2c(i,j) */
 
-	BLASCALL(dsyrk) (&uplo , &trans , &NyNx , &N1 , &one , Z1c , &NyNx , &zero , cov1c , &NyNx);
-	BLASCALL(dsyrk) (&uplo , &trans , &NyNx , &N2 , &one , Z2c , &NyNx , &zero , cov2c , &NyNx);
+	for (j = 0 ; j < NyNx ; j++)
+	{
+		indNyNx   = j*NyNx;
+		for (i = j ; i < NyNx ; i++)
+		{
+			indGi                = 2*(i + indNyNx);
+			indGj                = 2*(j + i*NyNx);
+			cov12[indGi]         = cov1c[i + indNyNx];
+			cov12[indGi + 1]     = cov2c[i + indNyNx];
+			cov12[indGj]         = cov12[indGi];
+			cov12[indGj + 1]     = cov12[indGi + 1];
+		}
+	}
 
-	indNyNx        = 0;
+	/* Features grouped by their leading support pixel (counting sort) : features of a block read the same columns of cov12 */
 
-/*
-#ifdef OMP 
-#pragma omp parallel for private(j,i) shared (cov1c,cov2c,NyNx) reduction (+:indNyNx)
-#endif
-*/
-	for (i = 0 ; i < NyNx - 1; i++)
+	for (i = 0 ; i <= NyNx ; i++)
+	{
+		countF[i]            = 0;
+	}
+	nnzmax                   = 0;
+	for (f = 0 ; f < nF ; f++)
 	{
-		for (j = i + 1 ; j < NyNx ; j++)
+		if ((indexF[f] != -1) && (jcG[f + 1] > jcG[f]))
 		{
-			cov1c[i + j*NyNx] = cov1c[j + indNyNx];	
-			cov2c[i + j*NyNx] = cov2c[j + indNyNx];			
+			countF[irG[jcG[f]] + 1]++;
+			nnzmax           = max(nnzmax , (int) (jcG[f + 1] - jcG[f]));
+		}
+	}
+	for (i = 0 ; i < NyNx ; i++)
+	{
+		countF[i + 1]       += countF[i];
+	}
+	nactive                  = countF[NyNx];
+	for (f = 0 ; f < nF ; f++)
+	{
+		if ((indexF[f] != -1) && (jcG[f + 1] > jcG[f]))
+		{
+			orderF[countF[irG[jcG[f]]]++] = f;
 		}
-		indNyNx   += NyNx;
 	}
 
 	ctep                      = p1/p2;
+	featuresIdx_opt           = 0;
+	th_opt                    = 0.0;
+	a_opt                     = 1.0;
+
+	/* Blocks of FEAT_BLOCK features per task, both quadratic forms G_f'*cov*G_f evaluated in the same pass over the gathered support of G_f */
+
 #ifdef OMP 
-#pragma omp parallel for default(none) private(f,i,j,m1c,m2c,Gi,indGi,var1c,var2c,temp1,temp2,Gj,indGj,indNyNx,alpha,beta,gamma,delta,sqrtdelta,std1c,std2c,x1,x2,Err) \
-	shared (Errormin,featuresIdx_opt,th_opt,a_opt,indexF,irG,jcG,my1,my2,cov1c,cov2c,G,N,NyNx,p1,p2,ctep,nF,fine_threshold) 
+#pragma omp parallel default(none) private(b,k,f,i,j,m1c,m2c,Gi,indGi,var1c,var2c,temp1,temp2,indNyNx,alpha,beta,gamma,delta,sqrtdelta,std1c,std2c,x1,x2,Err,nnz,Gs,indGs,cov12i,Errloc,floc,thloc,aloc) \
+	shared (Errormin,featuresIdx_opt,th_opt,a_opt,orderF,nactive,nnzmax,irG,jcG,my1,my2,cov12,G,NyNx,p1,p2,ctep,fine_threshold) 
 #endif
-	for (f = 0 ; f < nF ; f++)
 	{
-		if (indexF[f] != -1)
-		{
-			m1c                   = 0.0;
-			m2c                   = 0.0;
+		Gs                        = (double *)malloc(nnzmax*sizeof(double));
+		indGs                     = (int *)malloc(nnzmax*sizeof(int));
+		Errloc                    = huge;
+		floc                      = -1;
+		thloc                     = 0.0;
+		aloc                      = 1.0;
 
-			for( i = jcG[f] ; i < jcG[f + 1] ; i++)
+#ifdef OMP 
+#pragma omp for schedule(dynamic,1) nowait
+#endif
+		for (b = 0 ; b < nactive ; b += FEAT_BLOCK)
+		{
+			for (k = b ; k < min(b + FEAT_BLOCK , nactive) ; k++)
 			{
-				Gi                = G[i];
-				indGi             = irG[i];
-				m1c              += my1[indGi]*Gi;
-				m2c              += my2[indGi]*Gi;
-			}
+				f                     = orderF[k];
+				nnz                   = (int) (jcG[f + 1] - jcG[f]);
+				m1c                   = 0.0;
+				m2c                   = 0.0;
 
-			var1c                 = 0.0;
-			var2c                 = 0.0;
+				for( i = 0 ; i < nnz ; i++)
+				{
+					Gi                = G[jcG[f] + i];
+					indGi             = (int) irG[jcG[f] + i];
+					Gs[i]             = Gi;
+					indGs[i]          = 2*indGi;
+					m1c              += my1[indGi]*Gi;
+					m2c              += my2[indGi]*Gi;
+				}
 
-			for(j = jcG[f] ; j < jcG[f + 1] ; j++)
-			{
+				/* Symmetric form : diagonal terms + 2 x strictly upper terms */
 
-				temp1             = 0.0;
-				temp2             = 0.0;
-				Gj                = G[j];
-				indGj             = irG[j];
-				indNyNx           = indGj*NyNx;
+				var1c                 = 0.0;
+				var2c                 = 0.0;
 
-				for( i = jcG[f] ; i < jcG[f + 1] ; i++)
+				for(i = 0 ; i < nnz ; i++)
 				{
-					Gi             = G[i];
-					indGi          = irG[i] + indNyNx;
-					temp1         += cov1c[indGi]*Gi;
-					temp2         += cov2c[indGi]*Gi;
+					Gi                = Gs[i];
+					cov12i            = cov12 + indGs[i]*NyNx;
+					temp1             = 0.0;
+					temp2             = 0.0;
+					for(j = i + 1 ; j < nnz ; j++)
+					{
+						indNyNx       = indGs[j];
+						temp1        += cov12i[indNyNx]*Gs[j];
+						temp2        += cov12i[indNyNx + 1]*Gs[j];
+					}
+					indNyNx           = indGs[i];
+					var1c            += Gi*(cov12i[indNyNx]*Gi + 2.0*temp1);
+					var2c            += Gi*(cov12i[indNyNx + 1]*Gi + 2.0*temp2);
 				}
-				var1c             += temp1*Gj;
-				var2c             += temp2*Gj;			
-			}
 
-			alpha                  = var1c - var2c;
-			beta                   = (m1c*var2c - m2c*var1c);
-			gamma                  = m2c*m2c*var1c - m1c*m1c*var2c  +  2*var1c*var2c*log(ctep*(var2c/var1c));
-			delta                  = beta*beta - alpha*gamma;
+				alpha                  = var1c - var2c;
+				beta                   = (m1c*var2c - m2c*var1c);
+				gamma                  = m2c*m2c*var1c - m1c*m1c*var2c  +  2*var1c*var2c*log(ctep*(var2c/var1c));
+				delta                  = beta*beta - alpha*gamma;
 
-			if(delta < 0)
-			{	
-				delta              = -delta;	
-			}
+				if(delta < 0)
+				{	
+					delta              = -delta;	
+				}
 
-			sqrtdelta              = sqrt(delta);
-			std1c                  = 1.0/sqrt(var1c); /* 1.0/sqrt(2.0*var1c); */
-			std2c                  = 1.0/sqrt(var2c); /* 1.0/sqrt(2.0*var2c); */
+				sqrtdelta              = sqrt(delta);
+				std1c                  = 1.0/sqrt(var1c); /* 1.0/sqrt(2.0*var1c); */
+				std2c                  = 1.0/sqrt(var2c); /* 1.0/sqrt(2.0*var2c); */
 
-			if(alpha != 0.0)
-			{
-				x1                 = (-beta + sqrtdelta)/(alpha);
-				x2                 = (-beta - sqrtdelta)/(alpha);
-			}
-			else
-			{
-				x1                 = -gamma/beta;
-				x2                 = x1;
-			}
-			if(m1c > m2c)
-			{
-				if(fine_threshold)
+				if(alpha != 0.0)
 				{
-					Err                = neldermead_error_fcn(&x1,p1,p2,m1c,m2c,std1c,std2c);
+					x1                 = (-beta + sqrtdelta)/(alpha);
+					x2                 = (-beta - sqrtdelta)/(alpha);
 				}
 				else
 				{
-					Err                = error_fcn(x1,p1,p2,m1c,m2c,std1c,std2c);
-				}
-				if(Err < Errormin)
-				{
-					Errormin           = Err;
-					featuresIdx_opt    = f;
-					th_opt             = x1;
-					a_opt              = 1.0;
+					x1                 = -gamma/beta;
+					x2                 = x1;
 				}
-			}
-			else
-			{
-				if(fine_threshold)
+				if(m1c > m2c)
 				{
-					Err                = neldermead_error_fcn(&x2,p2,p1,m2c,m1c,std2c,std1c);
+					if(fine_threshold)
+					{
+						Err                = neldermead_error_fcn(&x1,p1,p2,m1c,m2c,std1c,std2c);
+					}
+					else
+					{
+						Err                = error_fcn(x1,p1,p2,m1c,m2c,std1c,std2c);
+					}
+					if((Err < Errloc) || ((Err == Errloc) && (f < floc)))
+					{
+						Errloc             = Err;
+						floc               = f;
+						thloc              = x1;
+						aloc               = 1.0;
+					}
 				}
 				else
 				{
-					Err                = error_fcn(x2,p2,p1,m2c,m1c,std2c,std1c);
-				}
-				if(Err < Errormin)
-				{
-					Errormin           = Err;
-					featuresIdx_opt    = f;
-					th_opt             = x2;
-					a_opt              = -1.0;
+					if(fine_threshold)
+					{
+						Err                = neldermead_error_fcn(&x2,p2,p1,m2c,m1c,std2c,std1c);
+					}
+					else
+					{
+						Err                = error_fcn(x2,p2,p1,m2c,m1c,std2c,std1c);
+					}
+					if((Err < Errloc) || ((Err == Errloc) && (f < floc)))
+					{
+						Errloc             = Err;
+						floc               = f;
+						thloc              = x2;
+						aloc               = -1.0;
+					}
 				}
 			}
 		}
+
+		/* Same selection as a sequential scan : lowest error, then lowest feature index */
+
+#ifdef OMP 
+#pragma omp critical
+#endif
+		{
+			if((floc != -1) && ((Errloc < Errormin) || ((Errloc == Errormin) && (floc < featuresIdx_opt))))
+			{
+				Errormin           = Errloc;
+				featuresIdx_opt    = floc;
+				th_opt             = thloc;
+				a_opt              = aloc;
+			}
+		}
+		free(Gs);
+		free(indGs);
 	}
 
 	errm             = 0.0;
@@ -617,17 +833,116 @@ void  fast_haar_ada_weaklearner(double *II , char *y , double *wold , int Ny , i
 	model[2]        = a_opt*cm;
 	model[3]        = 0.0;
 
+	if(momout != NULL)
+	{
+		/* Moments for wnew = wold*exp(-y*h*cm) : rescaling by exp(-cm) and low-rank update with the misclassified samples */
+
+		em              = exp(-cm);
+		ep              = exp(cm) - em;
+		S1              = momout->S1;
+		S2              = momout->S2;
+		s1              = momout->s1;
+		s2              = momout->s2;
+		for(i = 0 ; i < NyNx2 ; i++)
+		{
+			S1[i]      *= em;
+			S2[i]      *= em;
+		}
+		for(j = 0 ; j < NyNx ; j++)
+		{
+			s1[j]      *= em;
+			s2[j]      *= em;
+		}
+
+		n1              = 0;
+		n2              = N1;
+		for(i = 0 ; i < N ; i++)
+		{
+			if(y[i] != h[i])
+			{
+				wtemp   = ep*wold[i];
+				indNyNx = i*NyNx;
+				if(y[i] == 1)
+				{
+					for(j = 0 ; j < NyNx ; j++)
+					{
+						s1[j]  += wtemp*II[j + indNyNx];
+					}
+					idx[n1]     = i;
+					cw[n1++]    = fabs(wtemp);
+				}
+				else
+				{
+					for(j = 0 ; j < NyNx ; j++)
+					{
+						s2[j]  += wtemp*II[j + indNyNx];
+					}
+					idx[n2]     = i;
+					cw[n2++]    = fabs(wtemp);
+				}
+			}
+		}
+		syrk_samples(II , cw , idx , n1 , NyNx , NULL , sign(ep) , S1 , Zb);
+		syrk_samples(II , cw + N1 , idx + N1 , n2 - N1 , NyNx , NULL , sign(ep) , S2 , Zb);
+
+		for(i = 0 ; i < N ; i++)
+		{
+			momout->w[i]     = wnew[i];
+		}
+		momout->nupdate[0]  += 1.0;
+	}
 
 	free(h);
 	free(my1);
 	free(my2);
-	free(Z1c);
-	free(Z2c);
 	free(cov1c);
 	free(cov2c);
+	free(cov12);
+	free(countF);
+	free(orderF);
+	free(idx);
+	free(cw);
+	free(Zb);
 
 }
 
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void syrk_samples(double *II , double *c , int *idx , int n , int NyNx , double *mu , double alpha , double *S , double *Zb)
+{
+	/* S = S + alpha*sum_k c[k]*(x_k - mu)*(x_k - mu)' (lower part), with x_k = II(: , idx[k]), c[k] >= 0 and mu = NULL <=> mu = 0.
+	   Samples are gathered by blocks of BLOCK_SAMPLES columns for dsyrk */
+
+	int k , j , b , nb , indNyNx , ind;
+	double sqrtc , one = 1.0;
+	char uplo = 'L' , trans = 'N';
+
+	for(b = 0 ; b < n ; b += BLOCK_SAMPLES)
+	{
+		nb                  = min(BLOCK_SAMPLES , n - b);
+		ind                 = 0;
+		for(k = b ; k < b + nb ; k++)
+		{
+			sqrtc           = sqrt(c[k]);
+			indNyNx         = idx[k]*NyNx;
+			if(mu != NULL)
+			{
+				for(j = 0 ; j < NyNx ; j++)
+				{
+					Zb[j + ind] = sqrtc*(II[j + indNyNx] - mu[j]);
+				}
+			}
+			else
+			{
+				for(j = 0 ; j < NyNx ; j++)
+				{
+					Zb[j + ind] = sqrtc*II[j + indNyNx];
+				}
+			}
+			ind            += NyNx;
+		}
+		BLASCALL(dsyrk) (&uplo , &trans , &NyNx , &nb , &alpha , Zb , &NyNx , &one , S , &NyNx);
+	}
+}
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 double error_fcn (double x , double p1 , double p2 , double m1c , double m2c , double std1c , double std2c)
 {
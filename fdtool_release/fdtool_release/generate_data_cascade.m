@@ -222,6 +222,39 @@ end
 h                     = waitbar(0,sprintf('Generating negatives, n^o stage = %d' , nb_stage));
 set(h , 'name' , sprintf('Generating negatives, n^o stage = %d' , nb_stage))
 co                    = 1;
+
+%% Hard negatives mining with the native cascade scanner, remaining negatives (if any) are drawn below %%
+
+if(~isempty(options.param) && options.usebootstrap && (exist('bootstrap_negatives_cascade') == 3))
+    optionsboot                          = options;
+    index_bootphotos                     = randperm(nbneg_photos);
+    coboot                               = 0;
+    while((coneg <= Ntotal) && (coboot < nbneg_photos))
+        nbatch                           = min(options.bootstrap_batch , nbneg_photos - coboot);
+        Ibatch                           = cell(1 , nbatch);
+        for i = 1:nbatch
+            Itemp                        = imread(fullfile(options.negatives_path , directory(index_bootphotos(coboot + i)).name));
+            if(size(Itemp , 3) == 3)
+                Itemp                    = rgb2gray(Itemp);
+            end
+            maxNyNx                      = max(size(Itemp));
+            if(maxNyNx > options.negmax_size)
+                Itemp                    = imresize(Itemp , ceil(options.negmax_size/maxNyNx*size(Itemp)));
+            end
+            Ibatch{i}                    = Itemp;
+        end
+        coboot                           = coboot + nbatch;
+        optionsboot.Nneg                 = Ntotal - coneg + 1;
+        optionsboot.seed                 = options.seed + coboot;
+        [Xboot , statboot]               = bootstrap_negatives_cascade(Ibatch , optionsboot);
+        nboot                            = size(Xboot , 3);
+        X(: , : , coneg:coneg+nboot-1)   = Xboot;
+        coneg                            = coneg + nboot;
+        co                               = co + statboot(2);
+        waitbar((coneg - (options.Npos+1))/options.Nneg , h , sprintf('#neg/#generated = %d/%d, P_{fa} = %5.4f, #pictures = %d' , coneg - (options.Npos+1), co + prenegnum - 1 , (coneg - (options.Npos+1))/(co + prenegnum - 1) , coboot));
+    end
+end
+
 while(coneg <= Ntotal)
     if(~isempty(options.param))
         if(rand < options.probaswitchIneg)
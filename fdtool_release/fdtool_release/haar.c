@@ -323,6 +323,8 @@ If compiled with the "OMP" compilation flag
  Changelog :  - Add OpenMP support
  ----------   - Add double/single output format
               - Add transpose output
+              - Images are processed by blocks of HAAR_BLOCK in parallel (OMP) with a precomputed feature plan and
+                per-thread zero-padded integral images, output written directly in the transpose layout
 
  References : [1] R.E Schapire and al "Boosting the margin : A new explanation for the effectiveness of voting methods". 
  ----------       The annals of statistics, 1999
@@ -342,10 +344,19 @@ If compiled with the "OMP" compilation flag
  #include <omp.h>
 #endif
 
+#ifndef max
+    #define max(a,b) (a >= b ? a : b)
+    #define min(a,b) (a <= b ? a : b)
+#endif
+
 #ifndef MAX_THREADS
 #define MAX_THREADS 64
 #endif
 
+#ifndef HAAR_BLOCK
+#define HAAR_BLOCK 16
+#endif
+
 struct opts
 {
 	double        *rect_param;
@@ -363,14 +374,23 @@ struct opts
 #endif
 };
 
+struct haar_plan
+{
+	int           *start;          /* rectangles of feature f are start[f],...,start[f+1]-1 */
+	int           *off;            /* 4 corner offsets per rectangle in the (Ny+1 x Nx+1) integral image */
+	double        *s;              /* weight per rectangle */
+};
+
 /*-------------------------------------------------------------------------------------------------------------- */
 
 /* Function prototypes */
 
 int number_haar_features(int , int , double * , int );
 void haar_featlist(int , int , double * , int  , unsigned int * );
-void MakeIntegralImage(unsigned char *, unsigned int  *, int , int , unsigned int *);
-unsigned int Area(unsigned int * , int , int , int , int , int );
+void MakeIntegralImagePad(unsigned char *, unsigned int  *, int , int );
+void make_haar_plan(struct opts , int , struct haar_plan *);
+void free_haar_plan(struct haar_plan *);
+void haar_images(unsigned char * , int , int , int , struct opts , struct haar_plan , double * , float *);
 void shaar(unsigned char * , int , int , int , struct opts , float *);
 void dhaar(unsigned char * , int , int , int , struct opts , double *);
 
@@ -453,7 +473,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		else		
 		{
 			options.nF                    = number_haar_features(Ny , Nx , options.rect_param , options.nR);
-			options.F                     = (unsigned int *)mxMalloc(5*options.nF*sizeof(unsigned int));
+			options.F                     = (unsigned int *)mxMalloc(6*options.nF*sizeof(unsigned int));
 			haar_featlist(Ny , Nx , options.rect_param , options.nR , options.F);	
 		}
 
@@ -533,7 +553,7 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		}		
 
 		options.nF                    = number_haar_features(Ny , Nx , options.rect_param , options.nR);
-		options.F                     = (unsigned int *)mxMalloc(5*options.nF*sizeof(unsigned int));
+		options.F                     = (unsigned int *)mxMalloc(6*options.nF*sizeof(unsigned int));
 		haar_featlist(Ny , Nx , options.rect_param , options.nR , options.F);	        
     }   
 	
@@ -589,303 +609,169 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void dhaar(unsigned char *I , int Ny , int Nx , int P , struct opts options , double *z)
 {
-	double *rect_param = options.rect_param;
-	unsigned int *F = options.F;
-	int nF = options.nF , standardize = options.standardize , transpose = options.transpose;
+	struct haar_plan plan;
 #ifdef OMP 
     int num_threads = options.num_threads;
-#endif
-	int  p , indF , NxNy = Nx*Ny , indNxNy = 0 ;
-	int f , indnF = 0;
-	int x , xr , y , yr  , w , wr  , h , hr , i , r , R , indR ;
-	int coeffw , coeffh;
-	int last;
-	double val , s  , var , mean , std , cteNxNy;
-	unsigned int *II , *Itemp , tempI;
-
-	II              = (unsigned int *)malloc(NxNy*sizeof(unsigned int));
-	Itemp           = (unsigned int *)malloc(NxNy*sizeof(unsigned int));
 
-#ifdef OMP 
     num_threads     = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
     omp_set_num_threads(num_threads);
 #endif
 
-	if(standardize)
-	{
-		cteNxNy     = 1.0/NxNy;
-		last        = NxNy - 1;
-/*
-#ifdef OMP 
-#pragma omp parallel for default(none) private(p,i,f,r,tempI,mean,std,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s,var) shared(z,I,II,Itemp,F,rect_param,nF,P,Nx,Ny,NxNy,last,cteNxNy) reduction (*:indF,indnF,indNxNy)  reduction (+:val,indR) 
-#endif
-*/
-		for(p = 0 ; p < P ; p++)
-		{	
-			indNxNy    = p*NxNy;
-			indnF      = p*nF;	
-
-			MakeIntegralImage(I + indNxNy , II , Nx , Ny , Itemp);
-
-			var        = 0.0;
-			for(i = 0 ; i < NxNy ; i++)
-			{
-				tempI      = I[i + indNxNy];
-				var       += (tempI*tempI);
-			}
-
-			var       *= cteNxNy;
-			mean      = II[last]*cteNxNy;
-			std       = 1.0/sqrt(var - mean*mean);
-
-#ifdef OMP 
-#pragma omp parallel for default(none) private(f,r,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s) shared(p,P,transpose,z,II,F,rect_param,nF,Nx,Ny,std,indnF) reduction (*:indF)  reduction (+:val,indR) 
-#endif
-			for (f = 0 ; f < nF ; f++)
-			{	
-				indF  = f*6;
-				x     = F[1 + indF];		
-				y     = F[2 + indF];
-				w     = F[3 + indF];
-				h     = F[4 + indF];
-				indR  = F[5 + indF];
-				R     = (int) rect_param[3 + indR];				
-				val   = 0.0;
-
-				for (r = 0 ; r < R ; r++)
-				{
-					coeffw  = w/(int)rect_param[1 + indR];	
-					coeffh  = h/(int)rect_param[2 + indR];
-					xr      = x + coeffw*(int)rect_param[5 + indR];
-					yr      = y + coeffh*(int)rect_param[6 + indR];
-					wr      = coeffw*(int)(rect_param[7 + indR]);
-					hr      = coeffh*(int)(rect_param[8 + indR]);
-					s       = rect_param[9 + indR];
-					val    += s*Area(II,xr,yr,wr,hr,Ny);
-					indR   += 10;
-				}
-				if(transpose)
-				{
-					z[p + f*P]    = val*std;	
-				}
-				else
-				{
-					z[f + indnF]  = val*std;	
-				}
-			}
-		}
-	}
-	else
-	{
-		for(p = 0 ; p < P ; p++)
-		{
-			indNxNy    = p*NxNy;
-			indnF      = p*nF;	
-			
-			MakeIntegralImage(I + indNxNy , II , Nx , Ny , Itemp);	
-
-#ifdef OMP 
-#pragma omp parallel for default(none) private(f,r,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s) shared(p,P,transpose,z,II,F,rect_param,nF,Nx,Ny,std,indnF) reduction (*:indF)  reduction (+:val,indR) 
-#endif
-			for (f = 0 ; f < nF ; f++)
-			{
-				indF  = f*6;
-				x     = F[1 + indF];	
-				y     = F[2 + indF];
-				w     = F[3 + indF];
-				h     = F[4 + indF];
-				indR  = F[5 + indF];
-				R     = (int) rect_param[3 + indR];
-				val   = 0.0;
-
-				for (r = 0 ; r < R ; r++)
-				{
-					coeffw  = w/(int)rect_param[1 + indR];			
-					coeffh  = h/(int)rect_param[2 + indR];
-					xr      = x + coeffw*(int)rect_param[5 + indR];
-					yr      = y + coeffh*(int)rect_param[6 + indR];		
-					wr      = coeffw*(int)(rect_param[7 + indR]);
-					hr      = coeffh*(int)(rect_param[8 + indR]);
-					s       = rect_param[9 + indR];
-					val    += s*Area(II , xr  , yr  , wr , hr , Ny);
-					indR   += 10;
-				}
-				if(transpose)
-				{
-					z[p + f*P]    = val;	
-				}
-				else
-				{
-					z[f + indnF]    = val;	
-				}
-			}
-		}
-	}
-	free(II);
-	free(Itemp);	
+	make_haar_plan(options , Ny , &plan);
+	haar_images(I , Ny , Nx , P , options , plan , z , NULL);
+	free_haar_plan(&plan);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void shaar(unsigned char *I , int Ny , int Nx , int P , struct opts options , float *z)
 {
-	double *rect_param = options.rect_param;
-	unsigned int *F = options.F;
-	int nF = options.nF , standardize = options.standardize , transpose = options.transpose;
+	struct haar_plan plan;
 #ifdef OMP 
     int num_threads = options.num_threads;
-#endif
-	int  p , indF , NxNy = Nx*Ny , indNxNy = 0 ;
-	int f , indnF = 0;
-	int x , xr , y , yr  , w , wr  , h , hr , i , r , R , indR ;
-	int coeffw , coeffh;
-	int last;
-	double val , s  , var , mean , std , cteNxNy;
-	unsigned int *II , *Itemp , tempI;
-
-	II              = (unsigned int *)malloc(NxNy*sizeof(unsigned int));
-	Itemp           = (unsigned int *)malloc(NxNy*sizeof(unsigned int));
 
-#ifdef OMP 
     num_threads     = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
     omp_set_num_threads(num_threads);
 #endif
 
-	if(standardize)
-	{
-		cteNxNy     = 1.0/NxNy;
-		last        = NxNy - 1;
-/*
-#ifdef OMP 
-#pragma omp parallel for default(none) private(p,i,f,r,tempI,mean,std,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s,var) shared(z,I,II,Itemp,F,rect_param,nF,P,Nx,Ny,NxNy,last,cteNxNy) reduction (*:indF,indnF,indNxNy)  reduction (+:val,indR) 
-#endif
-*/
-		for(p = 0 ; p < P ; p++)
-		{	
-			indNxNy    = p*NxNy;
-			indnF      = p*nF;	
-
-			MakeIntegralImage(I + indNxNy , II , Nx , Ny , Itemp);
-
-			var        = 0.0;
-			for(i = 0 ; i < NxNy ; i++)
-			{
-				tempI      = I[i + indNxNy];
-				var       += (tempI*tempI);
-			}
+	make_haar_plan(options , Ny , &plan);
+	haar_images(I , Ny , Nx , P , options , plan , NULL , z);
+	free_haar_plan(&plan);
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void haar_images(unsigned char *I , int Ny , int Nx , int P , struct opts options , struct haar_plan plan , double *zd , float *zs)
+{
+	/* Images are split in blocks of HAAR_BLOCK, one block per task. Each thread builds the integral images of its block in
+	   its own buffer, then for each feature evaluates the block, i.e. writes HAAR_BLOCK consecutive values of z if transpose */
 
-			var       *= cteNxNy;
-			mean      = II[last]*cteNxNy;
-			std       = 1.0/sqrt(var - mean*mean);
+	int nF = options.nF , standardize = options.standardize , transpose = options.transpose;
+	int NxNy = Nx*Ny , NxNy1 = (Nx + 1)*(Ny + 1);
+	int p , p0 , b , nb , f , r , i , r4;
+	int *start = plan.start , *off = plan.off;
+	double *s = plan.s;
+	double val , var , mean , cteNxNy = 1.0/NxNy;
+	double std[HAAR_BLOCK];
+	unsigned int *II , *IIb , tempI;
+	unsigned char *Ip;
+	size_t indz;
 
 #ifdef OMP 
-#pragma omp parallel for default(none) private(f,r,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s) shared(transpose,p,P,z,II,F,rect_param,nF,Nx,Ny,std,indnF) reduction (*:indF)  reduction (+:val,indR) 
+#pragma omp parallel default(none) private(p,p0,b,nb,f,r,i,r4,val,var,mean,std,II,IIb,tempI,Ip,indz) shared(I,zd,zs,start,off,s,P,nF,Ny,Nx,NxNy,NxNy1,standardize,transpose,cteNxNy)
 #endif
-
-			for (f = 0 ; f < nF ; f++)
-			{	
-				indF  = f*6;
-				x     = F[1 + indF];		
-				y     = F[2 + indF];
-				w     = F[3 + indF];
-				h     = F[4 + indF];
-				indR  = F[5 + indF];
-				R     = (int) rect_param[3 + indR];				
-				val   = 0.0;
-
-				for (r = 0 ; r < R ; r++)
-				{
-					coeffw  = w/(int)rect_param[1 + indR];	
-					coeffh  = h/(int)rect_param[2 + indR];
-					xr      = x + coeffw*(int)rect_param[5 + indR];
-					yr      = y + coeffh*(int)rect_param[6 + indR];
-					wr      = coeffw*(int)(rect_param[7 + indR]);
-					hr      = coeffh*(int)(rect_param[8 + indR]);
-					s       = rect_param[9 + indR];
-					val    += s*Area(II,xr,yr,wr,hr,Ny);
-					indR   += 10;
-				}
-				if(transpose)
-				{
-					z[p + f*P]    = (float)(val*std);	
-				}
-				else
-				{
-					z[f + indnF]  = (float)(val*std);	
-				}
-			}
-		}
-	}
-	else
 	{
-		for(p = 0 ; p < P ; p++)
-		{
-			indNxNy    = p*NxNy;
-			indnF      = p*nF;	
-			
-			MakeIntegralImage(I + indNxNy , II , Nx , Ny , Itemp);	
+		II                  = (unsigned int *)malloc(HAAR_BLOCK*NxNy1*sizeof(unsigned int));
 
 #ifdef OMP 
-#pragma omp parallel for default(none) private(f,r,x,y,w,h,R,coeffw,coeffh,xr,yr,wr,hr,s) shared(transpose,p,P,z,II,F,rect_param,nF,Nx,Ny,std,indnF) reduction (*:indF)  reduction (+:val,indR) 
+#pragma omp for schedule(dynamic) nowait
 #endif
-			for (f = 0 ; f < nF ; f++)
+		for(p0 = 0 ; p0 < P ; p0 += HAAR_BLOCK)
+		{
+			nb              = min(HAAR_BLOCK , P - p0);
+			for(b = 0 ; b < nb ; b++)
 			{
-				indF  = f*6;
-				x     = F[1 + indF];	
-				y     = F[2 + indF];
-				w     = F[3 + indF];
-				h     = F[4 + indF];
-				indR  = F[5 + indF];
-				R     = (int) rect_param[3 + indR];
-				val   = 0.0;
-
-				for (r = 0 ; r < R ; r++)
+				Ip          = I + (size_t)(p0 + b)*NxNy;
+				IIb         = II + b*NxNy1;
+				MakeIntegralImagePad(Ip , IIb , Nx , Ny);
+				std[b]      = 1.0;
+				if(standardize)
 				{
-					coeffw  = w/(int)rect_param[1 + indR];			
-					coeffh  = h/(int)rect_param[2 + indR];
-					xr      = x + coeffw*(int)rect_param[5 + indR];
-					yr      = y + coeffh*(int)rect_param[6 + indR];		
-					wr      = coeffw*(int)(rect_param[7 + indR]);
-					hr      = coeffh*(int)(rect_param[8 + indR]);
-					s       = rect_param[9 + indR];
-					val    += s*Area(II , xr  , yr  , wr , hr , Ny);
-					indR   += 10;
-				}
-				if(transpose)
-				{
-					z[p + f*P]    = (float)val;	
+					var     = 0.0;
+					for(i = 0 ; i < NxNy ; i++)
+					{
+						tempI  = Ip[i];
+						var   += (tempI*tempI);
+					}
+					var    *= cteNxNy;
+					mean    = IIb[NxNy1 - 1]*cteNxNy;
+					std[b]  = 1.0/sqrt(var - mean*mean);
 				}
-				else
+			}
+			for (f = 0 ; f < nF ; f++)
+			{
+				for(b = 0 ; b < nb ; b++)
 				{
-					z[f + indnF]  = (float)val;	
+					IIb     = II + b*NxNy1;
+					val     = 0.0;
+					for (r = start[f] ; r < start[f + 1] ; r++)
+					{
+						r4      = 4*r;
+						val    += s[r]*(IIb[off[r4]] - IIb[off[r4 + 1]] - IIb[off[r4 + 2]] + IIb[off[r4 + 3]]);
+					}
+					if(standardize)
+					{
+						val    *= std[b];
+					}
+					p       = p0 + b;
+					indz    = transpose ? (p + (size_t)f*P) : (f + (size_t)p*nF);
+					if(zd != NULL)
+					{
+						zd[indz] = val;
+					}
+					else
+					{
+						zs[indz] = (float)val;
+					}
 				}
 			}
 		}
+		free(II);
 	}
-	free(II);
-	free(Itemp);	
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
-unsigned int Area(unsigned int *II , int x , int y , int w , int h , int Ny)
+void make_haar_plan(struct opts options , int Ny , struct haar_plan *plan)
 {
-	int h1 = h-1 , w1 = w-1 , x1 = x-1, y1 = y-1;
+	/* Rectangles of all features resolved once : corner offsets in the zero-padded integral image (Ny+1 x Nx+1) and weights,
+	   area of rectangle (xr,yr,wr,hr) = II[yr+hr , xr+wr] - II[yr , xr+wr] - II[yr+hr , xr] + II[yr , xr] without border cases */
 
-	if( (x == 0) && (y==0))
-	{	
-		return (II[h1 + w1*Ny]);	
-	}
-	if( x==0 ) 
+	double *rect_param = options.rect_param;
+	unsigned int *F = options.F;
+	int nF = options.nF , Ny1 = Ny + 1;
+	int f , r , R , indF , indR , ind;
+	int x , xr , y , yr , w , wr , h , hr , coeffw , coeffh;
+
+	plan->start             = (int *)malloc((nF + 1)*sizeof(int));
+	plan->start[0]          = 0;
+	for (f = 0 ; f < nF ; f++)
 	{
-		return(II[(y+h1) + w1*Ny] - II[y1 + w1*Ny]);
+		indR                = F[5 + f*6];
+		plan->start[f + 1]  = plan->start[f] + (int) rect_param[3 + indR];
 	}
-	if( y==0 ) 
+	plan->off               = (int *)malloc(4*plan->start[nF]*sizeof(int));
+	plan->s                 = (double *)malloc(plan->start[nF]*sizeof(double));
+
+	for (f = 0 ; f < nF ; f++)
 	{
-		return(II[h1 + (x+w1)*Ny] - II[h1 + x1*Ny]);	
-	}
-	else
-	{	
-		return (II[(y+h1) + (x+w1)*Ny] - (II[y1 + (x+w1)*Ny] + II[(y+h1) + x1*Ny]) + II[y1 + x1*Ny]);
+		indF                = f*6;
+		x                   = F[1 + indF];
+		y                   = F[2 + indF];
+		w                   = F[3 + indF];
+		h                   = F[4 + indF];
+		indR                = F[5 + indF];
+		R                   = plan->start[f + 1] - plan->start[f];
+		for (r = 0 ; r < R ; r++)
+		{
+			coeffw          = w/(int)rect_param[1 + indR];
+			coeffh          = h/(int)rect_param[2 + indR];
+			xr              = x + coeffw*(int)rect_param[5 + indR];
+			yr              = y + coeffh*(int)rect_param[6 + indR];
+			wr              = coeffw*(int)(rect_param[7 + indR]);
+			hr              = coeffh*(int)(rect_param[8 + indR]);
+			ind             = plan->start[f] + r;
+			plan->off[4*ind]     = (yr + hr) + (xr + wr)*Ny1;
+			plan->off[4*ind + 1] = yr + (xr + wr)*Ny1;
+			plan->off[4*ind + 2] = (yr + hr) + xr*Ny1;
+			plan->off[4*ind + 3] = yr + xr*Ny1;
+			plan->s[ind]    = rect_param[9 + indR];
+			indR           += 10;
+		}
 	}
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
+void free_haar_plan(struct haar_plan *plan)
+{
+	free(plan->start);
+	free(plan->off);
+	free(plan->s);
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
 void haar_featlist(int ny , int nx , double *rect_param , int nR , unsigned int *F )
 {
 	int  r , indF = 0 , indrect = 0 , currentfeat = 0 , temp , W , H , w , h , x , y;
@@ -948,41 +834,27 @@ int number_haar_features(int ny , int nx , double *rect_param , int nR)
 	return nF;
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
-void MakeIntegralImage(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax , unsigned int *pTemp)
+void MakeIntegralImagePad(unsigned char *pIn, unsigned int *pOut, int iXmax, int iYmax)
 {
-	/* Variable declaration */
-	int x , y , indx = 0;
-		
-	for(x=0 ; x<iXmax ; x++)
-	{
-		pTemp[indx]     = (unsigned int) pIn[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
-	{
-		pTemp[y]        = pTemp[y - 1] + (unsigned int)pIn[y];
-	}
-	pOut[0]             = (unsigned int) pIn[0];
-	indx                = iYmax;
-	for(x=1 ; x<iXmax ; x++)
-	{
-		pOut[indx]      = pOut[indx - iYmax] + pTemp[indx];
-		indx           += iYmax;
-	}
-	for(y = 1 ; y<iYmax ; y++)
+	/* Integral image with a zero first row and column : pOut is (iYmax+1 x iXmax+1), pOut[y + x*(iYmax+1)] = sum of pIn over [0,y-1]x[0,x-1] */
+	int x , y , iYmax1 = iYmax + 1 , indx , indx1;
+	unsigned int col;
+
+	for(y = 0 ; y < iYmax1 ; y++)
 	{
-		pOut[y]         = pOut[y - 1] + (unsigned int)pIn[y];
+		pOut[y]             = 0;
 	}
-	/* Calculate integral image */
-	indx                = iYmax;
-	for(x = 1 ; x < iXmax ; x++)
+	for(x = 0 ; x < iXmax ; x++)
 	{
-		for(y = 1 ; y < iYmax ; y++)
+		indx                = x*iYmax;
+		indx1               = (x + 1)*iYmax1;
+		col                 = 0;
+		pOut[indx1]         = 0;
+		for(y = 0 ; y < iYmax ; y++)
 		{
-			pTemp[y + indx]    = pTemp[y - 1 + indx] + (unsigned int)pIn[y + indx];	
-			pOut[y + indx]     = pOut[y + indx - iYmax] + pTemp[y + indx];
+			col                += (unsigned int)pIn[y + indx];
+			pOut[y + 1 + indx1] = pOut[y + 1 + indx1 - iYmax1] + col;
 		}
-		indx += iYmax;
 	}
 }
-/*----------------------------------------------------------------------------------------------------------------------------------------------*/
+/*----------------------------------------------------------------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -42,6 +42,10 @@
 	    max_ite                         Maximum number of iteration (default max_ite = 10)
 	    epsi                            Sigmoid parameter (default epsi = 1)
         premodel                        Classifier's premodels parameter up to n-1 stage (4 x Npremodels)(default premodel = [] for stage n=1)
+        trimming                        Weight trimming for the decision stump (weaklearner = 0): except every trimming_period rounds, the stump of a round
+                                        is only searched on the samples with largest weights covering (1 - trimming) of the weight mass. Weights of all
+                                        samples are always updated (default trimming = 0 <=> no trimming)
+        trimming_period                Number of rounds between two stump searches on all samples (default trimming_period = 10)
 
 If compiled with the "OMP" compilation flag
 
@@ -282,6 +286,8 @@ struct opts
     int            max_ite;
     double         *premodel;
     int            Npremodel;
+    double         trimming;
+    int            trimming_period;
 #ifdef OMP 
     int            num_threads;
 #endif
@@ -296,6 +302,7 @@ void haar_featlist(int , int , double * , int  , unsigned int * );
 double Area(double * , int , int , int , int , int );
 double haar_feat(double *  , int  , double * , unsigned int * , int , int , int );
 void qsindex( double * , int * , int , int  );
+int trim_weights(double * , int , double , double * , int * , char * , double *);
 void  gentelboost_decision_stump(double *, char *, int , int , int , struct opts ,  double *);
 void  gentelboost_perceptron(double *, char *, int , int , int , struct opts ,  double *);
 
@@ -321,6 +328,8 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	options.nR          = 4;
     options.nF          = 0;
 	options.weaklearner = 0; 
+	options.trimming    = 0.0;
+	options.trimming_period = 10;
 #ifdef OMP 
     options.num_threads = -1;
 #endif
@@ -465,6 +474,37 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 			options.premodel                      =  mxGetPr(mxtemp);
 			options.Npremodel                     =  mxGetN(mxtemp);
 		}
+
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			if((tmp[0] < 0.0) || (tmp[0] >= 1.0))
+			{
+				mexPrintf("0 <= trimming < 1, force to 0");
+				options.trimming          = 0.0;
+			}
+			else
+			{
+				options.trimming          = tmp[0];
+			}
+		}
+
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming_period");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			tempint                       = (int) tmp[0];
+			if(tempint < 1)
+			{
+				mexPrintf("trimming_period > 0, force to 10");
+				options.trimming_period   = 10;
+			}
+			else
+			{
+				options.trimming_period   = tempint;
+			}
+		}
 #ifdef OMP 
 		mxtemp                            = mxGetField( prhs[2] , 0, "num_threads" );
 		if(mxtemp != NULL)
@@ -547,15 +587,25 @@ void  gentelboost_decision_stump(double *II , char *y , int Ny , int Nx , int N
 	int num_threads = options.num_threads;
 #endif
 	int i , j , t;	
-	int NyNx = Ny*Nx , indM  , ind , N1 = N - 1 , featuresIdx_opt;
+	int NyNx = Ny*Nx , indM  , ind , featuresIdx_opt;
 	double cteN =1.0/(double)N , atemp , btemp  , sumSw , Eyw , fm  , temp , sumwyy , error , errormin, th_opt , a_opt , b_opt;
 	double wtemp , Sw , Syw;
 	double *w ;
 	double *xtemp , z;
 	int *index , *indexF;
+	double trimming = options.trimming , mass , cteW;
+	int trimming_period = options.trimming_period , Na , Na1 , n;
+	double *wa , *wsort;
+	int *act , *idw;
+	char *active;
 
 	w                = (double *)malloc(N*sizeof(double));
 	indexF           = (int *)malloc(nF*sizeof(int));
+	wa               = (double *)malloc(N*sizeof(double));
+	wsort            = (double *)malloc(N*sizeof(double));
+	act              = (int *)malloc(N*sizeof(int));
+	idw              = (int *)malloc(N*sizeof(int));
+	active           = (char *)malloc(N*sizeof(char));
 
 #ifdef OMP 
 	num_threads      = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
@@ -616,8 +666,36 @@ void  gentelboost_decision_stump(double *II , char *y , int Ny , int Nx , int N
 	{		
 		errormin = huge;
 
+		/* Weight trimming : restrict the stump search to the samples carrying (1 - trimming) of the weight mass */
+
+		if((trimming > 0.0) && (t % trimming_period))
+		{
+			Na                   = trim_weights(w , N , trimming , wsort , idw , active , &mass);
+			cteW                 = 1.0/mass;
+		}
+		else
+		{
+			for(i = 0 ; i < N ; i++)
+			{
+				active[i]        = 1;
+			}
+			Na                   = N;
+			cteW                 = 1.0;
+		}
+		Na1                      = Na - 1;
+
+		n                        = 0;
+		for(i = 0 ; i < N ; i++)
+		{
+			if(active[i])
+			{
+				act[n++]         = i;
+			}
+			wa[i]                = w[i]*cteW;
+		}
+
 #ifdef OMP 
-#pragma omp parallel default(none) private(error,xtemp,index,wtemp,atemp,btemp,temp,j,i,ind,Eyw,sumwyy) shared(N,N1,NyNx,Ny,nR,nF,indexF,II,w,y,rect_param,F,featuresIdx_opt,th_opt,a_opt,b_opt,errormin) reduction (+:Sw,Syw)
+#pragma omp parallel default(none) private(error,xtemp,index,wtemp,atemp,btemp,temp,j,i,ind,Eyw,sumwyy) shared(N,Na,Na1,act,NyNx,Ny,nR,nF,indexF,II,wa,y,rect_param,F,featuresIdx_opt,th_opt,a_opt,b_opt,errormin) reduction (+:Sw,Syw)
 #endif
 		{
 
@@ -636,24 +714,25 @@ void  gentelboost_decision_stump(double *II , char *y , int Ny , int Nx , int N
 					Eyw              = 0.0;
 					sumwyy           = 0.0;
 
-					for(i = 0 ; i < N ; i++)	
+					for(i = 0 ; i < Na ; i++)	
 					{	
-						index[i]    = i;
-						xtemp[i]    = haar_feat(II + i*NyNx , j , rect_param , F , Ny , nR , nF);
-						temp        = y[i]*w[i];
+						ind         = act[i];
+						index[i]    = ind;
+						xtemp[i]    = haar_feat(II + ind*NyNx , j , rect_param , F , Ny , nR , nF);
+						temp        = y[ind]*wa[ind];
 						Eyw        += temp;
-						sumwyy     += y[i]*temp;
+						sumwyy     += y[ind]*temp;
 					}
 
-					qsindex(xtemp , index , 0 , N1);			
+					qsindex(xtemp , index , 0 , Na1);			
 					Sw              = 0.0;
 					Syw             = 0.0;
 
-					for(i = 0 ; i < N ; i++)
+					for(i = 0 ; i < Na ; i++)
 
 					{
 						ind         = index[i];
-						wtemp       = w[ind];
+						wtemp       = wa[ind];
 						Sw         += wtemp;
 						Syw        += y[ind]*wtemp;
 						btemp       = Syw/Sw;
@@ -674,7 +753,7 @@ void  gentelboost_decision_stump(double *II , char *y , int Ny , int Nx , int N
 							errormin        = error;	
 							featuresIdx_opt = j;
 
-							if(i < N1)
+							if(i < Na1)
 							{	
 								th_opt     = (xtemp[i] + xtemp[i + 1])/2;	
 							}
@@ -729,6 +808,11 @@ void  gentelboost_decision_stump(double *II , char *y , int Ny , int Nx , int N
 
 	free(w);	
 	free(indexF);
+	free(wa);
+	free(wsort);
+	free(act);
+	free(idw);
+	free(active);
 
 #ifdef OMP
 
@@ -942,6 +1026,34 @@ void qsindex (double  *a, int *index , int lo, int hi)
     if (i<hi) qsindex(a , index , i , hi);
 }
 
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+int trim_weights(double *w , int N , double trimming , double *wsort , int *idw , char *active , double *mass)
+{
+	/* Flag the samples with largest weights covering (1 - trimming) of the total weight mass.
+	   Return their number and their mass in mass */
+
+	int i , Na = 0;
+	double total = 0.0 , cum = 0.0 , target;
+
+	for(i = 0 ; i < N ; i++)
+	{
+		wsort[i]      = w[i];
+		idw[i]        = i;
+		active[i]     = 0;
+		total        += w[i];
+	}
+	qsindex(wsort , idw , 0 , N - 1);
+
+	target            = (1.0 - trimming)*total;
+	for(i = N - 1 ; (i >= 0) && (cum < target) ; i--)
+	{
+		cum          += wsort[i];
+		active[idw[i]] = 1;
+		Na++;
+	}
+	*mass             = cum;
+	return Na;
+}
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 
 void randini(void)
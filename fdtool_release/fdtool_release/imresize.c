@@ -30,6 +30,8 @@
 
   If compiled with the "OMP" compilation flag
 
+  SSE2 kernels are used on x86/x64 targets, otherwise a scalar loop with the same fixed-point arithmetic
+
   mex  -DOMP -f mexopts_intel10.bat -output imresize.dll imresize.c "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_core.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_c.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_thread.lib" "C:\Program Files\Intel\Compiler\11.1\065\lib\ia32\libiomp5md.lib"
 
 
@@ -56,7 +58,8 @@
  -------  Date : 01/20/2009
 
  Changelog :  - Add OpenMP support
- ----------   
+ ----------   - Fixed-point (12 bits) bilinear weights tabulated per output row/column, columns interpolated with SSE2,
+                output within 1 LSB of the double version. Fix OMP clause
 
  Reference ""
 
@@ -69,8 +72,18 @@
  #include <omp.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+ #define RESIZE_SSE2
+ #include <emmintrin.h>
+#endif
+
 #define tiny  1e-7
 
+/* bilinear weights in 1/2^RESIZE_SHIFT units, RESIZE_SHIFT <= 12 so that the interpolated value (2*RESIZE_SHIFT + 8 bits) fits an unsigned int */
+
+#define RESIZE_SHIFT 12
+#define RESIZE_ONE   (1 << RESIZE_SHIFT)
+
 /*-------------------------------------------------------------------------------------------------------------- */
 /* Function prototypes */
 
@@ -131,32 +144,90 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
 void imresize(unsigned char *X , int Ny , int Nx , int ny , int nx ,  unsigned char *Y)
 {
-	int i , j  , indny = 0 , indfx , idx , idx1 , fy  , fx;
-	double deltay = (Ny-1)/((double)(ny-1) + tiny) , deltax = (Nx-1)/((double)(nx-1) + tiny) , x = 0.0 , y , tx , tx1 , ty , ty1;
+	/* Source columns/rows and weights of each output column/row are tabulated once. Output column i first interpolates its two
+	   source columns over the source rows in h, then each output pixel interpolates h between its two source rows */
+
+	int i , j , y , ymax , w0 , w1 , *fx , *fx1 , *wx , *fy , *fy1 , *wy;
+	unsigned char *c0 , *c1;
+	unsigned int *h;
+	double deltay = (Ny-1)/((double)(ny-1) + tiny) , deltax = (Nx-1)/((double)(nx-1) + tiny) , t;
+#ifdef RESIZE_SSE2
+	__m128i zero = _mm_setzero_si128() , w , a , b;
+#endif
+
+	fx              = (int *)malloc(nx*sizeof(int));
+	fx1             = (int *)malloc(nx*sizeof(int));
+	wx              = (int *)malloc(nx*sizeof(int));
+	fy              = (int *)malloc(ny*sizeof(int));
+	fy1             = (int *)malloc(ny*sizeof(int));
+	wy              = (int *)malloc(ny*sizeof(int));
+
+	for(i = 0 ; i < nx ; i++)
+	{
+		t           = i*deltax;
+		fx[i]       = (int)t;
+		fx1[i]      = (fx[i] + 1 < Nx) ? (fx[i] + 1) : fx[i];
+		wx[i]       = (int)((t - fx[i])*RESIZE_ONE + 0.5);
+	}
+	for(j = 0 ; j < ny ; j++)
+	{
+		t           = j*deltay;
+		fy[j]       = (int)t;
+		fy1[j]      = (fy[j] + 1 < Ny) ? (fy[j] + 1) : fy[j];
+		wy[j]       = (int)((t - fy[j])*RESIZE_ONE + 0.5);
+	}
+	ymax            = (ny > 0) ? (fy1[ny - 1] + 1) : 0;
 
 #ifdef OMP 
-#pragma omp parallel for default(none) firstprivate(j,fy,ty,ty1,idx,idx1) lastprivate(i,fx,tx,tx1,indfx) shared(X,Y,nx,ny,Ny,deltax,deltay) reduction(*:x,y,indny)
+#ifdef RESIZE_SSE2
+#pragma omp parallel default(none) private(i,j,y,w0,w1,c0,c1,h,w,a,b) shared(X,Y,Ny,nx,ny,ymax,fx,fx1,wx,fy,fy1,wy,zero)
+#else
+#pragma omp parallel default(none) private(i,j,y,w0,w1,c0,c1,h) shared(X,Y,Ny,nx,ny,ymax,fx,fx1,wx,fy,fy1,wy)
+#endif
 #endif
-
-	for(i = 0 ; i < nx ; i++) /* Loop shift on x-axis */
 	{
-		x                 = i*deltax;
-        indny             = i*ny;
-		fx                = (int)floor(x);
-		tx                = x - fx;
-		tx1               = 1.0 - tx;
-		indfx             = fx*Ny;
-		y                 = 0.0;
-		for(j = 0 ; j < ny ; j++)   /* Loop shift on y-axis  */
+		h           = (unsigned int *)malloc((ymax + 1)*sizeof(unsigned int));
+
+#ifdef OMP 
+#pragma omp for nowait
+#endif
+		for(i = 0 ; i < nx ; i++) /* Loop shift on x-axis */
 		{
-			y             = j*deltay;
-			fy            = (int)floor(y);
-			ty            = y - fy;
-			ty1           = 1.0 - ty;
-			idx           = fy + indfx;
-			idx1          = idx + Ny;
-			Y[j + indny]  = (X[idx]*ty1 + X[idx + 1]*ty)*tx1 + ( X[idx1]*ty1 + X[idx1 + 1]*ty )*tx;
+			c0      = X + fx[i]*Ny;
+			c1      = X + fx1[i]*Ny;
+			w1      = wx[i];
+			w0      = RESIZE_ONE - w1;
+			y       = 0;
+#ifdef RESIZE_SSE2
+			/* (c0[y] , c1[y]) pairs of 16 bits times (w0 , w1) by pmaddwd, 16 rows per step */
+			w       = _mm_set1_epi32((w1 << 16) | w0);
+			for( ; y + 16 <= ymax ; y += 16)
+			{
+				a   = _mm_loadu_si128((const __m128i *)(c0 + y));
+				b   = _mm_loadu_si128((const __m128i *)(c1 + y));
+				_mm_storeu_si128((__m128i *)(h + y)      , _mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(a , b) , zero) , w));
+				_mm_storeu_si128((__m128i *)(h + y + 4)  , _mm_madd_epi16(_mm_unpackhi_epi8(_mm_unpacklo_epi8(a , b) , zero) , w));
+				_mm_storeu_si128((__m128i *)(h + y + 8)  , _mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpackhi_epi8(a , b) , zero) , w));
+				_mm_storeu_si128((__m128i *)(h + y + 12) , _mm_madd_epi16(_mm_unpackhi_epi8(_mm_unpackhi_epi8(a , b) , zero) , w));
+			}
+#endif
+			for( ; y < ymax ; y++)
+			{
+				h[y] = c0[y]*w0 + c1[y]*w1;
+			}
+			for(j = 0 ; j < ny ; j++)   /* Loop shift on y-axis  */
+			{
+				Y[j + i*ny]  = (unsigned char)((h[fy[j]]*(RESIZE_ONE - wy[j]) + h[fy1[j]]*wy[j]) >> (2*RESIZE_SHIFT));
+			}
 		}
+		free(h);
 	}
+
+	free(fx);
+	free(fx1);
+	free(wx);
+	free(fy);
+	free(fy1);
+	free(wy);
 }
-/*----------------------------------------------------------------------------------------------------------------------------------------- */
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
\ No newline at end of file
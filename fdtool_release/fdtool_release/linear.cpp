@@ -5,6 +5,13 @@
 #include <stdarg.h>
 #include "linear.h"
 #include "tron.h"
+#ifdef OMP
+#include <omp.h>
+#endif
+#if defined(_DENSE_REP) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define DENSE_SSE2
+#include <emmintrin.h>
+#endif
 typedef signed char schar;
 template <class T> static inline void swap(T& x, T& y) { T t=x; x=y; y=t; }
 #ifndef min
@@ -43,6 +50,363 @@ static void info(const char *fmt,...)
 static void info(const char *fmt,...) {}
 #endif
 
+#ifdef _DENSE_REP
+/*
+ Dense instance access. x[i] holds the d values of instance i, stored as prob->xtype (double, single,
+ uint8 or uint16, e.g. pointing directly into a column-major matrix), the feature values being
+ prob->xscale*x[i][k]; the bias feature is not stored.
+ With an implicit homogeneous kernel map (prob->hom != NULL), x[i] only holds the d bins and each
+ psi(x[i][k]) (n1 values) is interpolated from hom->table on the fly, exactly as homkermap.c does,
+ so w is the same as when training on homkermap(X). Bins with psi = 0 are skipped.
+*/
+static inline const double *hom_psi(const homkermap *hom, double x, double *t)
+{
+	int exponent, n1 = hom->n1, numsubdiv = hom->numsubdiv;
+	double subdiv = 1.0/numsubdiv;
+	double mantissa = frexp(x, &exponent);
+
+	mantissa *= 2;
+	exponent--;
+	if (mantissa == 0 || exponent <= hom->minexponent || exponent >= hom->maxexponent)
+		return NULL;
+
+	int v1 = (exponent - hom->minexponent)*numsubdiv*n1;
+	mantissa -= 1.0;
+	while (mantissa >= subdiv)
+	{
+		mantissa -= subdiv;
+		v1 += n1;
+	}
+	*t = numsubdiv*mantissa;
+	return hom->table + v1;
+}
+
+#ifdef DENSE_SSE2
+/* loads s[0..3] as two pairs of doubles */
+static inline void load4(const double *s, __m128d &lo, __m128d &hi)
+{
+	lo = _mm_loadu_pd(s);
+	hi = _mm_loadu_pd(s + 2);
+}
+
+static inline void load4(const float *s, __m128d &lo, __m128d &hi)
+{
+	__m128 f = _mm_loadu_ps(s);
+	lo = _mm_cvtps_pd(f);
+	hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+}
+
+static inline void load4(const unsigned char *s, __m128d &lo, __m128d &hi)
+{
+	int b;
+	memcpy(&b, s, sizeof(int));
+	__m128i zero = _mm_setzero_si128();
+	__m128i q = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(b), zero), zero);
+	lo = _mm_cvtepi32_pd(q);
+	hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(q, _MM_SHUFFLE(1,0,3,2)));
+}
+
+static inline void load4(const unsigned short *s, __m128d &lo, __m128d &hi)
+{
+	__m128i q = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)s), _mm_setzero_si128());
+	lo = _mm_cvtepi32_pd(q);
+	hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(q, _MM_SHUFFLE(1,0,3,2)));
+}
+#endif
+
+/* kernels on the stored values (n x 1) */
+template <class T> static inline double dot_kernel(const T *s, const double *v, int n)
+{
+	int j = 0;
+	double sum = 0;
+#ifdef DENSE_SSE2
+	__m128d lo, hi, acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+	double tmp[2];
+
+	for(;j+4<=n;j+=4)
+	{
+		load4(s + j, lo, hi);
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, _mm_loadu_pd(v + j)));
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, _mm_loadu_pd(v + j + 2)));
+	}
+	_mm_storeu_pd(tmp, _mm_add_pd(acc0, acc1));
+	sum = tmp[0] + tmp[1];
+#endif
+	for(;j<n;j++)
+		sum+=v[j]*s[j];
+	return sum;
+}
+
+template <class T> static inline void axpy_kernel(const T *s, double a, double *v, int n)
+{
+	int j = 0;
+#ifdef DENSE_SSE2
+	__m128d lo, hi, va = _mm_set1_pd(a);
+
+	for(;j+4<=n;j+=4)
+	{
+		load4(s + j, lo, hi);
+		_mm_storeu_pd(v + j, _mm_add_pd(_mm_loadu_pd(v + j), _mm_mul_pd(va, lo)));
+		_mm_storeu_pd(v + j + 2, _mm_add_pd(_mm_loadu_pd(v + j + 2), _mm_mul_pd(va, hi)));
+	}
+#endif
+	for(;j<n;j++)
+		v[j]+=a*s[j];
+}
+
+template <class T> static inline double sqnorm_kernel(const T *s, int n)
+{
+	int j = 0;
+	double sum = 0;
+#ifdef DENSE_SSE2
+	__m128d lo, hi, acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+	double tmp[2];
+
+	for(;j+4<=n;j+=4)
+	{
+		load4(s + j, lo, hi);
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+	}
+	_mm_storeu_pd(tmp, _mm_add_pd(acc0, acc1));
+	sum = tmp[0] + tmp[1];
+#endif
+	for(;j<n;j++)
+		sum+=(double)s[j]*s[j];
+	return sum;
+}
+
+/* number of stored values per instance : the n features (without the bias), or the d bins */
+static inline int dense_nr_value(const problem *prob)
+{
+	if(prob->hom != NULL)
+		return prob->hom->d;
+	return prob->n - (prob->bias >= 0);
+}
+
+/* number of blocks of x (and w) for the _range functions : the values (features or bins) and the bias */
+static inline int dense_nr_block(const problem *prob)
+{
+	return dense_nr_value(prob) + (prob->bias >= 0);
+}
+
+/* value k of x, i.e. xscale*x[k] */
+static inline double dense_value(const problem *prob, const void *s, int k)
+{
+	switch(prob->xtype)
+	{
+		case DENSE_SINGLE:
+			return prob->xscale*((const float *)s)[k];
+		case DENSE_UINT8:
+			return prob->xscale*((const unsigned char *)s)[k];
+		case DENSE_UINT16:
+			return prob->xscale*((const unsigned short *)s)[k];
+		default:
+			return prob->xscale*((const double *)s)[k];
+	}
+}
+
+/* returns sum_{k0 <= k < k1} x[k] v[k] on the stored values */
+static inline double dense_dot_values(const problem *prob, const void *s, const double *v, int k0, int k1)
+{
+	switch(prob->xtype)
+	{
+		case DENSE_SINGLE:
+			return dot_kernel((const float *)s + k0, v + k0, k1 - k0);
+		case DENSE_UINT8:
+			return dot_kernel((const unsigned char *)s + k0, v + k0, k1 - k0);
+		case DENSE_UINT16:
+			return dot_kernel((const unsigned short *)s + k0, v + k0, k1 - k0);
+		default:
+			return dot_kernel((const double *)s + k0, v + k0, k1 - k0);
+	}
+}
+
+/* v[k] += a*x[k], k0 <= k < k1, on the stored values */
+static inline void dense_axpy_values(const problem *prob, const void *s, double a, double *v, int k0, int k1)
+{
+	switch(prob->xtype)
+	{
+		case DENSE_SINGLE:
+			axpy_kernel((const float *)s + k0, a, v + k0, k1 - k0);
+			break;
+		case DENSE_UINT8:
+			axpy_kernel((const unsigned char *)s + k0, a, v + k0, k1 - k0);
+			break;
+		case DENSE_UINT16:
+			axpy_kernel((const unsigned short *)s + k0, a, v + k0, k1 - k0);
+			break;
+		default:
+			axpy_kernel((const double *)s + k0, a, v + k0, k1 - k0);
+			break;
+	}
+}
+
+/* returns x^T v, restricted to the blocks k0 <= k < k1 of dense_nr_block */
+static inline double dense_dot_range(const problem *prob, const void *s, const double *v, int k0, int k1)
+{
+	const homkermap *hom = prob->hom;
+	int d = dense_nr_value(prob);
+	double sum = 0, t;
+
+	if(hom == NULL)
+	{
+		if(k0 < min(k1,d))
+			sum = prob->xscale*dense_dot_values(prob, s, v, k0, min(k1,d));
+		if(k1 > d)
+			sum+=v[d]*prob->bias;
+		return sum;
+	}
+	int n1 = hom->n1;
+	for(int k=k0;k<min(k1,d);k++)
+	{
+		const double *f1 = hom_psi(hom, dense_value(prob, s, k), &t);
+		if(f1 == NULL)
+			continue;
+		const double *f2 = f1 + n1, *vk = v + k*n1;
+		for(int j=0;j<n1;j++)
+			sum+=vk[j]*((f2[j] - f1[j])*t + f1[j]);
+	}
+	if(k1 > d)
+		sum+=v[d*n1]*prob->bias;
+	return sum;
+}
+
+/* v += a*x, restricted to the blocks k0 <= k < k1 */
+static inline void dense_axpy_range(const problem *prob, const void *s, double a, double *v, int k0, int k1)
+{
+	const homkermap *hom = prob->hom;
+	int d = dense_nr_value(prob);
+	double t;
+
+	if(hom == NULL)
+	{
+		if(k0 < min(k1,d))
+			dense_axpy_values(prob, s, a*prob->xscale, v, k0, min(k1,d));
+		if(k1 > d)
+			v[d]+=a*prob->bias;
+		return;
+	}
+	int n1 = hom->n1;
+	for(int k=k0;k<min(k1,d);k++)
+	{
+		const double *f1 = hom_psi(hom, dense_value(prob, s, k), &t);
+		if(f1 == NULL)
+			continue;
+		const double *f2 = f1 + n1;
+		double *vk = v + k*n1;
+		for(int j=0;j<n1;j++)
+			vk[j]+=a*((f2[j] - f1[j])*t + f1[j]);
+	}
+	if(k1 > d)
+		v[d*n1]+=a*prob->bias;
+}
+
+/* returns x^T v */
+static inline double dense_dot(const problem *prob, const void *s, const double *v)
+{
+	return dense_dot_range(prob, s, v, 0, dense_nr_block(prob));
+}
+
+/* v += a*x */
+static inline void dense_axpy(const problem *prob, const void *s, double a, double *v)
+{
+	dense_axpy_range(prob, s, a, v, 0, dense_nr_block(prob));
+}
+
+#ifdef OMP
+/* blocks of w owned by the calling thread in a parallel X^T v or dual coordinate descent */
+static inline void dense_thread_range(const problem *prob, int *k0, int *k1)
+{
+	int nr_block = dense_nr_block(prob), t = omp_get_thread_num(), nt = omp_get_num_threads();
+
+	*k0 = (int)(((double)nr_block*t)/nt);
+	*k1 = (int)(((double)nr_block*(t+1))/nt);
+}
+#endif
+
+/* returns sum + x^T x */
+static inline double dense_sqnorm(const problem *prob, const void *s, double sum)
+{
+	const homkermap *hom = prob->hom;
+	int d = dense_nr_value(prob);
+	double t, psi;
+
+	if(prob->bias >= 0)
+		sum+=prob->bias*prob->bias;
+	if(hom == NULL)
+	{
+		switch(prob->xtype)
+		{
+			case DENSE_SINGLE:
+				psi = sqnorm_kernel((const float *)s, d);
+				break;
+			case DENSE_UINT8:
+				psi = sqnorm_kernel((const unsigned char *)s, d);
+				break;
+			case DENSE_UINT16:
+				psi = sqnorm_kernel((const unsigned short *)s, d);
+				break;
+			default:
+				psi = sqnorm_kernel((const double *)s, d);
+				break;
+		}
+		return sum + prob->xscale*prob->xscale*psi;
+	}
+	int n1 = hom->n1;
+	for(int k=0;k<d;k++)
+	{
+		const double *f1 = hom_psi(hom, dense_value(prob, s, k), &t);
+		if(f1 == NULL)
+			continue;
+		const double *f2 = f1 + n1;
+		for(int j=0;j<n1;j++)
+		{
+			psi = (f2[j] - f1[j])*t + f1[j];
+			sum+=psi*psi;
+		}
+	}
+	return sum;
+}
+
+/* returns the n features of x (bias included), expanded into buf (n x 1) unless x already holds them as double */
+static inline double *dense_x(const problem *prob, void *s, double *buf)
+{
+	const homkermap *hom = prob->hom;
+	int d = dense_nr_value(prob);
+	double t;
+
+	if(hom == NULL)
+	{
+		if(prob->xtype == DENSE_DOUBLE && prob->xscale == 1 && prob->bias < 0)
+			return (double *)s;
+		for(int k=0;k<d;k++)
+			buf[k] = dense_value(prob, s, k);
+		if(prob->bias >= 0)
+			buf[d] = prob->bias;
+		return buf;
+	}
+	int n1 = hom->n1;
+	for(int k=0;k<d;k++)
+	{
+		const double *f1 = hom_psi(hom, dense_value(prob, s, k), &t);
+		double *bk = buf + k*n1;
+		if(f1 == NULL)
+		{
+			for(int j=0;j<n1;j++)
+				bk[j] = 0;
+			continue;
+		}
+		const double *f2 = f1 + n1;
+		for(int j=0;j<n1;j++)
+			bk[j] = (f2[j] - f1[j])*t + f1[j];
+	}
+	if(prob->bias >= 0)
+		buf[d*n1] = prob->bias;
+	return buf;
+}
+#endif
+
 class l2r_lr_fun : public function
 {
 public:
@@ -166,18 +530,13 @@ void l2r_lr_fun::Xv(double *v, double *Xv)
 	int l=prob->l;
 
 #ifdef _DENSE_REP
-        int w_size = get_nr_variable();
-	double **x = prob->x;
-	
+	void **x = prob->x;
+
+#ifdef OMP
+#pragma omp parallel for
+#endif
 	for(i=0;i<l;i++)
-	{
-		double *s=x[i];
-		Xv[i]=0;
-		for(int j=0;j<w_size;j++)
-		{
-                        Xv[i]+=v[j]*s[j];
-		}
-	}
+		Xv[i]=dense_dot(prob, x[i], v);
 #else
 	feature_node **x=prob->x;
 
@@ -201,19 +560,25 @@ void l2r_lr_fun::XTv(double *v, double *XTv)
 	int w_size=get_nr_variable();
 
 #ifdef _DENSE_REP
- 	double **x = prob->x;
+	void **x = prob->x;
 
 	for(i=0;i<w_size;i++)
 		XTv[i]=0;
 
-	for(i=0;i<l;i++)
+#ifdef OMP
+	/* each thread accumulates its own blocks of XTv over all instances, same sums as the serial loop */
+#pragma omp parallel private(i)
 	{
-		double *s=x[i];
-		for(int j=0;j<w_size;j++)
-		{
-		        XTv[j]+=v[i]*s[j];
-		}
+		int k0, k1;
+
+		dense_thread_range(prob, &k0, &k1);
+		for(i=0;i<l;i++)
+			dense_axpy_range(prob, x[i], v[i], XTv, k0, k1);
 	}
+#else
+	for(i=0;i<l;i++)
+		dense_axpy(prob, x[i], v[i], XTv);
+#endif
 #else
 	feature_node **x=prob->x;
 
@@ -359,20 +724,13 @@ void l2r_l2_svc_fun::Xv(double *v, double *Xv)
 	int l=prob->l;
 
 #ifdef _DENSE_REP
-	int j,w_size = get_nr_variable();
-	double **x = prob->x;
-
+	void **x = prob->x;
 
+#ifdef OMP
+#pragma omp parallel for
+#endif
 	for(i=0;i<l;i++)
-	{
-		double *s=x[i];
-		Xv[i]=0;
-		for(j=0;j<w_size;j++)
-		{
-			Xv[i]+=v[j]*s[j];
-
-		}
-	}
+		Xv[i]=dense_dot(prob, x[i], v);
 
 #else
 	feature_node **x=prob->x;
@@ -395,18 +753,13 @@ void l2r_l2_svc_fun::subXv(double *v, double *Xv)
 	int i;
 
 #ifdef _DENSE_REP
-	int j,w_size = get_nr_variable();
-	double **x=prob->x;
+	void **x=prob->x;
 
+#ifdef OMP
+#pragma omp parallel for
+#endif
 	for(i=0;i<sizeI;i++)
-	{
-		double *s=x[I[i]];
-		Xv[i]=0;
-		for(j=0;j<w_size;j++)
-		{
-		        Xv[i]+=v[j]*s[j];
-		}
-	}
+		Xv[i]=dense_dot(prob, x[I[i]], v);
 #else
 	feature_node **x=prob->x;
 
@@ -429,19 +782,23 @@ void l2r_l2_svc_fun::subXTv(double *v, double *XTv)
 	int w_size=get_nr_variable();
 
 #ifdef _DENSE_REP
-	double **x=prob->x;
-	int j;
+	void **x=prob->x;
 
 	for(i=0;i<w_size;i++)
 		XTv[i]=0;
-	for(i=0;i<sizeI;i++)
+#ifdef OMP
+#pragma omp parallel private(i)
 	{
-		double *s=x[I[i]];
-		for(j=0;j<w_size;j++)
-		{
-			XTv[j]+=v[i]*s[j];
-		}
+		int k0, k1;
+
+		dense_thread_range(prob, &k0, &k1);
+		for(i=0;i<sizeI;i++)
+			dense_axpy_range(prob, x[I[i]], v[i], XTv, k0, k1);
 	}
+#else
+	for(i=0;i<sizeI;i++)
+		dense_axpy(prob, x[I[i]], v[i], XTv);
+#endif
 	
 #else
 	feature_node **x=prob->x;
@@ -566,6 +923,7 @@ void Solver_MCSVM_CS::Solve(double *w)
 
 #ifdef _DENSE_REP
 	int j;
+	double *xbuf = new double[w_size];
 #endif
 	int iter = 0;
 	double *alpha =  new double[l*nr_class];
@@ -590,13 +948,7 @@ void Solver_MCSVM_CS::Solve(double *w)
 		for(m=0;m<nr_class;m++)
 			alpha_index[i*nr_class+m] = m;
 #ifdef _DENSE_REP
-		double *xi = prob->x[i];
-
-		QD[i] = 0;
-		for(j = 0; j < w_size; j++)
-		{
-                        QD[i] += xi[j]*xi[j];
-		}  
+		QD[i] = dense_sqnorm(prob, prob->x[i], 0);
 #else
 		feature_node *xi = prob->x[i];
 		QD[i] = 0;
@@ -634,7 +986,7 @@ void Solver_MCSVM_CS::Solve(double *w)
 					G[y_index[i]] = 0;
 
 #ifdef _DENSE_REP
-				double *xi = prob->x[i];
+				double *xi = dense_x(prob, prob->x[i], xbuf);
 				for(j=0; j < w_size ;j++)
 				{
 				        double *w_i = &w[j*nr_class];
@@ -719,7 +1071,7 @@ void Solver_MCSVM_CS::Solve(double *w)
 				}
 
 #ifdef _DENSE_REP
-				xi = prob->x[i];
+				/* xi already holds instance i */
 				for(j = 0; j < w_size; j++)
 				{
 					double *w_i = &w[(j)*nr_class];
@@ -793,6 +1145,9 @@ void Solver_MCSVM_CS::Solve(double *w)
 	delete [] alpha_index;
 	delete [] y_index;
 	delete [] active_size_i;
+#ifdef _DENSE_REP
+	delete [] xbuf;
+#endif
 }
 /*
  A coordinate descent algorithm for 
@@ -827,9 +1182,6 @@ static void solve_l2r_l1l2_svc(
 	int w_size = prob->n;
 	int i, s, iter = 0;
 
-#ifdef _DENSE_REP
-	int j;
-#endif
 	double C, d, G;
 	double *QD = new double[l];
 	int max_iter = 1000;
@@ -870,11 +1222,7 @@ static void solve_l2r_l1l2_svc(
 		}
 
 #ifdef _DENSE_REP
-		double *xi = prob->x[i];
-		for(j = 0; j < w_size ; j++)
-		{
-		        QD[i] += xi[j]*xi[j];
-		}
+		QD[i] = dense_sqnorm(prob, prob->x[i], QD[i]);
 #else
 		feature_node *xi = prob->x[i];
 		while (xi->index != -1)
@@ -904,11 +1252,7 @@ static void solve_l2r_l1l2_svc(
 			schar yi = y[i];
 
 #ifdef _DENSE_REP
-			double *xi = prob->x[i]; 
-        		for(j = 0; j < w_size ; j++)
-			{
-				G += w[j]*xi[j];
-			}
+			G = dense_dot(prob, prob->x[i], w);
 #else
 			feature_node *xi = prob->x[i];
 			while(xi->index!= -1)
@@ -967,11 +1311,7 @@ static void solve_l2r_l1l2_svc(
 				alpha[i] = min(max(alpha[i] - G/QD[i], 0.0), C);
 				d = (alpha[i] - alpha_old)*yi;
 #ifdef _DENSE_REP
-				xi = prob->x[i];
-				for(j = 0; j < w_size; j++)
-				{
-					w[j] += d*xi[j];
-				}
+				dense_axpy(prob, prob->x[i], d, w);
 #else
 				xi = prob->x[i];
 				while (xi->index != -1)
@@ -1036,6 +1376,239 @@ static void solve_l2r_l1l2_svc(
 	delete [] index;
 }
 
+#if defined(_DENSE_REP) && defined(OMP)
+/*
+ Multicore version of solve_l2r_l1l2_svc (nr_thread > 1) for long dense instances.
+
+ Coordinates of w are cut in one chunk per thread of at least DCD_CHUNK_MIN blocks, and each thread
+ owns a contiguous run of chunks. It computes the partial products of xi^T w over its chunks, and
+ after one barrier every thread sums the partials of all the chunks in chunk order, hence takes the
+ same step and shrinking decisions on its own copy of alpha, index and active_size, and updates its
+ own part of w. There is one barrier per coordinate step. The permutations are drawn with rand() by
+ one thread, as in solve_l2r_l1l2_svc, and shared: w differs from solve_l2r_l1l2_svc, and between
+ two numbers of threads, only by the rounding of xi^T w. When w has less than two chunks, the serial
+ solve_l2r_l1l2_svc is used.
+*/
+#define PARTIAL_STRIDE 8	/* one cache line per chunk */
+#define DCD_CHUNK_MIN 256
+
+static void solve_l2r_l1l2_svc_omp(
+	const problem *prob, double *w, double eps, 
+	double Cp, double Cn, int solver_type)
+{
+	int l = prob->l;
+	int w_size = prob->n;
+	int i, nr_thread = omp_get_max_threads();
+	int nr_block = dense_nr_block(prob);
+	int chunk = max((nr_block + nr_thread - 1)/nr_thread, DCD_CHUNK_MIN);
+	int nr_chunk = (nr_block + chunk - 1)/chunk;
+
+	if(nr_chunk < 2)
+	{
+		solve_l2r_l1l2_svc(prob, w, eps, Cp, Cn, solver_type);
+		return;
+	}
+
+	double *QD = new double[l];
+	int max_iter = 1000;
+	double *alpha = new double[l];
+	schar *y = new schar[l];
+	double *partial = new double[2*nr_chunk*PARTIAL_STRIDE];
+	int *draw = new int[l];
+	int iter = 0;
+
+	/* default solver_type: L2R_L2LOSS_SVC_DUAL */
+	double diag_p = 0.5/Cp, diag_n = 0.5/Cn;
+	double upper_bound_p = INF, upper_bound_n = INF;
+	if(solver_type == L2R_L1LOSS_SVC_DUAL)
+	{
+		diag_p = 0; diag_n = 0;
+		upper_bound_p = Cp; upper_bound_n = Cn;
+	}
+
+	for(i=0; i<w_size; i++)
+		w[i] = 0;
+
+#pragma omp parallel for
+	for(i=0; i<l; i++)
+	{
+		if(prob->y[i] > 0)
+		{
+			y[i] = +1; 
+			QD[i] = diag_p;
+		}
+		else
+		{
+			y[i] = -1;
+			QD[i] = diag_n;
+		}
+		QD[i] = dense_sqnorm(prob, prob->x[i], QD[i]);
+	}
+
+#pragma omp parallel num_threads(nr_chunk)
+	{
+		int s, i, c, c0, c1, step = 0, it = 0, active_size = l;
+		int t = omp_get_thread_num(), nt = omp_get_num_threads();
+		int *index = new int[l];
+		double *alpha_t = new double[l];
+		double C, d, G, PG;
+		double PGmax_old = INF, PGmin_old = -INF;
+		double PGmax_new, PGmin_new;
+
+		c0 = (int)(((double)nr_chunk*t)/nt);
+		c1 = (int)(((double)nr_chunk*(t+1))/nt);
+		for(i=0; i<l; i++)
+		{
+			alpha_t[i] = 0;
+			index[i] = i;
+		}
+
+		while (it < max_iter)
+		{
+			PGmax_new = -INF;
+			PGmin_new = INF;
+
+			/* every thread has the same active_size, and draw is read before the barrier
+			   of the first coordinate step */
+#pragma omp single
+			for (i=0; i<active_size; i++)
+				draw[i] = i+rand()%(active_size-i);
+			for (i=0; i<active_size; i++)
+				swap(index[i], index[draw[i]]);
+
+			for (s=0;s<active_size;s++)
+			{
+				double *part = partial + (step&1)*nr_chunk*PARTIAL_STRIDE;
+
+				i = index[s];
+				schar yi = y[i];
+
+				for(c=c0; c<c1; c++)
+					part[c*PARTIAL_STRIDE] = dense_dot_range(prob, prob->x[i], w, c*chunk, min((c+1)*chunk, nr_block));
+				step++;
+#pragma omp barrier
+				G = 0;
+				for(c=0; c<nr_chunk; c++)
+					G += part[c*PARTIAL_STRIDE];
+				G = G*yi-1;
+
+				if(yi == 1)
+				{
+					C = upper_bound_p; 
+					G += alpha_t[i]*diag_p; 
+				}
+				else 
+				{
+					C = upper_bound_n;
+					G += alpha_t[i]*diag_n; 
+				}
+
+				PG = 0;
+				if (alpha_t[i] == 0)
+				{
+					if (G > PGmax_old)
+					{
+						active_size--;
+						swap(index[s], index[active_size]);
+						s--;
+						continue;
+					}
+					else if (G < 0)
+						PG = G;
+				}
+				else if (alpha_t[i] == C)
+				{
+					if (G < PGmin_old)
+					{
+						active_size--;
+						swap(index[s], index[active_size]);
+						s--;
+						continue;
+					}
+					else if (G > 0)
+						PG = G;
+				}
+				else
+					PG = G;
+
+				PGmax_new = max(PGmax_new, PG);
+				PGmin_new = min(PGmin_new, PG);
+
+				if(fabs(PG) > 1.0e-12)
+				{
+					double alpha_old = alpha_t[i];
+					alpha_t[i] = min(max(alpha_t[i] - G/QD[i], 0.0), C);
+					d = (alpha_t[i] - alpha_old)*yi;
+					if(c0 < c1)
+						dense_axpy_range(prob, prob->x[i], d, w, c0*chunk, min(c1*chunk, nr_block));
+				}
+			}
+
+			it++;
+			if(t == 0 && it % 10 == 0)
+				info(".");
+
+			if(PGmax_new - PGmin_new <= eps)
+			{
+				if(active_size == l)
+					break;
+				else
+				{
+					active_size = l;
+					if(t == 0)
+						info("*");
+					PGmax_old = INF;
+					PGmin_old = -INF;
+					continue;
+				}
+			}
+			PGmax_old = PGmax_new;
+			PGmin_old = PGmin_new;
+			if (PGmax_old <= 0)
+				PGmax_old = INF;
+			if (PGmin_old >= 0)
+				PGmin_old = -INF;
+		}
+
+		if(t == 0)
+		{
+			iter = it;
+			memcpy(alpha, alpha_t, sizeof(double)*l);
+		}
+		delete [] index;
+		delete [] alpha_t;
+	}
+
+	info("\noptimization finished, #iter = %d\n",iter);
+	if (iter >= max_iter)
+		info("\nWARNING: reaching max number of iterations\nUsing -s 2 may be faster (also see FAQ)\n\n");
+
+	/* calculate objective value */
+
+	double v = 0;
+	int nSV = 0;
+	for(i=0; i<w_size; i++)
+		v += w[i]*w[i];
+	for(i=0; i<l; i++)
+	{
+		if (y[i] == 1)
+			v += alpha[i]*(alpha[i]*diag_p - 2); 
+		else
+			v += alpha[i]*(alpha[i]*diag_n - 2);
+		if(alpha[i] > 0)
+			++nSV;
+	}
+	info("Objective value = %lf\n",v/2);
+	info("nSV = %d\n",nSV);
+
+	delete [] QD;
+	delete [] alpha;
+	delete [] y;
+	delete [] partial;
+	delete [] draw;
+}
+#endif
+
 /*
  A coordinate descent algorithm for 
  L1-regularized L2-loss support vector classification
@@ -1104,7 +1677,7 @@ static void solve_l1r_l2_svc(
 		xj_sq[j] = 0;
 
 #ifdef _DENSE_REP
-		x = prob_col->x[j]; 
+		x = (double *)prob_col->x[j]; 
 		for(k = 0; k < l; k++)
 		{
 			double val = x[k];
@@ -1141,7 +1714,7 @@ static void solve_l1r_l2_svc(
 			H = 0;
 
 #ifdef _DENSE_REP
-			x = prob_col->x[j];
+			x = (double *)prob_col->x[j];
 			for(k = 0; k < l ; k++)
 			{
 				if(b[k] > 0)
@@ -1221,7 +1794,7 @@ static void solve_l1r_l2_svc(
 				{
 
 #ifdef _DENSE_REP
-					x = prob_col->x[j];
+					x = (double *)prob_col->x[j];
 					for(k = 0; k < l; k++)
 					{
          	                                b[k] += d_diff*x[k];
@@ -1242,7 +1815,7 @@ static void solve_l1r_l2_svc(
 					loss_old = 0;
 					loss_new = 0;
 #ifdef _DENSE_REP
-					x = prob_col->x[j];
+					x = (double *)prob_col->x[j];
 					for(k = 0; k < l; k++)
 					{
 						if(b[k] > 0)
@@ -1256,7 +1829,7 @@ static void solve_l1r_l2_svc(
 				else
 				{
 					loss_new = 0;
-					x = prob_col->x[j];
+					x = (double *)prob_col->x[j];
 					for(k = 0; k < l; k++)
 					{
 						double b_new = b[k] + d_diff*x[k];
@@ -1318,7 +1891,7 @@ static void solve_l1r_l2_svc(
 				{
 					if(w[i]==0) continue;
 #ifdef _DENSE_REP
-					x = prob_col->x[i];
+					x = (double *)prob_col->x[i];
 					for(int pp = 0; pp < l; pp++)
 					{
 						b[pp] -= w[i]*x[pp];
@@ -1368,7 +1941,7 @@ static void solve_l1r_l2_svc(
 	for(j=0; j<w_size; j++)
 	{
 #if _DENSE_REP
-		x = prob_col->x[j];
+		x = (double *)prob_col->x[j];
 		for(int k = 0; k < l; k++)
 		{
 			x[k] *= prob_col->y[k]; /* restore x->value */
@@ -1472,9 +2045,9 @@ static void solve_l1r_lr(
 		C_sum[j] = 0;
 		xjneg_sum[j] = 0;
 		xjpos_sum[j] = 0;
-		x = prob_col->x[j];
 
 #ifdef _DENSE_REP
+		x = (double *)prob_col->x[j];
 		for(k = 0 ; k < l; k++)
 		{
 			double val = x[k];
@@ -1487,6 +2060,7 @@ static void solve_l1r_lr(
 				xjpos_sum[j] += C[y[k]]*val;
 		}
 #else
+		x = prob_col->x[j];
 		while(x->index != -1)
 		{
 			int ind = x->index;
@@ -1520,8 +2094,8 @@ static void solve_l1r_lr(
 			sum2 = 0;
 			H = 0;
 
-			x = prob_col->x[j];
 #ifdef _DENSE_REP
+			x = (double *)prob_col->x[j];
 			for(k = 0; k < l; k++)
 			{
 				double exp_wTxind = exp_wTx[k];
@@ -1533,6 +2107,7 @@ static void solve_l1r_lr(
 				H += tmp1*tmp3;
 			}
 #else
+			x = prob_col->x[j];
 			while(x->index != -1)
 			{
 				int ind = x->index;
@@ -1599,7 +2174,7 @@ static void solve_l1r_lr(
 					if(min(appxcond1,appxcond2) <= 0)
 					{
 #ifdef _DENSE_REP
-						x = prob_col->x[j];
+						x = (double *)prob_col->x[j];
 						for(k = 0; k < l; k++)
 						{
 							exp_wTx[k] *= exp(d*x[k]);
@@ -1619,8 +2194,8 @@ static void solve_l1r_lr(
 				cond += d*xjneg_sum[j];
 
 				int i = 0;
-				x = prob_col->x[j];
 #ifdef _DENSE_REP
+				x = (double *)prob_col->x[j];
 				for(k = 0; k < l; k++)
 				{
 					double exp_dx = exp(d*x[k]);
@@ -1629,6 +2204,7 @@ static void solve_l1r_lr(
 					i++;
 				}
 #else
+				x = prob_col->x[j];
 				while(x->index != -1)
 				{
 					int ind = x->index;
@@ -1641,14 +2217,15 @@ static void solve_l1r_lr(
 				if(cond <= 0)
 				{
 					int i = 0;
-					x = prob_col->x[j];
 #ifdef _DENSE_REP
+					x = (double *)prob_col->x[j];
 					for(k = 0; k < l; k++)
 					{
 						exp_wTx[k] = exp_wTx_new[i];
 						i++;
 					}
 #else
+					x = prob_col->x[j];
 					while(x->index != -1)
 					{
 						int ind = x->index;
@@ -1677,13 +2254,14 @@ static void solve_l1r_lr(
 				for(int i=0; i<w_size; i++)
 				{
 					if(w[i]==0) continue;
-					x = prob_col->x[i];
 #ifdef _DENSE_REP
+					x = (double *)prob_col->x[i];
 					for(k = 0; k < l; k++)
 					{
 						exp_wTx[k] += w[i]*x[k];
 					}
 #else
+					x = prob_col->x[i];
 					while(x->index != -1)
 					{
 						exp_wTx[x->index] += w[i]*x->value;
@@ -1771,7 +2349,11 @@ static void transpose(const problem *prob, feature_node **x_space_ret, problem *
 
 #ifdef _DENSE_REP
 	double *x_space;
-	prob_col->x = new double*[n];
+	double *xbuf = new double[n];
+	prob_col->x = new void*[n];
+	prob_col->hom = NULL;
+	prob_col->xtype = DENSE_DOUBLE;
+	prob_col->xscale = 1;
 #else
 	int *col_ptr = new int[n+1];
 	feature_node *x_space;
@@ -1788,16 +2370,17 @@ static void transpose(const problem *prob, feature_node **x_space_ret, problem *
 	for(i=0; i<n; i++)
 		prob_col->x[i] = &x_space[i*l];
 
-	/*simply transpose the data */
+	/*simply transpose the data, psi(x) being expanded by the implicit kernel map */
 	for(i=0; i<l; i++)
 	{
-	  	double *x = prob->x[i];
-	        for(int j=0; j<n; j++)
+		double *x = dense_x(prob, prob->x[i], xbuf);
+		for(int j=0; j<n; j++)
 		{
-		  x_space[i + j*l] = x[j];
+			x_space[i + j*l] = x[j];
 		}
 	}
 	*x_space_ret = x_space;
+	delete [] xbuf;
 #else
 
 	for(i=0; i<n+1; i++)
@@ -1934,9 +2517,23 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 			break;
 		}
 		case L2R_L2LOSS_SVC_DUAL:
+#if defined(_DENSE_REP) && defined(OMP)
+			if(param->nr_thread > 1)
+			{
+				solve_l2r_l1l2_svc_omp(prob, w, eps, Cp, Cn, L2R_L2LOSS_SVC_DUAL);
+				break;
+			}
+#endif
 			solve_l2r_l1l2_svc(prob, w, eps, Cp, Cn, L2R_L2LOSS_SVC_DUAL);
 			break;
 		case L2R_L1LOSS_SVC_DUAL:
+#if defined(_DENSE_REP) && defined(OMP)
+			if(param->nr_thread > 1)
+			{
+				solve_l2r_l1l2_svc_omp(prob, w, eps, Cp, Cn, L2R_L1LOSS_SVC_DUAL);
+				break;
+			}
+#endif
 			solve_l2r_l1l2_svc(prob, w, eps, Cp, Cn, L2R_L1LOSS_SVC_DUAL);
 			break;
 		case L1R_L2LOSS_SVC:
@@ -1998,6 +2595,10 @@ model* train(const problem *prob, const parameter *param)
 	model_->param = *param;
 	model_->bias = prob->bias;
 
+#ifdef OMP
+	omp_set_num_threads(param->nr_thread);
+#endif
+
 	int nr_class;
 	int *label = NULL;
 	int *start = NULL;
@@ -2029,7 +2630,7 @@ model* train(const problem *prob, const parameter *param)
 
 	/* constructing the subproblem */
 #ifdef _DENSE_REP
-	double **x = Malloc(double *,l);
+	void **x = Malloc(void *,l);
 #else
 	feature_node **x = Malloc(feature_node *,l);
 #endif
@@ -2042,9 +2643,14 @@ model* train(const problem *prob, const parameter *param)
 	sub_prob.l = l;
 	sub_prob.n = n;
 	sub_prob.bias = prob->bias;
+#ifdef _DENSE_REP
+	sub_prob.hom = prob->hom;
+	sub_prob.xtype = prob->xtype;
+	sub_prob.xscale = prob->xscale;
+#endif
 
 #ifdef _DENSE_REP
-	sub_prob.x = Malloc(double *,sub_prob.l);
+	sub_prob.x = Malloc(void *,sub_prob.l);
 #else
 	sub_prob.x = Malloc(feature_node *,sub_prob.l);
 #endif	
@@ -2410,6 +3016,9 @@ const char *check_parameter(const problem *prob, const parameter *param)
 		&& param->solver_type != L1R_LR)
 		return "unknown solver type";
 
+	if(param->nr_thread < 1)
+		return "nr_thread < 1";
+
 	return NULL;
 }
 
@@ -2419,6 +3028,9 @@ void cross_validation(const problem *prob, const parameter *param, int nr_fold,
 	int *fold_start = Malloc(int,nr_fold+1);
 	int l = prob->l;
 	int *perm = Malloc(int,l);
+#ifdef _DENSE_REP
+	double *xbuf = Malloc(double,prob->n);
+#endif
 
 	for(i=0;i<l;i++) perm[i]=i;
 	for(i=0;i<l;i++)
@@ -2437,11 +3049,16 @@ void cross_validation(const problem *prob, const parameter *param, int nr_fold,
 		struct problem subprob;
 
 		subprob.bias = prob->bias;
+#ifdef _DENSE_REP
+		subprob.hom = prob->hom;
+		subprob.xtype = prob->xtype;
+		subprob.xscale = prob->xscale;
+#endif
 		subprob.n = prob->n;
 		subprob.l = l-(end-begin);
 
 #ifdef _DENSE_REP
-		subprob.x = Malloc(double *,subprob.l);
+		subprob.x = Malloc(void *,subprob.l);
 #else
 		subprob.x = Malloc(struct feature_node*,subprob.l);
 #endif
@@ -2461,14 +3078,22 @@ void cross_validation(const problem *prob, const parameter *param, int nr_fold,
 			++k;
 		}
 		struct model *submodel = train(&subprob,param);
+#ifdef _DENSE_REP
+		for(j=begin;j<end;j++)
+			target[perm[j]] = predict(submodel,dense_x(prob,prob->x[perm[j]],xbuf));
+#else
 		for(j=begin;j<end;j++)
 			target[perm[j]] = predict(submodel,prob->x[perm[j]]);
+#endif
 		destroy_model(submodel);
 		free(subprob.x);
 		free(subprob.y);
 	}
 	free(fold_start);
 	free(perm);
+#ifdef _DENSE_REP
+	free(xbuf);
+#endif
 }
 
 int get_nr_feature(const model *model_)
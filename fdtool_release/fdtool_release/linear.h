@@ -7,12 +7,28 @@ extern "C" {
 
 #ifdef _DENSE_REP
 
+/* Implicit homogeneous kernel map : x[i] holds the d bins (then the bias), features psi(x[i]) are interpolated from table */
+struct homkermap
+{
+  int d;
+  int n1;                 /* 2*n+1 features per bin */
+  int numsubdiv;
+  int minexponent;
+  int maxexponent;
+  double *table;          /* (1 x n1*(maxexponent - minexponent + 1)*numsubdiv), see homkertable.c */
+};
+
+enum { DENSE_DOUBLE, DENSE_SINGLE, DENSE_UINT8, DENSE_UINT16 }; /* xtype */
+
 struct problem
 {
   int l,n;
   int *y;
-  double **x;
+  void **x;               /* x[i] : the stored values of instance i (bias excluded), of type xtype */
   double bias;
+  struct homkermap *hom;  /* NULL if x[i] are the n features themselves, else n = d*n1 (+1 with bias) */
+  int xtype;
+  double xscale;          /* feature values are xscale*x[i][k] */
 };
 
 #else
@@ -44,6 +60,7 @@ struct parameter
 	int nr_weight;
 	int *weight_label;
 	double* weight;
+	int nr_thread;		/* number of threads for the dense solvers compiled with OMP */
 };
 
 struct model
@@ -24,6 +24,10 @@
 	     max_ite                        Maximum number of iteration
 		 epsi                           Sigmoid parameter
          premodel                       Classifier's premodels parameter up to n-1 stage (4 x Npremodels)(default premodel = [] for stage n=1)
+         trimming                       Weight trimming for the decision stump (weaklearner = 0): except every trimming_period rounds, the stump of a round
+                                        is only searched on the samples with largest weights covering (1 - trimming) of the weight mass. Weights of all
+                                        samples are always updated (default trimming = 0 <=> no trimming)
+         trimming_period                Number of rounds between two stump searches on all samples (default trimming_period = 10)
 		 transpose                      Suppose X' as input (in order to speed up Boosting algorithm avoiding internal transposing, default tranpose = 0)
 
 If compiled with the "OMP" compilation flag
@@ -293,6 +297,8 @@ struct opts
     double        *premodel;
     int            Npremodel;
 	int            transpose;
+	double         trimming;
+	int            trimming_period;
 
 #ifdef OMP 
     int   num_threads;
@@ -305,6 +311,8 @@ struct opts
 
 void randini(void);
 void qsindex( unsigned char * , int * , int , int  );
+void qsindexw( double * , int * , int , int  );
+int trim_weights(double * , int , double , double * , int * , char * , double *);
 void transposeX(unsigned char *, unsigned char * , int , int);
 void gentleboost_decision_stump(unsigned char *, char *, int , int ,  struct opts , double *);
 void gentleboost_perceptron(unsigned char *, char *, int , int ,  struct opts , double *);
@@ -329,6 +337,8 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 	options.lambda      = 1e-3;
 	options.max_ite     = 10;
 	options.transpose   = 0;
+	options.trimming    = 0.0;
+	options.trimming_period = 10;
 #ifdef OMP 
     options.num_threads = -1;
 #endif
@@ -437,6 +447,37 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 			options.Npremodel            =  mxGetN(mxtemp);
 		}
 
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			if((tmp[0] < 0.0) || (tmp[0] >= 1.0))
+			{
+				mexPrintf("0 <= trimming < 1, force to 0");
+				options.trimming          = 0.0;
+			}
+			else
+			{
+				options.trimming          = tmp[0];
+			}
+		}
+
+		mxtemp                            = mxGetField(prhs[2] , 0 , "trimming_period");
+		if(mxtemp != NULL)
+		{
+			tmp                           = mxGetPr(mxtemp);
+			tempint                       = (int) tmp[0];
+			if(tempint < 1)
+			{
+				mexPrintf("trimming_period > 0, force to 10");
+				options.trimming_period   = 10;
+			}
+			else
+			{
+				options.trimming_period   = tempint;
+			}
+		}
+
 		mxtemp                            = mxGetField( prhs[2] , 0, "transpose" );
 		if(mxtemp != NULL)
 		{
@@ -515,12 +556,17 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
 	int indN , Nd = N*d , ind , N1 = N - 1 , featuresIdx_opt;
 	int indM , indice ;
 	double *w , *wtemp ;
-	unsigned char *Xt, *xtemp;
+	unsigned char *Xt, *xtemp , *Xa = NULL , *Xs;
 	char *ytemp;
-	int *idX;
+	int *idX , *idXa = NULL , *idXs;
 	double atemp , btemp  , sumSw , Eyw , fm  , sumwyy , error , errormin, th_opt , a_opt , b_opt;
 	double Syw, Sw , temp;
 	int *indexF;
+	double trimming = options.trimming , mass , cteW;
+	int trimming_period = options.trimming_period , Na , Na1 , n;
+	double *wsort;
+	int *idw;
+	char *active;
 #ifdef OMP 
     int num_threads = options.num_threads;
     num_threads      = (num_threads == -1) ? min(MAX_THREADS,omp_get_num_procs()) : num_threads;
@@ -531,6 +577,15 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
     idX              = (int *)malloc(Nd*sizeof(int));
 	w                = (double *)malloc(N*sizeof(double));
 	indexF           = (int *)malloc(d*sizeof(int));
+	wsort            = (double *)malloc(N*sizeof(double));
+	idw              = (int *)malloc(N*sizeof(int));
+	active           = (char *)malloc(N*sizeof(char));
+	if(trimming > 0.0)
+	{
+		/* compacted presorted lists of the trimmed rounds, stride Na <= N */
+		Xa           = (unsigned char *)malloc(Nd*sizeof(unsigned char));
+		idXa         = (int *)malloc(Nd*sizeof(int));
+	}
 #ifdef OMP 
 
 #else
@@ -615,19 +670,75 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
 	indM  = 0;
 	for(t = 0 ; t < T ; t++)
 	{		
+		/* Weight trimming : restrict the stump search to the samples carrying (1 - trimming) of the weight mass */
+
+		if((trimming > 0.0) && (t % trimming_period))
+		{
+			Na                   = trim_weights(w , N , trimming , wsort , idw , active , &mass);
+			cteW                 = 1.0/mass;
+		}
+		else
+		{
+			for(i = 0 ; i < N ; i++)
+			{
+				active[i]        = 1;
+			}
+			Na                   = N;
+			cteW                 = 1.0;
+		}
+		Na1                      = Na - 1;
+
+		/* Presorted lists restricted to the active samples, filtered once per round : the stump search is then O(Na) per feature */
+
+		if(Na < N)
+		{
+#ifdef OMP 
+#pragma omp parallel for default(none) private(j,i,n,ind,indN,indice) shared(d,N,Na,indexF,idX,Xt,idXa,Xa,active)
+#endif
+			for(j = 0 ; j < d ; j++)
+			{
+				if(indexF[j] != -1)
+				{
+					indN             = j*N;
+					n                = j*Na;
+					for(i = 0 ; i < N ; i++)
+					{
+						ind          = i + indN;
+						indice       = idX[ind];
+						if(active[indice])
+						{
+							Xa[n]    = Xt[ind];
+							idXa[n]  = indice;
+							n++;
+						}
+					}
+				}
+			}
+			Xs                   = Xa;
+			idXs                 = idXa;
+		}
+		else
+		{
+			Xs                   = Xt;
+			idXs                 = idX;
+		}
+
 		Eyw              = 0.0;
 		sumwyy           = 0.0;
 		
 		for(i = 0 ; i < N ; i++)	
 		{
-			temp        = y[i]*w[i];
-			Eyw        += temp;
-			sumwyy     += y[i]*temp;			
+			if(active[i])
+			{
+				temp    = y[i]*w[i]*cteW;
+				Eyw    += temp;
+				sumwyy += y[i]*temp;
+			}
 		}
 		
 		errormin         = huge;
 #ifdef OMP 
-#pragma omp parallel  default(none) private(xtemp,ind,indice,ytemp,wtemp,j,i,atemp,error,Syw,Sw,indN,btemp) shared(d,N,N1,indexF,idX,Xt,w,y,Eyw,sumwyy,featuresIdx_opt,th_opt,a_opt,b_opt, errormin)
+#pragma omp parallel  default(none) private(xtemp,ind,indice,ytemp,wtemp,j,i,atemp,error,Syw,Sw,indN,btemp) shared(d,N,Na,Na1,cteW,indexF,idXs,Xs,w,y,Eyw,sumwyy,featuresIdx_opt,th_opt,a_opt,b_opt, errormin)
 #endif
 		{
 #ifdef OMP 
@@ -643,21 +754,21 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
 
 			for(j = 0 ; j < d  ; j++)	
 			{
-				indN         = j*N;
+				indN         = j*Na;
 				if(indexF[j] != -1)
 				{
-					for(i = 0 ; i < N ; i++)	
+					for(i = 0 ; i < Na ; i++)	
 					{
 						ind         = i + indN;
-						indice      = idX[ind];
-						xtemp[i]    = Xt[ind];
-						wtemp[i]    = w[indice];
+						indice      = idXs[ind];
+						xtemp[i]    = Xs[ind];
+						wtemp[i]    = w[indice]*cteW;
 						ytemp[i]    = y[indice];
 					}
 
 					Sw              = 0.0;	
 					Syw             = 0.0;
-					for(i = 0 ; i < N ; i++)	
+					for(i = 0 ; i < Na ; i++)	
 					{
 						Sw        += wtemp[i];
 						Syw       += ytemp[i]*wtemp[i];
@@ -679,7 +790,7 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
 							errormin        = error;
 							featuresIdx_opt = j;
 
-							if(i < N1)
+							if(i < Na1)
 							{	
 								th_opt     = (xtemp[i] + xtemp[i + 1])/2;	
 							}
@@ -738,6 +849,14 @@ void  gentleboost_decision_stump(unsigned char *X , char *y , int d , int N , st
 	free(idX);
 	free(w);
 	free(indexF);	
+	free(wsort);
+	free(idw);
+	free(active);
+	if(trimming > 0.0)
+	{
+		free(Xa);
+		free(idXa);
+	}
 
 #ifdef OMP
 
@@ -911,6 +1030,61 @@ void  gentleboost_perceptron(unsigned char *X , char *y , int d , int N , struct
 	free(indexF);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
+int trim_weights(double *w , int N , double trimming , double *wsort , int *idw , char *active , double *mass)
+{
+	/* Flag the samples with largest weights covering (1 - trimming) of the total weight mass.
+	   Return their number and their mass in mass */
+
+	int i , Na = 0;
+	double total = 0.0 , cum = 0.0 , target;
+
+	for(i = 0 ; i < N ; i++)
+	{
+		wsort[i]      = w[i];
+		idw[i]        = i;
+		active[i]     = 0;
+		total        += w[i];
+	}
+	qsindexw(wsort , idw , 0 , N - 1);
+
+	target            = (1.0 - trimming)*total;
+	for(i = N - 1 ; (i >= 0) && (cum < target) ; i--)
+	{
+		cum          += wsort[i];
+		active[idw[i]] = 1;
+		Na++;
+	}
+	*mass             = cum;
+	return Na;
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void qsindexw (double  *a, int *index , int lo, int hi)
+{
+    int i=lo, j=hi , ind;
+    double x=a[(lo+hi)/2] , h;
+
+    do
+    {    
+        while (a[i]<x) i++; 
+        while (a[j]>x) j--;
+        if (i<=j)
+        {
+            h        = a[i]; 
+			a[i]     = a[j]; 
+			a[j]     = h;
+			ind      = index[i];
+			index[i] = index[j];
+			index[j] = ind;
+            i++; 
+			j--;
+        }
+    }
+	while (i<=j);
+
+    if (lo<j) qsindexw(a , index , lo , j);
+    if (i<hi) qsindexw(a , index , i , hi);
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
 void qsindex (unsigned char  *a, int *index , int lo, int hi)
 {
 	/*  lo is the lower index, hi is the upper index
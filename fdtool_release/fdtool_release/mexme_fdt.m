@@ -58,7 +58,8 @@ try
         'mblbp' , 'mblbp_ada_weaklearner' , 'mblbp_adaboost_binary_train_cascade' , 'mblbp_adaboost_binary_predict_cascade' , 'mblbp_featlist' , 'mblbp_gentle_weaklearner' , 'mblbp_gentleboost_binary_train_cascade' , ...
         'mblbp_gentleboost_binary_predict_cascade'  , 'rgb2gray' , 'fast_rotate' ,...
         'haar_ada_weaklearner_memory', 'haar_adaboost_binary_predict_cascade_memory', 'haar_adaboost_binary_train_cascade_memory' , ...
-        'haar_gentle_weaklearner_memory' , 'haar_gentleboost_binary_predict_cascade_memory' , 'haar_gentleboost_binary_train_cascade_memory'};
+        'haar_gentle_weaklearner_memory' , 'haar_gentleboost_binary_predict_cascade_memory' , 'haar_gentleboost_binary_train_cascade_memory' , ...
+        'bootstrap_negatives_cascade'};
     
     files2 = {'int8tosparse' , 'fast_haar_ada_weaklearner' , 'fast_haar_adaboost_binary_train_cascade'};
     
@@ -124,7 +125,7 @@ try
                 strOMP = ' COMPFLAGS="$COMPFLAGS /Qopenmp" ';
             end
         else
-            strOMP     = ' CFLAGS="\$CFLAGS -fopenmp -Wall" LDFLAGS="\$LDFLAGS -fopenmp" ';
+            strOMP     = ' CFLAGS="\$CFLAGS -fopenmp -Wall" CXXFLAGS="\$CXXFLAGS -fopenmp -Wall" LDFLAGS="\$LDFLAGS -fopenmp" ';
         end
         
     end
@@ -182,7 +183,10 @@ try
             str = [str , '-output ' , name , '.' , options.ext , ' '];
         end
         
-        str                = [str , temp];
+        if(options.useOMP)
+            str            = [str , '-DOMP '];
+        end
+        str                = [str , temp , strOMP];
         
         disp(['compiling ' name])
         eval(['mex ' str])
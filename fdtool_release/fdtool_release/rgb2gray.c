@@ -6,13 +6,16 @@
   Usage
   ------
 
-  gray                                  = rgb2gray(rgb);
+  gray                                  = rgb2gray(rgb , [format]);
 
   
   Inputs
   -------
 
   rgb                                  RGB image (Ny x Nx x 3) in UINT8 format 
+                                       or YUY2 frame (2*Nx x Ny) in UINT8 format if format = 1, i.e. the raw camera buffer where
+                                       each column is one line Y0 U0 Y1 V0 Y2 U1 ...
+  format                               0 : RGB input (default), 1 : YUY2 input, gray is then the luma channel Y
    
 
   Outputs
@@ -30,6 +33,9 @@
 
   mex -DOMP -f mexopts_intel10.bat -output rgb2gray.dll rgb2gray.c
 
+  SSE2 kernels are used on x86/x64 targets, AVX2 ones if the compiler targets AVX2 (e.g. gcc -mavx2 or cl /arch:AVX2), 
+  otherwise a scalar loop with the same fixed-point arithmetic (same output on every target)
+
   mex -DOMP -f mexopts_intel10.bat -output rgb2gray.dll rgb2gray.c "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_core.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_c.lib" "C:\Program Files\Intel\Compiler\11.1\065\mkl\ia32\lib\mkl_intel_thread.lib" "C:\Program Files\Intel\Compiler\11.1\065\lib\ia32\libiomp5md.lib"
 
 
@@ -53,7 +59,8 @@
  -------  Date : 01/20/2009
 
   Changelog :  - Add OpenMP support
- ----------   
+ ----------   - Fixed-point (14 bits) RGB weights with SSE2/AVX2 kernels, output within 1 LSB of the double version
+              - Add YUY2 input (format = 1)
 
  Reference ""
 
@@ -68,19 +75,51 @@
  #include <omp.h>
 #endif
 
+#if defined(__AVX2__)
+ #define GRAY_AVX2
+ #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+ #define GRAY_SSE2
+ #include <emmintrin.h>
+#endif
+
+/* 0.298936021293776 , 0.587043074451121 , 0.114020904255103 in 1/2^GRAY_SHIFT units, sum = 2^GRAY_SHIFT */
+
+#define GRAY_SHIFT 14
+#define GRAY_WR    4898
+#define GRAY_WG    9618
+#define GRAY_WB    1868
+
+/* YUY2 frames are transposed by tiles of GRAY_TILE x GRAY_TILE pixels */
+
+#define GRAY_TILE  16
+
 /*-------------------------------------------------------------------------------------------------------------- */
 /* Function prototypes */
 
 void rgb2gray(unsigned char * , int , int  , unsigned char *);
+void yuy22gray(unsigned char * , int , int  , unsigned char *);
 /*-------------------------------------------------------------------------------------------------------------- */
 void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 {
 	unsigned char *rgb;
 	const int *dimsrgb;
 	int *dimsgray;
-	int numdimsrgb  , Ny , Nx;
+	int numdimsrgb  , Ny , Nx , format = 0;
     unsigned char *gray;
 
+    /* Input 2  */
+
+	if ((nrhs > 1) && !mxIsEmpty(prhs[1]))
+	{
+		format     = (int) mxGetScalar(prhs[1]);
+		if((format < 0) || (format > 1))
+		{
+			mexErrMsgTxt("format = {0,1}");	
+		}
+	}
+
     /* Input 1  */
 	
     
@@ -91,20 +130,32 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
 		
 		
 		rgb        = (unsigned char *)mxGetData(prhs[0]);
-		Ny         = dimsrgb[0];
-		Nx         = dimsrgb[1];
-		
-		if(numdimsrgb > 2)
+		if(format == 1)
 		{
-			if(dimsrgb[2] != 3)
+			if((numdimsrgb > 2) || (dimsrgb[0] % 2))
 			{		
-				mexErrMsgTxt("rgb must be (Ny x Nx x 3) in UINT8 format");	
+				mexErrMsgTxt("yuy2 must be (2*Nx x Ny) in UINT8 format");	
 			}
+			Ny     = dimsrgb[1];
+			Nx     = dimsrgb[0]/2;
 		}
 		else
-		{	
-			mexErrMsgTxt("rgb must be (Ny x Nx x 3) in UINT8 format");	
-		}		   
+		{
+			Ny         = dimsrgb[0];
+			Nx         = dimsrgb[1];
+
+			if(numdimsrgb > 2)
+			{
+				if(dimsrgb[2] != 3)
+				{		
+					mexErrMsgTxt("rgb must be (Ny x Nx x 3) in UINT8 format");	
+				}
+			}
+			else
+			{	
+				mexErrMsgTxt("rgb must be (Ny x Nx x 3) in UINT8 format");	
+			}		   
+		}
     }
 	else
 	{	
@@ -122,30 +173,161 @@ void mexFunction( int nlhs, mxArray *plhs[] , int nrhs, const mxArray *prhs[] )
     
     /*------------------------ Main Call ----------------------------*/
 	
-	rgb2gray(rgb , Ny , Nx , gray);
+	if(format == 1)
+	{
+		yuy22gray(rgb , Ny , Nx , gray);
+	}
+	else
+	{
+		rgb2gray(rgb , Ny , Nx , gray);
+	}
 
 	/*----------------- Free Memory --------------------------------*/
 		
 	mxFree(dimsgray);
 }
 /*----------------------------------------------------------------------------------------------------------------------------------------- */
+#ifdef GRAY_SSE2
+static __m128i gray_sse2(__m128i r , __m128i g , __m128i b)
+{
+	/* 16 pixels : (r,g) and (b,0) pairs of 16 bits weighted by pmaddwd into 32 bits, shifted and packed back to bytes */
+
+	__m128i zero = _mm_setzero_si128() , wrg = _mm_set1_epi32((GRAY_WG << 16) | GRAY_WR) , wb = _mm_set1_epi32(GRAY_WB);
+	__m128i r16 , g16 , b16 , q0 , q1 , lo , hi;
+
+	r16  = _mm_unpacklo_epi8(r , zero);
+	g16  = _mm_unpacklo_epi8(g , zero);
+	b16  = _mm_unpacklo_epi8(b , zero);
+	q0   = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r16 , g16) , wrg) , _mm_madd_epi16(_mm_unpacklo_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	q1   = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r16 , g16) , wrg) , _mm_madd_epi16(_mm_unpackhi_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	lo   = _mm_packs_epi32(q0 , q1);
+
+	r16  = _mm_unpackhi_epi8(r , zero);
+	g16  = _mm_unpackhi_epi8(g , zero);
+	b16  = _mm_unpackhi_epi8(b , zero);
+	q0   = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r16 , g16) , wrg) , _mm_madd_epi16(_mm_unpacklo_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	q1   = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r16 , g16) , wrg) , _mm_madd_epi16(_mm_unpackhi_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	hi   = _mm_packs_epi32(q0 , q1);
+
+	return _mm_packus_epi16(lo , hi);
+}
+#endif
+#ifdef GRAY_AVX2
+static __m256i gray_avx2(__m256i r , __m256i g , __m256i b)
+{
+	/* same as gray_sse2 on 32 pixels, unpacks and packs both work within 128 bits lanes so the pixel order is preserved */
+
+	__m256i zero = _mm256_setzero_si256() , wrg = _mm256_set1_epi32((GRAY_WG << 16) | GRAY_WR) , wb = _mm256_set1_epi32(GRAY_WB);
+	__m256i r16 , g16 , b16 , q0 , q1 , lo , hi;
+
+	r16  = _mm256_unpacklo_epi8(r , zero);
+	g16  = _mm256_unpacklo_epi8(g , zero);
+	b16  = _mm256_unpacklo_epi8(b , zero);
+	q0   = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r16 , g16) , wrg) , _mm256_madd_epi16(_mm256_unpacklo_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	q1   = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r16 , g16) , wrg) , _mm256_madd_epi16(_mm256_unpackhi_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	lo   = _mm256_packs_epi32(q0 , q1);
+
+	r16  = _mm256_unpackhi_epi8(r , zero);
+	g16  = _mm256_unpackhi_epi8(g , zero);
+	b16  = _mm256_unpackhi_epi8(b , zero);
+	q0   = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r16 , g16) , wrg) , _mm256_madd_epi16(_mm256_unpacklo_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	q1   = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r16 , g16) , wrg) , _mm256_madd_epi16(_mm256_unpackhi_epi16(b16 , zero) , wb)) , GRAY_SHIFT);
+	hi   = _mm256_packs_epi32(q0 , q1);
+
+	return _mm256_packus_epi16(lo , hi);
+}
+#endif
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
 void rgb2gray(unsigned char *rgb , int Ny , int Nx , unsigned char *gray)
 {
 	/* T    = inv([1.0 0.956 0.621; 1.0 -0.272 -0.647; 1.0 -1.106 1.703]);	 
 	 vect = T(1 , :);
+	 gray = (GRAY_WR*r + GRAY_WG*g + GRAY_WB*b) >> GRAY_SHIFT, the image is cut in blocks of 4096 pixels shared by the threads
 	 */
-	int i , NyNx = Ny*Nx , NyNx2 = 2*NyNx;
+	int i , i0 , i1 , NyNx = Ny*Nx , NyNx2 = 2*NyNx;
+	unsigned char *r = rgb , *g = rgb + NyNx , *b = rgb + NyNx2;
 
 #ifdef OMP 
-#pragma omp parallel private(i) shared(rgb,gray,NyNx) 
+#pragma omp parallel for default(none) private(i,i0,i1) shared(r,g,b,gray,NyNx) 
 #endif
+	for (i0 = 0 ; i0 < NyNx ; i0 += 4096)
 	{
+		i1        = (i0 + 4096 < NyNx) ? (i0 + 4096) : NyNx;
+		i         = i0;
+#ifdef GRAY_AVX2
+		for ( ; i + 32 <= i1 ; i += 32)
+		{
+			_mm256_storeu_si256((__m256i *)(gray + i) , gray_avx2(_mm256_loadu_si256((const __m256i *)(r + i)) , _mm256_loadu_si256((const __m256i *)(g + i)) , _mm256_loadu_si256((const __m256i *)(b + i))));
+		}
+#endif
+#ifdef GRAY_SSE2
+		for ( ; i + 16 <= i1 ; i += 16)
+		{
+			_mm_storeu_si128((__m128i *)(gray + i) , gray_sse2(_mm_loadu_si128((const __m128i *)(r + i)) , _mm_loadu_si128((const __m128i *)(g + i)) , _mm_loadu_si128((const __m128i *)(b + i))));
+		}
+#endif
+		for ( ; i < i1 ; i++)
+		{
+			gray[i]   = (unsigned char)((GRAY_WR*r[i] + GRAY_WG*g[i] + GRAY_WB*b[i]) >> GRAY_SHIFT);
+		}
+	}
+}
+/*----------------------------------------------------------------------------------------------------------------------------------------- */
+void yuy22gray(unsigned char *yuy2 , int Ny , int Nx , unsigned char *gray)
+{
+	/* gray(y , x) = yuy2(2*x , y) : luma bytes of each line, transposed by tiles of GRAY_TILE x GRAY_TILE.
+	   With SSE2, the 16 lumas of a tile line are packed from 32 bytes and the tile transposed by 4 passes of byte interleaving */
+
+	int x0 , y0 , x , y , Nx2 = 2*Nx;
+#ifdef GRAY_SSE2
+	__m128i a[GRAY_TILE] , t[GRAY_TILE] , mask = _mm_set1_epi16(0x00FF);
+	int l , k , pass;
+#endif
+
 #ifdef OMP 
-#pragma omp for nowait
+#ifdef GRAY_SSE2
+#pragma omp parallel for default(none) private(x0,y0,x,y,l,k,pass,a,t) shared(yuy2,gray,Ny,Nx,Nx2,mask) 
+#else
+#pragma omp parallel for default(none) private(x0,y0,x,y) shared(yuy2,gray,Ny,Nx,Nx2) 
+#endif
 #endif
-		for (i = 0 ; i  < NyNx ; i++)
+	for (y0 = 0 ; y0 < Ny ; y0 += GRAY_TILE)
+	{
+		for (x0 = 0 ; x0 < Nx ; x0 += GRAY_TILE)
 		{
-			gray[i]   = 0.298936021293776*rgb[i] + 0.587043074451121*rgb[i + NyNx] + 0.114020904255103*rgb[i + NyNx2];
+#ifdef GRAY_SSE2
+			if((y0 + GRAY_TILE <= Ny) && (x0 + GRAY_TILE <= Nx))
+			{
+				for (l = 0 ; l < GRAY_TILE ; l++)
+				{
+					a[l]  = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i *)(yuy2 + 2*x0 + (y0 + l)*Nx2)) , mask) , _mm_and_si128(_mm_loadu_si128((const __m128i *)(yuy2 + 2*x0 + 16 + (y0 + l)*Nx2)) , mask));
+				}
+				for (pass = 0 ; pass < 4 ; pass++)
+				{
+					for (k = 0 ; k < GRAY_TILE/2 ; k++)
+					{
+						t[2*k]     = _mm_unpacklo_epi8(a[k] , a[k + GRAY_TILE/2]);
+						t[2*k + 1] = _mm_unpackhi_epi8(a[k] , a[k + GRAY_TILE/2]);
+					}
+					for (k = 0 ; k < GRAY_TILE ; k++)
+					{
+						a[k]       = t[k];
+					}
+				}
+				for (x = 0 ; x < GRAY_TILE ; x++)
+				{
+					_mm_storeu_si128((__m128i *)(gray + y0 + (x0 + x)*Ny) , a[x]);
+				}
+				continue;
+			}
+#endif
+			for (x = x0 ; (x < x0 + GRAY_TILE) && (x < Nx) ; x++)
+			{
+				for (y = y0 ; (y < y0 + GRAY_TILE) && (y < Ny) ; y++)
+				{
+					gray[y + x*Ny] = yuy2[2*x + y*Nx2];
+				}
+			}
 		}
 	}
 }
@@ -52,6 +52,14 @@ function [options , model] = train_cascade(options)
 %                    usefa           Use previous False alarms to construct negatives (default usefa = 0)
 %                    scalemin        Minimum scaling factor to apply on negatives patch subwindows (default scalemin = 1)
 %                    scalemax        Maximum scaling factor to apply on negatives patch subwindows (default scalemax = 5)
+%                    usebootstrap    Mine negatives of stages > 1 with bootstrap_negatives_cascade (default usebootstrap = 1)
+%                    bootstrap_batch Number of negatives pictures scanned per call of bootstrap_negatives_cascade (default bootstrap_batch = 50)
+%                    maxperimage     Maximum number of negatives bootstrapped from the same picture (default maxperimage = 50)
+%                    checkpoint      MAT-file where the training is checkpointed (default checkpoint = '' <=> no checkpoint). 
+%                                    If this file exists, training resumes from it (see checkpoint_cascade function)
+%                    checkpoint_every Number of weaklearners trained between two checkpoints inside a stage. A checkpoint
+%                                    is also saved at the end of each stage (default checkpoint_every = 10).
+%                                    The data of the stage are saved once in [checkpoint , '.stage']
 %                    num_threads     Number of threads. If num_threads = -1, num_threads = number of core  (default num_threads = -1)
 %
 %  Outputs
@@ -310,6 +318,11 @@ if(nargin < 1)
     options.usefa              = 0;
     options.scalemin           = 1;
     options.scalemax           = 5;
+    options.usebootstrap       = 1;
+    options.bootstrap_batch    = 50;
+    options.maxperimage        = 50;
+    options.checkpoint         = '';
+    options.checkpoint_every   = 10;
     options.num_threads        = -1;
 end
 if(~any(strcmp(fieldnames(options) , 'positives_path')))
@@ -414,6 +427,21 @@ end
 if(~any(strcmp(fieldnames(options) , 'scalemax')))
     options.scalemax            = 5;
 end
+if(~any(strcmp(fieldnames(options) , 'usebootstrap')))
+    options.usebootstrap        = 1;
+end
+if(~any(strcmp(fieldnames(options) , 'bootstrap_batch')))
+    options.bootstrap_batch     = 50;
+end
+if(~any(strcmp(fieldnames(options) , 'maxperimage')))
+    options.maxperimage         = 50;
+end
+if(~any(strcmp(fieldnames(options) , 'checkpoint')))
+    options.checkpoint          = '';
+end
+if(~any(strcmp(fieldnames(options) , 'checkpoint_every')))
+    options.checkpoint_every    = 10;
+end
 
 
 ny                              = options.dimsItraining(1);
@@ -516,14 +544,49 @@ diffnodes                     = 0;
 
 nb_stage                      = 1;
 Xfa                           = zeros(ny , nx , 0);
+state                         = struct('Xfa' , Xfa);
+
+%% Resume from checkpoint eventually %%
+if(~isempty(options.checkpoint) && exist(options.checkpoint , 'file'))
+    ckpt                              = load(options.checkpoint , '-mat');
+    ckpt.options.checkpoint           = options.checkpoint;
+    ckpt.options.checkpoint_every     = options.checkpoint_every;
+    ckpt.options.num_threads          = options.num_threads;
+    ckpt.options.F                    = options.F;
+    if(any(strcmp(fieldnames(options) , 'G')))
+        ckpt.options.G                = options.G;
+    end
+    options                           = ckpt.options;
+    state                             = ckpt.state;
+    s                                 = RandStream.getDefaultStream;
+    s.State                           = ckpt.randstate;
+    nb_stage                          = length(options.m);
+    diffnodes                         = options.m(end);
+    if(any(strcmp(fieldnames(state) , 'Xfa')))
+        Xfa                           = state.Xfa;
+    end
+    fprintf('\nResume training from %s at stage %d\n' , options.checkpoint , nb_stage);
+end
 
 fprintf('\n--------------- > pd_cascade_theo(%d) = %5.4f\n'  , options.maxstage ,  prod(1-options.beta0));
 fprintf('--------------- > pfa_cascade_theo(%d) = %5.4f\n' , options.maxstage ,  prod(options.alpha0));
 
 %% Main loop %%
 while((diffnodes < options.maxwl_perstage) && (nb_stage <= options.maxstage))
-    [Xtrain , Xtest , stat]       = generate_data_cascade(options , Xfa);
-    [options , Xfa]               = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options);
+    if(any(strcmp(fieldnames(state) , 'wtrain')))
+        stage                     = load([options.checkpoint , '.stage'] , '-mat');
+        Xtrain                    = stage.Xtrain;
+        Xtest                     = stage.Xtest;
+        stat                      = state.stat;
+        clear stage
+    else
+        [Xtrain , Xtest , stat]   = generate_data_cascade(options , Xfa);
+        state                     = struct('stat' , stat);
+        if(~isempty(options.checkpoint))
+            checkpoint_cascade(options , [] , struct('Xtrain' , Xtrain , 'Xtest' , Xtest));
+        end
+    end
+    [options , Xfa]               = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options , state);
     options.stat(: , nb_stage)    = [stat(:) ; options.betaperstage(nb_stage) ; options.alphaperstage(nb_stage)];
     diffnodes                     = options.m(end);
     options.pfa_cascade(nb_stage) = prod(options.alphaperstage);
@@ -531,6 +594,10 @@ while((diffnodes < options.maxwl_perstage) && (nb_stage <= options.maxstage))
     fprintf('--------------- > pd_cascade(%d) = %5.4f\n'  , nb_stage ,  options.pd_cascade(nb_stage));
     fprintf('--------------- > pfa_cascade(%d) = %5.4f\n' , nb_stage ,  options.pfa_cascade(nb_stage));
     nb_stage                      = nb_stage + 1;
+    state                         = struct('Xfa' , Xfa);
+    if(~isempty(options.checkpoint))
+        checkpoint_cascade(options , state);
+    end
     drawnow
 end
 
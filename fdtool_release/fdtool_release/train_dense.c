@@ -2,6 +2,8 @@
 
 mex -D_DENSE_REP -f mexopts_intel10.bat -output train_dense.dll train_dense.c linear_model_matlab.c linear.cpp tron.cpp daxpy.c ddot.c dnrm2.c dscal.c
 
+mex -D_DENSE_REP -DOMP -f mexopts_intel10.bat -output train_dense.dll train_dense.c linear_model_matlab.c linear.cpp tron.cpp daxpy.c ddot.c dnrm2.c dscal.c  (with COMPFLAGS="$COMPFLAGS /Qopenmp")
+
 
 mex -D_DENSE_REP -DBLAS -f mexopts_intel10.bat -output train_dense.dll train_dense.c linear_model_matlab.c linear.cpp tron.cpp "C:\Program Files\MATLAB\R2009b\extern\lib\win32\microsoft\libmwblas.lib"
 
@@ -18,6 +20,27 @@ load C:\utilisateurs\SeBy\Matlab\scene_categorization\features\mlhmslbp_spyr.mat
 
 tic,model = train_dense(y',X,'-q -s 2 -c 1' , 'col');,toc
 
+
+Implicit homogeneous kernel map : with options.n > 0, model.w is the same as model = train_dense(y' , homkermap(X , options) , ...)
+but X is kept as (d x N) and psi(X) is interpolated from the homkertable during training (2n+1 times less memory)
+
+options.n          = 2;
+options.L          = 0.5;
+options.kerneltype = 2;
+tic,model = train_dense(y',X,'-q -s 2 -c 1' , 'col' , options);,toc
+
+
+Single or quantised (uint8/uint16) training_instance_matrix, used in place with 'col' (features = options.scale*X)
+
+options.scale      = 1/255;
+tic,model = train_dense(y',uint8(round(255*X)),'-q -s 2 -c 1' , 'col' , options);,toc
+
+
+Multicore training (compiled with -DOMP) : -n nr_thread, -1 for all the cores
+
+tic,model = train_dense(y',X,'-q -s 1 -c 1 -n -1' , 'col' , options);,toc
+
+
 */
 
 
@@ -27,7 +50,7 @@ tic,model = train_dense(y',X,'-q -s 2 -c 1' , 'col');,toc
 #include <string.h>
 #include <ctype.h>
 
-#ifdef BLAS
+#if defined(BLAS) || defined(OMP)
  #include <omp.h>
 #endif
 
@@ -41,6 +64,7 @@ typedef int mwIndex;
 #endif
 
 #define CMD_LEN 2048
+#define PI 3.14159265358979323846
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 #define INF HUGE_VAL
 
@@ -51,9 +75,9 @@ void (*liblinear_default_print_string) (const char *);
 void exit_with_help()
 {
 	mexPrintf(
-	"Usage: model = train(training_label_vector, training_instance_matrix, 'liblinear_options', 'col');\n"
+	"Usage: model = train(training_label_vector, training_instance_matrix, 'liblinear_options', 'col', [options]);\n"
 #ifdef _DENSE_REP
-	" ( warning : training_instance_matrix must be dense )\n"
+	" ( warning : training_instance_matrix must be dense, double, single, uint8 or uint16 )\n"
 #endif
 	"liblinear_options:\n"
 	"-s type : set type of solver (default 1)\n"
@@ -77,9 +101,18 @@ void exit_with_help()
 	"-B bias : if bias >= 0, instance x becomes [x; bias]; if < 0, no bias term added (default -1)\n"
 	"-wi weight: weights adjust the parameter C of different classes (see README for details)\n"
 	"-v n: n-fold cross validation mode\n"
+	"-n nr_thread : number of threads if compiled with OMP, -1 for all cores (default 1)\n"
+	"	-s 0, 1, 2 and 3 : each thread works on a block of features of the dense instances\n"
 	"-q : quiet mode (no outputs)\n"
 	"col:\n"
 	"	if 'col' is setted, training_instance_matrix is parsed in column format, otherwise is in row format\n"
+#ifdef _DENSE_REP
+	"	(in column format, training_instance_matrix is used in place without any copy)\n"
+	"options:\n"
+	"	feature values are options.scale*training_instance_matrix (default 1), e.g. for quantised uint8/uint16 histograms\n"
+	"	homogeneous kernel map applied implicitly to training_instance_matrix if options.n > 0\n"
+	"	(fields n, L, kerneltype, numsubdiv, minexponent, maxexponent, homtable as in homkermap/homkertable)\n"
+#endif
 	);
 }
 
@@ -89,7 +122,13 @@ struct problem prob;		/* set by read_problem */
 struct model *model_;
 
 #ifdef _DENSE_REP
-double *x_space;
+void *x_space;
+double xscale;
+struct homkermap hom;
+int hom_n;
+double hom_L;
+int hom_kerneltype;
+int hom_alloc;
 #else
 struct feature_node *x_space;
 #endif
@@ -132,6 +171,7 @@ int parse_command_line(int nrhs, const mxArray *prhs[], char *model_file_name)
 	param.nr_weight = 0;
 	param.weight_label = NULL;
 	param.weight = NULL;
+	param.nr_thread = 1;
 	cross_validation_flag = 0;
 	col_format_flag = 0;
 	bias = -1;
@@ -145,7 +185,7 @@ int parse_command_line(int nrhs, const mxArray *prhs[], char *model_file_name)
 	if(nrhs <= 1)
 		return 1;
 
-	if(nrhs == 4)
+	if(nrhs >= 4)
 	{
 		mxGetString(prhs[3], cmd, mxGetN(prhs[3])+1);
 		if(strcmp(cmd, "col") == 0)
@@ -198,6 +238,9 @@ int parse_command_line(int nrhs, const mxArray *prhs[], char *model_file_name)
 				param.weight_label[param.nr_weight-1] = atoi(&argv[i-1][2]);
 				param.weight[param.nr_weight-1] = atof(argv[i]);
 				break;
+			case 'n':
+				param.nr_thread = atoi(argv[i]);
+				break;
 			case 'q':
 				liblinear_print_string = &print_null;
 				i--;
@@ -217,26 +260,297 @@ int parse_command_line(int nrhs, const mxArray *prhs[], char *model_file_name)
 		else if(param.solver_type == L1R_L2LOSS_SVC || param.solver_type == L1R_LR)
 			param.eps = 0.01;
 	}
+#ifdef OMP
+	if(param.nr_thread == -1)
+		param.nr_thread = omp_get_num_procs();
+#else
+	param.nr_thread = 1;
+#endif
+	return 0;
+}
+
+#ifdef _DENSE_REP
+/* same table as homkertable.c */
+void homkertable(double *table)
+{
+	int n = hom_n, kerneltype = hom_kerneltype, numsubdiv = hom.numsubdiv, minexponent = hom.minexponent, maxexponent = hom.maxexponent;
+	double L = hom_L , subdiv = 1.0 / numsubdiv;
+	int exponent;
+	unsigned int i,j,co=0;
+	double x, logx, Lx, sqrtLx, Llogx, lambda ;
+	double kappa, kappa0 , sqrtkappa0, sqrt2kappa ;
+	double mantissa ;
+
+	if (kerneltype == 0)
+	{
+		kappa0          = 2.0/PI;
+		sqrtkappa0      = sqrt(kappa0) ;
+	}
+	else if (kerneltype == 1)
+	{
+		kappa0          = 2.0/log(4.0);
+		sqrtkappa0      = sqrt(kappa0) ;
+	}
+	else
+	{
+		sqrtkappa0      = 1.0 ;
+	}
+
+	for (exponent  = minexponent ; exponent <= maxexponent ; ++exponent) 
+	{
+		mantissa        = 1.0;
+		for (i = 0 ; i < numsubdiv ; ++i , mantissa += subdiv) 
+		{
+			x           = ldexp(mantissa, exponent);
+			Lx          = L * x ;
+			logx        = log(x);
+			sqrtLx      = sqrt(Lx);
+			Llogx       = L*logx;
+			table[co++] = (sqrtkappa0 * sqrtLx);
+
+			for (j = 1 ; j <= n ; ++j) 
+			{
+				lambda = j * L;
+				if (kerneltype == 0)
+				{
+					kappa   = kappa0 / (1.0 + 4.0*lambda*lambda) ;
+				}
+				else if (kerneltype == 1)
+				{
+					kappa   = kappa0 * 2.0 / (exp(PI * lambda) + exp(-PI * lambda)) / (1.0 + 4.0*lambda*lambda) ;
+				}
+				else
+				{
+					kappa   = 2.0 / (exp(PI * lambda) + exp(-PI * lambda)) ;
+				}
+				sqrt2kappa  = sqrt(2.0 * kappa)* sqrtLx ;
+				table[co++] = (sqrt2kappa * cos(j * Llogx)) ;
+				table[co++] = (sqrt2kappa * sin(j * Llogx)) ;
+			}
+		}
+	}
+}
+
+/* options : feature scale and implicit homogeneous kernel map, hom_n = 0 : no map */
+int parse_options(int nrhs, const mxArray *prhs[])
+{
+	mxArray *mxtemp;
+	int nhomtable;
+
+	hom_n = 0;
+	hom_L = 0.5;
+	hom_kerneltype = 0;
+	hom_alloc = 0;
+	hom.numsubdiv = 8;
+	hom.minexponent = -20;
+	hom.maxexponent = 8;
+	hom.table = NULL;
+	xscale = 1.0;
+
+	if((nrhs < 5) || mxIsEmpty(prhs[4]))
+		return 0;
+	if(!mxIsStruct(prhs[4]))
+	{
+		mexPrintf("options must be a structure\n");
+		return 1;
+	}
+	if((mxtemp = mxGetField(prhs[4], 0, "scale")) != NULL)
+		xscale = mxGetScalar(mxtemp);
+	if((mxtemp = mxGetField(prhs[4], 0, "n")) != NULL)
+		hom_n = (int) mxGetScalar(mxtemp);
+	if(hom_n <= 0)
+	{
+		hom_n = 0;
+		return 0;
+	}
+	if((mxtemp = mxGetField(prhs[4], 0, "L")) != NULL)
+		hom_L = mxGetScalar(mxtemp);
+	if((mxtemp = mxGetField(prhs[4], 0, "kerneltype")) != NULL)
+		hom_kerneltype = (int) mxGetScalar(mxtemp);
+	if((mxtemp = mxGetField(prhs[4], 0, "numsubdiv")) != NULL)
+		hom.numsubdiv = (int) mxGetScalar(mxtemp);
+	if((mxtemp = mxGetField(prhs[4], 0, "minexponent")) != NULL)
+		hom.minexponent = (int) mxGetScalar(mxtemp);
+	if((mxtemp = mxGetField(prhs[4], 0, "maxexponent")) != NULL)
+		hom.maxexponent = (int) mxGetScalar(mxtemp);
+	if((hom_L < 0.0) || (hom_kerneltype < 0) || (hom_kerneltype > 2) || (hom.numsubdiv < 1) || (hom.maxexponent <= hom.minexponent))
+	{
+		mexPrintf("L >= 0, kerneltype = {0,1,2}, numsubdiv > 0 and maxexponent > minexponent\n");
+		return 1;
+	}
+	hom.n1 = 2*hom_n + 1;
+	nhomtable = hom.n1*(hom.maxexponent - hom.minexponent + 1)*hom.numsubdiv;
+
+	mxtemp = mxGetField(prhs[4], 0, "homtable");
+	if(mxtemp != NULL)
+	{
+		if((int) mxGetNumberOfElements(mxtemp) != nhomtable)
+		{
+			mexPrintf("homtable must be (1 x (2*n+1)*(maxexponent - minexponent + 1)*numsubdiv)\n");
+			return 1;
+		}
+		hom.table = mxGetPr(mxtemp);
+	}
+	else
+	{
+		hom.table = Malloc(double, nhomtable);
+		hom_alloc = 1;
+		homkertable(hom.table);
+	}
 	return 0;
 }
 
+static void free_homkermap()
+{
+	if(hom_alloc)
+		free(hom.table);
+	hom_alloc = 0;
+	hom.table = NULL;
+}
+#endif
+
 static void fake_answer(mxArray *plhs[])
 {
 	plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
 }
 
-int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
+#ifdef _DENSE_REP
+/* dst (d x l) = src (l x d), both in the class of xtype */
+static void transpose_instances(const void *src, void *dst, int l, int d, int xtype)
 {
 	int i, j;
-#ifdef _DENSE_REP
-	mwIndex *ir, *jc;
-		
-	int x_space_idx , sample_idx;
 
+	switch(xtype)
+	{
+		case DENSE_SINGLE:
+			for(j=0;j<d;j++)
+				for(i=0;i<l;i++)
+					((float *)dst)[j + i*d] = ((const float *)src)[i + j*l];
+			break;
+		case DENSE_UINT8:
+			for(j=0;j<d;j++)
+				for(i=0;i<l;i++)
+					((unsigned char *)dst)[j + i*d] = ((const unsigned char *)src)[i + j*l];
+			break;
+		case DENSE_UINT16:
+			for(j=0;j<d;j++)
+				for(i=0;i<l;i++)
+					((unsigned short *)dst)[j + i*d] = ((const unsigned short *)src)[i + j*l];
+			break;
+		default:
+			for(j=0;j<d;j++)
+				for(i=0;i<l;i++)
+					((double *)dst)[j + i*d] = ((const double *)src)[i + j*l];
+			break;
+	}
+}
+
+/*
+ Instances are not copied : with 'col', prob.x[i] points to the i-th column of instance_mat (double, single,
+ uint8 or uint16), otherwise instance_mat is transposed once into x_space, in its own class. The bias is
+ handled by the solvers.
+*/
+int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
+{
+	int i, elsize, max_index, label_vector_row_num;
+	double *labels;
+	char *samples;
+
+	prob.x = NULL;
+	prob.y = NULL;
+	x_space = NULL;
+
+	switch(mxGetClassID(instance_mat))
+	{
+		case mxDOUBLE_CLASS:
+			prob.xtype = DENSE_DOUBLE;
+			elsize = sizeof(double);
+			break;
+		case mxSINGLE_CLASS:
+			prob.xtype = DENSE_SINGLE;
+			elsize = sizeof(float);
+			break;
+		case mxUINT8_CLASS:
+			prob.xtype = DENSE_UINT8;
+			elsize = sizeof(unsigned char);
+			break;
+		case mxUINT16_CLASS:
+			prob.xtype = DENSE_UINT16;
+			elsize = sizeof(unsigned short);
+			break;
+		default:
+			mexPrintf("Error: instance matrix must be double, single, uint8 or uint16\n");
+			return -1;
+	}
+
+	/* the number of instance */
+	if(col_format_flag)
+	{
+		prob.l = (int) mxGetN(instance_mat);
+		max_index = (int) mxGetM(instance_mat);
+	}
+	else
+	{
+		prob.l = (int) mxGetM(instance_mat);
+		max_index = (int) mxGetN(instance_mat);
+	}
+	label_vector_row_num = (int) mxGetM(label_vec);
+
+	if(label_vector_row_num!=prob.l)
+	{
+		mexPrintf("Length of label vector does not match # of instances.\n");
+		return -1;
+	}
+
+	labels = mxGetPr(label_vec);
+	samples = (char *) mxGetData(instance_mat);
+
+	prob.y = Malloc(int, prob.l);
+	prob.x = Malloc(void *, prob.l);
+	prob.bias = bias;
+	prob.xscale = xscale;
+
+	if(!col_format_flag)
+	{
+		x_space = malloc((size_t)elsize*max_index*prob.l);
+		if(x_space == NULL)
+		{
+			mexPrintf("Error: cannot transpose training instance matrix\n");
+			return -1;
+		}
+		transpose_instances(samples, x_space, prob.l, max_index, prob.xtype);
+		samples = (char *) x_space;
+	}
+
+	/* with the implicit kernel map, x[i] keeps the d bins and the n = d*(2n+1) features are computed on the fly */
+	prob.hom = NULL;
+	if(hom_n > 0)
+	{
+		hom.d = max_index;
+		prob.hom = &hom;
+	}
+
+	for(i=0;i<prob.l;i++)
+	{
+		prob.x[i] = samples + (size_t)i*max_index*elsize;
+		prob.y[i] = (int)labels[i];
+	}
+
+	if(prob.hom != NULL)
+		max_index *= hom.n1;
+	if(prob.bias>=0)
+		prob.n = max_index+1;
+	else
+		prob.n = max_index;
+
+	return 0;
+}
 #else
+int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
+{
+	int i, j;
 	int  k, low, high;
 	mwIndex *ir, *jc;
-#endif
 	int elements, max_index, label_vector_row_num , num_samples;
 	double *samples, *labels;
 	mxArray *instance_mat_col; /* instance sparse matrix in column format */
@@ -275,39 +589,6 @@ int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
 	labels = mxGetPr(label_vec);
 	samples = mxGetPr(instance_mat_col);
 
-#ifdef _DENSE_REP
-	max_index = (int) mxGetM(instance_mat_col);
-
-	if(bias >= 0)	  
-	  elements = (max_index + 1)*label_vector_row_num; /* with the bias */
-	else
-	  elements = max_index*label_vector_row_num; /* with the bias */
-
-	/* mexPrintf("elements : %i, max_index : %i \n", elements, max_index);  */
-	prob.y = Malloc(int, prob.l);
-	prob.x = Malloc(double *, prob.l);
-	x_space = Malloc(double, elements);
-	prob.bias = bias;
-
-	x_space_idx = 0; 
-	sample_idx  = 0;
-
-	for(i=0;i<prob.l;i++)
-        {
-	        prob.x[i] = &x_space[x_space_idx];
-		prob.y[i] = (int)labels[i];
-		
-		for(j=0;j<max_index;j++)
-		{
-	               x_space[x_space_idx++] = samples[sample_idx++];
-		}
-		if(prob.bias >= 0)
-		{
-                       x_space[x_space_idx++] = prob.bias;
-		}
-	}
-
-#else
 	ir = mxGetIr(instance_mat_col);
 	jc = mxGetJc(instance_mat_col);
 
@@ -342,7 +623,6 @@ int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
 		}
 		x_space[j++].index = -1;
 	}
-#endif
 	if(prob.bias>=0)
 		prob.n = max_index+1;
 	else
@@ -350,6 +630,7 @@ int read_problem_sparse(const mxArray *label_vec, const mxArray *instance_mat)
 
 	return 0;
 }
+#endif
 
 /* Interface function of matlab */
 /* now assume prhs[0]: label prhs[1]: features */
@@ -371,15 +652,23 @@ void mexFunction( int nlhs, mxArray *plhs[],
 */
 
 	/* Transform the input Matrix to libsvm format */
-	if(nrhs > 0 && nrhs < 5)
+	if(nrhs > 0 && nrhs < 6)
 	{
 		int err=0;
 
+#ifdef _DENSE_REP
+		if(!mxIsDouble(prhs[0])) {
+			mexPrintf("Error: label vector must be double\n");
+			fake_answer(plhs);
+			return;
+		}
+#else
 		if(!mxIsDouble(prhs[0]) || !mxIsDouble(prhs[1])) {
 			mexPrintf("Error: label vector and instance matrix must be double\n");
 			fake_answer(plhs);
 			return;
 		}
+#endif
 
 		if(parse_command_line(nrhs, prhs, NULL))
 		{
@@ -389,12 +678,21 @@ void mexFunction( int nlhs, mxArray *plhs[],
 			return;
 		}
 #ifdef _DENSE_REP
+		if(parse_options(nrhs, prhs))
+		{
+			exit_with_help();
+			destroy_param(&param);
+			free_homkermap();
+			fake_answer(plhs);
+			return;
+		}
 		if(!mxIsSparse(prhs[1]))
 			err = read_problem_sparse(prhs[0], prhs[1]);
 		else
 		{
 			mexPrintf("Training_instance_matrix must be dense\n");
 			destroy_param(&param);
+			free_homkermap();
 			fake_answer(plhs);
 			return;
 		}
@@ -421,6 +719,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
 			free(prob.y);
 			free(prob.x);
 			free(x_space);
+#ifdef _DENSE_REP
+			free_homkermap();
+#endif
 			fake_answer(plhs);
 			return;
 		}
@@ -445,6 +746,9 @@ void mexFunction( int nlhs, mxArray *plhs[],
 		free(prob.y);
 		free(prob.x);
 		free(x_space);
+#ifdef _DENSE_REP
+		free_homkermap();
+#endif
 	}
 	else
 	{
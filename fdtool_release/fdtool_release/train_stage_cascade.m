@@ -1,4 +1,4 @@
-function [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options)
+function [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options , state)
 %
 %
 %  Train model for a stage of the cascade
@@ -6,7 +6,7 @@ function [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest ,
 %  Usage
 %  -----
 %
-%  [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options)
+%  [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest , options , [state])
 %
 %
 %  Inputs
@@ -27,6 +27,11 @@ function [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest ,
 %
 %  options         Input options struture (see train_cascade function)
 %
+%  state           Training state of the current stage (see checkpoint_cascade function). If state contains
+%                  the field wtrain, boosting resumes from this state. state is saved with the current weights
+%                  and boosting variables every options.checkpoint_every weaklearners if options.checkpoint is
+%                  not empty (Xtrain and Xtest are saved once per stage by train_cascade)
+%
 %
 %  Outputs
 %  -------
@@ -45,19 +50,35 @@ function [options , Xfa] = train_stage_cascade(Xtrain , ytrain , Xtest , ytest ,
 %
 %
 
+if(nargin < 6)
+    state                    = struct('stat' , []);
+end
+if(~any(strcmp(fieldnames(options) , 'checkpoint')))
+    options.checkpoint       = '';
+end
+if(~any(strcmp(fieldnames(options) , 'checkpoint_every')))
+    options.checkpoint_every = 10;
+end
+resume                       = any(strcmp(fieldnames(state) , 'wtrain'));
+options.moments              = [];
+
 Ntrain                       = size(Xtrain , 3);
 Ntest                        = size(Xtest , 3);
 
 if(options.cascade_type == 1)
     if(options.typefeat == 0)
-        fxtrain              = eval_haar(Xtrain , options);
+        if(~resume)
+            fxtrain          = eval_haar(Xtrain , options);
+        end
         if(options.algoboost < 3)
             IItrain          = image_integral_standard(Xtrain);
         else
             Htrain           = haar(Xtrain , options);
         end
     elseif(options.typefeat == 1)
-        fxtrain              = eval_mblbp(Xtrain , options);
+        if(~resume)
+            fxtrain          = eval_mblbp(Xtrain , options);
+        end
         Htrain               = mblbp(Xtrain , options);
     end
     
@@ -66,9 +87,11 @@ if(options.cascade_type == 1)
     indptrain                =(ytrain == 1);
     indntrain                = ~indptrain;
     
-    wtrain                   = zeros(1 , Ntrain);
-    wtrain(indptrain)        = exp(-(fxtrain(indptrain) + ctelambda))/options.Npostrain;
-    wtrain(indntrain)        = exp(fxtrain(indntrain)  + ctelambda)/options.Nnegtrain;
+    if(~resume)
+        wtrain               = zeros(1 , Ntrain);
+        wtrain(indptrain)    = exp(-(fxtrain(indptrain) + ctelambda))/options.Npostrain;
+        wtrain(indntrain)    = exp(fxtrain(indntrain)  + ctelambda)/options.Nnegtrain;
+    end
     
 elseif(options.cascade_type == 0)
     if(options.typefeat == 0)
@@ -105,6 +128,20 @@ current_stage                 = length(options.m);
 alpha0                        = options.alpha0(current_stage);
 beta0                         = options.beta0(current_stage);
 
+if(resume)
+    wtrain                    = state.wtrain;
+    alpham                    = state.alpham;
+    betam                     = state.betam;
+    alphaold                  = state.alphaold;
+    betaold                   = state.betaold;
+    K                         = state.K;
+    m                         = state.m;
+    cascade_old               = state.cascade_old;
+    threshold                 = state.threshold;
+    indfa                     = state.indfa;
+    fprintf('stage %d/%d, resume at m = %d\n' , current_stage , options.maxstage , m);
+end
+
 while( (m < options.maxwl_perstage) && ~((alpham < alpha0) && (betam < beta0)) )
     m                            = m + 1;
     wtrain                       = wtrain/sum(wtrain);
@@ -116,7 +153,7 @@ while( (m < options.maxwl_perstage) && ~((alpham < alpha0) && (betam < beta0)) )
         elseif (options.algoboost == 1)
             [hm , wnew]          = haar_ada_weaklearner(IItrain , ytrain , wtrain , options);
         elseif (options.algoboost == 2)
-            [hm , wnew]          = fast_haar_ada_weaklearner(IItrain , ytrain , wtrain , options);
+            [hm , wnew , options.moments] = fast_haar_ada_weaklearner(IItrain , ytrain , wtrain , options);
         elseif (options.algoboost == 3)
             [hm , wnew]          = haar_gentle_weaklearner_memory(Htrain , ytrain , wtrain , options);
         else
@@ -218,6 +255,20 @@ while( (m < options.maxwl_perstage) && ~((alpham < alpha0) && (betam < beta0)) )
     wtrain                      = wnew;
     options.indexF(hm(1))       = -1;
     
+    if(~isempty(options.checkpoint) && (mod(m , options.checkpoint_every) == 0))
+        state.wtrain            = wtrain;
+        state.alpham            = alpham;
+        state.betam             = betam;
+        state.alphaold          = alphaold;
+        state.betaold           = betaold;
+        state.K                 = K;
+        state.m                 = m;
+        state.cascade_old       = cascade_old;
+        state.threshold         = threshold;
+        state.indfa             = indfa;
+        checkpoint_cascade(options , state);
+    end
+    
     fprintf('stage %d/%d, m = %d, alpham = %5.4f\n' , current_stage , options.maxstage , m ,  alpham);
     fprintf('stage %d/%d, m = %d, betam = %5.4f\n'  , current_stage , options.maxstage , m ,  betam);
     drawnow